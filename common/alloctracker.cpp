@@ -0,0 +1,423 @@
+#include "alloctracker.h"
+#include "profiler.h"
+#include "stacktrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>     // _aligned_malloc
+#endif
+
+using namespace ogle;
+
+#ifdef OGLE_ALLOC_TRACKER
+
+#if defined(_MSC_VER)
+#define OGLE_NOINLINE __declspec(noinline)
+#else
+#define OGLE_NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+    std::atomic<uint64_t> TotalAllocations(0);
+    std::atomic<uint64_t> TotalFrees(0);
+    std::atomic<uint64_t> TotalBytes(0);
+
+    thread_local uint64_t ThreadAllocations = 0;
+    thread_local uint64_t ThreadFrees = 0;
+    thread_local uint64_t ThreadBytes = 0;
+    // AllocTracker::Untracked scopes open on the thread
+    thread_local int UntrackedDepth = 0;
+
+    // the stack table must not allocate, and capturing a stack must not recurse into it
+    thread_local bool InsideHook = false;
+
+    const int StackDepth = 16;
+    // recordStack, allocate, operator new
+    const int HookFrames = 3;
+    const unsigned int StackTableSize = 1024;
+
+    struct StackEntry
+    {
+        uint64_t Hash;      // 0 marks an empty entry
+        int Depth;
+        void* Frames[StackDepth];
+        uint64_t Count;
+        uint64_t Bytes;
+    };
+
+    StackEntry Stacks[StackTableSize];
+    std::atomic_flag StackLock = ATOMIC_FLAG_INIT;
+    std::atomic<bool> Capturing(false);
+    std::atomic<uint64_t> StacksDropped(0);
+
+    OGLE_NOINLINE void recordStack(size_t size)
+    {
+        if (InsideHook)
+            return;
+        InsideHook = true;
+
+        void* frames[StackDepth];
+        int depth = StackTrace::capture(frames, StackDepth, HookFrames);
+
+        // FNV-1a over the return addresses
+        uint64_t hash = 14695981039346656037ull;
+        for (int i=0; i<depth; ++i) {
+            hash ^= (uint64_t)(uintptr_t)frames[i];
+            hash *= 1099511628211ull;
+        }
+        if (hash == 0)
+            hash = 1;
+
+        bool stored = false;
+        while (StackLock.test_and_set(std::memory_order_acquire)) {}
+        for (unsigned int probe=0; probe<StackTableSize; ++probe) {
+            StackEntry& entry = Stacks[(hash + probe) % StackTableSize];
+            if (entry.Hash == 0) {
+                entry.Hash = hash;
+                entry.Depth = depth;
+                memcpy(entry.Frames, frames, depth * sizeof(void*));
+            }
+            if (entry.Hash == hash) {
+                entry.Count++;
+                entry.Bytes += size;
+                stored = true;
+                break;
+            }
+        }
+        StackLock.clear(std::memory_order_release);
+
+        if (!stored)
+            StacksDropped.fetch_add(1, std::memory_order_relaxed);
+        InsideHook = false;
+    }
+
+    inline void count(size_t size)
+    {
+        if (UntrackedDepth > 0)
+            return;
+        TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+        TotalBytes.fetch_add(size, std::memory_order_relaxed);
+        ThreadAllocations++;
+        ThreadBytes += size;
+    }
+
+    inline void countFree(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+        TotalFrees.fetch_add(1, std::memory_order_relaxed);
+        ThreadFrees++;
+    }
+
+    OGLE_NOINLINE void* allocate(size_t size)
+    {
+        if (size == 0)
+            size = 1;
+
+        void* ptr = nullptr;
+        while ((ptr = malloc(size)) == nullptr) {
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+
+        count(size);
+        if (Capturing.load(std::memory_order_relaxed) && UntrackedDepth == 0)
+            recordStack(size);
+        return ptr;
+    }
+
+    OGLE_NOINLINE void* allocateAligned(size_t size, size_t alignment)
+    {
+        if (size == 0)
+            size = 1;
+
+        void* ptr = nullptr;
+        while (true) {
+#ifdef _WIN32
+            ptr = _aligned_malloc(size, alignment);
+#else
+            if (posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size) != 0)
+                ptr = nullptr;
+#endif
+            if (ptr != nullptr)
+                break;
+
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+
+        count(size);
+        if (Capturing.load(std::memory_order_relaxed) && UntrackedDepth == 0)
+            recordStack(size);
+        return ptr;
+    }
+
+    void release(void* ptr)
+    {
+        countFree(ptr);
+        free(ptr);
+    }
+
+    void releaseAligned(void* ptr)
+    {
+        countFree(ptr);
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, (size_t)alignment); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return allocateAligned(size, (size_t)alignment); } catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return allocateAligned(size, (size_t)alignment); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { releaseAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(ptr); }
+
+#endif // OGLE_ALLOC_TRACKER
+
+namespace {
+    // frame bookkeeping, only touched by the thread calling endFrame()
+    struct FrameState
+    {
+        AllocCounts FrameStart;
+        AllocCounts LastFrame;
+        unsigned int FrameNumber;
+        unsigned int SteadyFrames;
+        unsigned int AllocatingFrames;
+        uint64_t SteadyAllocations;
+        uint64_t SteadyBytes;
+        uint64_t MaxAllocations;
+
+        FrameState()
+            : FrameNumber(0)
+            , SteadyFrames(0)
+            , AllocatingFrames(0)
+            , SteadyAllocations(0)
+            , SteadyBytes(0)
+            , MaxAllocations(0)
+        {}
+    };
+
+    FrameState Frames;
+}
+
+AllocCounts::AllocCounts()
+    : Allocations(0)
+    , Frees(0)
+    , Bytes(0)
+{
+
+}
+
+bool AllocTracker::compiledIn()
+{
+#ifdef OGLE_ALLOC_TRACKER
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocCounts AllocTracker::total()
+{
+    AllocCounts counts;
+#ifdef OGLE_ALLOC_TRACKER
+    counts.Allocations = TotalAllocations.load(std::memory_order_relaxed);
+    counts.Frees = TotalFrees.load(std::memory_order_relaxed);
+    counts.Bytes = TotalBytes.load(std::memory_order_relaxed);
+#endif
+    return counts;
+}
+
+AllocCounts AllocTracker::thread()
+{
+    AllocCounts counts;
+#ifdef OGLE_ALLOC_TRACKER
+    counts.Allocations = ThreadAllocations;
+    counts.Frees = ThreadFrees;
+    counts.Bytes = ThreadBytes;
+#endif
+    return counts;
+}
+
+void AllocTracker::captureStacks(bool capture)
+{
+#ifdef OGLE_ALLOC_TRACKER
+    if (capture)
+        StackTrace::warmup();
+    Capturing = capture;
+#endif
+}
+
+void AllocTracker::endFrame()
+{
+    if (!compiledIn())
+        return;
+
+    AllocCounts now = total();
+    Frames.LastFrame.Allocations = now.Allocations - Frames.FrameStart.Allocations;
+    Frames.LastFrame.Frees = now.Frees - Frames.FrameStart.Frees;
+    Frames.LastFrame.Bytes = now.Bytes - Frames.FrameStart.Bytes;
+    Frames.FrameStart = now;
+    Frames.FrameNumber++;
+
+    Profiler::counter("allocations", (double)Frames.LastFrame.Allocations);
+    Profiler::counter("allocated bytes", (double)Frames.LastFrame.Bytes);
+
+    if (Frames.FrameNumber == WarmupFrames) {
+        captureStacks(true);
+    }
+    else if (Frames.FrameNumber > WarmupFrames) {
+        Frames.SteadyFrames++;
+        Frames.SteadyAllocations += Frames.LastFrame.Allocations;
+        Frames.SteadyBytes += Frames.LastFrame.Bytes;
+        Frames.MaxAllocations = std::max(Frames.MaxAllocations, Frames.LastFrame.Allocations);
+        if (Frames.LastFrame.Allocations > 0)
+            Frames.AllocatingFrames++;
+    }
+}
+
+AllocCounts AllocTracker::lastFrame()
+{
+    return Frames.LastFrame;
+}
+
+void AllocTracker::printSummary(size_t stackCount)
+{
+    if (!compiledIn())
+        return;
+
+    AllocCounts counts = total();
+    std::cout << "\nAllocTracker: " << counts.Allocations << " allocations, " << counts.Frees << " frees, "
+              << counts.Bytes << " bytes in total\n";
+    if (Frames.SteadyFrames > 0) {
+        std::cout << "steady state (after " << WarmupFrames << " frames): "
+                  << Frames.AllocatingFrames << " of " << Frames.SteadyFrames << " frames allocated, "
+                  << std::fixed << std::setprecision(1)
+                  << (double)Frames.SteadyAllocations / Frames.SteadyFrames << " allocations and "
+                  << (double)Frames.SteadyBytes / Frames.SteadyFrames << " bytes per frame, worst frame "
+                  << Frames.MaxAllocations << " allocations\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+#ifdef OGLE_ALLOC_TRACKER
+    // copy out under the lock, symbolizing allocates
+    std::vector<StackEntry> entries;
+    bool was_capturing = Capturing.exchange(false);
+    while (StackLock.test_and_set(std::memory_order_acquire)) {}
+    for (unsigned int i=0; i<StackTableSize; ++i) {
+        if (Stacks[i].Hash != 0)
+            entries.push_back(Stacks[i]);
+    }
+    StackLock.clear(std::memory_order_release);
+
+    std::sort(entries.begin(), entries.end(),
+        [](const StackEntry& a, const StackEntry& b) {
+            return a.Count > b.Count;
+        });
+
+    if (!entries.empty())
+        std::cout << "top allocating call stacks since steady state:\n";
+    for (size_t i=0; i<entries.size() && i<stackCount; ++i) {
+        const StackEntry& entry = entries[i];
+        std::cout << "  " << entry.Count << " allocations, " << entry.Bytes << " bytes\n";
+        for (int f=0; f<entry.Depth; ++f)
+            std::cout << "\t" << StackTrace::symbolize(StackTrace::callSite(entry.Frames[f])) << "\n";
+    }
+    if (StacksDropped.load() > 0)
+        std::cout << "  (" << StacksDropped.load() << " allocations had no room left in the stack table)\n";
+
+    Capturing = was_capturing;
+#endif
+    std::cout << std::endl;
+}
+
+AllocTracker::Untracked::Untracked()
+{
+#ifdef OGLE_ALLOC_TRACKER
+    UntrackedDepth++;
+#endif
+}
+
+AllocTracker::Untracked::~Untracked()
+{
+#ifdef OGLE_ALLOC_TRACKER
+    UntrackedDepth--;
+#endif
+}
+
+AllocTracker::Untracked::Untracked(const Untracked& other)
+{
+
+}
+
+AllocTracker::Untracked& AllocTracker::Untracked::operator=(const Untracked& other)
+{
+    return *this;
+}
+
+AllocTracker::AllocTracker()
+{
+
+}
+
+AllocTracker::~AllocTracker()
+{
+
+}
+
+AllocTracker::AllocTracker(const AllocTracker& other)
+{
+
+}
+
+AllocTracker& AllocTracker::operator=(const AllocTracker& other)
+{
+    return *this;
+}
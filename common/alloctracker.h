@@ -0,0 +1,91 @@
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+/****************************************************************
+
+    Counts heap allocations made through operator new, to find
+    and keep out allocations in per frame code.
+
+    Configure with -DOGLE_ALLOC_TRACKER=ON to replace the global
+    operator new/delete. Without it every function here still
+    exists, compiledIn() is false and all counts stay 0, so the
+    calls can stay in the experiments.
+
+    Counts are kept per process and per thread:
+        - Profiler zones record what their thread allocated
+          between push and pop, printed next to the zone times.
+        - Profiler::endFrame() calls AllocTracker::endFrame(),
+          which pushes allocations and bytes of the frame as
+          profiler counters. After WarmupFrames frames the
+          program is considered to be in a steady state: frames
+          that still allocate are counted, and the call stacks
+          of their allocations are recorded so printSummary()
+          can show the worst offenders.
+        - BenchmarkConfig::AssertNoAllocations fails a benchmark
+          whose measured iterations allocate.
+
+    Allocations made while an AllocTracker::Untracked is alive on
+    the thread aren't counted, the profiler uses it for its trace
+    and summary, which grow in steady state frames by design.
+
+    malloc() called directly (C libraries, the GL driver) is not
+    counted.
+
+****************************************************************/
+
+#include <cstdint>
+#include <cstddef>
+
+namespace ogle
+{
+    struct AllocCounts
+    {
+        AllocCounts();
+
+        uint64_t Allocations;
+        uint64_t Frees;
+        uint64_t Bytes;     // requested, freed bytes aren't known
+    };
+
+    class AllocTracker
+    {
+    public:
+        static constexpr unsigned int WarmupFrames = 30;
+
+        static bool compiledIn();
+
+        /** everything allocated since the program started */
+        static AllocCounts total();
+        /** what the calling thread allocated since it started */
+        static AllocCounts thread();
+
+        /** record call stacks of every allocation, steady state frames turn this on by themselves */
+        static void captureStacks(bool capture);
+
+        static void endFrame();
+        static AllocCounts lastFrame();
+
+        /** steady state frame statistics and the stacks that allocated most often */
+        static void printSummary(size_t stackCount = 10);
+
+        /** allocations of the creating thread aren't counted while one is alive, frees still are */
+        class Untracked
+        {
+        public:
+            Untracked();
+            ~Untracked();
+
+        private:
+            Untracked(const Untracked& other);
+            Untracked& operator=(const Untracked& other);
+        };
+
+    private:
+        AllocTracker();
+        ~AllocTracker();
+        AllocTracker(const AllocTracker& other);
+        AllocTracker& operator=(const AllocTracker& other);
+    };
+}
+
+#endif // ALLOCTRACKER_H
@@ -0,0 +1,320 @@
+#include "application.h"
+#include "alloctracker.h"
+#include "debug.h"
+#include "glintercept.h"
+#include "gpumemory.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "residency.h"
+#include "shadersource.h"
+#include "startup.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+using namespace ogle;
+
+namespace {
+    void closeOnEscape(GLFWwindow* window, int key, int scancode, int action, int mods)
+    {
+        if ((key == GLFW_KEY_ESCAPE) && action == GLFW_PRESS)
+            glfwSetWindowShouldClose(window, GL_TRUE);
+    }
+
+    std::string describe(const ContextConfig& config)
+    {
+        std::string text = std::to_string(config.MajorVersion) + "." + std::to_string(config.MinorVersion);
+        if (config.ForwardCompatible)
+            text += " forward compatible";
+        if (config.Debug)
+            text += " debug";
+        return text;
+    }
+}
+
+Application::Application(const std::string& name)
+    : Name(name)
+    , BenchmarkByDefault(false)
+    , Method(0)
+    , Benchmarking(false)
+    , Collector(nullptr)
+{
+    Config.Name = name;
+}
+
+Application::~Application()
+{
+
+}
+
+int Application::run(int argc, char* argv[])
+{
+    Startup::phase("command line");
+    if (!parseCommandLine(argc, argv)) {
+        Options.printUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+    if (Options.has("help")) {
+        Options.printUsage(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    Startup::phase("data dir");
+    // get base directory for reading in files
+    std::string path = Options.program();
+    std::replace(path.begin(), path.end(), '\\', '/');
+    size_t dir_idx = path.rfind("/")+1;
+    std::string exe_dir = path.substr(0, dir_idx);
+    std::string exe_name = path.substr(dir_idx);
+    DataDir = exe_dir + "../data/" + exe_name + "/";
+    // shaders every experiment may #include
+    ShaderSource::setIncludeDirectories({ exe_dir + "../data/common/" });
+
+    std::string program_cache = Options.value("program-cache", exe_dir + "../program_cache/");
+    ProgramCache::init(program_cache == "off" ? "" : program_cache);
+
+    if (!load())
+        return EXIT_FAILURE;
+
+    // a benchmark measures the frames, not the display's refresh, and ends when they are done
+    if (Benchmarking) {
+        Config.SwapInterval = 0;
+        Config.HeadlessFrames = 0;
+    }
+
+    // the suite's context outlives this run, it only has to look like a new one
+    bool owns_context = !Context::initialized();
+    Startup::phase("context");
+    if (owns_context) {
+        if (!Context::init(Config))
+            return EXIT_FAILURE;
+        Startup::phase("debug");
+        Debug::init();
+    }
+    else {
+        Context::reset(Config);
+        // reset() removed the debug callback with the rest of the state
+        Debug::init();
+
+        // results from a context that isn't the one asked for say so
+        const ContextConfig& shared = Context::created();
+        if (shared.MajorVersion != Config.MajorVersion || shared.MinorVersion != Config.MinorVersion ||
+            shared.ForwardCompatible != Config.ForwardCompatible || shared.Debug != Config.Debug)
+            Benchmark.Params["context"] = describe(shared);
+    }
+    Context::setKeyCallback(closeOnEscape);
+
+    Startup::phase("profiler");
+    Profiler::init(TraceFile);
+    GLIntercept::init();
+    Residency::init(Memory);
+
+    bool succeeded = init();
+    if (succeeded) {
+        Startup::phase("first frame");
+        if (Benchmarking) {
+            succeeded = runBenchmarks();
+        }
+        else {
+            setMethod(Method);
+            runloop();
+        }
+    }
+    else {
+        std::cerr << "[!] Application: " << Name << " failed to initialize" << std::endl;
+    }
+
+    shutdown();
+    ProgramCache::shutdown();
+    Residency::printSummary();
+    // after the experiment deleted its resources, only the copies of evicted ones are left
+    Residency::shutdown();
+
+    GLIntercept::printSummary();
+    GLIntercept::shutdown();
+    AllocTracker::printSummary();
+    GpuMemory::printSummary();
+    ProgramCache::printSummary();
+    Profiler::printSummary();
+    Profiler::shutdown();
+    if (owns_context) {
+        Debug::shutdown();
+        Context::shutdown();
+    }
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void Application::collectResults(BenchmarkRunner* runner)
+{
+    Collector = runner;
+}
+
+bool Application::load()
+{
+    return true;
+}
+
+void Application::endFrame()
+{
+
+}
+
+void Application::shutdown()
+{
+
+}
+
+void Application::setMethod(size_t method)
+{
+
+}
+
+void Application::setSize(int width, int height)
+{
+    Config.Width = width;
+    Config.Height = height;
+}
+
+const std::string& Application::dataDirectory() const
+{
+    return DataDir;
+}
+
+const CommandLine& Application::commandLine() const
+{
+    return Options;
+}
+
+size_t Application::method() const
+{
+    return Method;
+}
+
+bool Application::benchmarking() const
+{
+    return Benchmarking;
+}
+
+bool Application::parseCommandLine(int argc, char* argv[])
+{
+    if (!Options.parse(argc, argv))
+        return false;
+
+    if (Options.has("method")) {
+        std::string name = Options.value("method");
+        auto found = std::find(Methods.begin(), Methods.end(), name);
+        if (found == Methods.end()) {
+            std::cerr << "[!] Application: " << Name << " has no method \"" << name << "\", it has:";
+            for (const auto& m : Methods)
+                std::cerr << " " << m;
+            std::cerr << std::endl;
+            return false;
+        }
+        Method = found - Methods.begin();
+    }
+
+    int width = 0;
+    int height = 0;
+    if (!Options.size(width, height))
+        return false;
+    if (Options.has("size")) {
+        setSize(width, height);
+        Benchmark.Params["size"] = std::to_string(width) + "x" + std::to_string(height);
+    }
+
+    if (!Options.unsignedValue("frames", Benchmark.Iterations) || !Options.unsignedValue("warmup", Benchmark.WarmupIterations))
+        return false;
+
+    unsigned int budget = 0;
+    if (!Options.unsignedValue("vram-budget", budget))
+        return false;
+    if (budget > 0) {
+        Memory.BudgetBytes = (size_t)budget * 1024 * 1024;
+        Benchmark.Params["vram_budget"] = std::to_string(budget);
+    }
+
+    JsonFile = Options.value("json", JsonFile);
+    Benchmarking = BenchmarkByDefault || Options.has("frames") || Options.has("json");
+    return true;
+}
+
+void Application::runloop()
+{
+    while (!Context::shouldClose()){
+        Profiler::beginFrame();
+        frame();
+        {
+            OGLE_PROFILE_ZONE("swap");
+            Context::swapBuffers();
+        }
+        Startup::firstFrame();
+        Context::pollEvents();
+        endFrame();
+        GLIntercept::endFrame();
+        Profiler::endFrame();
+    }
+}
+
+bool Application::runBenchmarks()
+{
+    std::vector<size_t> methods;
+    if (Methods.empty() || Options.has("method")) {
+        methods.push_back(Method);
+    }
+    else {
+        for (size_t i=0; i<Methods.size(); ++i)
+            methods.push_back(i);
+    }
+
+    // built once, nothing in the measured frames may allocate on the runner's behalf
+    BenchmarkRunner::Callback measured = [this](){
+        Profiler::beginFrame();
+        frame();
+    };
+    BenchmarkRunner::Callback untimed = [this](){
+        {
+            OGLE_PROFILE_ZONE("swap");
+            Context::swapBuffers();
+        }
+        Startup::firstFrame();
+        Context::pollEvents();
+        endFrame();
+        GLIntercept::endFrame();
+        Profiler::endFrame();
+    };
+
+    BenchmarkRunner runner;
+    for (size_t m : methods) {
+        Method = m;
+        setMethod(m);
+
+        BenchmarkConfig config = Benchmark;
+        config.Name = Name;
+        if (!Methods.empty()) {
+            config.Name += " " + Methods[m];
+            config.Params["method"] = Methods[m];
+        }
+        runner.run(config, measured, untimed);
+    }
+
+    runner.printResults();
+    if (Collector) {
+        for (const auto& result : runner.results())
+            Collector->add(result);
+    }
+    else if (!JsonFile.empty()) {
+        runner.writeJson(JsonFile);
+    }
+    return !runner.failed();
+}
+
+Application::Application(const Application& other)
+{
+
+}
+
+Application& Application::operator=(const Application& other)
+{
+    return *this;
+}
@@ -0,0 +1,136 @@
+#ifndef APPLICATION_H
+#define APPLICATION_H
+
+/****************************************************************
+
+    What every experiment's main() used to copy: the data
+    directory, the context, Debug/Profiler/GLIntercept, the
+    runloop and the summaries at shutdown. An experiment fills in
+    Config and friends in its constructor and implements init()
+    and frame(), and ends with
+        OGLE_APPLICATION(RoundTrip)
+    which is main() in the experiment's executable and the entry
+    point of its module when built for the suite (OGLE_MODULE,
+    see experiments/suite). When a context already exists, the
+    suite's, run() resets it for this experiment and leaves it
+    up afterwards instead of creating and destroying its own.
+
+    Without options it runs until the window is closed. With
+    --frames N (or --json, or BenchmarkByDefault) it runs as a
+    benchmark instead: BenchmarkRunner times --warmup frames it
+    throws away and N it keeps, CPU and GPU, per method, prints
+    the results, writes them to --json and exits. N = 0 measures
+    for Benchmark.TimeBudget seconds. Benchmarks run with vsync
+    off and without the headless frame limit.
+
+    Methods are the variants an experiment compares. --method
+    picks one; a benchmark without it runs all of them in turn,
+    one result each, setMethod() is called before each.
+
+    --size WxH goes to setSize() before the context is created,
+    the window size unless the experiment sizes something else
+    (particles, buffers). Experiment specific options are added
+    to Options in the constructor and read with commandLine() in
+    init(). Everything that ends up in Benchmark.Params is written
+    out with each result, tools/bench_compare matches on it.
+
+    Linked programs are kept in <bin>/../program_cache/ between
+    runs, --program-cache moves or disables it (programcache.h).
+
+    Residency is up for every run with Memory as its config,
+    --vram-budget MB sets the budget. Buffers and textures an
+    experiment registers with it are evicted and restored to stay
+    under it (residency.h), its summary is printed at the end.
+
+****************************************************************/
+
+#include "benchmark.h"
+#include "commandline.h"
+#include "context.h"
+#include "residency.h"
+
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    class Application
+    {
+    public:
+        /** name is used for the trace, the default JSON file and the result names */
+        explicit Application(const std::string& name);
+        virtual ~Application();
+
+        /** parses the command line, runs, shuts down, returns main()'s exit code */
+        int run(int argc, char* argv[]);
+        /** benchmark results go to runner instead of the JSON file, the suite writes them all at once */
+        void collectResults(BenchmarkRunner* runner);
+
+    protected:
+        /** before the context exists, for work that doesn't need GL (parsing files) */
+        virtual bool load();
+        /** the context is current, Debug and the Profiler are up */
+        virtual bool init() = 0;
+        /** everything of a frame before the swap, the part that is measured */
+        virtual void frame() = 0;
+        /** after the swap and the event poll */
+        virtual void endFrame();
+        /** releases what init() created, the summaries are printed afterwards */
+        virtual void shutdown();
+
+        /** --method and every benchmarked method, after init() */
+        virtual void setMethod(size_t method);
+        /** --size, before load(), by default the window size */
+        virtual void setSize(int width, int height);
+
+        const std::string& dataDirectory() const;
+        const CommandLine& commandLine() const;
+        size_t method() const;
+        bool benchmarking() const;
+
+        std::string Name;
+        ContextConfig Config;
+        /** defaults, --frames and --warmup override Iterations and WarmupIterations */
+        BenchmarkConfig Benchmark;
+        std::vector<std::string> Methods;
+        /** Profiler trace, none when empty */
+        std::string TraceFile;
+        /** written when benchmarking, --json overrides it, none when empty */
+        std::string JsonFile;
+        bool BenchmarkByDefault;
+        CommandLine Options;
+        /** Residency's budget and spill directory, --vram-budget sets BudgetBytes */
+        ResidencyConfig Memory;
+
+    private:
+        bool parseCommandLine(int argc, char* argv[]);
+        void runloop();
+        bool runBenchmarks();
+
+        std::string DataDir;
+        size_t Method;
+        bool Benchmarking;
+        BenchmarkRunner* Collector;
+
+        Application(const Application& other);
+        Application& operator=(const Application& other);
+    };
+}
+
+/** an experiment's main(), or what the suite looks up in its module */
+#ifdef OGLE_MODULE
+#define OGLE_APPLICATION(type)                                  \
+    extern "C" ogle::Application* ogleCreateApplication()       \
+    {                                                           \
+        return new type();                                      \
+    }
+#else
+#define OGLE_APPLICATION(type)                                  \
+    int main(int argc, char* argv[])                            \
+    {                                                           \
+        type app;                                               \
+        return app.run(argc, argv);                             \
+    }
+#endif
+
+#endif // APPLICATION_H
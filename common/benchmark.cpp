@@ -0,0 +1,540 @@
+#include "benchmark.h"
+#include "alloctracker.h"
+#include "csv.h"
+#include "residency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <sys/utsname.h>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    const GLuint QueryGrowCount = 128;
+
+    std::string readSysFile(const std::string& path)
+    {
+        std::ifstream inf(path);
+        std::string value;
+        if (inf.is_open())
+            std::getline(inf, value);
+        return value;
+    }
+
+    /** average of scaling_cur_freq over all cores in kHz, 0 when cpufreq isn't exposed */
+    double averageCpuFrequency()
+    {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        double total = 0.0;
+        unsigned int found = 0;
+        for (unsigned int i=0; i<cores; ++i) {
+            std::string freq = readSysFile("/sys/devices/system/cpu/cpu" + std::to_string(i) + "/cpufreq/scaling_cur_freq");
+            if (!freq.empty()) {
+                total += atof(freq.c_str());
+                found++;
+            }
+        }
+        return found > 0 ? total / found : 0.0;
+    }
+
+    /** linear interpolation between the closest ranks, samples must be sorted */
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        double rank = p * (sorted.size() - 1);
+        size_t lo = (size_t)std::floor(rank);
+        size_t hi = (size_t)std::ceil(rank);
+        double t = rank - lo;
+        return sorted[lo] + (sorted[hi] - sorted[lo]) * t;
+    }
+
+    std::string escape(const std::string& str)
+    {
+        std::string result;
+        for (char c : str) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    void writeStats(std::ostream& out, const BenchmarkStats& stats, const std::vector<double>& samples)
+    {
+        out << "{\"count\":" << stats.Count
+            << ",\"rejected\":" << stats.Rejected
+            << ",\"min\":" << stats.Min
+            << ",\"max\":" << stats.Max
+            << ",\"mean\":" << stats.Mean
+            << ",\"median\":" << stats.Median
+            << ",\"p95\":" << stats.P95
+            << ",\"p99\":" << stats.P99
+            << ",\"stddev\":" << stats.StdDev
+            << ",\"cv\":" << stats.CV
+            << ",\"samples\":[";
+        for (size_t i=0; i<samples.size(); ++i)
+            out << (i > 0 ? "," : "") << samples[i];
+        out << "]}";
+    }
+
+    void printStats(const char* label, const BenchmarkStats& stats)
+    {
+        std::cout << "\t" << label << " ms:"
+                  << " median " << stats.Median
+                  << "  p95 " << stats.P95
+                  << "  p99 " << stats.P99
+                  << "  min " << stats.Min
+                  << "  max " << stats.Max
+                  << "  cv " << stats.CV * 100.0 << "%"
+                  << "  rejected " << stats.Rejected << "\n";
+    }
+}
+
+BenchmarkConfig::BenchmarkConfig()
+    : WarmupIterations(10)
+    , Iterations(0)
+    , TimeBudget(1.0)
+    , MaxIterations(100000)
+    , OutlierThreshold(5.0)
+    , MaxStableCV(0.05)
+    , GpuTiming(true)
+    , AssertNoAllocations(false)
+{
+
+}
+
+BenchmarkStats::BenchmarkStats()
+    : Count(0)
+    , Rejected(0)
+    , Min(0)
+    , Max(0)
+    , Mean(0)
+    , Median(0)
+    , P95(0)
+    , P99(0)
+    , StdDev(0)
+    , CV(0)
+{
+
+}
+
+BenchmarkRunner::BenchmarkRunner()
+{
+
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+    if (!Queries.empty())
+        glDeleteQueries((GLsizei)Queries.size(), Queries.data());
+}
+
+const BenchmarkResult& BenchmarkRunner::run(const BenchmarkConfig& config, const Callback& iteration, const Callback& untimed)
+{
+    typedef std::chrono::steady_clock clock;
+
+    BenchmarkResult result;
+    result.Name = config.Name;
+    result.Params = config.Params;
+    result.WarmupIterations = config.WarmupIterations;
+    result.Allocations = 0;
+    result.AllocatedBytes = 0;
+    result.RestoringIterations = 0;
+    result.Failed = false;
+    result.Warnings = checkEnvironment();
+
+    bool gpu_timing = config.GpuTiming && GLEW_ARB_timer_query == GL_TRUE;
+
+    // grab it while the context is known to be current
+    if (Machine.empty())
+        Machine = machineFingerprint();
+
+    std::cout << "Running " << config.Name << std::endl;
+    for (unsigned int i=0; i<config.WarmupIterations; ++i) {
+        iteration();
+        if (untimed)
+            untimed();
+    }
+    if (gpu_timing)
+        glFinish();
+
+    // the runner's own bookkeeping must not show up as allocations of the iterations
+    result.CpuSamples.reserve(config.Iterations > 0 ? config.Iterations : config.MaxIterations);
+    std::vector<char> restoring;
+    restoring.reserve(result.CpuSamples.capacity());
+    ResidencyStats residency_before = Residency::stats();
+    bool track_allocations = config.AssertNoAllocations && AllocTracker::compiledIn();
+    if (track_allocations)
+        AllocTracker::captureStacks(true);
+
+    double start_frequency = averageCpuFrequency();
+    clock::time_point run_start = clock::now();
+
+    unsigned int count = 0;
+    while (true) {
+        if (config.Iterations > 0) {
+            if (count >= config.Iterations)
+                break;
+        }
+        else {
+            std::chrono::duration<double> elapsed = clock::now() - run_start;
+            if (elapsed.count() >= config.TimeBudget || count >= config.MaxIterations)
+                break;
+        }
+
+        if (gpu_timing) {
+            if (Queries.size() < (count + 1) * 2) {
+                size_t used = Queries.size();
+                Queries.resize(used + QueryGrowCount);
+                glGenQueries(QueryGrowCount, &Queries[used]);
+            }
+            glQueryCounter(Queries[count * 2 + 0], GL_TIMESTAMP);
+        }
+
+        AllocCounts allocs_before = AllocTracker::total();
+        uint64_t restores_before = Residency::stats().Restores;
+        clock::time_point before = clock::now();
+        iteration();
+        clock::time_point after = clock::now();
+        AllocCounts allocs_after = AllocTracker::total();
+        restoring.push_back(Residency::stats().Restores != restores_before);
+
+        if (gpu_timing)
+            glQueryCounter(Queries[count * 2 + 1], GL_TIMESTAMP);
+
+        std::chrono::duration<double, std::milli> cpu_time = after - before;
+        result.CpuSamples.push_back(cpu_time.count());
+
+        if (untimed) {
+            AllocCounts untimed_before = AllocTracker::total();
+            untimed();
+            AllocCounts untimed_after = AllocTracker::total();
+            allocs_after.Allocations += untimed_after.Allocations - untimed_before.Allocations;
+            allocs_after.Bytes += untimed_after.Bytes - untimed_before.Bytes;
+        }
+        result.Allocations += allocs_after.Allocations - allocs_before.Allocations;
+        result.AllocatedBytes += allocs_after.Bytes - allocs_before.Bytes;
+        count++;
+    }
+    result.Iterations = count;
+
+    ResidencyStats residency_after = Residency::stats();
+    result.Evictions = residency_after.Evictions - residency_before.Evictions;
+    result.Restores = residency_after.Restores - residency_before.Restores;
+    result.RestoredBytes = residency_after.RestoredBytes - residency_before.RestoredBytes;
+    std::vector<double> restoring_samples;
+    for (size_t i=0; i<restoring.size(); ++i) {
+        if (restoring[i])
+            restoring_samples.push_back(result.CpuSamples[i]);
+    }
+    result.RestoringIterations = (unsigned int)restoring_samples.size();
+    result.CpuRestoring = computeStats(restoring_samples, config.OutlierThreshold);
+
+    if (track_allocations) {
+        AllocTracker::captureStacks(false);
+        if (result.Allocations > 0) {
+            std::ostringstream msg;
+            msg << "measured iterations allocated " << result.Allocations << " times ("
+                << result.AllocatedBytes << " bytes)";
+            result.Warnings.push_back(msg.str());
+            result.Failed = true;
+
+            std::cerr << "[!] BenchmarkRunner: " << config.Name << " " << msg.str() << std::endl;
+            AllocTracker::printSummary(5);
+        }
+    }
+    else if (config.AssertNoAllocations) {
+        std::cerr << "[!] BenchmarkRunner: " << config.Name << " asks for AssertNoAllocations, "
+                  << "allocations are only counted in builds with OGLE_ALLOC_TRACKER." << std::endl;
+    }
+
+    // the gpu had the whole run to finish these, reading them now only waits on the last few.
+    if (gpu_timing) {
+        result.GpuSamples.reserve(count);
+        for (unsigned int i=0; i<count; ++i) {
+            GLuint64 gpu_start = 0;
+            GLuint64 gpu_end = 0;
+            glGetQueryObjectui64v(Queries[i * 2 + 0], GL_QUERY_RESULT, &gpu_start);
+            glGetQueryObjectui64v(Queries[i * 2 + 1], GL_QUERY_RESULT, &gpu_end);
+            result.GpuSamples.push_back((gpu_end - gpu_start) * 1e-6);
+        }
+    }
+
+    result.Cpu = computeStats(result.CpuSamples, config.OutlierThreshold);
+    result.Gpu = computeStats(result.GpuSamples, config.OutlierThreshold);
+
+    double end_frequency = averageCpuFrequency();
+    if (start_frequency > 0.0 && std::fabs(end_frequency - start_frequency) > start_frequency * 0.1) {
+        std::ostringstream msg;
+        msg << "average CPU frequency changed from " << start_frequency * 1e-3
+            << " MHz to " << end_frequency * 1e-3 << " MHz during the run";
+        result.Warnings.push_back(msg.str());
+    }
+
+    if (result.Cpu.CV > config.MaxStableCV) {
+        std::ostringstream msg;
+        msg << "cpu coefficient of variation " << result.Cpu.CV * 100.0
+            << "% is above " << config.MaxStableCV * 100.0 << "%";
+        result.Warnings.push_back(msg.str());
+    }
+    if (result.Gpu.CV > config.MaxStableCV) {
+        std::ostringstream msg;
+        msg << "gpu coefficient of variation " << result.Gpu.CV * 100.0
+            << "% is above " << config.MaxStableCV * 100.0 << "%";
+        result.Warnings.push_back(msg.str());
+    }
+    result.Stable = result.Warnings.empty();
+
+    Results.push_back(result);
+    return Results.back();
+}
+
+void BenchmarkRunner::printResults() const
+{
+    for (const auto& result : Results) {
+        std::cout << result.Name;
+        for (const auto& kv : result.Params)
+            std::cout << " " << kv.first << "=" << kv.second;
+        if (result.Failed)
+            std::cout << " [FAILED]";
+        std::cout << "\n\titerations " << result.Iterations
+                  << " (warmup " << result.WarmupIterations << ")\n";
+        if (result.Allocations > 0)
+            std::cout << "\tallocations " << result.Allocations << " (" << result.AllocatedBytes << " bytes)\n";
+        if (result.Evictions > 0 || result.Restores > 0) {
+            std::cout << "\tresidency evictions " << result.Evictions << ", restores " << result.Restores
+                      << " (" << result.RestoredBytes / (1024.0 * 1024.0) << " MB)\n";
+            if (result.RestoringIterations > 0)
+                std::cout << "\t" << result.RestoringIterations << " iterations restored, cpu median "
+                          << result.CpuRestoring.Median << " ms against " << result.Cpu.Median << " ms overall\n";
+        }
+        printStats("cpu", result.Cpu);
+        if (!result.GpuSamples.empty())
+            printStats("gpu", result.Gpu);
+        for (const auto& warning : result.Warnings)
+            std::cout << "\t[!] " << warning << "\n";
+    }
+    std::cout << std::endl;
+}
+
+bool BenchmarkRunner::writeJson(const std::string& filename) const
+{
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << filename << std::endl;
+        return false;
+    }
+
+    std::map<std::string, std::string> machine = Machine.empty() ? machineFingerprint() : Machine;
+
+    out << std::setprecision(9);
+    out << "{\n\"machine\":{";
+    bool first_key = true;
+    for (const auto& kv : machine) {
+        out << (first_key ? "" : ",") << "\"" << escape(kv.first) << "\":\"" << escape(kv.second) << "\"";
+        first_key = false;
+    }
+    out << "},\n\"benchmarks\":[";
+    for (size_t r=0; r<Results.size(); ++r) {
+        const BenchmarkResult& result = Results[r];
+        out << (r > 0 ? "," : "") << "\n{\"name\":\"" << escape(result.Name) << "\",\"params\":{";
+        bool first = true;
+        for (const auto& kv : result.Params) {
+            out << (first ? "" : ",") << "\"" << escape(kv.first) << "\":\"" << escape(kv.second) << "\"";
+            first = false;
+        }
+        out << "},\"warmup\":" << result.WarmupIterations
+            << ",\"iterations\":" << result.Iterations
+            << ",\"stable\":" << (result.Stable ? "true" : "false")
+            << ",\"failed\":" << (result.Failed ? "true" : "false")
+            << ",\"allocations\":" << result.Allocations
+            << ",\"allocated_bytes\":" << result.AllocatedBytes
+            << ",\"evictions\":" << result.Evictions
+            << ",\"restores\":" << result.Restores
+            << ",\"restored_bytes\":" << result.RestoredBytes
+            << ",\"restoring_iterations\":" << result.RestoringIterations
+            << ",\"warnings\":[";
+        for (size_t i=0; i<result.Warnings.size(); ++i)
+            out << (i > 0 ? "," : "") << "\"" << escape(result.Warnings[i]) << "\"";
+        out << "],\n \"cpu_ms\":";
+        writeStats(out, result.Cpu, result.CpuSamples);
+        out << ",\n \"gpu_ms\":";
+        writeStats(out, result.Gpu, result.GpuSamples);
+        out << "}";
+    }
+    out << "\n]\n}\n";
+
+    std::cout << "Wrote benchmark results to " << filename << std::endl;
+    return true;
+}
+
+bool BenchmarkRunner::writeCsv(const std::string& filename) const
+{
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << filename << std::endl;
+        return false;
+    }
+
+    out << std::setprecision(9);
+    out << "name,params,iterations,stable,"
+        << "cpu_median,cpu_p95,cpu_p99,cpu_mean,cpu_cv,cpu_rejected,"
+        << "gpu_median,gpu_p95,gpu_p99,gpu_mean,gpu_cv,gpu_rejected\n";
+    for (const auto& result : Results) {
+        std::string params;
+        for (const auto& kv : result.Params)
+            params += (params.empty() ? "" : ";") + kv.first + "=" + kv.second;
+
+        Csv::writeField(out, result.Name);
+        out << ",";
+        Csv::writeField(out, params);
+        out << "," << result.Iterations << "," << (result.Stable ? 1 : 0) << ","
+            << result.Cpu.Median << "," << result.Cpu.P95 << "," << result.Cpu.P99 << ","
+            << result.Cpu.Mean << "," << result.Cpu.CV << "," << result.Cpu.Rejected << ","
+            << result.Gpu.Median << "," << result.Gpu.P95 << "," << result.Gpu.P99 << ","
+            << result.Gpu.Mean << "," << result.Gpu.CV << "," << result.Gpu.Rejected << "\n";
+    }
+
+    std::cout << "Wrote benchmark results to " << filename << std::endl;
+    return true;
+}
+
+void BenchmarkRunner::add(const BenchmarkResult& result)
+{
+    if (Machine.empty())
+        Machine = machineFingerprint();
+    Results.push_back(result);
+}
+
+const std::vector<BenchmarkResult>& BenchmarkRunner::results() const
+{
+    return Results;
+}
+
+bool BenchmarkRunner::failed() const
+{
+    for (const auto& result : Results) {
+        if (result.Failed)
+            return true;
+    }
+    return false;
+}
+
+BenchmarkStats BenchmarkRunner::computeStats(const std::vector<double>& samples, double outlierThreshold)
+{
+    BenchmarkStats stats;
+    if (samples.empty())
+        return stats;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    double median = percentile(sorted, 0.5);
+
+    // median absolute deviation, scaled so it estimates the standard deviation of normal data
+    std::vector<double> deviations(sorted.size());
+    for (size_t i=0; i<sorted.size(); ++i)
+        deviations[i] = std::fabs(sorted[i] - median);
+    std::sort(deviations.begin(), deviations.end());
+    double mad = percentile(deviations, 0.5) * 1.4826;
+
+    std::vector<double> kept;
+    kept.reserve(sorted.size());
+    for (double sample : sorted) {
+        if (outlierThreshold <= 0.0 || mad <= 0.0 || std::fabs(sample - median) <= outlierThreshold * mad)
+            kept.push_back(sample);
+    }
+
+    stats.Count = kept.size();
+    stats.Rejected = sorted.size() - kept.size();
+    stats.Min = kept.front();
+    stats.Max = kept.back();
+    stats.Median = percentile(kept, 0.5);
+    stats.P95 = percentile(kept, 0.95);
+    stats.P99 = percentile(kept, 0.99);
+
+    double sum = 0.0;
+    for (double sample : kept)
+        sum += sample;
+    stats.Mean = sum / kept.size();
+
+    double variance = 0.0;
+    for (double sample : kept)
+        variance += (sample - stats.Mean) * (sample - stats.Mean);
+    if (kept.size() > 1)
+        variance /= (kept.size() - 1);
+    stats.StdDev = std::sqrt(variance);
+    stats.CV = stats.Mean > 0.0 ? stats.StdDev / stats.Mean : 0.0;
+
+    return stats;
+}
+
+std::vector<std::string> BenchmarkRunner::checkEnvironment()
+{
+    std::vector<std::string> warnings;
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    std::map<std::string, unsigned int> governors;
+    for (unsigned int i=0; i<cores; ++i) {
+        std::string governor = readSysFile("/sys/devices/system/cpu/cpu" + std::to_string(i) + "/cpufreq/scaling_governor");
+        if (!governor.empty())
+            governors[governor]++;
+    }
+    for (const auto& kv : governors) {
+        if (kv.first != "performance") {
+            warnings.push_back("CPU frequency scaling governor is '" + kv.first + "' on "
+                + std::to_string(kv.second) + " cores, use 'performance' for stable numbers");
+        }
+    }
+
+    if (readSysFile("/sys/devices/system/cpu/intel_pstate/no_turbo") == "0")
+        warnings.push_back("turbo boost is enabled (intel_pstate/no_turbo is 0)");
+    if (readSysFile("/sys/devices/system/cpu/cpufreq/boost") == "1")
+        warnings.push_back("frequency boost is enabled (cpufreq/boost is 1)");
+
+    return warnings;
+}
+
+std::map<std::string, std::string> BenchmarkRunner::machineFingerprint()
+{
+    std::map<std::string, std::string> machine;
+
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    const GLubyte* vendor = glGetString(GL_VENDOR);
+    const GLubyte* version = glGetString(GL_VERSION);
+    machine["gl_renderer"] = renderer ? (const char*)renderer : "unknown";
+    machine["gl_vendor"] = vendor ? (const char*)vendor : "unknown";
+    machine["gl_version"] = version ? (const char*)version : "unknown";
+
+    std::string cpu_model = "unknown";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                cpu_model = line.substr(line.find_first_not_of(" \t", colon + 1));
+            break;
+        }
+    }
+    machine["cpu_model"] = cpu_model;
+    machine["cpu_cores"] = std::to_string(std::thread::hardware_concurrency());
+
+    struct utsname name;
+    if (uname(&name) == 0) {
+        machine["os"] = std::string(name.sysname) + " " + name.release;
+        machine["hostname"] = name.nodename;
+    }
+
+    return machine;
+}
@@ -0,0 +1,154 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/****************************************************************
+
+    Statistical benchmark runner.
+
+    Runs a warmup, then either a fixed number of iterations or as
+    many as fit in a time budget. Every iteration records a CPU
+    sample (std::chrono) and a GPU sample (GL_TIMESTAMP queries
+    that are only read back once the run is over, so they never
+    stall the pipeline).
+
+    Samples are summarized with median/p95/p99 and the coefficient
+    of variation after rejecting outliers that are more than
+    OutlierThreshold median absolute deviations from the median.
+
+    The machine is checked for things that make numbers unstable,
+    like CPU frequency scaling or turbo boost, those show up in the
+    Warnings of every result.
+
+    With AssertNoAllocations set a result fails when its measured
+    iterations (untimed callback included) make heap allocations,
+    this needs a build with OGLE_ALLOC_TRACKER, see alloctracker.h.
+
+    Evictions and restores of the residency manager (residency.h)
+    during the measured iterations are recorded too, with the CPU
+    times of the iterations that had to restore something, to see
+    what thrashing costs.
+
+    Results can be written out as JSON or CSV so that runs can be
+    compared later, the JSON includes a fingerprint of the machine
+    the run was made on. See tools/bench_compare.
+
+    extensions required:
+    GL_ARB_timer_query, without it only CPU samples are recorded.
+
+****************************************************************/
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    struct BenchmarkConfig
+    {
+        BenchmarkConfig();
+
+        std::string Name;
+        std::map<std::string, std::string> Params;
+
+        unsigned int WarmupIterations;
+        /** when 0 the run lasts TimeBudget seconds */
+        unsigned int Iterations;
+        double TimeBudget;
+        unsigned int MaxIterations;
+
+        /** in median absolute deviations, 0 keeps every sample */
+        double OutlierThreshold;
+        /** coefficient of variation above which a result is flagged as unstable */
+        double MaxStableCV;
+        bool GpuTiming;
+        /** fail the result when measured iterations allocate, only with OGLE_ALLOC_TRACKER */
+        bool AssertNoAllocations;
+    };
+
+    struct BenchmarkStats
+    {
+        BenchmarkStats();
+
+        size_t Count;       // samples kept
+        size_t Rejected;    // samples thrown out as outliers
+        double Min;
+        double Max;
+        double Mean;
+        double Median;
+        double P95;
+        double P99;
+        double StdDev;
+        double CV;          // StdDev / Mean
+    };
+
+    struct BenchmarkResult
+    {
+        std::string Name;
+        std::map<std::string, std::string> Params;
+        unsigned int WarmupIterations;
+        unsigned int Iterations;
+
+        /** milliseconds, in the order they were taken */
+        std::vector<double> CpuSamples;
+        std::vector<double> GpuSamples;
+        BenchmarkStats Cpu;
+        BenchmarkStats Gpu;
+
+        /** operator new calls during the measured iterations, 0 without OGLE_ALLOC_TRACKER */
+        uint64_t Allocations;
+        uint64_t AllocatedBytes;
+
+        /** residency manager traffic during the measured iterations */
+        uint64_t Evictions;
+        uint64_t Restores;
+        uint64_t RestoredBytes;
+        /** iterations that restored something and their CPU times */
+        unsigned int RestoringIterations;
+        BenchmarkStats CpuRestoring;
+
+        bool Stable;
+        bool Failed;
+        std::vector<std::string> Warnings;
+    };
+
+    class BenchmarkRunner
+    {
+    public:
+        typedef std::function<void()> Callback;
+
+        BenchmarkRunner();
+        ~BenchmarkRunner();
+
+        /**
+            iteration is what gets timed,
+            untimed is called after every iteration (swap buffers, poll events...) and can be empty.
+            Needs a current GL context when config.GpuTiming is set.
+        */
+        const BenchmarkResult& run(const BenchmarkConfig& config, const Callback& iteration, const Callback& untimed = Callback());
+        /** a result another runner made, the suite gathers its experiments' results in one file */
+        void add(const BenchmarkResult& result);
+
+        void printResults() const;
+        bool writeJson(const std::string& filename) const;
+        bool writeCsv(const std::string& filename) const;
+
+        const std::vector<BenchmarkResult>& results() const;
+        /** true when a result broke one of its config's asserts */
+        bool failed() const;
+
+        static BenchmarkStats computeStats(const std::vector<double>& samples, double outlierThreshold);
+        /** things on this machine that are known to skew results */
+        static std::vector<std::string> checkEnvironment();
+        /** GL_RENDERER, GL_VERSION, CPU model, core count... GL values need a current context */
+        static std::map<std::string, std::string> machineFingerprint();
+
+    private:
+        std::vector<BenchmarkResult> Results;
+        std::map<std::string, std::string> Machine;
+        std::vector<unsigned int> Queries;
+    };
+}
+
+#endif // BENCHMARK_H
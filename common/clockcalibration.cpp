@@ -0,0 +1,209 @@
+#include "clockcalibration.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    // the line is fitted through the most recent samples only,
+    // so a clock that changes its rate (power states) gets followed
+    const unsigned int MaxSamples = 32;
+
+    // glGetInteger64v is bracketed by two cpu reads, the tightest of a few tries is kept
+    const int TriesPerSample = 5;
+
+    // anything further off than this is a bad fit, not a real clock
+    const double MaxDrift = 0.01;
+
+    struct Sample
+    {
+        double Cpu;     // microseconds since the epoch
+        double Gpu;     // microseconds since the first gpu sample
+    };
+}
+
+struct ClockCalibration::State
+{
+    bool Initialized;
+    bool GpuTimers;
+    std::chrono::steady_clock::time_point Epoch;
+    double SampleInterval;  // seconds
+    double LastSample;      // microseconds
+
+    uint64_t Reference;     // first gpu sample in nanoseconds, keeps the doubles small
+    Sample Samples[MaxSamples];
+    unsigned int Count;
+    unsigned int Next;
+
+    // cpu = Offset + Slope * gpu
+    double Offset;
+    double Slope;
+
+    double now() const
+    {
+        std::chrono::duration<double, std::micro> us = std::chrono::steady_clock::now() - Epoch;
+        return us.count();
+    }
+
+    void fit()
+    {
+        unsigned int n = std::min(Count, MaxSamples);
+        if (n < 2) {
+            Slope = 1.0;
+            Offset = Samples[0].Cpu - Samples[0].Gpu;
+            return;
+        }
+
+        double mean_cpu = 0.0;
+        double mean_gpu = 0.0;
+        for (unsigned int i=0; i<n; ++i) {
+            mean_cpu += Samples[i].Cpu;
+            mean_gpu += Samples[i].Gpu;
+        }
+        mean_cpu /= n;
+        mean_gpu /= n;
+
+        double covariance = 0.0;
+        double variance = 0.0;
+        for (unsigned int i=0; i<n; ++i) {
+            double dg = Samples[i].Gpu - mean_gpu;
+            covariance += dg * (Samples[i].Cpu - mean_cpu);
+            variance += dg * dg;
+        }
+
+        Slope = variance > 0.0 ? covariance / variance : 1.0;
+        if (std::fabs(Slope - 1.0) > MaxDrift)
+            Slope = 1.0;
+        Offset = mean_cpu - Slope * mean_gpu;
+    }
+};
+
+ClockCalibration::State& ClockCalibration::instance()
+{
+    static State state = { false };
+    return state;
+}
+
+void ClockCalibration::init(double sampleInterval)
+{
+    State& state = instance();
+    if (state.Initialized)
+        return;
+
+    state.Initialized = true;
+    state.Epoch = std::chrono::steady_clock::now();
+    state.SampleInterval = sampleInterval;
+    state.LastSample = 0.0;
+    state.Reference = 0;
+    state.Count = 0;
+    state.Next = 0;
+    state.Offset = 0.0;
+    state.Slope = 1.0;
+    state.GpuTimers = GLEW_ARB_timer_query == GL_TRUE;
+
+    if (state.GpuTimers)
+        sample();
+}
+
+bool ClockCalibration::calibrated()
+{
+    return instance().Count > 0;
+}
+
+void ClockCalibration::update()
+{
+    State& state = instance();
+    if (!state.GpuTimers)
+        return;
+
+    if ((state.now() - state.LastSample) * 1e-6 >= state.SampleInterval)
+        sample();
+}
+
+void ClockCalibration::sample()
+{
+    State& state = instance();
+    if (!state.GpuTimers)
+        return;
+
+    double best_cpu = 0.0;
+    double best_bracket = 0.0;
+    GLint64 best_gpu = 0;
+    for (int i=0; i<TriesPerSample; ++i) {
+        GLint64 gpu = 0;
+        double before = state.now();
+        glGetInteger64v(GL_TIMESTAMP, &gpu);
+        double after = state.now();
+
+        if (i == 0 || after - before < best_bracket) {
+            best_bracket = after - before;
+            best_cpu = (before + after) * 0.5;
+            best_gpu = gpu;
+        }
+    }
+
+    if (state.Count == 0)
+        state.Reference = (uint64_t)best_gpu;
+
+    Sample& sample = state.Samples[state.Next];
+    sample.Cpu = best_cpu;
+    sample.Gpu = ((double)best_gpu - (double)state.Reference) * 1e-3;
+    state.Next = (state.Next + 1) % MaxSamples;
+    state.Count++;
+    state.LastSample = best_cpu;
+
+    state.fit();
+}
+
+double ClockCalibration::now()
+{
+    return instance().now();
+}
+
+double ClockCalibration::gpuToCpu(uint64_t gpuNanoseconds)
+{
+    State& state = instance();
+    if (state.Count == 0)
+        return 0.0;
+
+    double gpu = ((double)gpuNanoseconds - (double)state.Reference) * 1e-3;
+    return state.Offset + state.Slope * gpu;
+}
+
+double ClockCalibration::driftPpm()
+{
+    State& state = instance();
+    if (state.Count < 2)
+        return 0.0;
+    return (1.0 / state.Slope - 1.0) * 1e6;
+}
+
+unsigned int ClockCalibration::sampleCount()
+{
+    return instance().Count;
+}
+
+ClockCalibration::ClockCalibration()
+{
+
+}
+
+ClockCalibration::~ClockCalibration()
+{
+
+}
+
+ClockCalibration::ClockCalibration(const ClockCalibration& other)
+{
+
+}
+
+ClockCalibration& ClockCalibration::operator=(const ClockCalibration& other)
+{
+    return *this;
+}
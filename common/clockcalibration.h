@@ -0,0 +1,65 @@
+#ifndef CLOCKCALIBRATION_H
+#define CLOCKCALIBRATION_H
+
+/****************************************************************
+
+    Maps GPU time stamps onto the CPU clock.
+
+    GL_TIMESTAMP counts nanoseconds from some point the driver
+    picked, std::chrono::steady_clock from another, and the two
+    don't tick at exactly the same rate. Pairs of
+    (steady_clock, glGetInteger64v(GL_TIMESTAMP)) are sampled
+    every now and then and a line is fitted through them, giving
+    the offset and the drift between the two clocks.
+
+    Everything that puts GPU and CPU times next to each other
+    (Profiler, LatencyTracker) goes through here, so they share
+    one time line: microseconds since the first init().
+
+    Usage:
+        ogle::ClockCalibration::init();         // needs a current GL context
+        ogle::ClockCalibration::update();       // once per frame, resamples every SampleInterval
+        double cpu_us = ogle::ClockCalibration::gpuToCpu(gpu_ns);
+
+    extensions required:
+    GL_ARB_timer_query, without it gpuToCpu() has nothing to work with and returns 0.
+
+****************************************************************/
+
+#include <cstdint>
+
+namespace ogle
+{
+    class ClockCalibration
+    {
+    public:
+        /** takes the first samples, can be called more than once */
+        static void init(double sampleInterval = 1.0);
+        static bool calibrated();
+
+        /** cheap unless SampleInterval seconds have passed since the last sample */
+        static void update();
+        /** takes a sample right away */
+        static void sample();
+
+        /** microseconds since the first init() on the CPU clock */
+        static double now();
+        /** a GL_TIMESTAMP value in nanoseconds, moved onto the now() time line */
+        static double gpuToCpu(uint64_t gpuNanoseconds);
+
+        /** how much faster the GPU clock runs, in parts per million */
+        static double driftPpm();
+        static unsigned int sampleCount();
+
+    private:
+        struct State;
+        static State& instance();
+
+        ClockCalibration();
+        ~ClockCalibration();
+        ClockCalibration(const ClockCalibration& other);
+        ClockCalibration& operator=(const ClockCalibration& other);
+    };
+}
+
+#endif // CLOCKCALIBRATION_H
@@ -0,0 +1,174 @@
+#include "commandline.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace ogle;
+
+namespace {
+    bool parseUnsigned(const std::string& text, unsigned long& value)
+    {
+        if (text.empty() || text[0] == '-')
+            return false;
+        char* end = nullptr;
+        errno = 0;
+        value = strtoul(text.c_str(), &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+}
+
+CommandLine::CommandLine()
+{
+    addOption("frames", "measured frames, runs as a benchmark and exits");
+    addOption("warmup", "frames rendered before measuring starts");
+    addOption("size", "WxH or N, what it sizes depends on the experiment");
+    addOption("method", "run only this method");
+    addOption("json", "write the benchmark results to this file");
+    addOption("program-cache", "directory of the linked program binaries, off compiles every program");
+    addOption("vram-budget", "MB the buffers and textures an experiment registers with Residency may take");
+    addOption("help", "print this", false);
+    // started by samplingprofiler.cpp on its own, only needs to be accepted here
+    addOption("sample-profile", "sample call stacks, --sample-profile=<hz>", false);
+}
+
+void CommandLine::addOption(const std::string& name, const std::string& description, bool takesValue)
+{
+    for (auto& option : Options) {
+        if (option.Name == name) {
+            option.Description = description;
+            option.TakesValue = takesValue;
+            return;
+        }
+    }
+
+    Option option;
+    option.Name = name;
+    option.Description = description;
+    option.TakesValue = takesValue;
+    Options.push_back(option);
+}
+
+bool CommandLine::parse(int argc, char* argv[])
+{
+    Values.clear();
+    Positional.clear();
+    Program = argc > 0 ? argv[0] : "";
+
+    for (int i=1; i<argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0 || arg.size() == 2) {
+            Positional.push_back(arg);
+            continue;
+        }
+
+        std::string name = arg.substr(2);
+        std::string value;
+        bool has_value = false;
+        size_t equals = name.find('=');
+        if (equals != std::string::npos) {
+            value = name.substr(equals + 1);
+            name = name.substr(0, equals);
+            has_value = true;
+        }
+
+        const Option* option = find(name);
+        if (!option) {
+            std::cerr << "[!] CommandLine: unknown option --" << name << std::endl;
+            return false;
+        }
+
+        if (option->TakesValue && !has_value) {
+            if (i + 1 >= argc) {
+                std::cerr << "[!] CommandLine: --" << name << " needs a value" << std::endl;
+                return false;
+            }
+            value = argv[++i];
+        }
+        Values[name] = value;
+    }
+    return true;
+}
+
+bool CommandLine::has(const std::string& name) const
+{
+    return Values.find(name) != Values.end();
+}
+
+std::string CommandLine::value(const std::string& name, const std::string& fallback) const
+{
+    auto found = Values.find(name);
+    return found == Values.end() ? fallback : found->second;
+}
+
+bool CommandLine::unsignedValue(const std::string& name, unsigned int& value) const
+{
+    auto found = Values.find(name);
+    if (found == Values.end())
+        return true;
+
+    unsigned long parsed = 0;
+    if (!parseUnsigned(found->second, parsed) || parsed > 0xffffffffUL) {
+        std::cerr << "[!] CommandLine: --" << name << " expects a number >= 0, got \"" << found->second << "\"" << std::endl;
+        return false;
+    }
+    value = (unsigned int)parsed;
+    return true;
+}
+
+bool CommandLine::size(int& width, int& height) const
+{
+    auto found = Values.find("size");
+    if (found == Values.end())
+        return true;
+
+    const std::string& text = found->second;
+    size_t x = text.find_first_of("xX");
+    unsigned long w = 0;
+    unsigned long h = 0;
+    bool valid = false;
+    if (x == std::string::npos) {
+        valid = parseUnsigned(text, w);
+        h = w;
+    }
+    else {
+        valid = parseUnsigned(text.substr(0, x), w) && parseUnsigned(text.substr(x + 1), h);
+    }
+    if (!valid || w == 0 || h == 0 || w > 65536 || h > 65536) {
+        std::cerr << "[!] CommandLine: --size expects WxH or N, got \"" << text << "\"" << std::endl;
+        return false;
+    }
+    width = (int)w;
+    height = (int)h;
+    return true;
+}
+
+const std::string& CommandLine::program() const
+{
+    return Program;
+}
+
+const std::vector<std::string>& CommandLine::positional() const
+{
+    return Positional;
+}
+
+void CommandLine::printUsage(std::ostream& out) const
+{
+    std::string name = Program.substr(Program.find_last_of("/\\") + 1);
+    out << "usage: " << name << " [options]\n";
+    for (const auto& option : Options) {
+        std::string flag = "--" + option.Name + (option.TakesValue ? " <value>" : "");
+        out << "  " << std::left << std::setw(26) << flag << option.Description << "\n";
+    }
+    out << std::right << std::flush;
+}
+
+const CommandLine::Option* CommandLine::find(const std::string& name) const
+{
+    for (const auto& option : Options)
+        if (option.Name == name)
+            return &option;
+    return nullptr;
+}
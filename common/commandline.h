@@ -0,0 +1,74 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+/****************************************************************
+
+    The command line every experiment understands, see
+    application.h for what the options do:
+        --frames N      measured frames, then exit
+        --warmup N      frames before measuring starts
+        --size WxH      problem size, N alone is NxN
+        --method NAME   one of the experiment's methods
+        --json FILE     benchmark results as JSON
+        --program-cache DIR|off
+                        where program binaries are kept
+        --vram-budget MB
+                        what Residency may keep resident
+        --sample-profile[=HZ]
+                        sample call stacks, see samplingprofiler.h
+        --help
+
+    Options are written --name value or --name=value, arguments
+    that don't start with -- are positional. An experiment adds
+    its own options with addOption() before parse(). Options that
+    aren't known are an error, a typo in a sweep script must not
+    quietly measure the defaults.
+
+****************************************************************/
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    class CommandLine
+    {
+    public:
+        CommandLine();
+
+        /** takesValue false makes it a flag, --name=value is still accepted for those */
+        void addOption(const std::string& name, const std::string& description, bool takesValue = true);
+        /** false after printing what is wrong */
+        bool parse(int argc, char* argv[]);
+
+        bool has(const std::string& name) const;
+        std::string value(const std::string& name, const std::string& fallback = "") const;
+        /** fallback when missing, false after printing why when it isn't a number >= 0 */
+        bool unsignedValue(const std::string& name, unsigned int& value) const;
+        /** WxH or N, false after printing why when it is neither */
+        bool size(int& width, int& height) const;
+
+        const std::string& program() const;
+        const std::vector<std::string>& positional() const;
+        void printUsage(std::ostream& out) const;
+
+    private:
+        struct Option
+        {
+            std::string Name;
+            std::string Description;
+            bool TakesValue;
+        };
+
+        const Option* find(const std::string& name) const;
+
+        std::vector<Option> Options;
+        std::map<std::string, std::string> Values;
+        std::vector<std::string> Positional;
+        std::string Program;
+    };
+}
+
+#endif // COMMANDLINE_H
@@ -1,7 +1,9 @@
 #include "common.h"
+#include "context.h"
+#include "gpumemory.h"
+#include "programcache.h"
 
 #include <cassert>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
@@ -26,38 +28,31 @@ namespace ogle {
 
     void Framebuffer::shutdown()
     {
+        for (GLuint texture : TextureNames)
+            GpuMemory::release(GpuMemory::TEXTURE, texture);
+        GpuMemory::release(GpuMemory::FRAMEBUFFER, FramebufferName);
         glDeleteTextures(TextureNames.size(), TextureNames.data());
         glDeleteFramebuffers(1, &FramebufferName);
     }
 
-    ShaderProgram::ShaderProgram() : ProgramName(0) {}
+    ShaderProgram::ShaderProgram() : ProgramName(0), Linked(false) {}
     ShaderProgram::~ShaderProgram() {
         shutdown();
     }
 
-    void ShaderProgram::init( const std::map<GLuint, std::string>& shaders )
+    void ShaderProgram::init( const std::map<GLuint, std::string>& shaders, const ShaderDefines& defines )
     {
-        std::vector<GLuint> shader_list;
-        for (const auto& kv: shaders)
-            shader_list.push_back( createShader( kv.first, kv.second ) );
-
-        ProgramName = glCreateProgram();
-        for (const auto& shader : shader_list)
-            glAttachShader(ProgramName, shader);
-
-        glLinkProgram(ProgramName);
-
-        for (const auto& shader : shader_list)
-            glDeleteShader(shader);
-
-        checkShaderLinkage(ProgramName);
-        glUseProgram(ProgramName);
-        collectUniforms();
-        glUseProgram(0);
+        // Uniforms are filled in at the first bind(), the driver compiles meanwhile
+        ProgramName = ProgramCache::submit(shaders, defines);
+        Linked = false;
+        Label = ProgramCache::label(shaders);
+        if (!defines.empty())
+            Label += " (" + defines.key() + ")";
     }
 
     void ShaderProgram::bind()
     {
+        link();
         if (0 == ProgramName){
             std::string msg = "Tried using shader program object that was not valid. ";
             msg += __FILE__;
@@ -68,90 +63,43 @@ namespace ogle {
         glUseProgram(ProgramName);
     }
 
-    void ShaderProgram::collectUniforms()
+    UniformHandle ShaderProgram::uniform(const UniformName& name)
     {
-        // older way of doing things,
-        // upgrade to using uniform buffers...
-        int active_uniforms = 0;
-        glGetProgramiv(ProgramName, GL_ACTIVE_UNIFORMS, &active_uniforms);
-
-        for (int i=0; i<active_uniforms; ++i) {
-            const GLuint len = 50;
-            GLsizei used_len = 0;
-            GLsizei uniform_size = 0;
-            GLenum type;
-            char name[len] = {0};
-            glGetActiveUniform(ProgramName, GLuint(i), len, &used_len, &uniform_size, &type, name);
-            name[used_len] = 0;
-            GLint loc = glGetUniformLocation(ProgramName, name);
-            Uniforms[std::string(name)] = loc;
-            // std::cout << name << " " << loc << std::endl;
-        }
+        link();
+        return Uniforms.resolve(name);
     }
 
-    void ShaderProgram::shutdown()
+    bool ShaderProgram::block(const std::string& name, BlockLayout& layout, bool storage)
     {
-        // the ProgramName is stored in an array and is managed by someone else
-        // some sort of communication needs to be set up to notify each other for shutdowns.
-        ProgramName = 0;
+        link();
+        return layout.reflect(ProgramName, name, storage);
     }
 
-    GLuint ShaderProgram::createShader(GLenum type, const std::string& filename)
+    void ShaderProgram::link()
     {
-        GLuint shader = glCreateShader(type);
-
-        // load up the file
-        std::ifstream inf(filename);
-        if (!inf.is_open()) {
-            std::cerr << "Failed to open " << filename << std::endl;
-            assert(0);
-        }
-
-        std::string source;
-        inf.seekg(0, std::ios::end);
-        source.resize((unsigned int)inf.tellg());
-        inf.seekg(0, std::ios::beg);
-        inf.read(&source[0], source.size());
-        inf.close();
-
-        const char *c_str = source.c_str();
-        glShaderSource(shader, 1, &c_str, NULL);
-        glCompileShader(shader);
-
-        int status;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-        if (status == GL_FALSE)
-        {
-            const int maxLen = 1000;
-            int len;
-            char errorBuffer[maxLen];
-			memset((void*)errorBuffer, 0, (size_t)maxLen);
-            glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-            std::cerr   << "Shader: " << "\n\t"
-                        << filename << "\n"
-                        << "Failed to compile with errors:\n\t"
-                        << errorBuffer << std::endl;
-            assert(0);
+        if (!Linked) {
+            Linked = true;
+            if (!ProgramCache::finish(ProgramName)) {
+                // the log is printed, bind() throws from now on instead of drawing with it
+                ProgramName = 0;
+                assert(0);
+                return;
+            }
+            collectUniforms();
         }
+    }
 
-        return shader;
+    void ShaderProgram::collectUniforms()
+    {
+        // uniforms outside of blocks, data shared by programs goes in a block, see block()
+        Uniforms.collect(ProgramName, Label);
     }
 
-    void ShaderProgram::checkShaderLinkage( const GLuint& program)
+    void ShaderProgram::shutdown()
     {
-        int status;
-        glGetProgramiv(program, GL_LINK_STATUS, &status);
-        if (status == GL_FALSE)
-        {
-            const int maxLen = 1000;
-			int len;
-			char errorBuffer[maxLen];
-			memset((void*)errorBuffer, 0, (size_t)maxLen);
-            glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-            std::cerr   << "Shader Linked with erros:\n"
-                        << errorBuffer << std::endl;
-            assert(0);
-        }
+        // the ProgramName is stored in an array and is managed by someone else
+        // some sort of communication needs to be set up to notify each other for shutdowns.
+        ProgramName = 0;
     }
 
     FullscreenQuad::FullscreenQuad()
@@ -182,6 +130,7 @@ namespace ogle {
 
         glBindBuffer(GL_ARRAY_BUFFER, BufferName);
         glBufferData(GL_ARRAY_BUFFER, ByteCount, glm::value_ptr(Verts[0]), GL_STATIC_DRAW);
+        OGLE_GPU_BUFFER(BufferName, ByteCount, "FullscreenQuad");
     }
 
     void FullscreenQuad::render()
@@ -192,6 +141,7 @@ namespace ogle {
 
     void FullscreenQuad::shutdown()
     {
+        GpuMemory::release(GpuMemory::BUFFER, BufferName);
         glDeleteBuffers(1, &BufferName);
         glDeleteVertexArrays(1, &VAO_Name);
     }
@@ -227,6 +177,7 @@ namespace ogle {
 
         glBindTexture(target, 0);
         delete [] data;
+        OGLE_GPU_TEXTURE(textureName, internalFormat, width, height, "ogle::initTexture");
         return textureName;
     }
 
@@ -246,6 +197,7 @@ namespace ogle {
         }
 
         glGenFramebuffers(1, &framebuffer.FramebufferName);
+        OGLE_GPU_FRAMEBUFFER(framebuffer.FramebufferName, "ogle::initFramebuffer");
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.FramebufferName);
 
         size_t buffer_count = framebuffer.TextureNames.size();
@@ -259,7 +211,7 @@ namespace ogle {
 
         // check for completeness
         ogle::checkFramebufferStatus();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
     }
 
     void checkFramebufferStatus()
@@ -317,57 +269,4 @@ namespace ogle {
             assert(0);
         }
     }
-
-    void   initGLEW()
-    {
-        glewExperimental=GL_TRUE;
-        GLenum err = glewInit();
-        if (err != GLEW_OK) {
-            /// if it fails here, its becuase there is no current opengl version,
-            /// don't call glewInit() until after a context has been made current.
-            fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-            exit( EXIT_FAILURE );
-        }
-        glGetError(); // GLEW has problems, clear that one that it creates.
-    }
-    
-    void initGLFW(const WindowDetails& window)
-    {
-        // /* Init GLFW */
-        // if( !glfwInit() )
-        //     exit( EXIT_FAILURE );
-
-        // glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        // glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
-        // glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-        // glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug);
-
-        // // https://www.opengl.org/wiki/Core_And_Compatibility_in_Contexts
-        // // As of opengl 3.2+
-        // // it states:
-        // //      "Recommendation: You should never use the forward compatibility bit. 
-        // //       It had a use for GL 3.0, but once 3.1 removed most of the stuff, it stopped having a use."
-        // // glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-        
-        // glfwWindow = glfwCreateWindow( window_width, window_height, window_name, NULL, NULL );
-        // if (!glfwWindow)
-        // {
-        //     glfwTerminate();
-        //     exit( EXIT_FAILURE );
-        // }
-
-        // glfwMakeContextCurrent(glfwWindow);
-        // glfwSwapInterval( 0 ); // Turn off vsync for benchmarking.
-        // cout << "[!] Warning, be sure that vsync is disabled in NVidia controller panel." << endl;
-
-        // int width, height;
-        // glfwGetFramebufferSize(glfwWindow, &width, &height);
-        // glViewport( 0, 0, (GLsizei)width, (GLsizei)height );
-        // glfwSetTime( 0.0 );
-    }
-    
-    void   setDataDir(int argc, char *argv[])
-    {
-
-    }
 }
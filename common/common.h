@@ -13,6 +13,10 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "shadersource.h"
+#include "uniformblocks.h"
+#include "uniforms.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -38,18 +42,23 @@ namespace ogle
     struct ShaderProgram
     {
         GLuint ProgramName;
-        std::map<std::string, GLint> Uniforms;
+        UniformTable Uniforms;  // after the first bind()
+        bool Linked;
+        std::string Label;
 
         ShaderProgram();
         ~ShaderProgram();
-        void init( const std::map<GLuint, std::string>& shaders );
+        /** defines make it one variant of the shaders, see shadersource.h */
+        void init( const std::map<GLuint, std::string>& shaders, const ShaderDefines& defines = ShaderDefines() );
         void bind();
+        /** resolve once and keep the handle, Uniforms[handle] is the location; waits for the program to link */
+        UniformHandle uniform(const UniformName& name);
+        /** where the program puts the members of a uniform (or storage) block; waits for the program to link */
+        bool block(const std::string& name, BlockLayout& layout, bool storage = false);
+        /** waits for the program to link and collects its uniforms, bind() and uniform() call it; asserts when it failed */
+        void link();
         void collectUniforms();
         void shutdown();
-
-    private:
-        GLuint createShader(GLenum type, const std::string& filename);
-        void   checkShaderLinkage( const GLuint& program);
     };
 
     struct FullscreenQuad
@@ -68,25 +77,10 @@ namespace ogle
         GLuint BufferName;
     };
 
-    struct WindowDetails
-    {
-        bool Visible;
-        int Width;
-        int Height;
-        std::string Name;
-    };
-
     GLuint initTexture(GLenum target, GLint internalFormat, GLuint componentCount, GLsizei width, GLsizei height, GLenum format, GLenum type);
     // framebuffer releated
     void initFramebuffer(Framebuffer& framebuffer);
     void checkFramebufferStatus();
-
-    // setup
-    typedef void (APIENTRY *key_call_back)(GLFWwindow*, int, int, int, int);
-    typedef void (APIENTRY *error_call_back)(int, const char*);
-    void   initGLEW();
-    void   initGLFW(const WindowDetails& window);
-    void   setDataDir(int argc, char *argv[]);
 }
 
 #endif // common_gl_helpers
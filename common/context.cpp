@@ -0,0 +1,622 @@
+#include "context.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef OGLE_EGL
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+using namespace ogle;
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // default length of a headless run, OGLE_FRAMES overrides it
+    const unsigned int DefaultHeadlessFrames = 1000;
+
+    std::atomic<bool> StopRequested(false);
+
+    void requestStop(int)
+    {
+        StopRequested.store(true, std::memory_order_relaxed);
+    }
+
+    void errorCallback(int error, const char* description)
+    {
+        std::cerr << "[!] Context: GLFW error " << error << ", " << description << std::endl;
+    }
+
+    bool wantsHeadless(const ContextConfig& config)
+    {
+        if (config.Backend != ContextConfig::AUTO)
+            return config.Backend == ContextConfig::EGL;
+        if (getenv("OGLE_HEADLESS") != nullptr)
+            return true;
+#if defined(__linux__)
+        const char* x11 = getenv("DISPLAY");
+        const char* wayland = getenv("WAYLAND_DISPLAY");
+        return (x11 == nullptr || x11[0] == 0) && (wayland == nullptr || wayland[0] == 0);
+#else
+        return false;
+#endif
+    }
+
+    /** glewExperimental for core profiles, a GLEW built for GLX has nothing to load without an X display */
+    bool loadFunctions()
+    {
+        glewExperimental = GL_TRUE;
+        GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+            err = GLEW_OK;
+#endif
+        if (err != GLEW_OK) {
+            std::cerr << "[!] Context: " << glewGetErrorString(err) << std::endl;
+            return false;
+        }
+        glGetError(); // GLEW has problems, clear that one that it creates.
+        return true;
+    }
+
+    unsigned int headlessFrames(const ContextConfig& config)
+    {
+        const char* frames = getenv("OGLE_FRAMES");
+        return frames != nullptr ? (unsigned int)strtoul(frames, nullptr, 10) : config.HeadlessFrames;
+    }
+
+    /** the state a new context starts with, as far as the experiments change it */
+    void resetState(GLuint framebuffer)
+    {
+        // the last one's work must not end up in the next one's first frames
+        glFinish();
+
+        // a callback an experiment installed may point into a suite module that is about to be
+        // unloaded, Application installs the common one from debug.cpp again after the reset
+        if (GLEW_KHR_debug || GLEW_VERSION_4_3)
+            glDebugMessageCallback(nullptr, nullptr);
+        else if (GLEW_ARB_debug_output)
+            glDebugMessageCallbackARB(nullptr, nullptr);
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+        glUseProgram(0);
+        if (GLEW_ARB_separate_shader_objects)
+            glBindProgramPipeline(0);
+        glBindVertexArray(0);
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+        const GLenum buffers[] = {
+            GL_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_PIXEL_PACK_BUFFER,
+            GL_PIXEL_UNPACK_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_DISPATCH_INDIRECT_BUFFER, GL_TEXTURE_BUFFER
+        };
+        for (GLenum target : buffers)
+            glBindBuffer(target, 0);
+
+        const GLenum indexed[][2] = {
+            { GL_UNIFORM_BUFFER, GL_MAX_UNIFORM_BUFFER_BINDINGS },
+            { GL_SHADER_STORAGE_BUFFER, GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS },
+            { GL_ATOMIC_COUNTER_BUFFER, GL_MAX_ATOMIC_COUNTER_BUFFER_BINDINGS },
+        };
+        for (const auto& target : indexed) {
+            GLint count = 0;
+            glGetIntegerv(target[1], &count);
+            for (GLint i=0; i<count; ++i)
+                glBindBufferBase(target[0], (GLuint)i, 0);
+            glBindBuffer(target[0], 0);
+        }
+
+        GLint units = 0;
+        glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &units);
+        GLint images = 0;
+        glGetIntegerv(GL_MAX_IMAGE_UNITS, &images);
+        if (GLEW_ARB_multi_bind) {
+            glBindTextures(0, units, nullptr);
+            glBindSamplers(0, units, nullptr);
+            glBindImageTextures(0, images, nullptr);
+        }
+        else {
+            const GLenum textures[] = {
+                GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_1D_ARRAY, GL_TEXTURE_2D_ARRAY,
+                GL_TEXTURE_RECTANGLE, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_BUFFER,
+                GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_2D_MULTISAMPLE_ARRAY
+            };
+            for (GLint unit=0; unit<units; ++unit) {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                for (GLenum target : textures)
+                    glBindTexture(target, 0);
+                glBindSampler((GLuint)unit, 0);
+            }
+            for (GLint unit=0; unit<images; ++unit)
+                glBindImageTexture((GLuint)unit, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDrawBuffer(framebuffer != 0 ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+        glReadBuffer(framebuffer != 0 ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+
+        const GLenum disabled[] = {
+            GL_BLEND, GL_COLOR_LOGIC_OP, GL_CULL_FACE, GL_DEPTH_CLAMP, GL_DEPTH_TEST, GL_POLYGON_OFFSET_FILL,
+            GL_POLYGON_OFFSET_LINE, GL_POLYGON_OFFSET_POINT, GL_PRIMITIVE_RESTART, GL_PRIMITIVE_RESTART_FIXED_INDEX,
+            GL_PROGRAM_POINT_SIZE, GL_RASTERIZER_DISCARD, GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_ALPHA_TO_ONE,
+            GL_SAMPLE_COVERAGE, GL_SAMPLE_SHADING, GL_SAMPLE_MASK, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+            GL_TEXTURE_CUBE_MAP_SEAMLESS, GL_LINE_SMOOTH, GL_POLYGON_SMOOTH, GL_FRAMEBUFFER_SRGB
+        };
+        for (GLenum cap : disabled)
+            glDisable(cap);
+        glEnable(GL_DITHER);
+        glEnable(GL_MULTISAMPLE);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        glStencilMask(~0u);
+        glDepthFunc(GL_LESS);
+        glBlendFunc(GL_ONE, GL_ZERO);
+        glBlendEquation(GL_FUNC_ADD);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClearDepth(1.0);
+        glClearStencil(0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPointSize(1.0f);
+        glLineWidth(1.0f);
+
+        // errors the last one left behind aren't the next one's
+        while (glGetError() != GL_NO_ERROR) {}
+    }
+}
+
+ContextConfig::ContextConfig()
+    : Backend(AUTO)
+    , Width(640)
+    , Height(480)
+    , Name("ogle")
+    , MajorVersion(4)
+    , MinorVersion(5)
+    , ForwardCompatible(false)
+    , Debug(true)
+    , SwapInterval(0)
+    , HeadlessFrames(DefaultHeadlessFrames)
+{
+
+}
+
+struct Context::State
+{
+    State()
+        : Window(nullptr)
+        , Headless(false)
+        , Framebuffer(0)
+        , ColorBuffer(0)
+        , DepthBuffer(0)
+        , Width(0)
+        , Height(0)
+        , Frames(0)
+        , MaxFrames(0)
+        , Close(false)
+        , TimeOrigin(Clock::now())
+#ifdef OGLE_EGL
+        , Display(EGL_NO_DISPLAY)
+        , Surface(EGL_NO_SURFACE)
+        , EglContext(EGL_NO_CONTEXT)
+#endif
+    {
+
+    }
+
+    GLFWwindow* Window;
+    bool Headless;
+    GLuint Framebuffer;
+    GLuint ColorBuffer;
+    GLuint DepthBuffer;
+    int Width;
+    int Height;
+    unsigned int Frames;
+    unsigned int MaxFrames;
+    bool Close;
+    Clock::time_point TimeOrigin;
+    ContextConfig Created;
+
+#ifdef OGLE_EGL
+    EGLDisplay Display;
+    EGLSurface Surface;
+    EGLContext EglContext;
+#endif
+
+    bool initGLFW(const ContextConfig& config)
+    {
+        glfwSetErrorCallback(errorCallback);
+        if (!glfwInit())
+            return false;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, config.MajorVersion);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, config.MinorVersion);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, config.ForwardCompatible ? GL_TRUE : GL_FALSE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, config.Debug ? GL_TRUE : GL_FALSE);
+
+        Window = glfwCreateWindow(config.Width, config.Height, config.Name.c_str(), NULL, NULL);
+        if (!Window) {
+            glfwTerminate();
+            return false;
+        }
+
+        glfwMakeContextCurrent(Window);
+        glfwSwapInterval(config.SwapInterval);
+        glfwGetFramebufferSize(Window, &Width, &Height);
+        return true;
+    }
+
+    bool initEGL(const ContextConfig& config)
+    {
+#ifdef OGLE_EGL
+        // no window system at all when the driver can do it, the default display otherwise
+        const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (client_extensions != nullptr && strstr(client_extensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (get_platform_display != nullptr)
+                Display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (Display == EGL_NO_DISPLAY)
+            Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major = 0;
+        EGLint minor = 0;
+        if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &major, &minor)) {
+            std::cerr << "[!] Context: couldn't initialize EGL, error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cerr << "[!] Context: the EGL driver has no desktop OpenGL." << std::endl;
+            return false;
+        }
+
+        const char* display_extensions = eglQueryString(Display, EGL_EXTENSIONS);
+        bool surfaceless = display_extensions != nullptr && strstr(display_extensions, "EGL_KHR_surfaceless_context") != nullptr;
+
+        EGLint config_attributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+            EGL_NONE
+        };
+        EGLConfig egl_config = nullptr;
+        EGLint config_count = 0;
+        if (!eglChooseConfig(Display, config_attributes, &egl_config, 1, &config_count) || config_count == 0) {
+            std::cerr << "[!] Context: no EGL config for desktop OpenGL." << std::endl;
+            return false;
+        }
+
+        EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, config.MajorVersion,
+            EGL_CONTEXT_MINOR_VERSION, config.MinorVersion,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, config.ForwardCompatible ? EGL_TRUE : EGL_FALSE,
+            EGL_CONTEXT_OPENGL_DEBUG, config.Debug ? EGL_TRUE : EGL_FALSE,
+            EGL_NONE
+        };
+        EglContext = eglCreateContext(Display, egl_config, EGL_NO_CONTEXT, context_attributes);
+        if (EglContext == EGL_NO_CONTEXT) {
+            std::cerr << "[!] Context: couldn't create a GL " << config.MajorVersion << "." << config.MinorVersion
+                      << " core context with EGL, error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+
+        // the pbuffer only exists to make the context current, nothing is drawn to it
+        if (!surfaceless) {
+            EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            Surface = eglCreatePbufferSurface(Display, egl_config, pbuffer_attributes);
+        }
+        if (!eglMakeCurrent(Display, Surface, Surface, EglContext)) {
+            std::cerr << "[!] Context: couldn't make the EGL context current, error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+            return false;
+        }
+
+        Width = config.Width;
+        Height = config.Height;
+        std::cout << "[context] headless EGL " << major << "." << minor << (surfaceless ? ", surfaceless" : ", pbuffer")
+                  << ", rendering to a " << Width << "x" << Height << " offscreen framebuffer" << std::endl;
+        return true;
+#else
+        std::cerr << "[!] Context: built without EGL, can't run headless." << std::endl;
+        return false;
+#endif
+    }
+
+    void deleteFramebuffer()
+    {
+        if (Framebuffer == 0)
+            return;
+        glDeleteFramebuffers(1, &Framebuffer);
+        glDeleteRenderbuffers(1, &ColorBuffer);
+        glDeleteRenderbuffers(1, &DepthBuffer);
+        Framebuffer = 0;
+        ColorBuffer = 0;
+        DepthBuffer = 0;
+    }
+
+    /** the stand in for the back buffer of a window */
+    bool initFramebuffer()
+    {
+        glGenRenderbuffers(1, &ColorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, ColorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+        glGenRenderbuffers(1, &DepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &Framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, DepthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[!] Context: the offscreen framebuffer is incomplete." << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+Context::State* Context::Instance = nullptr;
+
+bool Context::init(const ContextConfig& config)
+{
+    if (Instance)
+        return true;
+
+    Instance = new State;
+    State& state = *Instance;
+    state.Created = config;
+
+    bool headless = wantsHeadless(config);
+    if (!headless && !state.initGLFW(config)) {
+        std::cerr << "[!] Context: couldn't open a window, trying headless." << std::endl;
+        headless = config.Backend == ContextConfig::AUTO;
+        if (!headless) {
+            shutdown();
+            return false;
+        }
+    }
+    if (headless && !state.initEGL(config)) {
+        shutdown();
+        return false;
+    }
+    state.Headless = headless;
+
+    if (!loadFunctions() || (headless && !state.initFramebuffer())) {
+        shutdown();
+        return false;
+    }
+
+    if (headless) {
+        state.MaxFrames = headlessFrames(config);
+        signal(SIGINT, requestStop);
+        signal(SIGTERM, requestStop);
+    }
+
+    glViewport(0, 0, (GLsizei)state.Width, (GLsizei)state.Height);
+    setTime(0.0);
+    return true;
+}
+
+bool Context::initialized()
+{
+    return Instance != nullptr;
+}
+
+void Context::reset(const ContextConfig& config)
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    if (state.Window) {
+        glfwSetWindowTitle(state.Window, config.Name.c_str());
+        glfwSetWindowSize(state.Window, config.Width, config.Height);
+        glfwSwapInterval(config.SwapInterval);
+        glfwSetKeyCallback(state.Window, nullptr);
+        glfwSetMouseButtonCallback(state.Window, nullptr);
+        glfwSetWindowShouldClose(state.Window, GL_FALSE);
+        glfwGetFramebufferSize(state.Window, &state.Width, &state.Height);
+    }
+    else {
+        if (config.Width != state.Width || config.Height != state.Height) {
+            state.deleteFramebuffer();
+            state.Width = config.Width;
+            state.Height = config.Height;
+            if (!state.initFramebuffer())
+                std::cerr << "[!] Context: couldn't resize the offscreen framebuffer to " << state.Width << "x" << state.Height << std::endl;
+        }
+        state.Frames = 0;
+        state.MaxFrames = headlessFrames(config);
+    }
+    state.Close = false;
+
+    resetState(state.Framebuffer);
+    glViewport(0, 0, (GLsizei)state.Width, (GLsizei)state.Height);
+    setTime(0.0);
+}
+
+const ContextConfig& Context::created()
+{
+    static const ContextConfig none;
+    return Instance ? Instance->Created : none;
+}
+
+bool Context::headless()
+{
+    return Instance && Instance->Headless;
+}
+
+GLFWwindow* Context::window()
+{
+    return Instance ? Instance->Window : nullptr;
+}
+
+GLuint Context::defaultFramebuffer()
+{
+    return Instance ? Instance->Framebuffer : 0;
+}
+
+void Context::framebufferSize(int& width, int& height)
+{
+    width = 0;
+    height = 0;
+    if (!Instance)
+        return;
+    if (Instance->Window)
+        glfwGetFramebufferSize(Instance->Window, &Instance->Width, &Instance->Height);
+    width = Instance->Width;
+    height = Instance->Height;
+}
+
+bool Context::extensionSupported(const char* extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i=0; i<count; ++i) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (name != nullptr && strcmp(name, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool Context::shouldClose()
+{
+    if (!Instance)
+        return true;
+    if (Instance->Window)
+        return glfwWindowShouldClose(Instance->Window) != 0;
+    return Instance->Close || StopRequested.load(std::memory_order_relaxed);
+}
+
+void Context::setShouldClose(bool close)
+{
+    if (!Instance)
+        return;
+    if (Instance->Window)
+        glfwSetWindowShouldClose(Instance->Window, close ? GL_TRUE : GL_FALSE);
+    Instance->Close = close;
+}
+
+void Context::swapBuffers()
+{
+    if (!Instance)
+        return;
+    if (Instance->Window) {
+        glfwSwapBuffers(Instance->Window);
+        return;
+    }
+
+    // nothing to present, keep the frame moving to the GPU the way a swap would
+    glFlush();
+    Instance->Frames++;
+    if (Instance->MaxFrames != 0 && Instance->Frames >= Instance->MaxFrames)
+        Instance->Close = true;
+}
+
+void Context::pollEvents()
+{
+    if (Instance && Instance->Window)
+        glfwPollEvents();
+}
+
+double Context::time()
+{
+    if (!Instance)
+        return 0.0;
+    return std::chrono::duration<double>(Clock::now() - Instance->TimeOrigin).count();
+}
+
+void Context::setTime(double seconds)
+{
+    if (!Instance)
+        return;
+    Instance->TimeOrigin = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+void Context::setKeyCallback(GLFWkeyfun callback)
+{
+    if (Instance && Instance->Window)
+        glfwSetKeyCallback(Instance->Window, callback);
+}
+
+void Context::setMouseButtonCallback(GLFWmousebuttonfun callback)
+{
+    if (Instance && Instance->Window)
+        glfwSetMouseButtonCallback(Instance->Window, callback);
+}
+
+void Context::cursorPos(double& x, double& y)
+{
+    x = 0.0;
+    y = 0.0;
+    if (Instance && Instance->Window)
+        glfwGetCursorPos(Instance->Window, &x, &y);
+}
+
+void Context::shutdown()
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    state.deleteFramebuffer();
+
+    if (state.Window) {
+        glfwDestroyWindow(state.Window);
+        glfwTerminate();
+    }
+
+#ifdef OGLE_EGL
+    if (state.Display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(state.Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (state.Surface != EGL_NO_SURFACE)
+            eglDestroySurface(state.Display, state.Surface);
+        if (state.EglContext != EGL_NO_CONTEXT)
+            eglDestroyContext(state.Display, state.EglContext);
+        eglTerminate(state.Display);
+    }
+#endif
+
+    if (state.Headless) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+    }
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+Context::Context()
+{
+
+}
+
+Context::~Context()
+{
+
+}
+
+Context::Context(const Context& other)
+{
+
+}
+
+Context& Context::operator=(const Context& other)
+{
+    return *this;
+}
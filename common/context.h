@@ -0,0 +1,127 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+/****************************************************************
+
+    The GL context and what the runloops need from the window,
+    so experiments run the same with or without a display.
+
+    GLFW opens a window and presents to it. EGL creates a context
+    without any window, surfaceless when the driver has
+    EGL_KHR_surfaceless_context, on a 1x1 pbuffer otherwise, and
+    every frame goes to an offscreen framebuffer of Width x Height
+    that stands in for the back buffer. Code that used to bind
+    framebuffer 0 binds defaultFramebuffer() instead.
+
+    AUTO picks EGL when OGLE_HEADLESS is in the environment, or on
+    Linux when neither DISPLAY nor WAYLAND_DISPLAY is set, and falls
+    back to EGL when GLFW can't create a window. EGL needs the
+    library at build time (OGLE_EGL, set by CMake when libEGL is
+    found), Mesa's llvmpipe is enough for CI.
+
+    There is no input without a window: a headless run stops after
+    HeadlessFrames frames (OGLE_FRAMES in the environment overrides
+    it, 0 runs until SIGINT/SIGTERM) so shutdown still prints every
+    summary.
+
+    init() loads the GL entry points with GLEW as well. The suite
+    keeps one context for all of its experiments and calls
+    reset() between them instead of shutdown() and init().
+
+    Usage:
+        ogle::ContextConfig config;
+        config.Name = "round_trip";
+        ogle::Context::init(config);
+        while (!ogle::Context::shouldClose()) {
+            render();
+            ogle::Context::swapBuffers();
+            ogle::Context::pollEvents();
+        }
+        ogle::Context::shutdown();
+
+****************************************************************/
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <string>
+
+namespace ogle
+{
+    struct ContextConfig
+    {
+        enum backend
+        {
+            AUTO,
+            GLFW,
+            EGL
+        };
+
+        ContextConfig();
+
+        backend Backend;
+        int Width;
+        int Height;
+        std::string Name;
+        int MajorVersion;
+        int MinorVersion;
+        bool ForwardCompatible;
+        bool Debug;
+        /** 0 turns vsync off for benchmarking */
+        int SwapInterval;
+        unsigned int HeadlessFrames;
+    };
+
+    class Context
+    {
+    public:
+        /** makes the context current, the viewport covers the default framebuffer */
+        static bool init(const ContextConfig& config = ContextConfig());
+        static bool initialized();
+        /**
+            hands the context to the next user as init() would have: size, vsync, frame
+            limit and title from config, no input callbacks, GL state at its defaults.
+            The version and debug flag stay what the context was created with.
+        */
+        static void reset(const ContextConfig& config);
+        /** the config init() was called with, reset() doesn't change the version, profile or debug flag */
+        static const ContextConfig& created();
+        static bool headless();
+        /** nullptr when headless */
+        static GLFWwindow* window();
+
+        /** the window's framebuffer 0, or the offscreen one when headless */
+        static GLuint defaultFramebuffer();
+        static void framebufferSize(int& width, int& height);
+        /** needs GLEW */
+        static bool extensionSupported(const char* extension);
+
+        static bool shouldClose();
+        static void setShouldClose(bool close);
+        static void swapBuffers();
+        static void pollEvents();
+
+        /** seconds, like glfwGetTime() */
+        static double time();
+        static void setTime(double seconds);
+
+        /** input, nothing happens when headless */
+        static void setKeyCallback(GLFWkeyfun callback);
+        static void setMouseButtonCallback(GLFWmousebuttonfun callback);
+        static void cursorPos(double& x, double& y);
+
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        Context();
+        ~Context();
+        Context(const Context& other);
+        Context& operator=(const Context& other);
+    };
+}
+
+#endif // CONTEXT_H
@@ -0,0 +1,44 @@
+#include "csv.h"
+
+using namespace ogle;
+
+void Csv::writeField(std::ostream& out, const std::string& field)
+{
+    out << '"';
+    for (char c : field) {
+        if (c == '"')
+            out << '"';
+        out << c;
+    }
+    out << '"';
+}
+
+void Csv::writeRow(std::ostream& out, const std::vector<std::string>& fields)
+{
+    for (size_t i=0; i<fields.size(); ++i) {
+        if (i > 0)
+            out << ',';
+        writeField(out, fields[i]);
+    }
+    out << '\n';
+}
+
+Csv::Csv()
+{
+
+}
+
+Csv::~Csv()
+{
+
+}
+
+Csv::Csv(const Csv& other)
+{
+
+}
+
+Csv& Csv::operator=(const Csv& other)
+{
+    return *this;
+}
@@ -0,0 +1,34 @@
+#ifndef CSV_H
+#define CSV_H
+
+/****************************************************************
+
+    Quoting for the CSV files the benchmark runner and the sweep
+    tool write. Every field is put in double quotes and a quote
+    inside it is doubled (RFC 4180), so names and params can hold
+    commas, quotes and semicolons.
+
+****************************************************************/
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    class Csv
+    {
+    public:
+        static void writeField(std::ostream& out, const std::string& field);
+        /** the fields separated by commas, ended by a newline */
+        static void writeRow(std::ostream& out, const std::vector<std::string>& fields);
+
+    private:
+        Csv();
+        ~Csv();
+        Csv(const Csv& other);
+        Csv& operator=(const Csv& other);
+    };
+}
+
+#endif // CSV_H
@@ -42,6 +42,8 @@ void debugOutput(
 
 void Debug::init()
 {
+    // the suite runs one application after the other, each one inits and shuts down
+    InstanceDestroyed = false;
     if (State *i = instance())
     {
         i->init();
@@ -0,0 +1,215 @@
+#include "framearena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    // blocks start on a cache line
+    const size_t BlockAlignment = 64;
+
+    char* alignUp(char* ptr, size_t alignment)
+    {
+        uintptr_t value = (uintptr_t)ptr;
+        return (char*)((value + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    }
+}
+
+FrameArena::FrameArena()
+    : Memory(nullptr)
+    , Block(nullptr)
+    , Capacity(0)
+    , Offset(0)
+    , HighWater(0)
+    , OverflowBytes(0)
+    , OverflowCount(0)
+{
+
+}
+
+FrameArena::~FrameArena()
+{
+    shutdown();
+}
+
+void FrameArena::init(size_t capacity)
+{
+    shutdown();
+
+    Memory = (char*)malloc(capacity + BlockAlignment);
+    if (Memory == nullptr) {
+        std::cerr << "[!] FrameArena: could not reserve " << capacity << " bytes." << std::endl;
+        return;
+    }
+    Block = alignUp(Memory, BlockAlignment);
+    Capacity = capacity;
+    Offset = 0;
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    if (Block != nullptr) {
+        char* ptr = alignUp(Block + Offset, alignment);
+        size_t end = (ptr - Block) + bytes;
+        if (end <= Capacity) {
+            Offset = end;
+            return ptr;
+        }
+    }
+
+    // doesn't fit, borrow from the heap until reset() makes the block big enough
+    void* memory = malloc(bytes + alignment);
+    if (memory == nullptr)
+        return nullptr;
+    Overflow.push_back(memory);
+    OverflowBytes += bytes + alignment;
+    OverflowCount++;
+    return alignUp((char*)memory, alignment);
+}
+
+void FrameArena::reset()
+{
+    size_t frame_bytes = Offset + OverflowBytes;
+    HighWater = std::max(HighWater, frame_bytes);
+
+    if (!Overflow.empty()) {
+        for (void* memory : Overflow)
+            free(memory);
+        Overflow.clear();
+        OverflowBytes = 0;
+
+        // grow with room to spare so a slowly growing frame doesn't overflow every time
+        size_t capacity = std::max(Capacity * 2, frame_bytes + frame_bytes / 2);
+        size_t overflows = OverflowCount;
+        init(capacity);
+        OverflowCount = overflows;
+    }
+
+    Offset = 0;
+}
+
+size_t FrameArena::used() const
+{
+    return Offset + OverflowBytes;
+}
+
+size_t FrameArena::capacity() const
+{
+    return Capacity;
+}
+
+size_t FrameArena::highWater() const
+{
+    return HighWater;
+}
+
+size_t FrameArena::overflows() const
+{
+    return OverflowCount;
+}
+
+void FrameArena::shutdown()
+{
+    for (void* memory : Overflow)
+        free(memory);
+    Overflow.clear();
+    OverflowBytes = 0;
+
+    free(Memory);
+    Memory = nullptr;
+    Block = nullptr;
+    Capacity = 0;
+    Offset = 0;
+}
+
+FrameArena::FrameArena(const FrameArena& other)
+{
+
+}
+
+FrameArena& FrameArena::operator=(const FrameArena& other)
+{
+    return *this;
+}
+
+FrameArenaRing::FrameArenaRing()
+    : Frames(0)
+    , Current(0)
+    , Fenced(false)
+{
+    for (size_t i=0; i<MaxFrames; ++i)
+        Fences[i] = nullptr;
+}
+
+FrameArenaRing::~FrameArenaRing()
+{
+
+}
+
+void FrameArenaRing::init(size_t frames, size_t capacity, bool fenced)
+{
+    Frames = std::min(std::max(frames, (size_t)1), MaxFrames);
+    Current = 0;
+    Fenced = fenced && GLEW_ARB_sync == GL_TRUE;
+    if (fenced && !Fenced)
+        std::cerr << "[!] FrameArenaRing: GL_ARB_sync is not supported, arenas are reused without waiting on the GPU." << std::endl;
+
+    for (size_t i=0; i<Frames; ++i)
+        Arenas[i].init(capacity);
+}
+
+void FrameArenaRing::beginFrame()
+{
+    Current = (Current + 1) % Frames;
+
+    if (Fences[Current] != nullptr) {
+        GLsync fence = (GLsync)Fences[Current];
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        Fences[Current] = nullptr;
+    }
+
+    Arenas[Current].reset();
+}
+
+void FrameArenaRing::endFrame()
+{
+    if (!Fenced)
+        return;
+
+    if (Fences[Current] != nullptr)
+        glDeleteSync((GLsync)Fences[Current]);
+    Fences[Current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+FrameArena& FrameArenaRing::current()
+{
+    return Arenas[Current];
+}
+
+void FrameArenaRing::shutdown()
+{
+    for (size_t i=0; i<MaxFrames; ++i) {
+        if (Fences[i] != nullptr)
+            glDeleteSync((GLsync)Fences[i]);
+        Fences[i] = nullptr;
+        Arenas[i].shutdown();
+    }
+    Frames = 0;
+}
+
+FrameArenaRing::FrameArenaRing(const FrameArenaRing& other)
+{
+
+}
+
+FrameArenaRing& FrameArenaRing::operator=(const FrameArenaRing& other)
+{
+    return *this;
+}
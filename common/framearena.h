@@ -0,0 +1,140 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+/****************************************************************
+
+    Linear allocators for data that only lives for one frame
+    (MVP arrays, staging copies, readbacks, uniform payloads).
+
+    FrameArena hands out memory by bumping an offset into one
+    block and gives all of it back at once with reset(), once per
+    frame. Nothing is freed on its own, deallocate is a no-op.
+    When a frame needs more than the block holds the rest comes
+    from the heap, and the next reset() grows the block so it
+    only happens while the program warms up.
+
+    FrameArenaRing keeps 2 or 3 arenas and moves to the next one
+    every frame, for memory the GPU may still read after the CPU
+    is done with the frame (client side arrays, glBufferSubData
+    sources the driver copies late). With fencing on, an arena is
+    only reset once the GPU finished the frame that used it last.
+
+    ArenaAllocator makes STL containers allocate from an arena:
+        ogle::FrameVector<glm::mat4> mvp(count, ogle::ArenaAllocator<glm::mat4>(arena));
+    Growing a container leaves its old storage behind in the
+    arena until reset(), reserve up front when the size is known.
+
+    Not thread safe, use one arena per thread.
+
+    extensions required for fenced FrameArenaRing:
+    GL_ARB_sync
+
+****************************************************************/
+
+#include <cstddef>
+#include <vector>
+
+namespace ogle
+{
+    class FrameArena
+    {
+    public:
+        FrameArena();
+        ~FrameArena();
+
+        void init(size_t capacity);
+
+        void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+        template <typename T>
+        T* allocate(size_t count)
+        {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        /** gives back everything allocated since the last reset */
+        void reset();
+
+        size_t used() const;
+        size_t capacity() const;
+        /** most bytes a single frame used */
+        size_t highWater() const;
+        /** allocations that didn't fit and went to the heap, since init */
+        size_t overflows() const;
+
+        void shutdown();
+
+    private:
+        char* Memory;       // what malloc returned, Block is aligned inside it
+        char* Block;
+        size_t Capacity;
+        size_t Offset;
+        size_t HighWater;
+
+        std::vector<void*> Overflow;
+        size_t OverflowBytes;
+        size_t OverflowCount;
+
+        FrameArena(const FrameArena& other);
+        FrameArena& operator=(const FrameArena& other);
+    };
+
+    class FrameArenaRing
+    {
+    public:
+        static constexpr size_t MaxFrames = 4;
+
+        FrameArenaRing();
+        ~FrameArenaRing();
+
+        /** frames arenas of capacity bytes each, fenced waits for the GPU before reusing one */
+        void init(size_t frames, size_t capacity, bool fenced = true);
+
+        /** moves to the next arena and resets it */
+        void beginFrame();
+        /** marks the end of the GPU work that may read the current arena */
+        void endFrame();
+
+        FrameArena& current();
+        void shutdown();
+
+    private:
+        FrameArena Arenas[MaxFrames];
+        void* Fences[MaxFrames];    // GLsync
+        size_t Frames;
+        size_t Current;
+        bool Fenced;
+
+        FrameArenaRing(const FrameArenaRing& other);
+        FrameArenaRing& operator=(const FrameArenaRing& other);
+    };
+
+    /** STL allocator on top of a FrameArena, deallocate does nothing */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        explicit ArenaAllocator(FrameArena& arena) : Arena(&arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : Arena(other.arena()) {}
+
+        T* allocate(size_t count) { return Arena->allocate<T>(count); }
+        void deallocate(T*, size_t) {}
+
+        FrameArena* arena() const { return Arena; }
+
+    private:
+        FrameArena* Arena;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+    template <typename T, typename U>
+    bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+    template <typename T>
+    using FrameVector = std::vector<T, ArenaAllocator<T>>;
+}
+
+#endif // FRAMEARENA_H
@@ -0,0 +1,149 @@
+#include "frametimes.h"
+#include "hdrhistogram.h"
+
+#include <atomic>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+
+using namespace ogle;
+
+namespace {
+    // one hour, a stall longer than that is counted at the top
+    const int64_t HighestTrackable = 3600LL * 1000 * 1000;
+
+    const char* Names[FrameTimes::MAX] = { "cpu", "gpu", "present" };
+
+    std::atomic<bool> PrintRequested(false);
+
+    void requestPrint(int)
+    {
+        PrintRequested.store(true, std::memory_order_relaxed);
+    }
+}
+
+struct FrameTimes::State
+{
+    State()
+        : LastEnd(-1.0)
+    {
+        for (int i=0; i<MAX; ++i)
+            Histograms[i] = new HdrHistogram(HighestTrackable, 3);
+    }
+
+    ~State()
+    {
+        for (int i=0; i<MAX; ++i)
+            delete Histograms[i];
+    }
+
+    HdrHistogram* Histograms[MAX];
+    double LastEnd;
+};
+
+FrameTimes::State* FrameTimes::Instance = nullptr;
+
+void FrameTimes::init()
+{
+    if (Instance)
+        return;
+
+    Instance = new State;
+#ifdef SIGUSR1
+    signal(SIGUSR1, requestPrint);
+#endif
+}
+
+void FrameTimes::endFrame(double cpuMicroseconds, double nowMicroseconds)
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    state.Histograms[CPU]->record((int64_t)(cpuMicroseconds + 0.5));
+    if (state.LastEnd >= 0.0)
+        state.Histograms[PRESENT]->record((int64_t)(nowMicroseconds - state.LastEnd + 0.5));
+    state.LastEnd = nowMicroseconds;
+
+    if (PrintRequested.exchange(false, std::memory_order_relaxed))
+        printSummary();
+}
+
+void FrameTimes::gpuFrame(double microseconds)
+{
+    if (!Instance)
+        return;
+
+    Instance->Histograms[GPU]->record((int64_t)(microseconds + 0.5));
+}
+
+const HdrHistogram* FrameTimes::histogram(kind k)
+{
+    if (!Instance || k < 0 || k >= MAX)
+        return nullptr;
+    return Instance->Histograms[k];
+}
+
+void FrameTimes::printSummary()
+{
+    if (!Instance || Instance->Histograms[CPU]->count() == 0)
+        return;
+
+    const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+    std::cout << "Frame times in milliseconds, " << Instance->Histograms[CPU]->count() << " frames:\n";
+    std::cout << std::left << std::setw(12) << "" << std::right
+              << std::setw(10) << "mean"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p90"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9"
+              << std::setw(10) << "p99.99"
+              << std::setw(10) << "max" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (int i=0; i<MAX; ++i) {
+        const HdrHistogram& histogram = *Instance->Histograms[i];
+        if (histogram.count() == 0)
+            continue;
+        std::cout << std::left << std::setw(12) << Names[i] << std::right
+                  << std::setw(10) << histogram.mean() * 0.001;
+        for (double percentile : percentiles)
+            std::cout << std::setw(10) << histogram.valueAtPercentile(percentile) * 0.001;
+        std::cout << std::setw(10) << histogram.max() * 0.001 << "\n";
+        if (histogram.clamped() > 0)
+            std::cout << "[!] " << histogram.clamped() << " " << Names[i] << " frames took longer than an hour" << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::endl;
+}
+
+void FrameTimes::shutdown()
+{
+    if (!Instance)
+        return;
+
+#ifdef SIGUSR1
+    signal(SIGUSR1, SIG_DFL);
+#endif
+    delete Instance;
+    Instance = nullptr;
+}
+
+FrameTimes::FrameTimes()
+{
+
+}
+
+FrameTimes::~FrameTimes()
+{
+
+}
+
+FrameTimes::FrameTimes(const FrameTimes& other)
+{
+
+}
+
+FrameTimes& FrameTimes::operator=(const FrameTimes& other)
+{
+    return *this;
+}
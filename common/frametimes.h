@@ -0,0 +1,63 @@
+#ifndef FRAMETIMES_H
+#define FRAMETIMES_H
+
+/****************************************************************
+
+    Frame time distributions for the whole run.
+
+    Three HdrHistograms, in microseconds: CPU frame time (the
+    Profiler's frame zone), GPU frame time (the same zone's
+    GL_TIMESTAMP queries, recorded when they are resolved a few
+    frames later) and the present interval (from one endFrame()
+    to the next, the runloops call it right after the swap).
+    Nothing is printed while running and recording never
+    allocates, the averages an FPS counter shows hide the hitches,
+    the percentiles up to p99.99 and the max don't.
+
+    Profiler::init() calls init(), Profiler::endFrame() records,
+    Profiler::printSummary() prints the percentiles. Sending
+    SIGUSR1 to a running experiment prints them too, from the
+    next endFrame() on the render thread:
+        kill -USR1 $(pidof round_trip)
+
+****************************************************************/
+
+#include <cstdint>
+
+namespace ogle
+{
+    class HdrHistogram;
+
+    class FrameTimes
+    {
+    public:
+        enum kind
+        {
+            CPU,
+            GPU,
+            PRESENT,
+            MAX
+        };
+
+        static void init();
+        /** cpuMicroseconds of the frame that just ended, now on the same clock, prints when SIGUSR1 came in */
+        static void endFrame(double cpuMicroseconds, double nowMicroseconds);
+        /** a frame's GPU time, known some frames after it ended */
+        static void gpuFrame(double microseconds);
+
+        static const HdrHistogram* histogram(kind k);
+        static void printSummary();
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        FrameTimes();
+        ~FrameTimes();
+        FrameTimes(const FrameTimes& other);
+        FrameTimes& operator=(const FrameTimes& other);
+    };
+}
+
+#endif // FRAMETIMES_H
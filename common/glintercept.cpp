@@ -0,0 +1,804 @@
+#include "glintercept.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    namespace category
+    {
+        enum type
+        {
+            OTHER,
+            DRAW,
+            DISPATCH,
+            BIND,
+            UNIFORM,
+            TRANSFER,
+            MAX
+        };
+    }
+
+    struct Entry
+    {
+        const char* Name;
+        category::type Category;
+        uint64_t FrameCalls;
+        uint64_t TotalCalls;
+    };
+
+    struct Counters
+    {
+        std::vector<Entry> Entries;
+        GLCallStats Frame;   // bytes and redundant binds, the call counts live in Entries
+
+        // shadow of the bind points, used to spot redundant binds
+        GLenum ActiveTexture;
+        std::map<GLenum, GLuint> Buffers;
+        std::map<std::pair<GLenum, GLuint>, GLuint> IndexedBuffers;
+        std::map<std::pair<GLenum, GLenum>, GLuint> Textures;   // (texture unit, target)
+        std::map<GLenum, GLuint> Framebuffers;
+        GLuint VertexArray;
+        GLuint Program;
+        GLuint ProgramPipeline;
+        GLuint Renderbuffer;
+
+        Counters()
+            : ActiveTexture(GL_TEXTURE0)
+            , VertexArray(0)
+            , Program(0)
+            , ProgramPipeline(0)
+            , Renderbuffer(0)
+        {}
+    };
+
+    Counters* Active = nullptr;
+
+    int addEntry(const char* name, category::type cat)
+    {
+        Entry entry = { name, cat, 0, 0 };
+        Active->Entries.push_back(entry);
+        return (int)Active->Entries.size() - 1;
+    }
+
+    inline void countCall(int id)
+    {
+        if (Active)
+            Active->Entries[id].FrameCalls++;
+    }
+
+    template <typename T>
+    void bind(T& bound, T name)
+    {
+        if (bound == name)
+            Active->Frame.RedundantBinds++;
+        bound = name;
+    }
+
+    /** deleted objects fall back to 0 on every bind point they were bound to */
+    template <typename Key>
+    void forget(std::map<Key, GLuint>& bound, GLsizei n, const GLuint* names)
+    {
+        for (auto& kv : bound) {
+            if (std::find(names, names + n, kv.second) != names + n)
+                kv.second = 0;
+        }
+    }
+
+    void forget(GLuint& bound, GLsizei n, const GLuint* names)
+    {
+        if (std::find(names, names + n, bound) != names + n)
+            bound = 0;
+    }
+
+    /** ignores GL_PACK/UNPACK_ALIGNMENT and row lengths, close enough for counting */
+    uint64_t pixelBytes(GLenum format, GLenum type)
+    {
+        switch (type) {
+            case GL_UNSIGNED_BYTE_3_3_2:
+            case GL_UNSIGNED_BYTE_2_3_3_REV:
+                return 1;
+            case GL_UNSIGNED_SHORT_5_6_5:
+            case GL_UNSIGNED_SHORT_5_6_5_REV:
+            case GL_UNSIGNED_SHORT_4_4_4_4:
+            case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+            case GL_UNSIGNED_SHORT_5_5_5_1:
+            case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+                return 2;
+            case GL_UNSIGNED_INT_8_8_8_8:
+            case GL_UNSIGNED_INT_8_8_8_8_REV:
+            case GL_UNSIGNED_INT_10_10_10_2:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_24_8:
+            case GL_UNSIGNED_INT_10F_11F_11F_REV:
+            case GL_UNSIGNED_INT_5_9_9_9_REV:
+                return 4;
+            case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+                return 8;
+        }
+
+        uint64_t components = 4;
+        switch (format) {
+            case GL_RED: case GL_GREEN: case GL_BLUE: case GL_ALPHA:
+            case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+                components = 1; break;
+            case GL_RG: case GL_RG_INTEGER:
+                components = 2; break;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+                components = 3; break;
+        }
+
+        uint64_t size = 1;
+        switch (type) {
+            case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT:
+                size = 2; break;
+            case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT:
+                size = 4; break;
+            case GL_DOUBLE:
+                size = 8; break;
+        }
+        return components * size;
+    }
+
+    /** only client memory counts, with a pixel buffer bound the copy stays on the gpu */
+    void pixelTransfer(uint64_t& total, GLenum bufferTarget, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type)
+    {
+        if (Active->Buffers[bufferTarget] != 0)
+            return;
+        total += (uint64_t)w * (uint64_t)h * (uint64_t)d * pixelBytes(format, type);
+    }
+
+    /**
+        Hook<&__glewFoo, observer, PFN...>::install swaps the GLEW pointer for call(),
+        which counts, lets the observer look at the arguments and then calls the driver.
+    */
+    template <auto* Slot, auto Observer, typename F>
+    struct Hook;
+
+    template <auto* Slot, auto Observer, typename Ret, typename... Args>
+    struct Hook<Slot, Observer, Ret (GLAPIENTRY *)(Args...)>
+    {
+        typedef Ret (GLAPIENTRY *Function)(Args...);
+
+        static Function Real;
+        static int Id;
+
+        static Ret GLAPIENTRY call(Args... args)
+        {
+            if (Active) {
+                Active->Entries[Id].FrameCalls++;
+                if constexpr (!std::is_same<decltype(Observer), std::nullptr_t>::value)
+                    Observer(args...);
+            }
+            return Real(args...);
+        }
+
+        static void uninstall()
+        {
+            if (*Slot == &call)
+                *Slot = Real;
+            Real = nullptr;
+        }
+
+        static bool install(const char* name, category::type cat)
+        {
+            // not supported by the driver, nothing to count
+            if (*Slot == nullptr)
+                return false;
+            // a second install would take call() for the driver's function and call itself forever
+            if (Real != nullptr) {
+                std::cerr << "[!] GLIntercept: " << name << " is hooked twice, ignoring the second one" << std::endl;
+                assert(0);
+                return false;
+            }
+            Real = *Slot;
+            Id = addEntry(name, cat);
+            *Slot = &call;
+            return true;
+        }
+    };
+
+    template <auto* Slot, auto Observer, typename Ret, typename... Args>
+    typename Hook<Slot, Observer, Ret (GLAPIENTRY *)(Args...)>::Function Hook<Slot, Observer, Ret (GLAPIENTRY *)(Args...)>::Real = nullptr;
+
+    template <auto* Slot, auto Observer, typename Ret, typename... Args>
+    int Hook<Slot, Observer, Ret (GLAPIENTRY *)(Args...)>::Id = 0;
+
+    //// observers, only called while counting
+
+    void onBindBuffer(GLenum target, GLuint buffer)
+    {
+        bind(Active->Buffers[target], buffer);
+    }
+
+    void onBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        bind(Active->IndexedBuffers[std::make_pair(target, index)], buffer);
+        Active->Buffers[target] = buffer;
+    }
+
+    void onBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr, GLsizeiptr)
+    {
+        // different ranges of the same buffer are not redundant, only track the generic bind point
+        Active->IndexedBuffers[std::make_pair(target, index)] = buffer;
+        Active->Buffers[target] = buffer;
+    }
+
+    void onBindVertexArray(GLuint vao)
+    {
+        if (Active->VertexArray != vao)
+            Active->Buffers.erase(GL_ELEMENT_ARRAY_BUFFER); // belongs to the vao
+        bind(Active->VertexArray, vao);
+    }
+
+    void onUseProgram(GLuint program)
+    {
+        bind(Active->Program, program);
+    }
+
+    void onBindProgramPipeline(GLuint pipeline)
+    {
+        bind(Active->ProgramPipeline, pipeline);
+    }
+
+    void onBindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        if (target == GL_FRAMEBUFFER) {
+            bool redundant = Active->Framebuffers[GL_DRAW_FRAMEBUFFER] == framebuffer
+                          && Active->Framebuffers[GL_READ_FRAMEBUFFER] == framebuffer;
+            if (redundant)
+                Active->Frame.RedundantBinds++;
+            Active->Framebuffers[GL_DRAW_FRAMEBUFFER] = framebuffer;
+            Active->Framebuffers[GL_READ_FRAMEBUFFER] = framebuffer;
+            return;
+        }
+        bind(Active->Framebuffers[target], framebuffer);
+    }
+
+    void onBindRenderbuffer(GLenum, GLuint renderbuffer)
+    {
+        bind(Active->Renderbuffer, renderbuffer);
+    }
+
+    void onActiveTexture(GLenum texture)
+    {
+        Active->ActiveTexture = texture;
+    }
+
+    void onDeleteBuffers(GLsizei n, const GLuint* buffers)
+    {
+        forget(Active->Buffers, n, buffers);
+        forget(Active->IndexedBuffers, n, buffers);
+    }
+
+    void onDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+    {
+        forget(Active->VertexArray, n, arrays);
+    }
+
+    void onDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+    {
+        forget(Active->Framebuffers, n, framebuffers);
+    }
+
+    void onDeleteProgramPipelines(GLsizei n, const GLuint* pipelines)
+    {
+        forget(Active->ProgramPipeline, n, pipelines);
+    }
+
+    void onBufferData(GLenum, GLsizeiptr size, const void* data, GLenum)
+    {
+        if (data)
+            Active->Frame.UploadBytes += size;
+    }
+
+    void onBufferSubData(GLenum, GLintptr, GLsizeiptr size, const void*)
+    {
+        Active->Frame.UploadBytes += size;
+    }
+
+    void onBufferStorage(GLenum, GLsizeiptr size, const void* data, GLbitfield)
+    {
+        if (data)
+            Active->Frame.UploadBytes += size;
+    }
+
+    void onNamedBufferSubData(GLuint, GLintptr, GLsizeiptr size, const void*)
+    {
+        Active->Frame.UploadBytes += size;
+    }
+
+    void onGetBufferSubData(GLenum, GLintptr, GLsizeiptr size, void*)
+    {
+        Active->Frame.ReadbackBytes += size;
+    }
+
+    void onMapBufferRange(GLenum, GLintptr, GLsizeiptr length, GLbitfield)
+    {
+        Active->Frame.MappedBytes += length;
+    }
+
+    void onTexImage3D(GLenum, GLint, GLint, GLsizei w, GLsizei h, GLsizei d, GLint, GLenum format, GLenum type, const void* data)
+    {
+        if (data)
+            pixelTransfer(Active->Frame.UploadBytes, GL_PIXEL_UNPACK_BUFFER, w, h, d, format, type);
+    }
+
+    void onTexSubImage3D(GLenum, GLint, GLint, GLint, GLint, GLsizei w, GLsizei h, GLsizei d, GLenum format, GLenum type, const void*)
+    {
+        pixelTransfer(Active->Frame.UploadBytes, GL_PIXEL_UNPACK_BUFFER, w, h, d, format, type);
+    }
+
+    void onCompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei imageSize, const void* data)
+    {
+        if (data && Active->Buffers[GL_PIXEL_UNPACK_BUFFER] == 0)
+            Active->Frame.UploadBytes += imageSize;
+    }
+
+    void onCompressedTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei imageSize, const void*)
+    {
+        if (Active->Buffers[GL_PIXEL_UNPACK_BUFFER] == 0)
+            Active->Frame.UploadBytes += imageSize;
+    }
+}
+
+#define OGLE_HOOK(fn, cat, observer) \
+    if (Hook<&__glew##fn, observer, decltype(__glew##fn)>::install("gl" #fn, cat)) \
+        Instance->Uninstall.push_back(&Hook<&__glew##fn, observer, decltype(__glew##fn)>::uninstall)
+
+#define OGLE_HOOK_UNIFORMS(prefix) \
+    OGLE_HOOK(prefix##1f, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##2f, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##3f, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##4f, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##1i, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##2i, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##3i, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##4i, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##1ui, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##1fv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##2fv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##3fv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##4fv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##1iv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##2iv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##3iv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##4iv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##Matrix3fv, category::UNIFORM, nullptr); \
+    OGLE_HOOK(prefix##Matrix4fv, category::UNIFORM, nullptr)
+
+struct GLIntercept::State
+{
+    Counters Data;
+    std::vector<void (*)()> Uninstall;
+
+    GLCallStats Last;
+    GLCallStats Total;
+    GLCallStats Max;
+    unsigned int Frames;
+};
+
+GLIntercept::State* GLIntercept::Instance = nullptr;
+
+GLCallStats::GLCallStats()
+    : Calls(0)
+    , Draws(0)
+    , Dispatches(0)
+    , Binds(0)
+    , RedundantBinds(0)
+    , UniformUpdates(0)
+    , UploadBytes(0)
+    , ReadbackBytes(0)
+    , MappedBytes(0)
+{
+
+}
+
+#ifdef OGLE_GL_INTERCEPT_CORE
+namespace {
+    // GL 1.1 entry points, same order as CoreEntries. Registered first so their ids are fixed.
+    namespace core
+    {
+        enum type
+        {
+            DRAW_ARRAYS,
+            DRAW_ELEMENTS,
+            BIND_TEXTURE,
+            DELETE_TEXTURES,
+            TEX_IMAGE_2D,
+            TEX_SUB_IMAGE_2D,
+            TEX_PARAMETERI,
+            READ_PIXELS,
+            GET_TEX_IMAGE,
+            CLEAR,
+            ENABLE,
+            DISABLE,
+            VIEWPORT,
+            MAX
+        };
+    }
+
+    void onBindTexture(GLenum target, GLuint texture)
+    {
+        bind(Active->Textures[std::make_pair(Active->ActiveTexture, target)], texture);
+    }
+
+    void onDeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        forget(Active->Textures, n, textures);
+    }
+
+    const Entry CoreEntries[core::MAX] = {
+        { "glDrawArrays",     category::DRAW,     0, 0 },
+        { "glDrawElements",   category::DRAW,     0, 0 },
+        { "glBindTexture",    category::BIND,     0, 0 },
+        { "glDeleteTextures", category::OTHER,    0, 0 },
+        { "glTexImage2D",     category::TRANSFER, 0, 0 },
+        { "glTexSubImage2D",  category::TRANSFER, 0, 0 },
+        { "glTexParameteri",  category::OTHER,    0, 0 },
+        { "glReadPixels",     category::TRANSFER, 0, 0 },
+        { "glGetTexImage",    category::TRANSFER, 0, 0 },
+        { "glClear",          category::OTHER,    0, 0 },
+        { "glEnable",         category::OTHER,    0, 0 },
+        { "glDisable",        category::OTHER,    0, 0 },
+        { "glViewport",       category::OTHER,    0, 0 },
+    };
+}
+
+// the linker sends calls to glFoo here and __real_glFoo to the driver, see CMakeLists.txt
+extern "C" {
+    void GLAPIENTRY __real_glDrawArrays(GLenum mode, GLint first, GLsizei count);
+    void GLAPIENTRY __real_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+    void GLAPIENTRY __real_glBindTexture(GLenum target, GLuint texture);
+    void GLAPIENTRY __real_glDeleteTextures(GLsizei n, const GLuint* textures);
+    void GLAPIENTRY __real_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+    void GLAPIENTRY __real_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+    void GLAPIENTRY __real_glTexParameteri(GLenum target, GLenum pname, GLint param);
+    void GLAPIENTRY __real_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels);
+    void GLAPIENTRY __real_glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void* pixels);
+    void GLAPIENTRY __real_glClear(GLbitfield mask);
+    void GLAPIENTRY __real_glEnable(GLenum cap);
+    void GLAPIENTRY __real_glDisable(GLenum cap);
+    void GLAPIENTRY __real_glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    void GLAPIENTRY __wrap_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        countCall(core::DRAW_ARRAYS);
+        __real_glDrawArrays(mode, first, count);
+    }
+
+    void GLAPIENTRY __wrap_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        countCall(core::DRAW_ELEMENTS);
+        __real_glDrawElements(mode, count, type, indices);
+    }
+
+    void GLAPIENTRY __wrap_glBindTexture(GLenum target, GLuint texture)
+    {
+        if (Active) {
+            countCall(core::BIND_TEXTURE);
+            onBindTexture(target, texture);
+        }
+        __real_glBindTexture(target, texture);
+    }
+
+    void GLAPIENTRY __wrap_glDeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        if (Active) {
+            countCall(core::DELETE_TEXTURES);
+            onDeleteTextures(n, textures);
+        }
+        __real_glDeleteTextures(n, textures);
+    }
+
+    void GLAPIENTRY __wrap_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+        if (Active) {
+            countCall(core::TEX_IMAGE_2D);
+            if (pixels)
+                pixelTransfer(Active->Frame.UploadBytes, GL_PIXEL_UNPACK_BUFFER, width, height, 1, format, type);
+        }
+        __real_glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    }
+
+    void GLAPIENTRY __wrap_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+        if (Active) {
+            countCall(core::TEX_SUB_IMAGE_2D);
+            pixelTransfer(Active->Frame.UploadBytes, GL_PIXEL_UNPACK_BUFFER, width, height, 1, format, type);
+        }
+        __real_glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+    }
+
+    void GLAPIENTRY __wrap_glTexParameteri(GLenum target, GLenum pname, GLint param)
+    {
+        countCall(core::TEX_PARAMETERI);
+        __real_glTexParameteri(target, pname, param);
+    }
+
+    void GLAPIENTRY __wrap_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+    {
+        if (Active) {
+            countCall(core::READ_PIXELS);
+            pixelTransfer(Active->Frame.ReadbackBytes, GL_PIXEL_PACK_BUFFER, width, height, 1, format, type);
+        }
+        __real_glReadPixels(x, y, width, height, format, type, pixels);
+    }
+
+    void GLAPIENTRY __wrap_glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void* pixels)
+    {
+        if (Active) {
+            countCall(core::GET_TEX_IMAGE);
+            GLint width = 0, height = 0, depth = 0;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+            pixelTransfer(Active->Frame.ReadbackBytes, GL_PIXEL_PACK_BUFFER, width, height, std::max(depth, 1), format, type);
+        }
+        __real_glGetTexImage(target, level, format, type, pixels);
+    }
+
+    void GLAPIENTRY __wrap_glClear(GLbitfield mask)
+    {
+        countCall(core::CLEAR);
+        __real_glClear(mask);
+    }
+
+    void GLAPIENTRY __wrap_glEnable(GLenum cap)
+    {
+        countCall(core::ENABLE);
+        __real_glEnable(cap);
+    }
+
+    void GLAPIENTRY __wrap_glDisable(GLenum cap)
+    {
+        countCall(core::DISABLE);
+        __real_glDisable(cap);
+    }
+
+    void GLAPIENTRY __wrap_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        countCall(core::VIEWPORT);
+        __real_glViewport(x, y, width, height);
+    }
+}
+#endif // OGLE_GL_INTERCEPT_CORE
+
+bool GLIntercept::init(bool force)
+{
+    if (Instance)
+        return true;
+
+    if (!force && getenv("OGLE_GL_INTERCEPT") == nullptr)
+        return false;
+
+    Instance = new State;
+    Instance->Frames = 0;
+    Active = &Instance->Data;
+
+#ifdef OGLE_GL_INTERCEPT_CORE
+    Active->Entries.assign(CoreEntries, CoreEntries + core::MAX);
+#endif
+
+    OGLE_HOOK(DrawArraysInstanced, category::DRAW, nullptr);
+    OGLE_HOOK(DrawArraysInstancedBaseInstance, category::DRAW, nullptr);
+    OGLE_HOOK(DrawArraysIndirect, category::DRAW, nullptr);
+    OGLE_HOOK(DrawElementsInstanced, category::DRAW, nullptr);
+    OGLE_HOOK(DrawElementsBaseVertex, category::DRAW, nullptr);
+    OGLE_HOOK(DrawElementsInstancedBaseVertex, category::DRAW, nullptr);
+    OGLE_HOOK(DrawElementsIndirect, category::DRAW, nullptr);
+    OGLE_HOOK(DrawRangeElements, category::DRAW, nullptr);
+    OGLE_HOOK(MultiDrawArrays, category::DRAW, nullptr);
+    OGLE_HOOK(MultiDrawElements, category::DRAW, nullptr);
+    OGLE_HOOK(MultiDrawArraysIndirect, category::DRAW, nullptr);
+    OGLE_HOOK(MultiDrawElementsIndirect, category::DRAW, nullptr);
+    OGLE_HOOK(DispatchCompute, category::DISPATCH, nullptr);
+    OGLE_HOOK(DispatchComputeIndirect, category::DISPATCH, nullptr);
+
+    OGLE_HOOK(BindBuffer, category::BIND, onBindBuffer);
+    OGLE_HOOK(BindBufferBase, category::BIND, onBindBufferBase);
+    OGLE_HOOK(BindBufferRange, category::BIND, onBindBufferRange);
+    OGLE_HOOK(BindVertexArray, category::BIND, onBindVertexArray);
+    OGLE_HOOK(UseProgram, category::BIND, onUseProgram);
+    OGLE_HOOK(BindProgramPipeline, category::BIND, onBindProgramPipeline);
+    OGLE_HOOK(BindFramebuffer, category::BIND, onBindFramebuffer);
+    OGLE_HOOK(BindRenderbuffer, category::BIND, onBindRenderbuffer);
+    OGLE_HOOK(BindImageTexture, category::BIND, nullptr);
+    OGLE_HOOK(BindSampler, category::BIND, nullptr);
+    OGLE_HOOK(ActiveTexture, category::OTHER, onActiveTexture);
+    OGLE_HOOK(DeleteBuffers, category::OTHER, onDeleteBuffers);
+    OGLE_HOOK(DeleteVertexArrays, category::OTHER, onDeleteVertexArrays);
+    OGLE_HOOK(DeleteFramebuffers, category::OTHER, onDeleteFramebuffers);
+    OGLE_HOOK(DeleteProgramPipelines, category::OTHER, onDeleteProgramPipelines);
+
+    OGLE_HOOK_UNIFORMS(Uniform);
+    OGLE_HOOK_UNIFORMS(ProgramUniform);
+
+    OGLE_HOOK(BufferData, category::TRANSFER, onBufferData);
+    OGLE_HOOK(BufferSubData, category::TRANSFER, onBufferSubData);
+    OGLE_HOOK(BufferStorage, category::TRANSFER, onBufferStorage);
+    OGLE_HOOK(NamedBufferSubData, category::TRANSFER, onNamedBufferSubData);
+    OGLE_HOOK(GetBufferSubData, category::TRANSFER, onGetBufferSubData);
+    OGLE_HOOK(MapBufferRange, category::TRANSFER, onMapBufferRange);
+    OGLE_HOOK(UnmapBuffer, category::TRANSFER, nullptr);
+    OGLE_HOOK(TexImage3D, category::TRANSFER, onTexImage3D);
+    OGLE_HOOK(TexSubImage3D, category::TRANSFER, onTexSubImage3D);
+    OGLE_HOOK(CompressedTexImage2D, category::TRANSFER, onCompressedTexImage2D);
+    OGLE_HOOK(CompressedTexSubImage2D, category::TRANSFER, onCompressedTexSubImage2D);
+
+    OGLE_HOOK(VertexAttribPointer, category::OTHER, nullptr);
+    OGLE_HOOK(EnableVertexAttribArray, category::OTHER, nullptr);
+    OGLE_HOOK(DisableVertexAttribArray, category::OTHER, nullptr);
+    OGLE_HOOK(ClearBufferData, category::OTHER, nullptr);
+    OGLE_HOOK(ClearBufferuiv, category::OTHER, nullptr);
+    OGLE_HOOK(ClearTexImage, category::OTHER, nullptr);
+    OGLE_HOOK(GenerateMipmap, category::OTHER, nullptr);
+    OGLE_HOOK(BlendEquation, category::OTHER, nullptr);
+    OGLE_HOOK(DrawBuffers, category::OTHER, nullptr);
+    OGLE_HOOK(FramebufferTexture2D, category::OTHER, nullptr);
+    OGLE_HOOK(MemoryBarrier, category::OTHER, nullptr);
+    OGLE_HOOK(FenceSync, category::OTHER, nullptr);
+    OGLE_HOOK(ClientWaitSync, category::OTHER, nullptr);
+    OGLE_HOOK(WaitSync, category::OTHER, nullptr);
+    OGLE_HOOK(DeleteSync, category::OTHER, nullptr);
+
+    std::cout << "GLIntercept: counting " << Active->Entries.size() << " GL entry points";
+#ifndef OGLE_GL_INTERCEPT_CORE
+    std::cout << ", GL 1.1 calls are not counted (configure with -DOGLE_GL_INTERCEPT_CORE=ON)";
+#endif
+    std::cout << std::endl;
+    return true;
+}
+
+bool GLIntercept::running()
+{
+    return Instance != nullptr;
+}
+
+void GLIntercept::endFrame()
+{
+    if (!Instance)
+        return;
+
+    GLCallStats& frame = Instance->Data.Frame;
+    for (auto& entry : Instance->Data.Entries) {
+        frame.Calls += entry.FrameCalls;
+        switch (entry.Category) {
+            case category::DRAW:     frame.Draws += entry.FrameCalls; break;
+            case category::DISPATCH: frame.Dispatches += entry.FrameCalls; break;
+            case category::BIND:     frame.Binds += entry.FrameCalls; break;
+            case category::UNIFORM:  frame.UniformUpdates += entry.FrameCalls; break;
+            default: break;
+        }
+        entry.TotalCalls += entry.FrameCalls;
+        entry.FrameCalls = 0;
+    }
+
+    Profiler::counter("gl calls", (double)frame.Calls);
+    Profiler::counter("gl draws", (double)frame.Draws);
+    Profiler::counter("gl dispatches", (double)frame.Dispatches);
+    Profiler::counter("gl binds", (double)frame.Binds);
+    Profiler::counter("gl redundant binds", (double)frame.RedundantBinds);
+    Profiler::counter("gl uniform updates", (double)frame.UniformUpdates);
+    Profiler::counter("gl upload bytes", (double)frame.UploadBytes);
+    Profiler::counter("gl readback bytes", (double)frame.ReadbackBytes);
+    Profiler::counter("gl mapped bytes", (double)frame.MappedBytes);
+
+    GLCallStats& total = Instance->Total;
+    GLCallStats& max = Instance->Max;
+    total.Calls += frame.Calls;                   max.Calls = std::max(max.Calls, frame.Calls);
+    total.Draws += frame.Draws;                   max.Draws = std::max(max.Draws, frame.Draws);
+    total.Dispatches += frame.Dispatches;         max.Dispatches = std::max(max.Dispatches, frame.Dispatches);
+    total.Binds += frame.Binds;                   max.Binds = std::max(max.Binds, frame.Binds);
+    total.RedundantBinds += frame.RedundantBinds; max.RedundantBinds = std::max(max.RedundantBinds, frame.RedundantBinds);
+    total.UniformUpdates += frame.UniformUpdates; max.UniformUpdates = std::max(max.UniformUpdates, frame.UniformUpdates);
+    total.UploadBytes += frame.UploadBytes;       max.UploadBytes = std::max(max.UploadBytes, frame.UploadBytes);
+    total.ReadbackBytes += frame.ReadbackBytes;   max.ReadbackBytes = std::max(max.ReadbackBytes, frame.ReadbackBytes);
+    total.MappedBytes += frame.MappedBytes;       max.MappedBytes = std::max(max.MappedBytes, frame.MappedBytes);
+
+    Instance->Last = frame;
+    Instance->Frames++;
+    frame = GLCallStats();
+}
+
+const GLCallStats& GLIntercept::lastFrame()
+{
+    static const GLCallStats empty;
+    return Instance ? Instance->Last : empty;
+}
+
+void GLIntercept::printSummary(size_t entryPoints)
+{
+    if (!Instance || Instance->Frames == 0)
+        return;
+
+    const double frames = Instance->Frames;
+    const GLCallStats& total = Instance->Total;
+    const GLCallStats& max = Instance->Max;
+
+    std::cout << "GL calls per frame over " << Instance->Frames << " frames:\n";
+    std::cout << std::left << std::setw(24) << ""
+              << std::right << std::setw(16) << "average"
+              << std::setw(16) << "max" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+
+    const std::pair<const char*, std::pair<uint64_t, uint64_t>> rows[] = {
+        { "calls",            { total.Calls,          max.Calls } },
+        { "draws",            { total.Draws,          max.Draws } },
+        { "dispatches",       { total.Dispatches,     max.Dispatches } },
+        { "binds",            { total.Binds,          max.Binds } },
+        { "redundant binds",  { total.RedundantBinds, max.RedundantBinds } },
+        { "uniform updates",  { total.UniformUpdates, max.UniformUpdates } },
+        { "upload bytes",     { total.UploadBytes,    max.UploadBytes } },
+        { "readback bytes",   { total.ReadbackBytes,  max.ReadbackBytes } },
+        { "mapped bytes",     { total.MappedBytes,    max.MappedBytes } },
+    };
+    for (const auto& row : rows) {
+        std::cout << std::left << std::setw(24) << row.first
+                  << std::right << std::setw(16) << row.second.first / frames
+                  << std::setw(16) << row.second.second << "\n";
+    }
+
+    std::vector<Entry> sorted = Instance->Data.Entries;
+    std::sort(sorted.begin(), sorted.end(),
+        [](const Entry& lhs, const Entry& rhs) {
+            return lhs.TotalCalls > rhs.TotalCalls;
+        });
+
+    std::cout << "\n" << std::left << std::setw(40) << "entry point"
+              << std::right << std::setw(16) << "calls"
+              << std::setw(16) << "per frame" << "\n";
+    for (size_t i=0; i<sorted.size() && i<entryPoints && sorted[i].TotalCalls > 0; ++i) {
+        std::cout << std::left << std::setw(40) << sorted[i].Name
+                  << std::right << std::setw(16) << sorted[i].TotalCalls
+                  << std::setw(16) << sorted[i].TotalCalls / frames << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::endl;
+}
+
+void GLIntercept::shutdown()
+{
+    if (!Instance)
+        return;
+
+    for (auto uninstall : Instance->Uninstall)
+        uninstall();
+
+    Active = nullptr;
+    delete Instance;
+    Instance = nullptr;
+}
+
+GLIntercept::GLIntercept()
+{
+
+}
+
+GLIntercept::~GLIntercept()
+{
+
+}
+
+GLIntercept::GLIntercept(const GLIntercept& other)
+{
+
+}
+
+GLIntercept& GLIntercept::operator=(const GLIntercept& other)
+{
+    return *this;
+}
@@ -0,0 +1,85 @@
+#ifndef GLINTERCEPT_H
+#define GLINTERCEPT_H
+
+/****************************************************************
+
+    GL call interception, counts what an experiment asks of the
+    driver every frame.
+
+    init() swaps the GLEW function pointers for wrappers that
+    count calls per entry point, binds that set what is already
+    bound, and the bytes that go up (glBufferData, glBufferSubData,
+    glTexSubImage...) or come back (glGetBufferSubData, glReadPixels).
+    shutdown() puts the original pointers back.
+
+    GL 1.1 functions (glDrawArrays, glBindTexture, glTexImage2D,
+    glReadPixels...) are not GLEW pointers, they are only counted
+    when configured with -DOGLE_GL_INTERCEPT_CORE=ON, which routes
+    them through the linker's --wrap option.
+
+    Usage:
+        ogle::Context::init(...);
+        ogle::Profiler::init(...);
+        ogle::GLIntercept::init(); // only when OGLE_GL_INTERCEPT is set in the environment
+        while (running) {
+            ...
+            ogle::GLIntercept::endFrame(); // before Profiler::endFrame
+            ogle::Profiler::endFrame();
+        }
+        ogle::GLIntercept::printSummary();
+        ogle::GLIntercept::shutdown();
+
+    Redundant binds are tracked with a shadow of the bind points,
+    work that changes bindings behind GL's back (NV_command_list)
+    makes that number an estimate. Pixel transfer sizes ignore
+    the pack/unpack row length and alignment.
+
+****************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ogle
+{
+    struct GLCallStats
+    {
+        GLCallStats();
+
+        uint64_t Calls;
+        uint64_t Draws;
+        uint64_t Dispatches;
+        uint64_t Binds;
+        uint64_t RedundantBinds;
+        uint64_t UniformUpdates;
+        uint64_t UploadBytes;
+        uint64_t ReadbackBytes;
+        uint64_t MappedBytes;
+    };
+
+    class GLIntercept
+    {
+    public:
+        /** needs GLEW to be initialized, does nothing unless force is set or OGLE_GL_INTERCEPT is in the environment */
+        static bool init(bool force = false);
+        static bool running();
+
+        /** hands the counts of this frame to the Profiler as counters and starts counting the next one */
+        static void endFrame();
+        static const GLCallStats& lastFrame();
+
+        /** per frame averages and the busiest entry points */
+        static void printSummary(size_t entryPoints = 20);
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        GLIntercept();
+        ~GLIntercept();
+        GLIntercept(const GLIntercept& other);
+        GLIntercept& operator=(const GLIntercept& other);
+    };
+}
+
+#endif // GLINTERCEPT_H
@@ -0,0 +1,286 @@
+#include "gpumemory.h"
+#include "profiler.h"
+#include "stacktrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    // the function that created the object and its caller
+    const int SiteDepth = 2;
+
+    const char* CategoryNames[GpuMemory::MAX] = {
+        "buffers",
+        "textures",
+        "framebuffers",
+    };
+
+    struct Entry
+    {
+        GpuMemory::category Category;
+        unsigned int Name;
+        size_t Bytes;
+        unsigned int Format;
+        int Width;
+        int Height;
+        int Depth;
+        std::string Label;
+        const char* File;
+        int Line;
+        void* Site[SiteDepth];
+        int SiteCount;
+    };
+
+    typedef std::pair<int, unsigned int> Key;
+
+    const char* fileName(const char* path)
+    {
+        const char* slash = strrchr(path, '/');
+        const char* backslash = strrchr(path, '\\');
+        const char* last = std::max(slash, backslash);
+        return last != nullptr ? last + 1 : path;
+    }
+
+    double megabytes(size_t bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    void printEntry(const Entry& entry)
+    {
+        std::cout << "\t" << std::left << std::setw(28) << entry.Label << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(3) << megabytes(entry.Bytes) << " MB  "
+                  << CategoryNames[entry.Category] << " " << entry.Name;
+        std::cout.unsetf(std::ios::floatfield);
+        if (entry.Category == GpuMemory::TEXTURE) {
+            std::cout << " " << entry.Width << "x" << entry.Height;
+            if (entry.Depth > 1)
+                std::cout << "x" << entry.Depth;
+            std::cout << " format 0x" << std::hex << entry.Format << std::dec;
+        }
+        std::cout << "\n\t    created at " << fileName(entry.File) << ":" << entry.Line;
+        for (int i=0; i<entry.SiteCount; ++i)
+            std::cout << (i == 0 ? " in " : " <- ") << StackTrace::symbolize(StackTrace::callSite(entry.Site[i]));
+        std::cout << "\n";
+    }
+}
+
+struct GpuMemory::State
+{
+    std::map<Key, Entry> Live;
+    size_t Current[MAX];
+    size_t Peak[MAX];
+    size_t Objects[MAX];
+    bool Tracked;
+
+    void add(Entry& entry)
+    {
+        Key key((int)entry.Category, entry.Name);
+        auto found = Live.find(key);
+        if (found != Live.end()) {
+            Current[entry.Category] -= found->second.Bytes;
+            Objects[entry.Category]--;
+        }
+        Live[key] = entry;
+
+        Current[entry.Category] += entry.Bytes;
+        Peak[entry.Category] = std::max(Peak[entry.Category], Current[entry.Category]);
+        Objects[entry.Category]++;
+        Tracked = true;
+    }
+};
+
+GpuMemory::State& GpuMemory::instance()
+{
+    static State state = { std::map<Key, Entry>(), {0}, {0}, {0}, false };
+    return state;
+}
+
+void GpuMemory::trackBuffer(unsigned int name, size_t bytes, const char* label, const char* file, int line)
+{
+    Entry entry;
+    entry.Category = BUFFER;
+    entry.Name = name;
+    entry.Bytes = bytes;
+    entry.Format = 0;
+    entry.Width = 0;
+    entry.Height = 0;
+    entry.Depth = 0;
+    entry.Label = label;
+    entry.File = file;
+    entry.Line = line;
+    // leave out this function, what's left is whoever created the object
+    entry.SiteCount = StackTrace::capture(entry.Site, SiteDepth, 1);
+    instance().add(entry);
+}
+
+void GpuMemory::trackTexture(unsigned int name, unsigned int internalFormat, int width, int height, int depth,
+                             const char* label, const char* file, int line)
+{
+    Entry entry;
+    entry.Category = TEXTURE;
+    entry.Name = name;
+    entry.Bytes = bytesPerTexel(internalFormat) * width * height * std::max(depth, 1);
+    entry.Format = internalFormat;
+    entry.Width = width;
+    entry.Height = height;
+    entry.Depth = depth;
+    entry.Label = label;
+    entry.File = file;
+    entry.Line = line;
+    // leave out this function, what's left is whoever created the object
+    entry.SiteCount = StackTrace::capture(entry.Site, SiteDepth, 1);
+    instance().add(entry);
+}
+
+void GpuMemory::trackFramebuffer(unsigned int name, const char* label, const char* file, int line)
+{
+    Entry entry;
+    entry.Category = FRAMEBUFFER;
+    entry.Name = name;
+    entry.Bytes = 0;
+    entry.Format = 0;
+    entry.Width = 0;
+    entry.Height = 0;
+    entry.Depth = 0;
+    entry.Label = label;
+    entry.File = file;
+    entry.Line = line;
+    // leave out this function, what's left is whoever created the object
+    entry.SiteCount = StackTrace::capture(entry.Site, SiteDepth, 1);
+    instance().add(entry);
+}
+
+void GpuMemory::release(category c, unsigned int name)
+{
+    State& state = instance();
+    auto found = state.Live.find(Key((int)c, name));
+    if (found == state.Live.end())
+        return;
+
+    state.Current[c] -= found->second.Bytes;
+    state.Objects[c]--;
+    state.Live.erase(found);
+}
+
+size_t GpuMemory::current(category c)
+{
+    return instance().Current[c];
+}
+
+size_t GpuMemory::peak(category c)
+{
+    return instance().Peak[c];
+}
+
+size_t GpuMemory::liveObjects(category c)
+{
+    return instance().Objects[c];
+}
+
+size_t GpuMemory::bytesPerTexel(unsigned int internalFormat)
+{
+    switch (internalFormat) {
+        case GL_R8: case GL_R8I: case GL_R8UI: case GL_RED: case GL_STENCIL_INDEX8:
+            return 1;
+        case GL_RG8: case GL_RG8I: case GL_RG8UI: case GL_RG:
+        case GL_R16: case GL_R16F: case GL_R16I: case GL_R16UI:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB8: case GL_RGB:
+            return 3;
+        case GL_RGBA8: case GL_RGBA8I: case GL_RGBA8UI: case GL_RGBA: case GL_SRGB8_ALPHA8: case GL_RGB10_A2:
+        case GL_RG16: case GL_RG16F: case GL_RG16I: case GL_RG16UI:
+        case GL_R32F: case GL_R32I: case GL_R32UI: case GL_R11F_G11F_B10F:
+        case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F: case GL_RGB16I: case GL_RGB16UI:
+            return 6;
+        case GL_RGBA16: case GL_RGBA16F: case GL_RGBA16I: case GL_RGBA16UI:
+        case GL_RG32F: case GL_RG32I: case GL_RG32UI: case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI:
+            return 12;
+        case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+void GpuMemory::endFrame()
+{
+    State& state = instance();
+    if (!state.Tracked)
+        return;
+
+    Profiler::counter("gpu buffers MB", megabytes(state.Current[BUFFER]));
+    Profiler::counter("gpu textures MB", megabytes(state.Current[TEXTURE]));
+}
+
+void GpuMemory::printSummary(size_t largest)
+{
+    State& state = instance();
+    if (!state.Tracked)
+        return;
+
+    std::cout << "\nGPU memory, estimated:\n";
+    std::cout << std::left << std::setw(16) << "category" << std::right
+              << std::setw(14) << "current MB" << std::setw(14) << "peak MB" << std::setw(10) << "objects" << "\n";
+    for (int c=0; c<MAX; ++c) {
+        std::cout << std::left << std::setw(16) << CategoryNames[c] << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << megabytes(state.Current[c])
+                  << std::setw(14) << megabytes(state.Peak[c])
+                  << std::setw(10) << state.Objects[c] << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    // shutdown already deleted what it knows about, anything left is a leak
+    std::vector<const Entry*> leaks;
+    for (const auto& kv : state.Live)
+        leaks.push_back(&kv.second);
+    std::sort(leaks.begin(), leaks.end(),
+        [](const Entry* a, const Entry* b) {
+            return a->Bytes > b->Bytes;
+        });
+
+    if (!leaks.empty()) {
+        std::cout << "[!] GpuMemory: " << leaks.size() << " objects were never released";
+        if (leaks.size() > largest)
+            std::cout << ", the " << largest << " largest";
+        std::cout << ":\n";
+    }
+    for (size_t i=0; i<leaks.size() && i<largest; ++i)
+        printEntry(*leaks[i]);
+    std::cout << std::endl;
+}
+
+GpuMemory::GpuMemory()
+{
+
+}
+
+GpuMemory::~GpuMemory()
+{
+
+}
+
+GpuMemory::GpuMemory(const GpuMemory& other)
+{
+
+}
+
+GpuMemory& GpuMemory::operator=(const GpuMemory& other)
+{
+    return *this;
+}
@@ -0,0 +1,83 @@
+#ifndef GPUMEMORY_H
+#define GPUMEMORY_H
+
+/****************************************************************
+
+    Bookkeeping of the GPU memory the experiments create.
+
+    GL doesn't say how much memory a buffer or texture takes, so
+    every place that creates one reports it here: the common
+    helpers (ogle::initTexture, ogle::initFramebuffer, Texture,
+    RenderTarget, FullscreenQuad) do it themselves, experiment
+    code uses the macros below. Sizes of textures are estimated
+    from their internal format, drivers add padding and mips on
+    top.
+
+    Every object keeps its label, size, format and where it was
+    created. The registry gives current and peak bytes per
+    category, pushes them as profiler counters every frame
+    (Profiler::endFrame calls endFrame()), and printSummary()
+    lists everything that was never released as a leak, so call
+    it after the experiment deleted its GL objects.
+
+    Usage:
+        glGenBuffers(1, &vbo);
+        glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+        OGLE_GPU_BUFFER(vbo, bytes, "particle vbo");
+        ...
+        glDeleteBuffers(1, &vbo);
+        ogle::GpuMemory::release(ogle::GpuMemory::BUFFER, vbo);
+
+****************************************************************/
+
+#include <cstddef>
+
+namespace ogle
+{
+    class GpuMemory
+    {
+    public:
+        enum category
+        {
+            BUFFER,
+            TEXTURE,
+            FRAMEBUFFER,    // owns no memory, tracked so they show up as leaks
+            MAX
+        };
+
+        /** tracking a name again replaces the old entry, like re-specifying the storage */
+        static void trackBuffer(unsigned int name, size_t bytes, const char* label, const char* file, int line);
+        static void trackTexture(unsigned int name, unsigned int internalFormat, int width, int height, int depth,
+                                 const char* label, const char* file, int line);
+        static void trackFramebuffer(unsigned int name, const char* label, const char* file, int line);
+        static void release(category c, unsigned int name);
+
+        static size_t current(category c);
+        static size_t peak(category c);
+        static size_t liveObjects(category c);
+        /** estimate for the sized formats, 4 when the format is unknown */
+        static size_t bytesPerTexel(unsigned int internalFormat);
+
+        static void endFrame();
+        /** current/peak per category, the largest objects, and everything still alive as a leak */
+        static void printSummary(size_t largest = 10);
+
+    private:
+        struct State;
+        static State& instance();
+
+        GpuMemory();
+        ~GpuMemory();
+        GpuMemory(const GpuMemory& other);
+        GpuMemory& operator=(const GpuMemory& other);
+    };
+}
+
+#define OGLE_GPU_BUFFER(name, bytes, label) \
+    ogle::GpuMemory::trackBuffer(name, bytes, label, __FILE__, __LINE__)
+#define OGLE_GPU_TEXTURE(name, internalFormat, width, height, label) \
+    ogle::GpuMemory::trackTexture(name, internalFormat, width, height, 1, label, __FILE__, __LINE__)
+#define OGLE_GPU_FRAMEBUFFER(name, label) \
+    ogle::GpuMemory::trackFramebuffer(name, label, __FILE__, __LINE__)
+
+#endif // GPUMEMORY_H
@@ -0,0 +1,172 @@
+#include "hdrhistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace ogle;
+
+namespace {
+    int leadingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        return _BitScanReverse64(&index, value) ? 63 - (int)index : 64;
+#else
+        return value == 0 ? 64 : __builtin_clzll(value);
+#endif
+    }
+}
+
+HdrHistogram::HdrHistogram(int64_t highestTrackable, int significantDigits)
+    : HighestTrackable(std::max<int64_t>(highestTrackable, 2))
+    , TotalCount(0)
+    , Clamped(0)
+    , Min(std::numeric_limits<int64_t>::max())
+    , Max(0)
+    , Sum(0.0)
+{
+    significantDigits = std::min(std::max(significantDigits, 1), 5);
+
+    // below this every value gets its own counter, above it buckets double in width
+    int64_t largest_single_unit = 2 * (int64_t)std::pow(10.0, significantDigits);
+    int sub_bucket_count_magnitude = (int)std::ceil(std::log2((double)largest_single_unit));
+    SubBucketHalfCountMagnitude = std::max(sub_bucket_count_magnitude, 1) - 1;
+    SubBucketHalfCount = 1 << SubBucketHalfCountMagnitude;
+    int64_t sub_bucket_count = (int64_t)SubBucketHalfCount * 2;
+    SubBucketMask = sub_bucket_count - 1;
+
+    int buckets = 1;
+    for (int64_t untrackable = sub_bucket_count; untrackable <= HighestTrackable; untrackable <<= 1) {
+        buckets++;
+        if (untrackable > std::numeric_limits<int64_t>::max() / 2)
+            break;
+    }
+    Counts.assign((size_t)(buckets + 1) * SubBucketHalfCount, 0);
+}
+
+void HdrHistogram::record(int64_t value)
+{
+    record(value, 1);
+}
+
+void HdrHistogram::record(int64_t value, uint64_t count)
+{
+    if (value < 0)
+        value = 0;
+    if (value > HighestTrackable) {
+        value = HighestTrackable;
+        Clamped += count;
+    }
+
+    Counts[countsIndex(value)] += count;
+    TotalCount += count;
+    Sum += (double)value * count;
+    Min = std::min(Min, value);
+    Max = std::max(Max, value);
+}
+
+void HdrHistogram::add(const HdrHistogram& other)
+{
+    if (other.Counts.size() != Counts.size() || other.SubBucketHalfCount != SubBucketHalfCount)
+        return;
+
+    for (size_t i=0; i<Counts.size(); ++i)
+        Counts[i] += other.Counts[i];
+    TotalCount += other.TotalCount;
+    Clamped += other.Clamped;
+    Sum += other.Sum;
+    Min = std::min(Min, other.Min);
+    Max = std::max(Max, other.Max);
+}
+
+void HdrHistogram::reset()
+{
+    std::fill(Counts.begin(), Counts.end(), 0);
+    TotalCount = 0;
+    Clamped = 0;
+    Min = std::numeric_limits<int64_t>::max();
+    Max = 0;
+    Sum = 0.0;
+}
+
+uint64_t HdrHistogram::count() const
+{
+    return TotalCount;
+}
+
+uint64_t HdrHistogram::clamped() const
+{
+    return Clamped;
+}
+
+int64_t HdrHistogram::min() const
+{
+    return TotalCount == 0 ? 0 : Min;
+}
+
+int64_t HdrHistogram::max() const
+{
+    return Max;
+}
+
+double HdrHistogram::mean() const
+{
+    return TotalCount == 0 ? 0.0 : Sum / TotalCount;
+}
+
+int64_t HdrHistogram::valueAtPercentile(double percentile) const
+{
+    if (TotalCount == 0)
+        return 0;
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t target = (uint64_t)(percentile / 100.0 * TotalCount + 0.5);
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i=0; i<Counts.size(); ++i) {
+        seen += Counts[i];
+        if (seen >= target)
+            return std::min(highestEquivalentValue(valueFromIndex((int)i)), Max);
+    }
+    return Max;
+}
+
+size_t HdrHistogram::memoryBytes() const
+{
+    return Counts.size() * sizeof(uint64_t);
+}
+
+int HdrHistogram::countsIndex(int64_t value) const
+{
+    int pow2_ceiling = 64 - leadingZeros((uint64_t)(value | SubBucketMask));
+    int bucket = pow2_ceiling - (SubBucketHalfCountMagnitude + 1);
+    int sub_bucket = (int)(value >> bucket);
+    return ((bucket + 1) << SubBucketHalfCountMagnitude) + (sub_bucket - SubBucketHalfCount);
+}
+
+int64_t HdrHistogram::valueFromIndex(int index) const
+{
+    int bucket = (index >> SubBucketHalfCountMagnitude) - 1;
+    int sub_bucket = (index & (SubBucketHalfCount - 1)) + SubBucketHalfCount;
+    if (bucket < 0) {
+        sub_bucket -= SubBucketHalfCount;
+        bucket = 0;
+    }
+    return (int64_t)sub_bucket << bucket;
+}
+
+int64_t HdrHistogram::highestEquivalentValue(int64_t value) const
+{
+    int pow2_ceiling = 64 - leadingZeros((uint64_t)(value | SubBucketMask));
+    int bucket = pow2_ceiling - (SubBucketHalfCountMagnitude + 1);
+    int64_t sub_bucket = value >> bucket;
+    int64_t lowest = sub_bucket << bucket;
+    int range_bucket = sub_bucket > SubBucketMask ? bucket + 1 : bucket;
+    return lowest + ((int64_t)1 << range_bucket) - 1;
+}
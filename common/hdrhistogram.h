@@ -0,0 +1,71 @@
+#ifndef HDRHISTOGRAM_H
+#define HDRHISTOGRAM_H
+
+/****************************************************************
+
+    High dynamic range histogram, after Gil Tene's HdrHistogram.
+
+    Values are integers from 1 to a highest trackable value, kept
+    to a fixed number of significant decimal digits: buckets are
+    powers of two, each split linearly into enough sub buckets for
+    that precision. FrameTimes records microseconds with 3 digits
+    and one hour as the top, that is 23.5k counters, about 188 KB
+    per histogram, and every value from 1 us to an hour lands
+    within 0.1% of where it was recorded. The constructor's
+    default top of one minute takes 17k counters, 139 KB.
+
+    All memory is taken in the constructor, record() is a couple
+    of shifts and an increment and never allocates, so it can run
+    every frame. Values above the highest trackable one are counted
+    at the top and reported by clamped().
+
+****************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ogle
+{
+    class HdrHistogram
+    {
+    public:
+        /** significantDigits from 1 to 5 */
+        HdrHistogram(int64_t highestTrackable = 60 * 1000 * 1000, int significantDigits = 3);
+
+        void record(int64_t value);
+        void record(int64_t value, uint64_t count);
+        /** adds the counts of a histogram with the same layout */
+        void add(const HdrHistogram& other);
+        void reset();
+
+        uint64_t count() const;
+        uint64_t clamped() const;
+        int64_t min() const;
+        int64_t max() const;
+        double mean() const;
+        /** the largest value at or below which percentile% of the values fall, percentile in [0, 100] */
+        int64_t valueAtPercentile(double percentile) const;
+
+        size_t memoryBytes() const;
+
+    private:
+        int countsIndex(int64_t value) const;
+        int64_t valueFromIndex(int index) const;
+        int64_t highestEquivalentValue(int64_t value) const;
+
+        int64_t HighestTrackable;
+        int SubBucketHalfCountMagnitude;
+        int SubBucketHalfCount;
+        int64_t SubBucketMask;
+
+        std::vector<uint64_t> Counts;
+        uint64_t TotalCount;
+        uint64_t Clamped;
+        int64_t Min;
+        int64_t Max;
+        double Sum;
+    };
+}
+
+#endif // HDRHISTOGRAM_H
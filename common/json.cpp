@@ -0,0 +1,317 @@
+#include "json.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace ogle
+{
+    /** recursive descent over the text, stops at the first error */
+    class JsonParser
+    {
+    public:
+        JsonParser(const std::string& text) : Text(text), Pos(0) {}
+
+        bool parse(JsonValue& result, std::string& error)
+        {
+            if (!parseValue(result) || (skipSpace(), Pos != Text.size())) {
+                if (Error.empty())
+                    fail("unexpected trailing characters");
+                error = Error;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        const std::string& Text;
+        size_t Pos;
+        std::string Error;
+
+        bool fail(const std::string& msg)
+        {
+            if (Error.empty()) {
+                std::ostringstream out;
+                out << msg << " at offset " << Pos;
+                Error = out.str();
+            }
+            return false;
+        }
+
+        void skipSpace()
+        {
+            while (Pos < Text.size() && (Text[Pos] == ' ' || Text[Pos] == '\n' || Text[Pos] == '\r' || Text[Pos] == '\t'))
+                ++Pos;
+        }
+
+        bool match(const char* word)
+        {
+            size_t len = strlen(word);
+            if (Text.compare(Pos, len, word) != 0)
+                return false;
+            Pos += len;
+            return true;
+        }
+
+        bool parseValue(JsonValue& value)
+        {
+            skipSpace();
+            if (Pos >= Text.size())
+                return fail("unexpected end of input");
+
+            char c = Text[Pos];
+            if (c == '{')
+                return parseObject(value);
+            if (c == '[')
+                return parseArray(value);
+            if (c == '"') {
+                value.Type = JsonValue::STRING;
+                return parseString(value.String);
+            }
+            if (match("true")) {
+                value.Type = JsonValue::BOOLEAN;
+                value.Bool = true;
+                return true;
+            }
+            if (match("false")) {
+                value.Type = JsonValue::BOOLEAN;
+                value.Bool = false;
+                return true;
+            }
+            if (match("null")) {
+                value.Type = JsonValue::NUL;
+                return true;
+            }
+            return parseNumber(value);
+        }
+
+        bool parseNumber(JsonValue& value)
+        {
+            const char* start = Text.c_str() + Pos;
+            char* end = nullptr;
+            double number = strtod(start, &end);
+            if (end == start)
+                return fail("expected a value");
+            Pos += end - start;
+            value.Type = JsonValue::NUMBER;
+            value.Number = number;
+            return true;
+        }
+
+        bool parseString(std::string& str)
+        {
+            ++Pos; // opening quote
+            str.clear();
+            while (Pos < Text.size() && Text[Pos] != '"') {
+                char c = Text[Pos++];
+                if (c != '\\') {
+                    str += c;
+                    continue;
+                }
+                if (Pos >= Text.size())
+                    break;
+                char escaped = Text[Pos++];
+                switch (escaped) {
+                    case 'n': str += '\n'; break;
+                    case 't': str += '\t'; break;
+                    case 'r': str += '\r'; break;
+                    case 'b': str += '\b'; break;
+                    case 'f': str += '\f'; break;
+                    case 'u': {
+                        // only the ascii range is kept, anything else becomes '?'
+                        if (Pos + 4 > Text.size())
+                            return fail("bad unicode escape");
+                        long code = strtol(Text.substr(Pos, 4).c_str(), nullptr, 16);
+                        str += code < 128 ? (char)code : '?';
+                        Pos += 4;
+                        break;
+                    }
+                    default: str += escaped; break;
+                }
+            }
+            if (Pos >= Text.size())
+                return fail("unterminated string");
+            ++Pos; // closing quote
+            return true;
+        }
+
+        bool parseArray(JsonValue& value)
+        {
+            ++Pos;
+            value.Type = JsonValue::ARRAY;
+            skipSpace();
+            if (Pos < Text.size() && Text[Pos] == ']') {
+                ++Pos;
+                return true;
+            }
+            while (true) {
+                value.Array.push_back(JsonValue());
+                if (!parseValue(value.Array.back()))
+                    return false;
+                skipSpace();
+                if (Pos < Text.size() && Text[Pos] == ',') {
+                    ++Pos;
+                    continue;
+                }
+                if (Pos < Text.size() && Text[Pos] == ']') {
+                    ++Pos;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool parseObject(JsonValue& value)
+        {
+            ++Pos;
+            value.Type = JsonValue::OBJECT;
+            skipSpace();
+            if (Pos < Text.size() && Text[Pos] == '}') {
+                ++Pos;
+                return true;
+            }
+            while (true) {
+                skipSpace();
+                if (Pos >= Text.size() || Text[Pos] != '"')
+                    return fail("expected a key");
+                std::string key;
+                if (!parseString(key))
+                    return false;
+                skipSpace();
+                if (Pos >= Text.size() || Text[Pos] != ':')
+                    return fail("expected ':'");
+                ++Pos;
+                if (!parseValue(value.Object[key]))
+                    return false;
+                skipSpace();
+                if (Pos < Text.size() && Text[Pos] == ',') {
+                    ++Pos;
+                    continue;
+                }
+                if (Pos < Text.size() && Text[Pos] == '}') {
+                    ++Pos;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+    };
+}
+
+using namespace ogle;
+
+namespace {
+    const JsonValue NullValue;
+    const std::map<std::string, JsonValue> EmptyObject;
+}
+
+JsonValue::JsonValue()
+    : Type(NUL)
+    , Bool(false)
+    , Number(0.0)
+{
+
+}
+
+bool JsonValue::parse(const std::string& text, JsonValue& result, std::string& error)
+{
+    result = JsonValue();
+    JsonParser parser(text);
+    return parser.parse(result, error);
+}
+
+bool JsonValue::load(const std::string& filename, JsonValue& result, std::string& error)
+{
+    std::ifstream inf(filename);
+    if (!inf.is_open()) {
+        error = "failed to open " + filename;
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << inf.rdbuf();
+    if (!parse(buffer.str(), result, error)) {
+        error = filename + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+JsonValue::type JsonValue::getType() const
+{
+    return Type;
+}
+
+bool JsonValue::isNull() const
+{
+    return Type == NUL;
+}
+
+bool JsonValue::isObject() const
+{
+    return Type == OBJECT;
+}
+
+bool JsonValue::isArray() const
+{
+    return Type == ARRAY;
+}
+
+bool JsonValue::asBool(bool fallback) const
+{
+    return Type == BOOLEAN ? Bool : fallback;
+}
+
+double JsonValue::asNumber(double fallback) const
+{
+    return Type == NUMBER ? Number : fallback;
+}
+
+std::string JsonValue::asString(const std::string& fallback) const
+{
+    if (Type == STRING)
+        return String;
+    if (Type == NUMBER) {
+        std::ostringstream out;
+        out << Number;
+        return out.str();
+    }
+    if (Type == BOOLEAN)
+        return Bool ? "true" : "false";
+    return fallback;
+}
+
+size_t JsonValue::size() const
+{
+    if (Type == ARRAY)
+        return Array.size();
+    if (Type == OBJECT)
+        return Object.size();
+    return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    if (Type != ARRAY || index >= Array.size())
+        return NullValue;
+    return Array[index];
+}
+
+bool JsonValue::has(const std::string& key) const
+{
+    return Type == OBJECT && Object.count(key) > 0;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+    if (Type != OBJECT)
+        return NullValue;
+    auto iter = Object.find(key);
+    return iter == Object.end() ? NullValue : iter->second;
+}
+
+const std::map<std::string, JsonValue>& JsonValue::members() const
+{
+    return Type == OBJECT ? Object : EmptyObject;
+}
@@ -0,0 +1,68 @@
+#ifndef OGLE_JSON_H
+#define OGLE_JSON_H
+
+/****************************************************************
+
+    Minimal JSON reader, enough to load back what the benchmark
+    and profiling tools write out.
+
+    Numbers are always doubles, objects keep their keys sorted.
+
+****************************************************************/
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    class JsonValue
+    {
+    public:
+        enum type
+        {
+            NUL,
+            BOOLEAN,
+            NUMBER,
+            STRING,
+            ARRAY,
+            OBJECT
+        };
+
+        JsonValue();
+
+        /** returns false and fills in error on malformed input */
+        static bool parse(const std::string& text, JsonValue& result, std::string& error);
+        static bool load(const std::string& filename, JsonValue& result, std::string& error);
+
+        type getType() const;
+        bool isNull() const;
+        bool isObject() const;
+        bool isArray() const;
+
+        bool asBool(bool fallback = false) const;
+        double asNumber(double fallback = 0.0) const;
+        std::string asString(const std::string& fallback = "") const;
+
+        /** array access, out of range or non arrays return a null value */
+        size_t size() const;
+        const JsonValue& operator[](size_t index) const;
+
+        /** object access, missing keys return a null value */
+        bool has(const std::string& key) const;
+        const JsonValue& operator[](const std::string& key) const;
+        const std::map<std::string, JsonValue>& members() const;
+
+    private:
+        friend class JsonParser;
+
+        type Type;
+        bool Bool;
+        double Number;
+        std::string String;
+        std::vector<JsonValue> Array;
+        std::map<std::string, JsonValue> Object;
+    };
+}
+
+#endif // OGLE_JSON_H
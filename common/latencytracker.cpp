@@ -0,0 +1,257 @@
+#include "latencytracker.h"
+#include "clockcalibration.h"
+#include "hdrhistogram.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    struct Frame
+    {
+        double Input;       // milliseconds on the ClockCalibration time line
+        double Submit;
+        GLsync Fence;
+        GLuint Query;
+    };
+
+    // latencies are recorded in microseconds, anything past a minute is clamped
+    const int64_t HighestLatency = 60 * 1000 * 1000;
+
+    /** scale turns the recorded integers back into what is printed */
+    void printLine(const char* name, const HdrHistogram& histogram, double scale)
+    {
+        std::cout << std::left << std::setw(24) << name
+                  << std::right << std::setw(10) << histogram.count()
+                  << std::setw(10) << histogram.min() * scale
+                  << std::setw(10) << histogram.valueAtPercentile(50.0) * scale
+                  << std::setw(10) << histogram.valueAtPercentile(95.0) * scale
+                  << std::setw(10) << histogram.valueAtPercentile(99.0) * scale
+                  << std::setw(10) << histogram.max() * scale << "\n";
+    }
+
+    int64_t microseconds(double milliseconds)
+    {
+        return (int64_t)(milliseconds * 1000.0 + 0.5);
+    }
+}
+
+struct LatencyTracker::State
+{
+    State()
+        : SubmitToGpu(HighestLatency, 3)
+        , SubmitToFence(HighestLatency, 3)
+        , InputToGpu(HighestLatency, 3)
+        , QueueDepth(1024, 3)
+    {
+
+    }
+
+    bool GpuTimers;
+
+    // ring of frames in flight, Pending frames starting at Oldest
+    std::vector<Frame> Frames;
+    std::vector<GLuint> Queries;
+    size_t Oldest;
+    size_t Pending;
+    double InputTime;
+
+    unsigned int ForcedWaits;
+    // fixed size however long the run is, nothing is allocated per frame
+    HdrHistogram SubmitToGpu;
+    HdrHistogram SubmitToFence;
+    HdrHistogram InputToGpu;
+    HdrHistogram QueueDepth;
+    double LastSubmitToGpu;     // milliseconds, negative until a frame finished
+
+    double now() const
+    {
+        return ClockCalibration::now() * 1e-3;
+    }
+
+    void finish(Frame& frame, double seen)
+    {
+        SubmitToFence.record(microseconds(seen - frame.Submit));
+
+        if (GpuTimers) {
+            // the query was issued before the fence, its result is there by now
+            GLuint64 gpu_done = 0;
+            glGetQueryObjectui64v(frame.Query, GL_QUERY_RESULT, &gpu_done);
+            double done = ClockCalibration::gpuToCpu(gpu_done) * 1e-3;
+            LastSubmitToGpu = done - frame.Submit;
+            SubmitToGpu.record(microseconds(LastSubmitToGpu));
+            InputToGpu.record(microseconds(done - frame.Input));
+        }
+
+        glDeleteSync(frame.Fence);
+        frame.Fence = 0;
+        Oldest = (Oldest + 1) % Frames.size();
+        Pending--;
+    }
+
+    /** retires frames in order, stops at the first one that is still running */
+    void poll()
+    {
+        while (Pending > 0) {
+            Frame& frame = Frames[Oldest];
+            GLenum status = glClientWaitSync(frame.Fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                return;
+            finish(frame, now());
+        }
+    }
+};
+
+LatencyTracker::State* LatencyTracker::Instance = nullptr;
+
+void LatencyTracker::init(size_t maxFramesInFlight)
+{
+    if (Instance)
+        return;
+
+    Instance = new State;
+    Instance->GpuTimers = GLEW_ARB_timer_query == GL_TRUE;
+    Instance->Frames.resize(std::max<size_t>(maxFramesInFlight, 1));
+    Instance->Queries.resize(Instance->Frames.size());
+    Instance->Oldest = 0;
+    Instance->Pending = 0;
+    Instance->InputTime = 0.0;
+    Instance->ForcedWaits = 0;
+    Instance->LastSubmitToGpu = -1.0;
+
+    ClockCalibration::init();
+
+    if (Instance->GpuTimers) {
+        glGenQueries((GLsizei)Instance->Queries.size(), Instance->Queries.data());
+    }
+    else {
+        std::cerr << "[!] LatencyTracker: GL_ARB_timer_query is not supported, only fence times are recorded." << std::endl;
+    }
+}
+
+void LatencyTracker::beginFrame()
+{
+    if (!Instance)
+        return;
+
+    Instance->InputTime = Instance->now();
+}
+
+void LatencyTracker::endFrame()
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    state.poll();
+
+    if (state.Pending == state.Frames.size()) {
+        // the ring is full, the oldest frame has to finish before its slot can be reused
+        Frame& oldest = state.Frames[state.Oldest];
+        glClientWaitSync(oldest.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        state.finish(oldest, state.now());
+        state.ForcedWaits++;
+    }
+
+    size_t index = (state.Oldest + state.Pending) % state.Frames.size();
+    Frame& frame = state.Frames[index];
+    frame.Input = state.InputTime;
+    frame.Submit = state.now();
+    frame.Query = state.Queries[index];
+    if (state.GpuTimers)
+        glQueryCounter(frame.Query, GL_TIMESTAMP);
+    frame.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    state.Pending++;
+
+    state.QueueDepth.record((int64_t)state.Pending);
+    Profiler::counter("frames in flight", (double)state.Pending);
+    if (state.LastSubmitToGpu >= 0.0)
+        Profiler::counter("submit to gpu done ms", state.LastSubmitToGpu);
+}
+
+void LatencyTracker::poll()
+{
+    if (!Instance)
+        return;
+
+    Instance->poll();
+}
+
+size_t LatencyTracker::framesInFlight()
+{
+    return Instance ? Instance->Pending : 0;
+}
+
+void LatencyTracker::printSummary()
+{
+    if (!Instance)
+        return;
+
+    std::cout << "Frame latency in milliseconds:\n";
+    std::cout << std::left << std::setw(24) << ""
+              << std::right << std::setw(10) << "count"
+              << std::setw(10) << "min"
+              << std::setw(10) << "median"
+              << std::setw(10) << "p95"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "max" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    if (Instance->GpuTimers) {
+        printLine("submit -> gpu done", Instance->SubmitToGpu, 1e-3);
+        printLine("input -> gpu done", Instance->InputToGpu, 1e-3);
+    }
+    printLine("submit -> fence seen", Instance->SubmitToFence, 1e-3);
+    std::cout << std::setprecision(1);
+    printLine("frames in flight", Instance->QueueDepth, 1.0);
+    std::cout.unsetf(std::ios::floatfield);
+    if (Instance->ForcedWaits > 0)
+        std::cout << "[!] " << Instance->ForcedWaits << " frames had to wait for the GPU, more than "
+                  << Instance->Frames.size() << " frames were queued" << std::endl;
+    std::cout << std::endl;
+}
+
+void LatencyTracker::shutdown()
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    while (state.Pending > 0) {
+        Frame& oldest = state.Frames[state.Oldest];
+        glClientWaitSync(oldest.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        state.finish(oldest, state.now());
+    }
+
+    if (state.GpuTimers)
+        glDeleteQueries((GLsizei)state.Queries.size(), state.Queries.data());
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+LatencyTracker::LatencyTracker()
+{
+
+}
+
+LatencyTracker::~LatencyTracker()
+{
+
+}
+
+LatencyTracker::LatencyTracker(const LatencyTracker& other)
+{
+
+}
+
+LatencyTracker& LatencyTracker::operator=(const LatencyTracker& other)
+{
+    return *this;
+}
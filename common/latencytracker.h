@@ -0,0 +1,71 @@
+#ifndef LATENCYTRACKER_H
+#define LATENCYTRACKER_H
+
+/****************************************************************
+
+    End to end frame latency.
+
+    beginFrame() marks when the frame's input was sampled,
+    endFrame() marks when the CPU handed the frame to GL (after
+    swap) and puts a GL_TIMESTAMP query and a fence behind it.
+    Fences are polled with a zero timeout, nothing ever waits on
+    the GPU unless more than maxFramesInFlight frames are queued.
+
+    Every finished frame gives:
+        submit -> gpu done      GL_TIMESTAMP of the last command, moved onto the CPU clock
+        submit -> fence seen    first poll that saw the fence signaled, an upper bound
+        input  -> gpu done      roughly input to display, the swap is the last command
+    and every endFrame() samples how many frames are still queued.
+    They go into HDR histograms (see hdrhistogram.h), a fixed amount
+    of memory however long the run is, precise to 0.1%.
+
+    Usage:
+        ogle::LatencyTracker::init();
+        while (running) {
+            glfwPollEvents();
+            ogle::LatencyTracker::beginFrame();
+            render();
+            glfwSwapBuffers(window);
+            ogle::LatencyTracker::endFrame();
+        }
+        ogle::LatencyTracker::printSummary();
+        ogle::LatencyTracker::shutdown();
+
+    extensions required:
+    GL_ARB_sync, GL_ARB_timer_query, without it only the fence times are recorded.
+
+****************************************************************/
+
+#include <cstddef>
+
+namespace ogle
+{
+    class LatencyTracker
+    {
+    public:
+        /** needs a current GL context */
+        static void init(size_t maxFramesInFlight = 8);
+        static void beginFrame();
+        static void endFrame();
+        /** checks the queued fences without blocking, endFrame() already does this */
+        static void poll();
+
+        /** frames submitted but not yet finished by the GPU */
+        static size_t framesInFlight();
+
+        /** latency distributions in milliseconds and the queue depth */
+        static void printSummary();
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        LatencyTracker();
+        ~LatencyTracker();
+        LatencyTracker(const LatencyTracker& other);
+        LatencyTracker& operator=(const LatencyTracker& other);
+    };
+}
+
+#endif // LATENCYTRACKER_H
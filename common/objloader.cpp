@@ -1,4 +1,5 @@
 #include "objloader.h"
+#include "profiler.h"
 
 #include <iostream>
 #include <cstdlib>
@@ -45,6 +46,7 @@ struct vert_less {
 
 void ObjLoader::load(const std::string& filename)
 {
+    OGLE_PROFILE_ZONE("obj load");
     ifstream inf;
     inf.open(filename.c_str(), ios_base::in);
     if (!inf.is_open()) {
@@ -0,0 +1,185 @@
+#include "perfcounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ogle;
+
+namespace {
+    const char* CounterNames[PerfCounters::MAX] = {
+        "cycles",
+        "instructions",
+        "llc misses",
+        "branch misses",
+        "dtlb misses",
+    };
+
+#ifdef __linux__
+    struct CounterConfig
+    {
+        uint32_t Type;
+        uint64_t Config;
+    };
+
+    const CounterConfig Configs[PerfCounters::MAX] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    };
+
+    int openCounter(const CounterConfig& config, int group)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = config.Type;
+        attr.config = config.Config;
+        attr.disabled = group == -1 ? 1 : 0;    // the leader starts the whole group
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this thread, any cpu
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+    }
+#endif
+}
+
+struct PerfCounters::State
+{
+    int Leader;
+    int Descriptors[MAX];
+    int Slot[MAX];      // position in the group read, -1 when the counter isn't open
+    int Opened;
+};
+
+PerfCounters::State* PerfCounters::Instance = nullptr;
+
+bool PerfCounters::init()
+{
+    if (Instance)
+        return true;
+
+#ifdef __linux__
+    State state;
+    state.Leader = openCounter(Configs[CYCLES], -1);
+    if (state.Leader < 0) {
+        std::string paranoid;
+        std::ifstream inf("/proc/sys/kernel/perf_event_paranoid");
+        if (inf.is_open())
+            std::getline(inf, paranoid);
+        std::cerr << "[!] PerfCounters: perf_event_open failed (" << strerror(errno) << ", perf_event_paranoid "
+                  << (paranoid.empty() ? "unknown" : paranoid) << "), hardware counters are disabled." << std::endl;
+        return false;
+    }
+
+    state.Descriptors[CYCLES] = state.Leader;
+    state.Slot[CYCLES] = 0;
+    state.Opened = 1;
+    for (int i=CYCLES+1; i<MAX; ++i) {
+        state.Descriptors[i] = openCounter(Configs[i], state.Leader);
+        state.Slot[i] = state.Descriptors[i] < 0 ? -1 : state.Opened++;
+        if (state.Descriptors[i] < 0)
+            std::cerr << "[!] PerfCounters: " << CounterNames[i] << " is not available on this CPU." << std::endl;
+    }
+
+    ioctl(state.Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(state.Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    Instance = new State(state);
+    return true;
+#else
+    std::cerr << "[!] PerfCounters: hardware counters are only supported on Linux." << std::endl;
+    return false;
+#endif
+}
+
+bool PerfCounters::available()
+{
+    return Instance != nullptr;
+}
+
+bool PerfCounters::available(counter c)
+{
+    return Instance != nullptr && Instance->Slot[c] >= 0;
+}
+
+const char* PerfCounters::name(counter c)
+{
+    return CounterNames[c];
+}
+
+void PerfCounters::read(uint64_t values[MAX])
+{
+    for (int i=0; i<MAX; ++i)
+        values[i] = 0;
+
+#ifdef __linux__
+    if (!Instance)
+        return;
+
+    // nr, time_enabled, time_running, then one value per counter in the group
+    uint64_t buffer[3 + MAX];
+    ssize_t bytes = ::read(Instance->Leader, buffer, sizeof(buffer));
+    if (bytes < (ssize_t)(3 * sizeof(uint64_t)))
+        return;
+
+    uint64_t count = buffer[0];
+    double enabled = (double)buffer[1];
+    double running = (double)buffer[2];
+    double scale = running > 0.0 ? enabled / running : 1.0;
+    for (int i=0; i<MAX; ++i) {
+        int slot = Instance->Slot[i];
+        if (slot >= 0 && (uint64_t)slot < count)
+            values[i] = (uint64_t)(buffer[3 + slot] * scale);
+    }
+#endif
+}
+
+void PerfCounters::shutdown()
+{
+    if (!Instance)
+        return;
+
+#ifdef __linux__
+    for (int i=MAX-1; i>=0; --i) {
+        if (Instance->Descriptors[i] >= 0)
+            close(Instance->Descriptors[i]);
+    }
+#endif
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+PerfCounters::PerfCounters()
+{
+
+}
+
+PerfCounters::~PerfCounters()
+{
+
+}
+
+PerfCounters::PerfCounters(const PerfCounters& other)
+{
+
+}
+
+PerfCounters& PerfCounters::operator=(const PerfCounters& other)
+{
+    return *this;
+}
@@ -0,0 +1,62 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/****************************************************************
+
+    CPU hardware counters through Linux perf_event_open.
+
+    Counts cycles, instructions, last level cache misses, branch
+    misses and dTLB misses of the calling thread, user space only.
+    The counters are opened as one group so they are read at the
+    same moment, values are scaled when the kernel had to
+    multiplex them.
+
+    The Profiler reads these at the start and end of every zone
+    when OGLE_PERF_COUNTERS is set in the environment.
+
+    perf events are often not allowed (perf_event_paranoid,
+    containers, virtual machines without a PMU), init() then
+    returns false and read() gives zeros, nothing else changes.
+    Counters the CPU doesn't have are left out on their own.
+
+****************************************************************/
+
+#include <cstdint>
+
+namespace ogle
+{
+    class PerfCounters
+    {
+    public:
+        enum counter
+        {
+            CYCLES,
+            INSTRUCTIONS,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            DTLB_MISSES,
+            MAX
+        };
+
+        /** opens the counters for the calling thread, false when perf events aren't permitted */
+        static bool init();
+        static bool available();
+        static bool available(counter c);
+        static const char* name(counter c);
+
+        /** running totals since init(), counters that aren't available read 0 */
+        static void read(uint64_t values[MAX]);
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters& other);
+        PerfCounters& operator=(const PerfCounters& other);
+    };
+}
+
+#endif // PERFCOUNTERS_H
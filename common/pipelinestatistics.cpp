@@ -0,0 +1,225 @@
+#include "pipelinestatistics.h"
+
+#include <iomanip>
+#include <iostream>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    // query targets, in the same order as the statistics in PipelineStatistics
+    const GLenum StatisticTargets[] = {
+        GL_VERTICES_SUBMITTED_ARB,
+        GL_PRIMITIVES_SUBMITTED_ARB,
+        GL_VERTEX_SHADER_INVOCATIONS_ARB,
+        GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+        GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+        GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+        GL_COMPUTE_SHADER_INVOCATIONS_ARB,
+    };
+    const int StatisticCount = sizeof(StatisticTargets) / sizeof(StatisticTargets[0]);
+
+    void add(PipelineCounts& total, const PipelineCounts& counts)
+    {
+        total.VerticesSubmitted += counts.VerticesSubmitted;
+        total.PrimitivesSubmitted += counts.PrimitivesSubmitted;
+        total.VertexInvocations += counts.VertexInvocations;
+        total.ClippingInput += counts.ClippingInput;
+        total.ClippingOutput += counts.ClippingOutput;
+        total.FragmentInvocations += counts.FragmentInvocations;
+        total.ComputeInvocations += counts.ComputeInvocations;
+        total.GpuTime += counts.GpuTime;
+    }
+}
+
+PipelineCounts::PipelineCounts()
+    : VerticesSubmitted(0)
+    , PrimitivesSubmitted(0)
+    , VertexInvocations(0)
+    , ClippingInput(0)
+    , ClippingOutput(0)
+    , FragmentInvocations(0)
+    , ComputeInvocations(0)
+    , GpuTime(0.0)
+{
+
+}
+
+PipelineStatistics::PipelineStatistics()
+    : Statistics(false)
+    , Active(false)
+    , Count(0)
+{
+
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+
+}
+
+void PipelineStatistics::init(const std::string& name)
+{
+    Name = name;
+    Statistics = GLEW_ARB_pipeline_statistics_query == GL_TRUE;
+    if (!Statistics)
+        std::cerr << "[!] PipelineStatistics: GL_ARB_pipeline_statistics_query is not supported, " << Name << " only records GPU time." << std::endl;
+}
+
+void PipelineStatistics::begin()
+{
+    if (Active) {
+        std::cerr << "[!] PipelineStatistics: " << Name << " begin() called twice, zones can not be nested." << std::endl;
+        return;
+    }
+
+    if (Free.empty()) {
+        QuerySet set;
+        glGenQueries(QUERY_COUNT, set.Queries);
+        Free.push_back(Sets.size());
+        Sets.push_back(set);
+    }
+
+    size_t index = Free.back();
+    Free.pop_back();
+    Pending.push_back(index);
+    Active = true;
+
+    const QuerySet& set = Sets[index];
+    glQueryCounter(set.Queries[TIME_START], GL_TIMESTAMP);
+    if (Statistics) {
+        for (int i=0; i<StatisticCount; ++i)
+            glBeginQuery(StatisticTargets[i], set.Queries[VERTICES + i]);
+    }
+}
+
+void PipelineStatistics::end()
+{
+    if (!Active)
+        return;
+
+    const QuerySet& set = Sets[Pending.back()];
+    if (Statistics) {
+        for (int i=0; i<StatisticCount; ++i)
+            glEndQuery(StatisticTargets[i]);
+    }
+    glQueryCounter(set.Queries[TIME_END], GL_TIMESTAMP);
+    Active = false;
+}
+
+int PipelineStatistics::poll()
+{
+    int read = 0;
+
+    // zones finish in order, stop at the first one that is still running
+    size_t done = 0;
+    size_t finished = Active ? Pending.size() - 1 : Pending.size();
+    while (done < finished) {
+        const QuerySet& set = Sets[Pending[done]];
+        int last = Statistics ? QUERY_COUNT : TIME_END + 1;
+
+        bool available = true;
+        for (int i=0; i<last && available; ++i) {
+            GLint result = GL_FALSE;
+            glGetQueryObjectiv(set.Queries[i], GL_QUERY_RESULT_AVAILABLE, &result);
+            available = result == GL_TRUE;
+        }
+        if (!available)
+            break;
+
+        GLuint64 values[QUERY_COUNT] = {0};
+        for (int i=0; i<last; ++i)
+            glGetQueryObjectui64v(set.Queries[i], GL_QUERY_RESULT, &values[i]);
+
+        PipelineCounts counts;
+        counts.GpuTime = (values[TIME_END] - values[TIME_START]) * 1e-6;
+        counts.VerticesSubmitted = values[VERTICES];
+        counts.PrimitivesSubmitted = values[PRIMITIVES];
+        counts.VertexInvocations = values[VERTEX_INVOCATIONS];
+        counts.ClippingInput = values[CLIPPING_INPUT];
+        counts.ClippingOutput = values[CLIPPING_OUTPUT];
+        counts.FragmentInvocations = values[FRAGMENT_INVOCATIONS];
+        counts.ComputeInvocations = values[COMPUTE_INVOCATIONS];
+
+        Last = counts;
+        add(Total, counts);
+        Count++;
+
+        Free.push_back(Pending[done]);
+        done++;
+        read++;
+    }
+    Pending.erase(Pending.begin(), Pending.begin() + done);
+
+    return read;
+}
+
+const PipelineCounts& PipelineStatistics::last() const
+{
+    return Last;
+}
+
+PipelineCounts PipelineStatistics::average() const
+{
+    PipelineCounts result;
+    if (Count == 0)
+        return result;
+
+    result.VerticesSubmitted = Total.VerticesSubmitted / Count;
+    result.PrimitivesSubmitted = Total.PrimitivesSubmitted / Count;
+    result.VertexInvocations = Total.VertexInvocations / Count;
+    result.ClippingInput = Total.ClippingInput / Count;
+    result.ClippingOutput = Total.ClippingOutput / Count;
+    result.FragmentInvocations = Total.FragmentInvocations / Count;
+    result.ComputeInvocations = Total.ComputeInvocations / Count;
+    result.GpuTime = Total.GpuTime / Count;
+    return result;
+}
+
+size_t PipelineStatistics::samples() const
+{
+    return Count;
+}
+
+void PipelineStatistics::print() const
+{
+    PipelineCounts avg = average();
+    std::cout << Name << ", average of " << Count << " zones:\n"
+              << "\tgpu time:              " << std::fixed << std::setprecision(4) << avg.GpuTime << " ms\n";
+    std::cout.unsetf(std::ios::floatfield);
+    if (Statistics) {
+        std::cout << "\tvertices submitted:    " << avg.VerticesSubmitted << "\n"
+                  << "\tprimitives submitted:  " << avg.PrimitivesSubmitted << "\n"
+                  << "\tvertex invocations:    " << avg.VertexInvocations << "\n"
+                  << "\tclipping in / out:     " << avg.ClippingInput << " / " << avg.ClippingOutput << "\n"
+                  << "\tfragment invocations:  " << avg.FragmentInvocations << "\n"
+                  << "\tcompute invocations:   " << avg.ComputeInvocations << "\n";
+        if (avg.GpuTime > 0.0 && avg.FragmentInvocations > 0)
+            std::cout << "\tfragments per us:      " << avg.FragmentInvocations / (avg.GpuTime * 1e3) << "\n";
+        if (avg.GpuTime > 0.0 && avg.ComputeInvocations > 0)
+            std::cout << "\tinvocations per us:    " << avg.ComputeInvocations / (avg.GpuTime * 1e3) << "\n";
+    }
+    std::cout << std::endl;
+}
+
+void PipelineStatistics::shutdown()
+{
+    for (auto& set : Sets)
+        glDeleteQueries(QUERY_COUNT, set.Queries);
+    Sets.clear();
+    Free.clear();
+    Pending.clear();
+    Active = false;
+}
+
+PipelineStatistics::PipelineStatistics(const PipelineStatistics& other)
+{
+
+}
+
+PipelineStatistics& PipelineStatistics::operator=(const PipelineStatistics& other)
+{
+    return *this;
+}
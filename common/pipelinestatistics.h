@@ -0,0 +1,116 @@
+#ifndef PIPELINESTATISTICS_H
+#define PIPELINESTATISTICS_H
+
+/****************************************************************
+
+    Pipeline statistics for a GPU zone, a companion to gpuTimer
+    that says why a pass is slow instead of only how slow it is.
+
+    begin()/end() wrap the pass in GL_TIMESTAMP queries and one
+    query per pipeline statistic. Results are read back by poll()
+    once they are available, it never waits on the GPU, so queries
+    from a couple of frames can be in flight at the same time.
+
+    Usage:
+        ogle::PipelineStatistics stats;
+        stats.init("xor pass");
+        ...
+        stats.begin();
+        draw();
+        stats.end();
+        ...
+        stats.poll(); // once per frame
+        ...
+        stats.print();
+        stats.shutdown();
+
+    Zones can not be nested, or overlap with other queries on the
+    same statistic targets.
+
+    extensions required:
+    GL_ARB_pipeline_statistics_query, without it only the GPU time is recorded.
+    GL_ARB_timer_query
+
+****************************************************************/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    struct PipelineCounts
+    {
+        PipelineCounts();
+
+        uint64_t VerticesSubmitted;
+        uint64_t PrimitivesSubmitted;
+        uint64_t VertexInvocations;
+        uint64_t ClippingInput;         // primitives that reached the clipper
+        uint64_t ClippingOutput;        // primitives that came out of it
+        uint64_t FragmentInvocations;
+        uint64_t ComputeInvocations;
+        double GpuTime;                 // milliseconds
+    };
+
+    class PipelineStatistics
+    {
+    public:
+        PipelineStatistics();
+        ~PipelineStatistics();
+
+        /** needs a current GL context, name is only used in print() */
+        void init(const std::string& name);
+        void begin();
+        void end();
+
+        /** reads back every finished zone without waiting, returns how many were read */
+        int poll();
+
+        /** most recent finished zone */
+        const PipelineCounts& last() const;
+        PipelineCounts average() const;
+        size_t samples() const;
+
+        /** average counts next to the average GPU time */
+        void print() const;
+        void shutdown();
+
+    private:
+        enum
+        {
+            TIME_START,
+            TIME_END,
+            VERTICES,
+            PRIMITIVES,
+            VERTEX_INVOCATIONS,
+            CLIPPING_INPUT,
+            CLIPPING_OUTPUT,
+            FRAGMENT_INVOCATIONS,
+            COMPUTE_INVOCATIONS,
+            QUERY_COUNT
+        };
+
+        struct QuerySet
+        {
+            unsigned int Queries[QUERY_COUNT];
+        };
+
+        std::string Name;
+        bool Statistics;
+        bool Active;
+
+        std::vector<QuerySet> Sets;
+        std::vector<size_t> Free;
+        std::vector<size_t> Pending;   // oldest first
+
+        PipelineCounts Last;
+        PipelineCounts Total;
+        size_t Count;
+
+        PipelineStatistics(const PipelineStatistics& other);
+        PipelineStatistics& operator=(const PipelineStatistics& other);
+    };
+}
+
+#endif // PIPELINESTATISTICS_H
@@ -0,0 +1,641 @@
+#include "profiler.h"
+#include "alloctracker.h"
+#include "clockcalibration.h"
+#include "frametimes.h"
+#include "glintercept.h"
+#include "gpumemory.h"
+#include "perfcounters.h"
+#include "residency.h"
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    // caps the memory used by a long run, zones past this are summarized but not traced
+    const size_t MaxRecordedZones = 1 << 20;
+
+    const GLuint QueryGrowCount = 64;
+
+    // frames the gpu may run behind before endFrame() waits for the oldest one, plus the open frame
+    const unsigned int FrameSlots = 8;
+
+    struct Zone
+    {
+        const char* Name;
+        unsigned int Frame;
+        int Depth;
+        double CpuStart;    // microseconds since Profiler::init
+        double CpuEnd;
+        GLuint QueryStart;  // 0 when gpu timers aren't available
+        GLuint QueryEnd;
+        double GpuStart;    // microseconds, moved onto the CPU time line
+        double GpuEnd;
+        uint64_t Counters[PerfCounters::MAX];   // hardware counter deltas, zeros when they are off
+        uint64_t Bytes;     // what the zone said it moved, see Profiler::zoneBytes
+        uint64_t Allocations;       // operator new calls on the zone's thread, see alloctracker.h
+        uint64_t AllocatedBytes;
+    };
+
+    struct FrameSlot
+    {
+        std::vector<Zone> Zones;
+        std::vector<GLuint> Queries;
+        size_t QueriesUsed;
+
+        FrameSlot() : QueriesUsed(0) {}
+    };
+
+    struct CounterSample
+    {
+        const char* Name;
+        unsigned int Frame;
+        double Time;        // microseconds since Profiler::init
+        double Value;
+    };
+
+    struct CounterTotals
+    {
+        unsigned int Count;
+        double Sum;
+        double Max;
+
+        CounterTotals() : Count(0), Sum(0), Max(0) {}
+    };
+
+    struct Totals
+    {
+        unsigned int Count;
+        double Cpu;
+        double Gpu;
+        uint64_t Counters[PerfCounters::MAX];
+        uint64_t Bytes;
+        uint64_t Allocations;
+        uint64_t AllocatedBytes;
+
+        Totals() : Count(0), Cpu(0), Gpu(0), Counters(), Bytes(0), Allocations(0), AllocatedBytes(0) {}
+
+        void add(const Totals& other)
+        {
+            Count += other.Count;
+            Cpu += other.Cpu;
+            Gpu += other.Gpu;
+            for (int i=0; i<PerfCounters::MAX; ++i)
+                Counters[i] += other.Counters[i];
+            Bytes += other.Bytes;
+            Allocations += other.Allocations;
+            AllocatedBytes += other.AllocatedBytes;
+        }
+    };
+
+    void writeEscaped(std::ostream& out, const char* str)
+    {
+        for (const char* c = str; *c != 0; ++c) {
+            if (*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+    }
+}
+
+struct Profiler::State
+{
+    std::string TraceFilename;
+    std::thread::id Owner;
+    bool GpuTimers;
+    bool CpuCounters;
+
+    // ring of frames, the PendingCount closed frames after Oldest wait for the gpu
+    // to finish their queries, the slot after them is the open frame
+    FrameSlot Slots[FrameSlots];
+    unsigned int Oldest;
+    unsigned int PendingCount;
+    unsigned int FrameNumber;
+    int FrameZone;
+    // microseconds, the frame zone of the latest resolved frame
+    double LastGpuFrame;
+
+    std::vector<int> Stack;
+    std::vector<Zone> Recorded;
+    bool RecordedFull;
+
+    // keyed by the name's address, names are expected to be literals
+    std::map<const char*, Totals> Summary;
+
+    std::vector<CounterSample> Counters;
+    std::map<const char*, CounterTotals> CounterSummary;
+
+    double now() const
+    {
+        return ClockCalibration::now();
+    }
+
+    FrameSlot& active()
+    {
+        return Slots[(Oldest + PendingCount) % FrameSlots];
+    }
+
+    const FrameSlot& active() const
+    {
+        return Slots[(Oldest + PendingCount) % FrameSlots];
+    }
+
+    GLuint nextQuery()
+    {
+        FrameSlot& slot = active();
+        if (slot.QueriesUsed == slot.Queries.size()) {
+            slot.Queries.resize(slot.Queries.size() + QueryGrowCount);
+            glGenQueries(QueryGrowCount, &slot.Queries[slot.QueriesUsed]);
+        }
+        return slot.Queries[slot.QueriesUsed++];
+    }
+
+    /** false while the gpu hasn't written every timestamp of the slot, asking doesn't wait */
+    bool available(const FrameSlot& slot) const
+    {
+        for (const auto& zone : slot.Zones) {
+            if (zone.QueryEnd != 0) {
+                GLuint done = GL_FALSE;
+                glGetQueryObjectuiv(zone.QueryEnd, GL_QUERY_RESULT_AVAILABLE, &done);
+                if (done == GL_FALSE)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /** resolves pending frames in order until one isn't available, unless wait */
+    void resolvePending(bool wait)
+    {
+        while (PendingCount > 0 && (wait || available(Slots[Oldest])))
+            resolveOldest();
+    }
+
+    void resolveOldest()
+    {
+        resolve(Slots[Oldest]);
+        Oldest = (Oldest + 1) % FrameSlots;
+        PendingCount--;
+    }
+
+    /** reads back the gpu times of a slot and moves its zones into the recording */
+    void resolve(FrameSlot& slot)
+    {
+        // the summary and the trace are the profiler's own, they grow until the trace is full
+        AllocTracker::Untracked untracked;
+        for (auto& zone : slot.Zones) {
+            if (zone.QueryStart != 0) {
+                GLuint64 start = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(zone.QueryStart, GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(zone.QueryEnd,   GL_QUERY_RESULT, &end);
+                zone.GpuStart = ClockCalibration::gpuToCpu(start);
+                zone.GpuEnd   = ClockCalibration::gpuToCpu(end);
+                if (zone.Depth == 0 && strcmp(zone.Name, "frame") == 0) {
+                    LastGpuFrame = zone.GpuEnd - zone.GpuStart;
+                    FrameTimes::gpuFrame(LastGpuFrame);
+                }
+            }
+
+            Totals& totals = Summary[zone.Name];
+            totals.Count++;
+            totals.Cpu += zone.CpuEnd - zone.CpuStart;
+            totals.Gpu += zone.GpuEnd - zone.GpuStart;
+            for (int i=0; i<PerfCounters::MAX; ++i)
+                totals.Counters[i] += zone.Counters[i];
+            totals.Bytes += zone.Bytes;
+            totals.Allocations += zone.Allocations;
+            totals.AllocatedBytes += zone.AllocatedBytes;
+
+            if (Recorded.size() < MaxRecordedZones) {
+                Recorded.push_back(zone);
+            }
+            else if (!RecordedFull) {
+                std::cerr << "[!] Profiler: trace is full, only the summary will be updated from now on." << std::endl;
+                RecordedFull = true;
+            }
+        }
+
+        slot.Zones.clear();
+        slot.QueriesUsed = 0;
+    }
+
+    /** microseconds, the frame zone was closed but the slot wasn't resolved yet */
+    double frameCpuTime() const
+    {
+        const FrameSlot& slot = active();
+        if (FrameZone < 0 || FrameZone >= (int)slot.Zones.size())
+            return 0.0;
+        return slot.Zones[FrameZone].CpuEnd - slot.Zones[FrameZone].CpuStart;
+    }
+
+    /** one sample for the shared memory ring, a few loads and a copy */
+    void writeTelemetry()
+    {
+        TelemetrySample sample = {};
+        sample.Frame = FrameNumber;
+        sample.CpuMilliseconds = (float)(frameCpuTime() * 0.001);
+        sample.GpuMilliseconds = (float)(LastGpuFrame * 0.001);
+        if (GLIntercept::running()) {
+            const GLCallStats& calls = GLIntercept::lastFrame();
+            sample.UploadBytes = calls.UploadBytes;
+            sample.DrawCalls = (uint32_t)calls.Draws;
+        }
+        sample.GpuMemoryBytes = GpuMemory::current(GpuMemory::BUFFER) + GpuMemory::current(GpuMemory::TEXTURE);
+        sample.ResidentBytes = Residency::stats().ResidentBytes;
+        sample.Allocations = (uint32_t)AllocTracker::lastFrame().Allocations;
+        Telemetry::write(sample);
+    }
+};
+
+Profiler::State* Profiler::Instance = nullptr;
+
+void Profiler::init(const std::string& traceFilename)
+{
+    if (Instance)
+        return;
+
+    Instance = new State;
+    Instance->TraceFilename = traceFilename;
+    Instance->Owner = std::this_thread::get_id();
+    Instance->Oldest = 0;
+    Instance->PendingCount = 0;
+    Instance->FrameNumber = 0;
+    Instance->FrameZone = -1;
+    Instance->LastGpuFrame = 0.0;
+    Instance->RecordedFull = false;
+    Instance->GpuTimers = GLEW_ARB_timer_query == GL_TRUE;
+
+    // GL_TIMESTAMP and the cpu clock have different origins and rates,
+    // gpu zones are moved onto the cpu time line when they are resolved.
+    ClockCalibration::init();
+
+    if (!Instance->GpuTimers) {
+        std::cerr << "[!] Profiler: GL_ARB_timer_query is not supported, only recording CPU times." << std::endl;
+    }
+
+    // hardware counters cost a syscall per zone edge, only read them when asked for
+    Instance->CpuCounters = getenv("OGLE_PERF_COUNTERS") != nullptr && PerfCounters::init();
+
+    FrameTimes::init();
+    // only with OGLE_TELEMETRY in the environment
+    Telemetry::init();
+}
+
+void Profiler::beginFrame()
+{
+    if (!Instance)
+        return;
+
+    Instance->FrameZone = pushZone("frame");
+}
+
+void Profiler::endFrame()
+{
+    if (!Instance)
+        return;
+
+    popZone(Instance->FrameZone);
+    FrameTimes::endFrame(Instance->frameCpuTime(), Instance->now());
+    AllocTracker::endFrame();
+    GpuMemory::endFrame();
+    Residency::endFrame();
+    if (Telemetry::running())
+        Instance->writeTelemetry();
+    Instance->FrameZone = -1;
+    Instance->FrameNumber++;
+    ClockCalibration::update();
+
+    // the frame waits until the gpu is done with it, frames still running are looked at again next time,
+    // only a gpu that is a whole ring behind makes this wait for the oldest one
+    State& state = *Instance;
+    state.PendingCount++;
+    if (state.PendingCount == FrameSlots)
+        state.resolveOldest();
+    state.resolvePending(false);
+}
+
+int Profiler::pushZone(const char* name)
+{
+    if (!Instance || std::this_thread::get_id() != Instance->Owner)
+        return -1;
+
+    State& state = *Instance;
+    FrameSlot& slot = state.active();
+    // the slot's zones and queries grow until the ring has seen the busiest frame
+    AllocTracker::Untracked untracked;
+
+    Zone zone;
+    zone.Name = name;
+    zone.Frame = state.FrameNumber;
+    zone.Depth = (int)state.Stack.size();
+    zone.CpuStart = state.now();
+    zone.CpuEnd = zone.CpuStart;
+    zone.QueryStart = 0;
+    zone.QueryEnd = 0;
+    zone.GpuStart = 0.0;
+    zone.GpuEnd = 0.0;
+    zone.Bytes = 0;
+
+    if (state.GpuTimers) {
+        zone.QueryStart = state.nextQuery();
+        zone.QueryEnd = state.nextQuery();
+        glQueryCounter(zone.QueryStart, GL_TIMESTAMP);
+    }
+
+    // read last so the profiler's own work is counted as little as possible
+    PerfCounters::read(zone.Counters);
+
+    int id = (int)slot.Zones.size();
+    slot.Zones.push_back(zone);
+    state.Stack.push_back(id);
+
+    AllocCounts allocs = AllocTracker::thread();
+    slot.Zones[id].Allocations = allocs.Allocations;
+    slot.Zones[id].AllocatedBytes = allocs.Bytes;
+    return id;
+}
+
+void Profiler::popZone(int id)
+{
+    if (!Instance || id < 0)
+        return;
+
+    State& state = *Instance;
+    AllocCounts allocs = AllocTracker::thread();
+    uint64_t counters[PerfCounters::MAX];
+    if (state.CpuCounters)
+        PerfCounters::read(counters);
+
+    FrameSlot& slot = state.active();
+    if (state.Stack.empty() || state.Stack.back() != id || id >= (int)slot.Zones.size()) {
+        std::cerr << "[!] Profiler: zones closed out of order, or a zone was left open across endFrame()." << std::endl;
+        return;
+    }
+    state.Stack.pop_back();
+
+    Zone& zone = slot.Zones[id];
+    for (int i=0; i<PerfCounters::MAX; ++i)
+        zone.Counters[i] = state.CpuCounters ? counters[i] - zone.Counters[i] : 0;
+    zone.Allocations = allocs.Allocations - zone.Allocations;
+    zone.AllocatedBytes = allocs.Bytes - zone.AllocatedBytes;
+    if (zone.QueryEnd != 0)
+        glQueryCounter(zone.QueryEnd, GL_TIMESTAMP);
+    zone.CpuEnd = state.now();
+}
+
+void Profiler::zoneBytes(uint64_t bytes)
+{
+    if (!Instance || Instance->Stack.empty() || std::this_thread::get_id() != Instance->Owner)
+        return;
+
+    State& state = *Instance;
+    state.active().Zones[state.Stack.back()].Bytes += bytes;
+}
+
+void Profiler::counter(const char* name, double value)
+{
+    if (!Instance || std::this_thread::get_id() != Instance->Owner)
+        return;
+
+    State& state = *Instance;
+    // recorded until the trace is full, the profiler's bookkeeping isn't the frame's allocation
+    AllocTracker::Untracked untracked;
+    CounterTotals& totals = state.CounterSummary[name];
+    totals.Max = totals.Count == 0 ? value : std::max(totals.Max, value);
+    totals.Count++;
+    totals.Sum += value;
+
+    if (state.Counters.size() < MaxRecordedZones) {
+        CounterSample sample;
+        sample.Name = name;
+        sample.Frame = state.FrameNumber;
+        sample.Time = state.now();
+        sample.Value = value;
+        state.Counters.push_back(sample);
+    }
+}
+
+void Profiler::printSummary()
+{
+    if (!Instance)
+        return;
+
+    // different call sites can use the same name, merge them
+    std::map<std::string, Totals> merged;
+    for (const auto& kv : Instance->Summary)
+        merged[kv.first].add(kv.second);
+
+    std::vector<std::pair<std::string, Totals>> sorted(merged.begin(), merged.end());
+    std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<std::string, Totals>& lhs, const std::pair<std::string, Totals>& rhs) {
+            return lhs.second.Cpu > rhs.second.Cpu;
+        });
+
+    std::cout << "Profiler summary, averages in milliseconds:\n";
+    std::cout << std::left << std::setw(32) << "zone"
+              << std::right << std::setw(10) << "count"
+              << std::setw(12) << "cpu"
+              << std::setw(12) << "gpu" << "\n";
+    std::cout << std::fixed << std::setprecision(4);
+    for (const auto& kv : sorted) {
+        const Totals& totals = kv.second;
+        std::cout << std::left << std::setw(32) << kv.first
+                  << std::right << std::setw(10) << totals.Count
+                  << std::setw(12) << (totals.Cpu * 1e-3) / totals.Count
+                  << std::setw(12) << (totals.Gpu * 1e-3) / totals.Count << "\n";
+    }
+
+    if (Instance->CpuCounters) {
+        std::cout << "\nHardware counters, averages per zone:\n";
+        std::cout << std::left << std::setw(32) << "zone" << std::right;
+        for (int i=0; i<PerfCounters::MAX; ++i)
+            std::cout << std::setw(16) << PerfCounters::name((PerfCounters::counter)i);
+        std::cout << std::setw(8) << "ipc" << std::setw(14) << "bytes/cycle" << "\n";
+        for (const auto& kv : sorted) {
+            const Totals& totals = kv.second;
+            std::cout << std::left << std::setw(32) << kv.first << std::right << std::setprecision(0);
+            for (int i=0; i<PerfCounters::MAX; ++i) {
+                if (PerfCounters::available((PerfCounters::counter)i))
+                    std::cout << std::setw(16) << (double)totals.Counters[i] / totals.Count;
+                else
+                    std::cout << std::setw(16) << "-";
+            }
+
+            double cycles = (double)totals.Counters[PerfCounters::CYCLES];
+            double instructions = (double)totals.Counters[PerfCounters::INSTRUCTIONS];
+            std::cout << std::setprecision(2);
+            if (cycles > 0.0 && PerfCounters::available(PerfCounters::INSTRUCTIONS))
+                std::cout << std::setw(8) << instructions / cycles;
+            else
+                std::cout << std::setw(8) << "-";
+            if (totals.Bytes > 0 && cycles > 0.0)
+                std::cout << std::setw(14) << totals.Bytes / cycles;
+            std::cout << "\n";
+        }
+        std::cout << std::setprecision(4);
+    }
+
+    if (AllocTracker::compiledIn()) {
+        std::cout << "\nHeap allocations, averages per zone:\n";
+        std::cout << std::left << std::setw(32) << "zone" << std::right
+                  << std::setw(16) << "allocations" << std::setw(16) << "bytes" << "\n";
+        std::cout << std::setprecision(1);
+        for (const auto& kv : sorted) {
+            const Totals& totals = kv.second;
+            std::cout << std::left << std::setw(32) << kv.first << std::right
+                      << std::setw(16) << (double)totals.Allocations / totals.Count
+                      << std::setw(16) << (double)totals.AllocatedBytes / totals.Count << "\n";
+        }
+        std::cout << std::setprecision(4);
+    }
+
+    if (!Instance->CounterSummary.empty()) {
+        std::map<std::string, CounterTotals> counters;
+        for (const auto& kv : Instance->CounterSummary) {
+            CounterTotals& totals = counters[kv.first];
+            totals.Max = totals.Count == 0 ? kv.second.Max : std::max(totals.Max, kv.second.Max);
+            totals.Count += kv.second.Count;
+            totals.Sum += kv.second.Sum;
+        }
+
+        std::cout << "\n" << std::left << std::setw(32) << "counter"
+                  << std::right << std::setw(10) << "count"
+                  << std::setw(16) << "average"
+                  << std::setw(16) << "max" << "\n";
+        std::cout << std::setprecision(1);
+        for (const auto& kv : counters) {
+            const CounterTotals& totals = kv.second;
+            std::cout << std::left << std::setw(32) << kv.first
+                      << std::right << std::setw(10) << totals.Count
+                      << std::setw(16) << totals.Sum / totals.Count
+                      << std::setw(16) << totals.Max << "\n";
+        }
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    if (Instance->GpuTimers) {
+        std::cout << "\ngpu clock drift " << ClockCalibration::driftPpm() << " ppm over "
+                  << ClockCalibration::sampleCount() << " calibration samples\n";
+    }
+    std::cout << std::endl;
+
+    FrameTimes::printSummary();
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+    if (!Instance)
+        return false;
+
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "[!] Profiler: failed to open " << filename << std::endl;
+        return false;
+    }
+
+    const int pid = 1;
+    const int cpu_tid = 1;
+    const int gpu_tid = 2;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << cpu_tid << ",\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << gpu_tid << ",\"args\":{\"name\":\"GPU\"}},\n";
+    out << "{\"name\":\"clock_calibration\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"drift_ppm\":" << ClockCalibration::driftPpm()
+        << ",\"samples\":" << ClockCalibration::sampleCount() << "}}";
+
+    for (const auto& zone : Instance->Recorded) {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, zone.Name);
+        out << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << cpu_tid
+            << ",\"ts\":" << zone.CpuStart << ",\"dur\":" << zone.CpuEnd - zone.CpuStart
+            << ",\"args\":{\"frame\":" << zone.Frame << ",\"depth\":" << zone.Depth;
+        if (Instance->CpuCounters) {
+            for (int i=0; i<PerfCounters::MAX; ++i) {
+                if (PerfCounters::available((PerfCounters::counter)i))
+                    out << ",\"" << PerfCounters::name((PerfCounters::counter)i) << "\":" << zone.Counters[i];
+            }
+        }
+        if (zone.Bytes > 0)
+            out << ",\"bytes\":" << zone.Bytes;
+        if (zone.Allocations > 0)
+            out << ",\"allocations\":" << zone.Allocations << ",\"allocated_bytes\":" << zone.AllocatedBytes;
+        out << "}}";
+
+        if (zone.QueryStart != 0) {
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, zone.Name);
+            out << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << gpu_tid
+                << ",\"ts\":" << zone.GpuStart << ",\"dur\":" << zone.GpuEnd - zone.GpuStart
+                << ",\"args\":{\"frame\":" << zone.Frame << ",\"depth\":" << zone.Depth << "}}";
+        }
+    }
+    for (const auto& sample : Instance->Counters) {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, sample.Name);
+        out << "\",\"ph\":\"C\",\"pid\":" << pid << ",\"ts\":" << sample.Time
+            << ",\"args\":{\"value\":" << sample.Value << "}}";
+    }
+    out << "\n]}\n";
+
+    std::cout << "Wrote " << Instance->Recorded.size() << " profiler zones and "
+              << Instance->Counters.size() << " counter samples to " << filename << std::endl;
+    return true;
+}
+
+void Profiler::shutdown()
+{
+    if (!Instance)
+        return;
+
+    // pick up everything that is still in flight, oldest frames first, waiting is fine now
+    Instance->resolvePending(true);
+
+    if (!Instance->TraceFilename.empty())
+        writeChromeTrace(Instance->TraceFilename);
+
+    if (Instance->CpuCounters)
+        PerfCounters::shutdown();
+    Telemetry::shutdown();
+    FrameTimes::shutdown();
+
+    for (auto& slot : Instance->Slots) {
+        if (!slot.Queries.empty())
+            glDeleteQueries((GLsizei)slot.Queries.size(), slot.Queries.data());
+    }
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+Profiler::Profiler()
+{
+
+}
+
+Profiler::~Profiler()
+{
+
+}
+
+Profiler::Profiler(const Profiler& other)
+{
+
+}
+
+Profiler& Profiler::operator=(const Profiler& other)
+{
+    return *this;
+}
@@ -0,0 +1,120 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/****************************************************************
+
+    Hierarchical CPU + GPU profiling zones.
+
+    Every zone records a CPU time stamp and a GL_TIMESTAMP query
+    when it opens and when it closes. GPU results are read back
+    only once GL_QUERY_RESULT_AVAILABLE says they are there, a
+    frame the GPU hasn't finished yet is looked at again at the
+    next endFrame(). Frames wait in a ring of 8, only a GPU that
+    is 7 frames behind makes endFrame() wait for the oldest one.
+
+    Finished frames are kept in memory and can be written out as
+    Chrome trace-event JSON, open the file in about://tracing or
+    https://ui.perfetto.dev
+
+    Usage:
+        ogle::Profiler::init("experiment.trace.json");
+        while (running) {
+            ogle::Profiler::beginFrame();
+            {
+                OGLE_PROFILE_ZONE("update");
+                update();
+            }
+            ogle::Profiler::endFrame();
+        }
+        ogle::Profiler::shutdown(); // writes the trace
+
+    Zones are only meant to be used from the thread that owns the GL context,
+    the one that called init(). Zones, bytes and counters from other threads
+    (background loading, see startup.h) are ignored.
+
+    With OGLE_PERF_COUNTERS set in the environment every zone also
+    records CPU hardware counters (cycles, instructions, cache and
+    TLB misses), see perfcounters.h. The summary then adds IPC, and
+    bytes per cycle for zones that report what they moved with
+    zoneBytes().
+
+    Built with OGLE_ALLOC_TRACKER zones also count the heap
+    allocations their thread made, see alloctracker.h. The
+    profiler's own trace and summary keep growing, their
+    allocations aren't counted.
+
+    Every frame's CPU, GPU and present times also go into HDR
+    histograms, printSummary() ends with their percentiles, see
+    frametimes.h.
+
+    With OGLE_TELEMETRY set in the environment endFrame() also
+    writes a sample for tools/telemetry_tail into shared memory,
+    see telemetry.h.
+
+    Counters are single values per frame (draw calls, bytes uploaded...),
+    they show up as counter tracks in the trace and as averages in the summary.
+
+    extensions required:
+    GL_ARB_timer_query, without it only CPU times are recorded.
+
+****************************************************************/
+
+#include <cstdint>
+#include <string>
+
+namespace ogle
+{
+    class Profiler
+    {
+    public:
+        /** needs a current GL context, an empty filename skips writing a trace at shutdown */
+        static void init(const std::string& traceFilename = "");
+        static void beginFrame();
+        static void endFrame();
+
+        /** returns an id that has to be passed to popZone(), -1 when the profiler is not running */
+        static int  pushZone(const char* name);
+        static void popZone(int zone);
+        /** adds to the bytes moved by the innermost open zone, shows up as bytes per cycle */
+        static void zoneBytes(uint64_t bytes);
+
+        /** records a value for the current frame, name must outlive the profiler like zone names */
+        static void counter(const char* name, double value);
+
+        /** average CPU and GPU time of every zone name in milliseconds, and the average/max of every counter */
+        static void printSummary();
+        static bool writeChromeTrace(const std::string& filename);
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        Profiler();
+        ~Profiler();
+        Profiler(const Profiler& other);
+        Profiler& operator=(const Profiler& other);
+    };
+
+    /** RAII helper, use OGLE_PROFILE_ZONE instead of creating these by hand */
+    class ProfileZone
+    {
+    public:
+        explicit ProfileZone(const char* name) : Zone(Profiler::pushZone(name)) {}
+        ~ProfileZone() { Profiler::popZone(Zone); }
+
+    private:
+        int Zone;
+
+        ProfileZone(const ProfileZone& other);
+        ProfileZone& operator=(const ProfileZone& other);
+    };
+}
+
+#define OGLE_PROFILE_CONCAT_(a, b) a##b
+#define OGLE_PROFILE_CONCAT(a, b) OGLE_PROFILE_CONCAT_(a, b)
+
+/** name must be a string literal, or at least outlive the profiler */
+#define OGLE_PROFILE_ZONE(name) ogle::ProfileZone OGLE_PROFILE_CONCAT(ProfileZone_, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -0,0 +1,573 @@
+#include "programcache.h"
+
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // bump when the file layout or what goes into the key changes
+    const char Magic[8] = { 'O', 'G', 'L', 'E', 'P', 'R', 'G', '1' };
+
+    struct Header
+    {
+        char Magic[8];
+        uint64_t Key;
+        uint32_t Format;
+        uint32_t Length;
+    };
+
+    enum lookup
+    {
+        MISS,
+        FOUND,      // handed to glProgramBinary, the link status says whether the driver took it
+        STALE       // there was a file, but not for this key or driver
+    };
+
+    struct Stage
+    {
+        GLenum Type;
+        std::string File;
+        std::string Source;                 // includes expanded, defines applied
+        std::vector<std::string> Files;     // by #line source string number
+    };
+
+    // FNV-1a, the length goes in first so "ab"+"c" and "a"+"bc" differ
+    uint64_t hash(uint64_t h, const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i=0; i<size; ++i) {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    uint64_t hash(uint64_t h, const std::string& text)
+    {
+        uint64_t size = text.size();
+        h = hash(h, &size, sizeof(size));
+        return hash(h, text.data(), text.size());
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? (const char*)value : "";
+    }
+
+    bool makeDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        int result = _mkdir(path.c_str());
+#else
+        int result = mkdir(path.c_str(), 0755);
+#endif
+        return result == 0 || errno == EEXIST;
+    }
+
+    bool makeDirectories(const std::string& path)
+    {
+        for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            if (!makeDirectory(path.substr(0, slash)))
+                return false;
+        }
+        return makeDirectory(path);
+    }
+
+    int processId()
+    {
+#ifdef _WIN32
+        return _getpid();
+#else
+        return getpid();
+#endif
+    }
+
+    /** compiles and links without asking how it went, the driver may still be busy with it */
+    void startCompile(GLuint program, const std::vector<Stage>& stages, std::vector<GLuint>& shaders)
+    {
+        for (const auto& stage : stages) {
+            GLuint shader = glCreateShader(stage.Type);
+            const char* c_str = stage.Source.c_str();
+            glShaderSource(shader, 1, &c_str, NULL);
+            glCompileShader(shader);
+            glAttachShader(program, shader);
+            shaders.push_back(shader);
+        }
+        glLinkProgram(program);
+    }
+
+    bool linked(GLuint program)
+    {
+        int status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        return status == GL_TRUE;
+    }
+
+    /** the shaders that didn't compile, or the link log when they all did */
+    void printErrors(GLuint program, const std::vector<Stage>& stages, const std::vector<GLuint>& shaders, const std::string& variant)
+    {
+        const int maxLen = 1000;
+        int len;
+        bool compiled = true;
+        for (size_t i=0; i<shaders.size(); ++i) {
+            int status;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+            if (status == GL_FALSE) {
+                char errorBuffer[maxLen] = {0};
+                glGetShaderInfoLog(shaders[i], maxLen, &len, errorBuffer);
+                std::cerr << "[!] ProgramCache: " << stages[i].File << (variant.empty() ? "" : " (" + variant + ")")
+                          << " failed to compile:\n\t" << errorBuffer << std::endl;
+                // the log numbers the files the way the #line directives did
+                if (stages[i].Files.size() > 1) {
+                    std::cerr << "\tsource strings:";
+                    for (size_t f=0; f<stages[i].Files.size(); ++f)
+                        std::cerr << " " << f << " " << stages[i].Files[f];
+                    std::cerr << std::endl;
+                }
+                compiled = false;
+            }
+        }
+        if (compiled) {
+            char errorBuffer[maxLen] = {0};
+            glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
+            std::cerr << "[!] ProgramCache: " << stages.front().File;
+            for (size_t i=1; i<stages.size(); ++i)
+                std::cerr << ", " << stages[i].File;
+            std::cerr << (variant.empty() ? "" : " (" + variant + ")") << " failed to link:\n\t" << errorBuffer << std::endl;
+        }
+    }
+
+    lookup load(const std::string& file, uint64_t key, const std::vector<GLint>& formats, GLuint program)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in.is_open())
+            return MISS;
+
+        Header header;
+        in.read((char*)&header, sizeof(header));
+        bool valid = in.good()
+            && memcmp(header.Magic, Magic, sizeof(Magic)) == 0
+            && header.Key == key
+            && header.Length > 0;
+        // glProgramBinary with a format the driver doesn't list is an error, not just a failed link
+        bool known_format = false;
+        for (GLint format : formats)
+            known_format = known_format || (GLenum)format == header.Format;
+        if (!valid || !known_format)
+            return STALE;
+
+        std::vector<char> binary(header.Length);
+        in.read(binary.data(), binary.size());
+        if (!in.good())
+            return STALE;
+
+        glProgramBinary(program, header.Format, binary.data(), (GLsizei)binary.size());
+        return FOUND;
+    }
+
+    void store(const std::string& file, uint64_t key, GLuint program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+
+        Header header;
+        memcpy(header.Magic, Magic, sizeof(Magic));
+        header.Key = key;
+        header.Format = format;
+        header.Length = (uint32_t)written;
+
+        // whoever renames last wins, a reader never sees half a file
+        std::string temporary = file + "." + std::to_string(processId()) + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "[!] ProgramCache: could not write " << temporary << std::endl;
+                return;
+            }
+            out.write((const char*)&header, sizeof(header));
+            out.write(binary.data(), written);
+            if (!out.good()) {
+                out.close();
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        if (std::rename(temporary.c_str(), file.c_str()) != 0)
+            std::remove(temporary.c_str());
+    }
+}
+
+struct ProgramCache::State
+{
+    /** a program between submit() and finish() */
+    struct Pending
+    {
+        GLuint Program;
+        std::vector<Stage> Stages;
+        std::vector<GLuint> Shaders;    // none while it is loading from a binary
+        bool FromBinary;
+        bool Caching;
+        uint64_t Key;
+        std::string File;
+        std::string Variant;            // ShaderDefines::key(), for messages
+    };
+
+    std::string Directory;
+    bool DriverKnown;
+    bool Parallel;              // KHR/ARB_parallel_shader_compile
+    uint64_t Driver;            // hash of the driver strings
+    std::vector<GLint> Formats; // what glProgramBinary accepts, none disables the cache
+    std::vector<Pending> Submitted;
+    size_t Built;
+    size_t Loaded;
+    size_t Stale;
+    size_t Failed;
+    size_t Unused;
+    double Milliseconds;        // in submit() and finish()
+    double Waited;              // in finish(), for the driver
+
+    State()
+        : DriverKnown(false)
+        , Parallel(false)
+        , Driver(0)
+        , Built(0)
+        , Loaded(0)
+        , Stale(0)
+        , Failed(0)
+        , Unused(0)
+        , Milliseconds(0.0)
+        , Waited(0.0)
+    {
+
+    }
+
+    /** needs the context, so it waits for the first submit() */
+    void queryDriver()
+    {
+        DriverKnown = true;
+        Driver = 14695981039346656037ull;
+        Driver = hash(Driver, Magic, sizeof(Magic));
+        Driver = hash(Driver, glString(GL_VENDOR));
+        Driver = hash(Driver, glString(GL_RENDERER));
+        Driver = hash(Driver, glString(GL_VERSION));
+
+        Formats.clear();
+        GLint count = 0;
+        if (GLEW_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+        if (count > 0) {
+            Formats.resize(count);
+            glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, Formats.data());
+        }
+        else if (!Directory.empty()) {
+            std::cerr << "[!] ProgramCache: the driver has no program binary formats, every program is compiled." << std::endl;
+        }
+
+        // 0xFFFFFFFF is as many threads as the driver likes
+        Parallel = true;
+        if (GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        else if (GLEW_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        else
+            Parallel = false;
+    }
+
+    Pending* find(GLuint program)
+    {
+        for (auto& pending : Submitted) {
+            if (pending.Program == program)
+                return &pending;
+        }
+        return nullptr;
+    }
+
+    bool completed(const Pending& pending) const
+    {
+        if (!Parallel)
+            return true;
+        int status = GL_FALSE;
+        glGetProgramiv(pending.Program, GL_COMPLETION_STATUS_KHR, &status);
+        return status == GL_TRUE;
+    }
+
+    /** the first status query waits for the driver */
+    bool check(Pending& pending)
+    {
+        if (pending.FromBinary) {
+            if (linked(pending.Program)) {
+                ++Loaded;
+                return true;
+            }
+            // compiled right here, the binary was worth a try
+            ++Stale;
+            pending.FromBinary = false;
+            glProgramParameteri(pending.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            startCompile(pending.Program, pending.Stages, pending.Shaders);
+        }
+
+        bool succeeded = linked(pending.Program);
+        if (!succeeded)
+            printErrors(pending.Program, pending.Stages, pending.Shaders, pending.Variant);
+        else if (pending.Caching)
+            store(pending.File, pending.Key, pending.Program);
+
+        for (GLuint shader : pending.Shaders) {
+            glDetachShader(pending.Program, shader);
+            glDeleteShader(shader);
+        }
+        pending.Shaders.clear();
+        return succeeded;
+    }
+};
+
+ProgramCache::State& ProgramCache::instance()
+{
+    static State state;
+    return state;
+}
+
+void ProgramCache::init(const std::string& directory)
+{
+    // what a previous application left pending went with its context, or shutdown() dropped it
+    State& state = instance();
+    state = State();
+    state.Directory = directory;
+    if (state.Directory.empty())
+        return;
+    if (state.Directory.back() != '/')
+        state.Directory += "/";
+    if (!makeDirectories(state.Directory.substr(0, state.Directory.size() - 1))) {
+        std::cerr << "[!] ProgramCache: could not create " << state.Directory << " (" << strerror(errno) << "), every program is compiled." << std::endl;
+        state.Directory.clear();
+    }
+}
+
+bool ProgramCache::enabled()
+{
+    return !instance().Directory.empty();
+}
+
+unsigned int ProgramCache::submit(const std::map<unsigned int, std::string>& shaders, const ShaderDefines& defines, bool separable)
+{
+    State& state = instance();
+    Clock::time_point start = Clock::now();
+
+    State::Pending pending;
+    for (const auto& kv : shaders) {
+        Stage stage;
+        stage.Type = kv.first;
+        stage.File = kv.second;
+        if (!ShaderSource::load(stage.File, defines, stage.Source, stage.Files)) {
+            ++state.Failed;
+            return 0;
+        }
+        pending.Stages.push_back(stage);
+    }
+    if (pending.Stages.empty())
+        return 0;
+
+    if (!state.DriverKnown)
+        state.queryDriver();
+    pending.Caching = !state.Directory.empty() && !state.Formats.empty();
+    pending.FromBinary = false;
+    pending.Key = 0;
+    pending.Variant = defines.key();
+
+    pending.Program = glCreateProgram();
+    if (separable)
+        glProgramParameteri(pending.Program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+
+    if (pending.Caching) {
+        uint64_t key = state.Driver;
+        key = hash(key, &separable, sizeof(separable));
+        for (const auto& stage : pending.Stages) {
+            key = hash(key, &stage.Type, sizeof(stage.Type));
+            key = hash(key, stage.Source);
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        pending.Key = key;
+        pending.File = state.Directory + name;
+
+        lookup found = load(pending.File, key, state.Formats, pending.Program);
+        pending.FromBinary = found == FOUND;
+        if (found == STALE)
+            ++state.Stale;
+    }
+
+    if (!pending.FromBinary) {
+        if (pending.Caching)
+            glProgramParameteri(pending.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        startCompile(pending.Program, pending.Stages, pending.Shaders);
+    }
+
+    state.Submitted.push_back(pending);
+    state.Milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return pending.Program;
+}
+
+bool ProgramCache::ready(unsigned int program)
+{
+    State& state = instance();
+    const State::Pending* pending = state.find(program);
+    return !pending || state.completed(*pending);
+}
+
+bool ProgramCache::finish(unsigned int program)
+{
+    State& state = instance();
+    State::Pending* pending = state.find(program);
+    // finishAll() got to it first, the log was printed then
+    if (!pending)
+        return program != 0 && linked(program);
+
+    Clock::time_point start = Clock::now();
+    bool succeeded = state.check(*pending);
+    if (succeeded)
+        ++state.Built;
+    else
+        ++state.Failed;
+    state.Submitted.erase(state.Submitted.begin() + (pending - state.Submitted.data()));
+
+    double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    state.Milliseconds += milliseconds;
+    state.Waited += milliseconds;
+    return succeeded;
+}
+
+bool ProgramCache::finishAll()
+{
+    State& state = instance();
+    bool succeeded = true;
+    while (!state.Submitted.empty()) {
+        // whichever is done first, or wait for the oldest
+        size_t next = 0;
+        for (size_t i=0; i<state.Submitted.size(); ++i) {
+            if (state.completed(state.Submitted[i])) {
+                next = i;
+                break;
+            }
+        }
+        succeeded = finish(state.Submitted[next].Program) && succeeded;
+    }
+    return succeeded;
+}
+
+void ProgramCache::discard(unsigned int program)
+{
+    State& state = instance();
+    State::Pending* pending = state.find(program);
+    if (!pending)
+        return;
+    for (GLuint shader : pending->Shaders)
+        glDeleteShader(shader);
+    ++state.Unused;
+    state.Submitted.erase(state.Submitted.begin() + (pending - state.Submitted.data()));
+}
+
+void ProgramCache::shutdown()
+{
+    State& state = instance();
+    while (!state.Submitted.empty())
+        discard(state.Submitted.front().Program);
+}
+
+std::string ProgramCache::label(const std::map<unsigned int, std::string>& shaders)
+{
+    std::string result;
+    for (const auto& kv : shaders) {
+        size_t slash = kv.second.find_last_of("/\\");
+        if (!result.empty())
+            result += " + ";
+        result += slash == std::string::npos ? kv.second : kv.second.substr(slash + 1);
+    }
+    return result;
+}
+
+unsigned int ProgramCache::build(const std::map<unsigned int, std::string>& shaders, const ShaderDefines& defines, bool separable)
+{
+    GLuint program = submit(shaders, defines, separable);
+    if (program && !finish(program)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::printSummary()
+{
+    State& state = instance();
+    if (state.Built == 0 && state.Failed == 0 && state.Unused == 0)
+        return;
+
+    std::cout << "\nPrograms: " << state.Built << " built in " << std::fixed << std::setprecision(1)
+              << state.Milliseconds << " ms, " << state.Waited << " of it waiting for the driver"
+              << (state.Parallel ? " (parallel compile)" : "");
+    std::cout.unsetf(std::ios::floatfield);
+    if (!state.Directory.empty() && !state.Formats.empty()) {
+        std::cout << ", " << state.Loaded << " from " << state.Directory
+                  << ", " << state.Built - state.Loaded << " compiled";
+        if (state.Stale)
+            std::cout << " (" << state.Stale << " stale binaries replaced)";
+    }
+    else {
+        std::cout << ", all compiled, no program cache";
+    }
+    if (state.Failed)
+        std::cout << ", " << state.Failed << " failed";
+    if (state.Unused)
+        std::cout << ", " << state.Unused << " submitted but never used";
+    std::cout << std::endl;
+}
+
+ProgramCache::ProgramCache()
+{
+
+}
+
+ProgramCache::~ProgramCache()
+{
+
+}
+
+ProgramCache::ProgramCache(const ProgramCache& other)
+{
+
+}
+
+ProgramCache& ProgramCache::operator=(const ProgramCache& other)
+{
+    return *this;
+}
@@ -0,0 +1,105 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+/****************************************************************
+
+    Linked programs kept on disk between runs.
+
+    submit() hashes the source of every stage (its #includes
+    expanded and defines applied, see shadersource.h), the
+    separable flag and the driver (GL_VENDOR, GL_RENDERER,
+    GL_VERSION). When the cache has a binary under that hash it
+    is handed to glProgramBinary, otherwise the sources are
+    compiled and linked and glGetProgramBinary's output is
+    written for the next run. Editing a shader changes the hash,
+    a driver update usually does too; when it doesn't and the
+    driver rejects the binary, finish() compiles and replaces it.
+
+    ProgramObject, ShaderProgram and the experiments build their
+    programs through it. Application::run() points it at
+    <bin>/../program_cache/, --program-cache DIR puts it
+    elsewhere and --program-cache off always compiles. Files are
+    written under a temporary name and renamed, parallel runs of
+    tools/sweep share the cache.
+
+    submit() only starts the work: it hands every source to
+    glCompileShader and the program to glLinkProgram (or
+    glProgramBinary) without asking how it went. With
+    GL_KHR_parallel_shader_compile (or the ARB one) the driver
+    compiles on its own threads meanwhile. finish() waits for one
+    program and checks it, finishAll() for every program that was
+    submitted, taking them in the order they complete
+    (GL_COMPLETION_STATUS). Without the extension the status
+    queries still happen in one go instead of after each compile.
+    So submit everything, then finish each program where it is
+    first used; build() is submit() and finish() in one.
+
+    Usage:
+        std::map<unsigned int, std::string> shaders;
+        shaders[GL_VERTEX_SHADER] = dir + "quad.vert";
+        shaders[GL_FRAGMENT_SHADER] = dir + "quad.frag";
+        GLuint program = ogle::ProgramCache::build(shaders);
+
+        // or batched
+        for (int i=0; i<count; ++i)
+            programs[i] = ogle::ProgramCache::submit(stages[i]);
+        if (!ogle::ProgramCache::finishAll())
+            return false;
+
+****************************************************************/
+
+#include "shadersource.h"
+
+#include <map>
+#include <string>
+
+namespace ogle
+{
+    class ProgramCache
+    {
+    public:
+        /** where the binaries go, an empty directory disables the cache; resets the counts */
+        static void init(const std::string& directory);
+        static bool enabled();
+
+        /**
+        *   shaders maps stages (GL_VERTEX_SHADER...) to files. defines
+        *   go after each stage's #version, every set of them is its own
+        *   program. Returns the program while it is still compiling,
+        *   0 when a file can't be read.
+        */
+        static unsigned int submit(const std::map<unsigned int, std::string>& shaders,
+                                   const ShaderDefines& defines = ShaderDefines(), bool separable = false);
+        /** without blocking, whether finish() would return right away; always true without the extension */
+        static bool ready(unsigned int program);
+        /** waits for program, false after printing the log when it didn't compile or link; a finished one only reports its link status */
+        static bool finish(unsigned int program);
+        /** finishes every submitted program, false when one of them failed */
+        static bool finishAll();
+        /** for a program deleted before it was finished */
+        static void discard(unsigned int program);
+        /** drops the programs that were never finished, while the context is still current */
+        static void shutdown();
+
+        /** the shaders' file names without their directories, for messages */
+        static std::string label(const std::map<unsigned int, std::string>& shaders);
+
+        /** submit() and finish(), 0 when that failed */
+        static unsigned int build(const std::map<unsigned int, std::string>& shaders,
+                                  const ShaderDefines& defines = ShaderDefines(), bool separable = false);
+
+        /** programs built, how many came from the cache and how long it took */
+        static void printSummary();
+
+    private:
+        struct State;
+        static State& instance();
+
+        ProgramCache();
+        ~ProgramCache();
+        ProgramCache(const ProgramCache& other);
+        ProgramCache& operator=(const ProgramCache& other);
+    };
+}
+
+#endif // PROGRAMCACHE_H
@@ -1,9 +1,10 @@
 #include "programobject.h"
+#include "programcache.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <iostream>
-#include <fstream>
+#include <stdexcept>
 #include <string.h>
 #include <vector>
 
@@ -14,6 +15,7 @@ using namespace ogle;
 
 ProgramObject::ProgramObject()
     : ProgramName(0)
+    , Linked(false)
 {
 }
 
@@ -22,58 +24,52 @@ ProgramObject::~ProgramObject()
     shutdown();
 }
 
-void ProgramObject::init( const std::map<unsigned int, std::string>& shaders )
+void ProgramObject::init( const std::map<unsigned int, std::string>& shaders, const ShaderDefines& defines )
 {
-    std::vector<GLuint> shader_list;
-    for (const auto& kv: shaders)
-        shader_list.push_back( createShader( kv.first, kv.second ) );
-
-    ProgramName = glCreateProgram();
-    for (const auto& shader : shader_list)
-        glAttachShader(ProgramName, shader);
-
-    linkProgram();
-    
-    for (const auto& shader : shader_list){
-        glDetachShader(ProgramName, shader);
-        glDeleteShader(shader);
-    }
-
-    collectUniforms();
+    // linked and checked at the first bind(), the driver compiles meanwhile
+    ProgramName = ProgramCache::submit(shaders, defines);
+    Linked = false;
+    Label = ProgramCache::label(shaders);
+    if (!defines.empty())
+        Label += " (" + defines.key() + ")";
 }
 
-void ProgramObject::bindAttribLoc(GLuint index, const char * variable)
+UniformHandle ProgramObject::uniform(const UniformName& name)
 {
-    glBindAttribLocation(ProgramName, index, variable);
+    link();
+    return Uniforms.resolve(name);
 }
 
-void ProgramObject::setTexture(unsigned int textureStage, const char * name)
+void ProgramObject::setTexture(unsigned int textureStage, UniformHandle handle)
 {
-    glUniform1i(Uniforms[name], textureStage);
+    glUniform1i(Uniforms[handle], textureStage);
 }
 
-void ProgramObject::setFloat(float val, const char * name)
+void ProgramObject::setFloat(float val, UniformHandle handle)
 {
-    glUniform1f(Uniforms[name], val);
+    glUniform1f(Uniforms[handle], val);
 }
 
-void ProgramObject::setVec4(const float * vec, const char * name)
+void ProgramObject::setVec4(const float * vec, UniformHandle handle)
 {
-    glUniform4fv(Uniforms[name], 1, vec);
+    glUniform4fv(Uniforms[handle], 1, vec);
 }
 
-void ProgramObject::setVec2(const float * vec, const char * name)
+void ProgramObject::setVec2(const float * vec, UniformHandle handle)
 {
-    glUniform2fv(Uniforms[name], 1, vec);    
+    glUniform2fv(Uniforms[handle], 1, vec);
 }
 
-void ProgramObject::setMatrix44(const float * mat, const char * name)
+void ProgramObject::setMatrix44(const float * mat, UniformHandle handle)
 {
-    glUniformMatrix4fv(Uniforms[name], 1, GL_FALSE, mat);
+    glUniformMatrix4fv(Uniforms[handle], 1, GL_FALSE, mat);
 }
 
 void ProgramObject::bind()
 {
+    link();
+    if (0 == ProgramName)
+        throw std::runtime_error("ProgramObject: tried to bind " + Label + ", which failed to compile or link");
     glUseProgram(ProgramName);
 }
 
@@ -84,94 +80,39 @@ void ProgramObject::unbind()
 
 void ProgramObject::shutdown()
 {
+    ProgramCache::discard(ProgramName);
     glUseProgram(0);
     glDeleteProgram(ProgramName);
 }
 
-void ProgramObject::linkProgram()
+bool ProgramObject::block(const std::string& name, BlockLayout& layout, bool storage)
 {
-    // Link Program MUST be done after and bindAttri's
-    glLinkProgram(ProgramName);
-    int status;
-    glGetProgramiv(ProgramName, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int buffSize = 1000;
-        int length;
-        char errorBuffer[buffSize] = {0};
-        glGetProgramInfoLog(ProgramName, buffSize, &length, errorBuffer);
-        std::cerr << "Shader failed to link: " << "\n\t"
-                  << errorBuffer
-                  << std::endl;
-    }
+    link();
+    return layout.reflect(ProgramName, name, storage);
 }
 
-GLuint ProgramObject::createShader(unsigned int type, const std::string& filename)
+void ProgramObject::link()
 {
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(filename);
-    if (!inf.is_open()) {
-        std::cerr << "Failed to open " << filename << std::endl;
-        assert(0);
+    if (!Linked) {
+        Linked = true;
+        if (!ProgramCache::finish(ProgramName)) {
+            // the log is printed, bind() throws from now on instead of drawing with it
+            glDeleteProgram(ProgramName);
+            ProgramName = 0;
+            assert(0);
+            return;
+        }
+        collectUniforms();
     }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize((unsigned int)inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen];
-        memset((void*)errorBuffer, 0, (size_t)maxLen);
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader: " << "\n\t"
-                    << filename << "\n"
-                    << "Failed to compile with errors:\n\t"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
 }
 
 void ProgramObject::collectUniforms()
 {
-    glUseProgram(ProgramName);
-
-    // older way of doing things,
-    // upgrade to using uniform buffers...
-    int active_uniforms = 0;
-    glGetProgramiv(ProgramName, GL_ACTIVE_UNIFORMS, &active_uniforms);
-
-    for (int i=0; i<active_uniforms; ++i) {
-        const GLuint len = 50;
-        GLsizei used_len = 0;
-        GLsizei uniform_size = 0;
-        GLenum type;
-        char name[len] = {0};
-        glGetActiveUniform(ProgramName, GLuint(i), len, &used_len, &uniform_size, &type, name);
-        name[used_len] = 0;
-        GLint loc = glGetUniformLocation(ProgramName, name);
-        Uniforms[std::string(name)] = loc;
-        // std::cout << name << " " << loc << std::endl;
-    }
+    // uniforms outside of blocks, data shared by programs goes in a block, see block()
+    Uniforms.collect(ProgramName, Label);
 
     // not using the following because the demos this code is used in knows the location of all the attributes.
     // unsigned int d = glGetAttribLocation(ProgramName, "Position");
-    glUseProgram(0);
 
     // with uniform buffers, found in GL_ARB_uniform_buffer_object
     /*
@@ -1,7 +1,12 @@
 #ifndef SHADER_PIPELINE
 #define SHADER_PIPELINE
 
+#include "shadersource.h"
+#include "uniformblocks.h"
+#include "uniforms.h"
+
 #include <map>
+#include <string>
 
 namespace ogle
 {
@@ -15,26 +20,33 @@ namespace ogle
         ProgramObject();
         virtual ~ProgramObject();
 
-        void init( const std::map<unsigned int, std::string>& shaders );
-
-        void bindAttribLoc(unsigned int index, const char * variable);
-        void setTexture(unsigned int textureStage, const char * name);
-        void setFloat(float val, const char * name);
-        void setVec4(const float * vec, const char * name);
-        void setVec2(const float * vec, const char * name);
-        void setMatrix44(const float * mat, const char * name);
-
+        /** defines make it one variant of the shaders, see shadersource.h; attributes take their
+        *   locations from layout(location=), init() already hands the program to the linker */
+        void init( const std::map<unsigned int, std::string>& shaders, const ShaderDefines& defines = ShaderDefines() );
+
+        /** resolve once, after init(), and keep the handle; waits for the program to link */
+        UniformHandle uniform(const UniformName& name);
+        void setTexture(unsigned int textureStage, UniformHandle handle);
+        void setFloat(float val, UniformHandle handle);
+        void setVec4(const float * vec, UniformHandle handle);
+        void setVec2(const float * vec, UniformHandle handle);
+        void setMatrix44(const float * mat, UniformHandle handle);
+        /** where the program puts the members of a uniform (or storage) block; waits for the program to link */
+        bool block(const std::string& name, BlockLayout& layout, bool storage = false);
+
+        /** throws when the program failed to compile or link, asserts the first time in debug builds */
         void bind();
         void unbind();
         void shutdown();
 
     private:
-        void linkProgram();
-        unsigned int createShader(unsigned int type, const std::string& filename);
+        void link();
         void collectUniforms();
 
         unsigned int ProgramName;
-        std::map<std::string, int> Uniforms;
+        bool Linked;
+        std::string Label;
+        UniformTable Uniforms;
     };
 }
 
@@ -1,4 +1,6 @@
 #include "renderTarget.h"
+#include "context.h"
+#include "gpumemory.h"
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -29,6 +31,7 @@ void RenderTarget::init(bool clearColor, bool clearDepth, bool clearStencil)
     UseClearDepth = clearDepth;
     UseClearStencil = clearStencil;
     glGenFramebuffers(1, &FramebufferName);
+    OGLE_GPU_FRAMEBUFFER(FramebufferName, "RenderTarget");
 }
 
 void RenderTarget::attachColor(const std::vector<Texture>& textures)
@@ -40,19 +43,20 @@ void RenderTarget::attachColor(const std::vector<Texture>& textures)
 
     // check for completeness
     checkStatus();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
 }
 
 void RenderTarget::attachColor(const Texture& texture)
 {
     NumColorBuffers = 1;
     glGenFramebuffers(1, &FramebufferName);
+    OGLE_GPU_FRAMEBUFFER(FramebufferName, "RenderTarget::attachColor");
     glBindFramebuffer(GL_FRAMEBUFFER, FramebufferName);
     glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture.Target, texture.Name, 0);
 
     // check for completeness
     checkStatus();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
 }
 
 void RenderTarget::attachDepth(const Texture& texture)
@@ -138,7 +142,7 @@ void RenderTarget::bind()
 
 void RenderTarget::unbind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
 }
 
 void RenderTarget::clear()
@@ -148,6 +152,7 @@ void RenderTarget::clear()
 
 void RenderTarget::shutdown()
 {
+    GpuMemory::release(GpuMemory::FRAMEBUFFER, FramebufferName);
     glDeleteFramebuffers(1, &FramebufferName);
     FramebufferName = 0;
 }
@@ -0,0 +1,590 @@
+#include "residency.h"
+#include "profiler.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    enum kind
+    {
+        BUFFER,
+        TEXTURE
+    };
+
+    enum state
+    {
+        RESIDENT,
+        EVICTING,   // copy into Staging is in flight
+        IN_HOST,
+        ON_DISK
+    };
+
+    struct Resource
+    {
+        kind Kind;
+        state State;
+        GLuint Name;
+        size_t Bytes;
+        std::string Label;
+
+        GLenum Usage;           // buffers
+        GLenum InternalFormat;  // textures
+        GLsizei Width;
+        GLsizei Height;
+        GLenum Format;
+        GLenum Type;
+
+        uint64_t LastUse;
+        bool UsedThisFrame;     // use()d since the last endFrame(), may still be bound
+        GLuint Staging;
+        GLsync Fence;
+        std::vector<char> Host;
+        std::string SpillPath;
+        bool Removed;
+    };
+
+    const char* StateNames[] = {
+        "resident",
+        "evicting",
+        "host",
+        "disk",
+    };
+
+    size_t componentCount(GLenum format)
+    {
+        switch (format) {
+            case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+                return 1;
+            case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL:
+                return 2;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+                return 3;
+            default:
+                return 4;
+        }
+    }
+
+    // bytes a texel takes in client memory, with GL_PACK_ALIGNMENT 1
+    size_t pixelBytes(GLenum format, GLenum type)
+    {
+        switch (type) {
+            case GL_UNSIGNED_BYTE: case GL_BYTE:
+                return componentCount(format);
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+                return componentCount(format) * 2;
+            case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+                return componentCount(format) * 4;
+            default:
+                // packed types like GL_UNSIGNED_INT_8_8_8_8 or GL_UNSIGNED_INT_24_8
+                return 4;
+        }
+    }
+
+    double megabytes(size_t bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    size_t budgetFromDriver()
+    {
+        if (GLEW_NVX_gpu_memory_info != GL_TRUE)
+            return 0;
+        GLint kilobytes = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &kilobytes);
+        return (size_t)kilobytes * 1024 / 10 * 8;
+    }
+}
+
+struct Residency::State
+{
+    ResidencyConfig Config;
+    std::vector<Resource> Resources;
+    ResidencyStats Stats;
+    uint64_t Clock;     // bumped by every use(), orders the LRU
+    uint64_t FrameEvictions;
+    uint64_t FrameRestores;
+    bool WarnedOverBudget;
+
+    Resource* find(int handle)
+    {
+        if (handle < 0 || handle >= (int)Resources.size() || Resources[handle].Removed)
+            return nullptr;
+        return &Resources[handle];
+    }
+
+    void evict(Resource& res)
+    {
+        glGenBuffers(1, &res.Staging);
+        if (res.Kind == BUFFER) {
+            glBindBuffer(GL_COPY_READ_BUFFER, res.Name);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, res.Staging);
+            glBufferData(GL_COPY_WRITE_BUFFER, res.Bytes, nullptr, GL_STREAM_COPY);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, res.Bytes);
+            // commands are ordered, the copy above still sees the old storage
+            glBufferData(GL_COPY_READ_BUFFER, 0, nullptr, res.Usage);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        else {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, res.Staging);
+            glBufferData(GL_PIXEL_PACK_BUFFER, res.Bytes, nullptr, GL_STREAM_READ);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, res.Name);
+            glGetTexImage(GL_TEXTURE_2D, 0, res.Format, res.Type, 0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glTexImage2D(GL_TEXTURE_2D, 0, res.InternalFormat, 0, 0, 0, res.Format, res.Type, nullptr);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        res.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        res.State = EVICTING;
+
+        Stats.ResidentBytes -= res.Bytes;
+        Stats.Evictions++;
+        Stats.EvictedBytes += res.Bytes;
+        FrameEvictions++;
+    }
+
+    // moves a finished eviction out of its staging buffer, never waits for one that isn't
+    void collect(Resource& res)
+    {
+        GLenum status = glClientWaitSync(res.Fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+            return;
+        glDeleteSync(res.Fence);
+        res.Fence = nullptr;
+
+        res.Host.resize(res.Bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, res.Staging);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, res.Bytes, res.Host.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &res.Staging);
+        res.Staging = 0;
+        res.State = IN_HOST;
+        Stats.HostBytes += res.Bytes;
+
+        if (Config.HostBudgetBytes > 0 && Stats.HostBytes > Config.HostBudgetBytes)
+            spill(res);
+    }
+
+    void spill(Resource& res)
+    {
+        std::ostringstream path;
+        path << Config.SpillDirectory << "/ogle_residency_" << (&res - Resources.data()) << ".bin";
+        FILE* file = fopen(path.str().c_str(), "wb");
+        if (file == nullptr || fwrite(res.Host.data(), 1, res.Bytes, file) != res.Bytes) {
+            std::cerr << "[!] Residency: could not write " << path.str() << ", " << res.Label
+                      << " stays in host memory." << std::endl;
+            if (file != nullptr)
+                fclose(file);
+            return;
+        }
+        fclose(file);
+
+        res.SpillPath = path.str();
+        std::vector<char>().swap(res.Host);
+        res.State = ON_DISK;
+        Stats.HostBytes -= res.Bytes;
+        Stats.DiskWrites++;
+    }
+
+    void unspill(Resource& res)
+    {
+        res.Host.resize(res.Bytes);
+        FILE* file = fopen(res.SpillPath.c_str(), "rb");
+        bool ok = file != nullptr && fread(res.Host.data(), 1, res.Bytes, file) == res.Bytes;
+        if (file != nullptr)
+            fclose(file);
+        if (!ok) {
+            std::cerr << "[!] Residency: could not read " << res.SpillPath << ", " << res.Label << " is lost." << std::endl;
+            std::fill(res.Host.begin(), res.Host.end(), 0);
+        }
+        ::remove(res.SpillPath.c_str());
+        res.SpillPath.clear();
+        res.State = IN_HOST;
+        Stats.HostBytes += res.Bytes;
+        Stats.DiskReads++;
+    }
+
+    void restore(Resource& res)
+    {
+        if (res.State == ON_DISK)
+            unspill(res);
+
+        // an eviction still in flight is uploaded from its own staging buffer, no round trip over the bus
+        if (res.State == IN_HOST) {
+            glGenBuffers(1, &res.Staging);
+            glBindBuffer(GL_COPY_READ_BUFFER, res.Staging);
+            glBufferData(GL_COPY_READ_BUFFER, res.Bytes, res.Host.data(), GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            Stats.HostBytes -= res.Bytes;
+            std::vector<char>().swap(res.Host);
+        }
+        else if (res.Fence != nullptr) {
+            glDeleteSync(res.Fence);
+            res.Fence = nullptr;
+        }
+
+        if (res.Kind == BUFFER) {
+            glBindBuffer(GL_COPY_READ_BUFFER, res.Staging);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, res.Name);
+            glBufferData(GL_COPY_WRITE_BUFFER, res.Bytes, nullptr, res.Usage);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, res.Bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, res.Staging);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, res.Name);
+            glTexImage2D(GL_TEXTURE_2D, 0, res.InternalFormat, res.Width, res.Height, 0, res.Format, res.Type, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        // GL keeps it alive until the copy is done
+        glDeleteBuffers(1, &res.Staging);
+        res.Staging = 0;
+        res.State = RESIDENT;
+
+        Stats.ResidentBytes += res.Bytes;
+        Stats.PeakResidentBytes = std::max(Stats.PeakResidentBytes, Stats.ResidentBytes);
+        Stats.Restores++;
+        Stats.RestoredBytes += res.Bytes;
+        FrameRestores++;
+    }
+
+    // evicts least recently used resources until bytes more fit, keep and the frame's others are never evicted
+    void makeRoom(size_t bytes, const Resource* keep)
+    {
+        if (Stats.Budget == 0)
+            return;
+
+        while (Stats.ResidentBytes + bytes > Stats.Budget) {
+            Resource* oldest = nullptr;
+            for (auto& res : Resources) {
+                if (res.Removed || res.State != RESIDENT || &res == keep || res.UsedThisFrame)
+                    continue;
+                if (oldest == nullptr || res.LastUse < oldest->LastUse)
+                    oldest = &res;
+            }
+            if (oldest == nullptr) {
+                Stats.OverBudget++;
+                if (!WarnedOverBudget) {
+                    std::cerr << "[!] Residency: " << megabytes(bytes) << " MB don't fit in the budget of "
+                              << megabytes(Stats.Budget) << " MB, going over it." << std::endl;
+                    WarnedOverBudget = true;
+                }
+                return;
+            }
+            evict(*oldest);
+        }
+    }
+
+    int add(Resource& res)
+    {
+        res.State = RESIDENT;
+        res.LastUse = ++Clock;
+        res.UsedThisFrame = false;
+        res.Staging = 0;
+        res.Fence = nullptr;
+        res.Removed = false;
+
+        // it already takes up memory, others make room for it
+        makeRoom(res.Bytes, nullptr);
+        Stats.ResidentBytes += res.Bytes;
+        Stats.PeakResidentBytes = std::max(Stats.PeakResidentBytes, Stats.ResidentBytes);
+        Stats.Resources++;
+
+        Resources.push_back(res);
+        return (int)Resources.size() - 1;
+    }
+};
+
+Residency::State* Residency::Instance = nullptr;
+
+ResidencyConfig::ResidencyConfig()
+    : BudgetBytes(0)
+    , HostBudgetBytes(0)
+    , SpillDirectory(".")
+{
+
+}
+
+ResidencyStats::ResidencyStats()
+    : Budget(0)
+    , Resources(0)
+    , ResidentBytes(0)
+    , PeakResidentBytes(0)
+    , HostBytes(0)
+    , Evictions(0)
+    , Restores(0)
+    , EvictedBytes(0)
+    , RestoredBytes(0)
+    , DiskWrites(0)
+    , DiskReads(0)
+    , OverBudget(0)
+{
+
+}
+
+void Residency::init(const ResidencyConfig& config)
+{
+    if (Instance)
+        shutdown();
+
+    if (GLEW_ARB_sync != GL_TRUE) {
+        std::cerr << "[!] Residency: GL_ARB_sync is not supported, nothing will be evicted." << std::endl;
+    }
+
+    Instance = new State();
+    Instance->Config = config;
+    Instance->Clock = 0;
+    Instance->FrameEvictions = 0;
+    Instance->FrameRestores = 0;
+    Instance->WarnedOverBudget = false;
+
+    size_t budget = config.BudgetBytes > 0 ? config.BudgetBytes : budgetFromDriver();
+    const char* env = getenv("OGLE_VRAM_BUDGET_MB");
+    if (env != nullptr && atoi(env) > 0)
+        budget = (size_t)atoi(env) * 1024 * 1024;
+    if (GLEW_ARB_sync != GL_TRUE)
+        budget = 0;
+    Instance->Stats.Budget = budget;
+}
+
+int Residency::addBuffer(unsigned int name, size_t bytes, const char* label)
+{
+    if (!Instance)
+        return InvalidHandle;
+
+    GLint immutable = GL_FALSE;
+    GLint usage = GL_STATIC_DRAW;
+    glBindBuffer(GL_COPY_READ_BUFFER, name);
+    if (GLEW_ARB_buffer_storage == GL_TRUE)
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_IMMUTABLE_STORAGE, &immutable);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    if (immutable == GL_TRUE) {
+        std::cerr << "[!] Residency: " << label << " has immutable storage, it can't be evicted." << std::endl;
+        return InvalidHandle;
+    }
+
+    Resource res;
+    res.Kind = BUFFER;
+    res.Name = name;
+    res.Bytes = bytes;
+    res.Label = label;
+    res.Usage = usage;
+    res.InternalFormat = 0;
+    res.Width = 0;
+    res.Height = 0;
+    res.Format = 0;
+    res.Type = 0;
+    return Instance->add(res);
+}
+
+int Residency::addTexture(unsigned int name, unsigned int internalFormat, int width, int height,
+                          unsigned int format, unsigned int type, const char* label)
+{
+    if (!Instance)
+        return InvalidHandle;
+
+    GLint immutable = GL_FALSE;
+    if (GLEW_ARB_texture_storage == GL_TRUE) {
+        glBindTexture(GL_TEXTURE_2D, name);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    if (immutable == GL_TRUE) {
+        std::cerr << "[!] Residency: " << label << " has immutable storage, it can't be evicted." << std::endl;
+        return InvalidHandle;
+    }
+
+    Resource res;
+    res.Kind = TEXTURE;
+    res.Name = name;
+    res.Bytes = pixelBytes(format, type) * width * height;
+    res.Label = label;
+    res.Usage = 0;
+    res.InternalFormat = internalFormat;
+    res.Width = width;
+    res.Height = height;
+    res.Format = format;
+    res.Type = type;
+    return Instance->add(res);
+}
+
+int Residency::addTexture(const Texture& texture, const char* label)
+{
+    if (texture.Target != GL_TEXTURE_2D) {
+        std::cerr << "[!] Residency: " << label << " is not a GL_TEXTURE_2D, only those can be evicted." << std::endl;
+        return InvalidHandle;
+    }
+    return addTexture(texture.Name, texture.InternalFormat, texture.Width, texture.Height,
+                      texture.Format, texture.Type, label);
+}
+
+void Residency::remove(int handle)
+{
+    if (!Instance)
+        return;
+    Resource* res = Instance->find(handle);
+    if (res == nullptr)
+        return;
+
+    // the owner deletes the GL name, it expects to find its contents until then
+    if (res->State != RESIDENT)
+        Instance->restore(*res);
+    Instance->Stats.ResidentBytes -= res->Bytes;
+    Instance->Stats.Resources--;
+    res->Removed = true;
+}
+
+unsigned int Residency::use(int handle)
+{
+    if (!Instance)
+        return 0;
+    Resource* res = Instance->find(handle);
+    if (res == nullptr)
+        return 0;
+
+    res->LastUse = ++Instance->Clock;
+    res->UsedThisFrame = true;
+    if (res->State != RESIDENT) {
+        Instance->makeRoom(res->Bytes, res);
+        Instance->restore(*res);
+    }
+    return res->Name;
+}
+
+void Residency::prefetch(int handle)
+{
+    if (!Instance)
+        return;
+    Resource* res = Instance->find(handle);
+    if (res == nullptr || res->State == RESIDENT)
+        return;
+
+    // only into free room, prefetching shouldn't push out what is being drawn
+    if (Instance->Stats.Budget > 0 && Instance->Stats.ResidentBytes + res->Bytes > Instance->Stats.Budget)
+        return;
+    Instance->restore(*res);
+}
+
+bool Residency::resident(int handle)
+{
+    if (!Instance)
+        return false;
+    Resource* res = Instance->find(handle);
+    return res != nullptr && res->State == RESIDENT;
+}
+
+void Residency::endFrame()
+{
+    if (!Instance)
+        return;
+
+    for (auto& res : Instance->Resources) {
+        if (!res.Removed && res.State == EVICTING)
+            Instance->collect(res);
+    }
+
+    if (Instance->Stats.Budget > 0) {
+        Profiler::counter("resident MB", megabytes(Instance->Stats.ResidentBytes));
+        Profiler::counter("evictions", (double)Instance->FrameEvictions);
+        Profiler::counter("restores", (double)Instance->FrameRestores);
+    }
+    Instance->FrameEvictions = 0;
+    Instance->FrameRestores = 0;
+    for (auto& res : Instance->Resources)
+        res.UsedThisFrame = false;
+}
+
+ResidencyStats Residency::stats()
+{
+    if (!Instance)
+        return ResidencyStats();
+    return Instance->Stats;
+}
+
+void Residency::printSummary()
+{
+    // nothing registered and no budget, nothing to say
+    if (!Instance || (Instance->Stats.Resources == 0 && Instance->Stats.Budget == 0))
+        return;
+
+    const ResidencyStats& stats = Instance->Stats;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nResidency, budget ";
+    if (stats.Budget > 0)
+        std::cout << megabytes(stats.Budget) << " MB";
+    else
+        std::cout << "none";
+    std::cout << "\n\tresident " << megabytes(stats.ResidentBytes) << " MB, peak " << megabytes(stats.PeakResidentBytes)
+              << " MB, host " << megabytes(stats.HostBytes) << " MB\n"
+              << "\tevictions " << stats.Evictions << " (" << megabytes(stats.EvictedBytes) << " MB), restores "
+              << stats.Restores << " (" << megabytes(stats.RestoredBytes) << " MB)\n";
+    if (stats.DiskWrites > 0)
+        std::cout << "\tspilled to disk " << stats.DiskWrites << ", read back " << stats.DiskReads << "\n";
+    if (stats.OverBudget > 0)
+        std::cout << "\t[!] went over budget " << stats.OverBudget << " times\n";
+
+    for (const auto& res : Instance->Resources) {
+        if (res.Removed || res.State == RESIDENT)
+            continue;
+        std::cout << "\t" << std::left << std::setw(28) << res.Label << std::right << std::setw(10)
+                  << megabytes(res.Bytes) << " MB  " << StateNames[res.State] << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::endl;
+}
+
+void Residency::shutdown()
+{
+    if (!Instance)
+        return;
+
+    for (auto& res : Instance->Resources) {
+        if (res.Fence != nullptr)
+            glDeleteSync(res.Fence);
+        if (res.Staging != 0)
+            glDeleteBuffers(1, &res.Staging);
+        if (!res.SpillPath.empty())
+            ::remove(res.SpillPath.c_str());
+    }
+    delete Instance;
+    Instance = nullptr;
+}
+
+Residency::Residency()
+{
+
+}
+
+Residency::~Residency()
+{
+
+}
+
+Residency::Residency(const Residency& other)
+{
+
+}
+
+Residency& Residency::operator=(const Residency& other)
+{
+    return *this;
+}
@@ -0,0 +1,125 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+/****************************************************************
+
+    Keeps the textures and buffers registered with it under a
+    VRAM budget, so experiments with big volumes and meshes still
+    run on cards with less memory than they want.
+
+    Call use() with a handle right before binding the resource.
+    When that would go over the budget the least recently used
+    resources are evicted, but never one used since the last
+    endFrame(), it may still be bound for this frame's draws;
+    when those alone don't fit it goes over the budget instead.
+    An evicted resource's contents are copied into a staging
+    buffer on the GPU, its storage is given back (glBufferData/
+    glTexImage2D of size 0, the GL name stays valid), and once
+    the copy is done endFrame() moves it to host memory. Copies
+    that don't fit in the host budget are written to
+    SpillDirectory. Restoring uploads from a staging buffer too,
+    so neither direction waits on the GPU; a resource whose
+    eviction is still in flight is restored straight from its
+    staging buffer.
+
+    Only mutable storage can be given back: buffers created with
+    glBufferData and 2D textures created with glTexImage2D, level
+    0 only; add*() refuses immutable ones (glBufferStorage,
+    glTexStorage2D). Eviction and restore change the
+    GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, pixel pack/unpack
+    and GL_TEXTURE_2D bindings, they are left at 0.
+
+    Application inits it for every run. The budget comes from
+    ResidencyConfig (Application::Memory, --vram-budget),
+    OGLE_VRAM_BUDGET_MB in the environment overrides it to try
+    smaller cards. Profiler
+    ::endFrame calls endFrame(), which pushes resident MB and the
+    evictions/restores of the frame as profiler counters, and
+    BenchmarkRunner records evictions and restores per result.
+
+    extensions required:
+    GL_ARB_copy_buffer
+    GL_ARB_sync
+    GL_NVX_gpu_memory_info when the budget should come from the card
+
+****************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ogle
+{
+    class Texture;
+
+    struct ResidencyConfig
+    {
+        ResidencyConfig();
+
+        /** 0 uses 80% of the dedicated video memory if the driver tells, no limit otherwise */
+        size_t BudgetBytes;
+        /** evicted copies above this go to SpillDirectory, 0 keeps everything in host memory */
+        size_t HostBudgetBytes;
+        std::string SpillDirectory;
+    };
+
+    struct ResidencyStats
+    {
+        ResidencyStats();
+
+        size_t Budget;
+        size_t Resources;
+        size_t ResidentBytes;
+        size_t PeakResidentBytes;
+        size_t HostBytes;           // evicted copies held in host memory
+
+        uint64_t Evictions;
+        uint64_t Restores;
+        uint64_t EvictedBytes;
+        uint64_t RestoredBytes;
+        uint64_t DiskWrites;
+        uint64_t DiskReads;
+        /** use() calls that couldn't make enough room because everything else was in use */
+        uint64_t OverBudget;
+    };
+
+    class Residency
+    {
+    public:
+        static const int InvalidHandle = -1;
+
+        static void init(const ResidencyConfig& config = ResidencyConfig());
+
+        /** the buffer must have storage from glBufferData, returns InvalidHandle otherwise */
+        static int addBuffer(unsigned int name, size_t bytes, const char* label);
+        /** a GL_TEXTURE_2D created with glTexImage2D, returns InvalidHandle for glTexStorage2D ones */
+        static int addTexture(unsigned int name, unsigned int internalFormat, int width, int height,
+                              unsigned int format, unsigned int type, const char* label);
+        static int addTexture(const Texture& texture, const char* label);
+        /** forgets the resource, restoring it first if it was evicted */
+        static void remove(int handle);
+
+        /** marks the resource as used and brings it back if it was evicted, returns its GL name */
+        static unsigned int use(int handle);
+        /** starts the upload of an evicted resource ahead of its use() */
+        static void prefetch(int handle);
+        static bool resident(int handle);
+
+        static void endFrame();
+        static ResidencyStats stats();
+        static void printSummary();
+        /** drops host copies, spill files and staging buffers, the GL names stay with their owners */
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        Residency();
+        ~Residency();
+        Residency(const Residency& other);
+        Residency& operator=(const Residency& other);
+    };
+}
+
+#endif // RESIDENCY_H
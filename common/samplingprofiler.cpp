@@ -0,0 +1,352 @@
+#include "samplingprofiler.h"
+#include "stacktrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace ogle;
+
+#ifdef __linux__
+namespace {
+    const int MaxDepth = 64;
+
+    // the signal handler and the kernel's signal trampoline
+    const int SkipFrames = 2;
+
+    // must be a power of two, the drain thread empties it every DrainInterval
+    const unsigned int SlotCount = 4096;
+    const int DrainInterval = 20;   // milliseconds
+
+    enum slot_status
+    {
+        FREE,
+        WRITING,
+        READY
+    };
+
+    struct Slot
+    {
+        std::atomic<unsigned int> Status;
+        pid_t Thread;
+        int Depth;
+        void* Frames[MaxDepth];     // innermost first
+    };
+
+    // only touched through lock free atomics inside the signal handler
+    Slot* Slots = nullptr;
+    std::atomic<unsigned int> Head(0);
+    std::atomic<unsigned int> Dropped(0);
+    std::atomic<bool> Sampling(false);
+
+    void onSignal(int, siginfo_t*, void*)
+    {
+        if (!Sampling.load(std::memory_order_relaxed))
+            return;
+
+        int saved_errno = errno;
+
+        // a slot the drain thread hasn't gotten to yet is dropped, not waited on
+        Slot& slot = Slots[Head.fetch_add(1, std::memory_order_relaxed) & (SlotCount - 1)];
+        unsigned int expected = FREE;
+        if (!slot.Status.compare_exchange_strong(expected, WRITING, std::memory_order_acquire)) {
+            Dropped.fetch_add(1, std::memory_order_relaxed);
+            errno = saved_errno;
+            return;
+        }
+
+        void* frames[MaxDepth + SkipFrames];
+        int depth = backtrace(frames, MaxDepth + SkipFrames) - SkipFrames;
+        if (depth < 0)
+            depth = 0;
+        memcpy(slot.Frames, frames + SkipFrames, depth * sizeof(void*));
+        slot.Depth = depth;
+        slot.Thread = (pid_t)syscall(SYS_gettid);
+        slot.Status.store(READY, std::memory_order_release);
+
+        errno = saved_errno;
+    }
+
+    struct StackKey
+    {
+        pid_t Thread;
+        std::vector<void*> Frames;
+
+        bool operator<(const StackKey& other) const
+        {
+            if (Thread != other.Thread)
+                return Thread < other.Thread;
+            return Frames < other.Frames;
+        }
+    };
+
+    std::string threadName(pid_t thread)
+    {
+        std::string name;
+        std::ifstream inf("/proc/self/task/" + std::to_string(thread) + "/comm");
+        if (inf.is_open())
+            std::getline(inf, name);
+        if (name.empty())
+            name = "thread";
+        return name + " (" + std::to_string(thread) + ")";
+    }
+}
+#endif
+
+struct SamplingProfiler::State
+{
+    std::string Filename;
+    int Frequency;
+
+#ifdef __linux__
+    struct sigaction Previous;
+    std::thread Drainer;
+    std::atomic<bool> Draining;
+
+    std::map<StackKey, unsigned int> Stacks;
+    std::map<pid_t, std::string> ThreadNames;
+    unsigned int Samples;
+
+    void drain()
+    {
+        for (unsigned int i=0; i<SlotCount; ++i) {
+            Slot& slot = Slots[i];
+            if (slot.Status.load(std::memory_order_acquire) != READY)
+                continue;
+
+            StackKey key;
+            key.Thread = slot.Thread;
+            key.Frames.assign(slot.Frames, slot.Frames + slot.Depth);
+            slot.Status.store(FREE, std::memory_order_release);
+
+            // threads can be gone by the time stop() runs, name them while they are around
+            if (ThreadNames.find(key.Thread) == ThreadNames.end())
+                ThreadNames[key.Thread] = threadName(key.Thread);
+
+            Stacks[key]++;
+            Samples++;
+        }
+    }
+#endif
+};
+
+SamplingProfiler::State* SamplingProfiler::Instance = nullptr;
+
+bool SamplingProfiler::start(int frequency, const std::string& filename)
+{
+    if (Instance)
+        return true;
+
+#ifdef __linux__
+    if (frequency <= 0 || frequency > 10000) {
+        std::cerr << "[!] SamplingProfiler: frequency " << frequency << " Hz is out of range, using 999 Hz." << std::endl;
+        frequency = 999;
+    }
+
+    // loading libgcc_s must not happen inside the signal handler
+    StackTrace::warmup();
+
+    Slots = new Slot[SlotCount];
+    for (unsigned int i=0; i<SlotCount; ++i)
+        Slots[i].Status.store(FREE);
+
+    Instance = new State;
+    Instance->Filename = filename;
+    Instance->Frequency = frequency;
+    Instance->Samples = 0;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = onSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &Instance->Previous) != 0) {
+        std::cerr << "[!] SamplingProfiler: could not install the SIGPROF handler (" << strerror(errno) << ")." << std::endl;
+        delete Instance;
+        Instance = nullptr;
+        return false;
+    }
+
+    // the drainer is started with SIGPROF blocked so it doesn't sample itself
+    sigset_t profile_signal, previous_mask;
+    sigemptyset(&profile_signal);
+    sigaddset(&profile_signal, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profile_signal, &previous_mask);
+    Instance->Draining = true;
+    Instance->Drainer = std::thread([] {
+        while (Instance->Draining.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(DrainInterval));
+            Instance->drain();
+        }
+    });
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+
+    Sampling = true;
+
+    // ITIMER_PROF counts cpu time of the whole process, the signal goes to the thread that is running
+    itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / frequency;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    std::cout << "SamplingProfiler: sampling at " << frequency << " Hz into " << filename << std::endl;
+    return true;
+#else
+    std::cerr << "[!] SamplingProfiler: only supported on Linux." << std::endl;
+    return false;
+#endif
+}
+
+bool SamplingProfiler::running()
+{
+    return Instance != nullptr;
+}
+
+void SamplingProfiler::stop()
+{
+    if (!Instance)
+        return;
+
+#ifdef __linux__
+    itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    Sampling = false;
+
+    Instance->Draining = false;
+    Instance->Drainer.join();
+    Instance->drain();
+    sigaction(SIGPROF, &Instance->Previous, nullptr);
+
+    // return addresses point after the call, step back into it so the right line/function is found.
+    // the innermost frame is where the signal hit and is exact.
+    std::map<void*, std::string> symbols;
+    for (const auto& kv : Instance->Stacks) {
+        const std::vector<void*>& frames = kv.first.Frames;
+        for (size_t i=0; i<frames.size(); ++i) {
+            void* address = i == 0 ? frames[i] : StackTrace::callSite(frames[i]);
+            if (symbols.find(address) == symbols.end())
+                symbols[address] = StackTrace::symbolize(address);
+        }
+    }
+
+    std::map<std::string, unsigned int> self;
+    std::ofstream out(Instance->Filename.c_str());
+    if (!out.is_open())
+        std::cerr << "[!] SamplingProfiler: could not open " << Instance->Filename << " for writing." << std::endl;
+
+    for (const auto& kv : Instance->Stacks) {
+        const std::vector<void*>& frames = kv.first.Frames;
+        std::string line = Instance->ThreadNames[kv.first.Thread];
+        for (size_t i=frames.size(); i-- > 0; ) {
+            void* address = i == 0 ? frames[i] : StackTrace::callSite(frames[i]);
+            line += ";" + symbols[address];
+        }
+        if (out.is_open())
+            out << line << " " << kv.second << "\n";
+
+        if (!frames.empty())
+            self[symbols[frames[0]]] += kv.second;
+    }
+
+    std::vector<std::pair<std::string, unsigned int>> hottest(self.begin(), self.end());
+    std::sort(hottest.begin(), hottest.end(),
+        [](const std::pair<std::string, unsigned int>& a, const std::pair<std::string, unsigned int>& b) {
+            return a.second > b.second;
+        });
+
+    unsigned int samples = std::max(Instance->Samples, 1u);
+    std::cout << "\nSamplingProfiler: " << Instance->Samples << " samples (" << Dropped.load() << " dropped) in "
+              << Instance->Stacks.size() << " unique stacks, written to " << Instance->Filename << "\n";
+    std::cout << "hottest functions by self samples:\n";
+    for (size_t i=0; i<hottest.size() && i<15; ++i) {
+        std::cout << std::fixed << std::setprecision(1) << std::setw(7) << 100.0 * hottest[i].second / samples << "%  "
+                  << hottest[i].first << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::endl;
+
+    delete[] Slots;
+    Slots = nullptr;
+#endif
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+SamplingProfiler::SamplingProfiler()
+{
+
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+
+}
+
+SamplingProfiler::SamplingProfiler(const SamplingProfiler& other)
+{
+
+}
+
+SamplingProfiler& SamplingProfiler::operator=(const SamplingProfiler& other)
+{
+    return *this;
+}
+
+#ifdef __linux__
+namespace {
+    // every experiment links this file, so the flag works without touching their main()
+    struct CommandLineStart
+    {
+        CommandLineStart()
+        {
+            std::ifstream inf("/proc/self/cmdline", std::ios::binary);
+            std::vector<std::string> args;
+            std::string arg;
+            while (std::getline(inf, arg, '\0'))
+                args.push_back(arg);
+            if (args.empty())
+                return;
+
+            const std::string flag = "--sample-profile";
+            for (const auto& a : args) {
+                if (a.compare(0, flag.size(), flag) != 0)
+                    continue;
+
+                int frequency = 999;
+                if (a.size() > flag.size() && a[flag.size()] == '=')
+                    frequency = atoi(a.c_str() + flag.size() + 1);
+                else if (a.size() != flag.size())
+                    continue;
+
+                std::string name = args[0].substr(args[0].find_last_of("/\\") + 1);
+                if (SamplingProfiler::start(frequency, name + ".folded"))
+                    atexit(SamplingProfiler::stop);
+                return;
+            }
+        }
+    };
+
+    CommandLineStart StartFromCommandLine;
+}
+#endif
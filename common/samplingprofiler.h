@@ -0,0 +1,60 @@
+#ifndef SAMPLINGPROFILER_H
+#define SAMPLINGPROFILER_H
+
+/****************************************************************
+
+    In process sampling profiler, for everything the Profiler's
+    zones don't cover (the GL driver, glfw, code nobody thought
+    to instrument).
+
+    A SIGPROF interval timer interrupts whichever thread is using
+    CPU time, render thread, driver threads and workers alike,
+    and the signal handler stores that thread's call stack in a
+    preallocated ring. A background thread folds the ring into
+    unique stacks as it goes. stop() symbolizes the addresses
+    with dladdr and writes collapsed stacks, one
+        thread;outermost;...;innermost count
+    line per unique stack, ready for flamegraph.pl or
+    https://www.speedscope.app
+
+    Every experiment starts it on its own when run with
+        --sample-profile           (999 Hz)
+        --sample-profile=<hz>
+    and writes <experiment>.folded to the working directory on
+    exit, main() doesn't need to know about it.
+
+    Functions are only named when they are in the dynamic symbol
+    table, the experiments link with -rdynamic for that. Static
+    functions and stripped driver code show up as module+offset
+    or as the closest exported symbol before them.
+
+    Linux only, start() prints a message and does nothing elsewhere.
+
+****************************************************************/
+
+#include <string>
+
+namespace ogle
+{
+    class SamplingProfiler
+    {
+    public:
+        /** installs the SIGPROF handler and starts the timer, returns false when it couldn't */
+        static bool start(int frequency, const std::string& filename);
+        static bool running();
+
+        /** stops sampling, writes the collapsed stacks and prints the hottest functions */
+        static void stop();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        SamplingProfiler();
+        ~SamplingProfiler();
+        SamplingProfiler(const SamplingProfiler& other);
+        SamplingProfiler& operator=(const SamplingProfiler& other);
+    };
+}
+
+#endif // SAMPLINGPROFILER_H
@@ -0,0 +1,251 @@
+#include "shadersource.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace ogle;
+
+struct ShaderSource::State
+{
+    std::vector<std::string> IncludeDirectories;
+};
+
+namespace {
+    bool readFile(const std::string& filename, std::string& contents)
+    {
+        std::ifstream inf(filename, std::ios::binary);
+        if (!inf.is_open())
+            return false;
+        inf.seekg(0, std::ios::end);
+        contents.resize((size_t)inf.tellg());
+        inf.seekg(0, std::ios::beg);
+        inf.read(&contents[0], contents.size());
+        return true;
+    }
+
+    bool exists(const std::string& filename)
+    {
+        std::ifstream inf(filename, std::ios::binary);
+        return inf.is_open();
+    }
+
+    /** a/b/../c is a/c, a file included through two paths is still seen as one */
+    std::string normalize(const std::string& path)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t slash = path.find('/', start);
+            if (slash == std::string::npos)
+                slash = path.size();
+            std::string part = path.substr(start, slash - start);
+            if (part == ".." && !parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if (!part.empty() && part != ".")
+                parts.push_back(part);
+            start = slash + 1;
+        }
+
+        std::string result = !path.empty() && path[0] == '/' ? "/" : "";
+        for (size_t i=0; i<parts.size(); ++i)
+            result += (i ? "/" : "") + parts[i];
+        return result;
+    }
+
+    std::string directoryOf(const std::string& file)
+    {
+        size_t slash = file.rfind('/');
+        return slash == std::string::npos ? "" : file.substr(0, slash + 1);
+    }
+
+    bool startsWith(const std::string& line, const char* directive)
+    {
+        size_t first = line.find_first_not_of(" \t");
+        return first != std::string::npos && line.compare(first, strlen(directive), directive) == 0;
+    }
+
+    /** the file of an #include "file" or #include <file> line */
+    bool includeName(const std::string& line, std::string& name)
+    {
+        if (!startsWith(line, "#include"))
+            return false;
+        size_t open = line.find_first_of("\"<");
+        if (open == std::string::npos)
+            return false;
+        size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+        if (close == std::string::npos)
+            return false;
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    bool hasVersion(const std::string& source)
+    {
+        size_t version = source.find("#version");
+        return version != std::string::npos && (version == 0 || source[version - 1] == '\n');
+    }
+
+    struct Expansion
+    {
+        const std::vector<std::string>& IncludeDirectories;
+        std::vector<std::string>& Files;
+        std::string& Source;
+
+        /** the included file next to from, or in an include directory; empty when there is none */
+        std::string resolve(const std::string& from, const std::string& name) const
+        {
+            std::string path = normalize(directoryOf(from) + name);
+            if (exists(path))
+                return path;
+            for (const auto& directory : IncludeDirectories) {
+                path = normalize(directory + "/" + name);
+                if (exists(path))
+                    return path;
+            }
+            return "";
+        }
+
+        /** defines only for the file that was asked for, they go after its #version */
+        bool expand(const std::string& file, const std::string* defines)
+        {
+            std::string contents;
+            if (!readFile(file, contents)) {
+                std::cerr << "[!] ShaderSource: could not open " << file << std::endl;
+                return false;
+            }
+            std::string index = std::to_string(Files.size());
+            Files.push_back(file);
+
+            if (defines && !defines->empty() && !hasVersion(contents))
+                Source += *defines + "#line 1 0\n";
+
+            size_t line_number = 0;
+            size_t start = 0;
+            while (start < contents.size()) {
+                size_t end = contents.find('\n', start);
+                if (end == std::string::npos)
+                    end = contents.size();
+                std::string line = contents.substr(start, end - start);
+                start = end + 1;
+                ++line_number;
+
+                std::string name;
+                if (includeName(line, name)) {
+                    std::string path = resolve(file, name);
+                    if (path.empty()) {
+                        std::cerr << "[!] ShaderSource: " << file << ":" << line_number << " includes \"" << name << "\", which isn't there" << std::endl;
+                        return false;
+                    }
+                    // included already, the line stays to keep the numbering
+                    if (std::find(Files.begin(), Files.end(), path) != Files.end()) {
+                        Source += "\n";
+                        continue;
+                    }
+                    Source += "#line 1 " + std::to_string(Files.size()) + "\n";
+                    if (!expand(path, nullptr))
+                        return false;
+                    if (Source.back() != '\n')
+                        Source += "\n";
+                    Source += "#line " + std::to_string(line_number + 1) + " " + index + "\n";
+                }
+                else if (startsWith(line, "#version")) {
+                    // only the first thing in the shader may be a #version
+                    if (!defines) {
+                        Source += "\n";
+                        continue;
+                    }
+                    Source += line + "\n";
+                    if (!defines->empty())
+                        Source += *defines + "#line " + std::to_string(line_number + 1) + " 0\n";
+                }
+                else {
+                    Source += line + "\n";
+                }
+            }
+            return true;
+        }
+    };
+}
+
+ShaderDefines& ShaderDefines::set(const std::string& name, const std::string& value)
+{
+    Values[name] = value;
+    return *this;
+}
+
+ShaderDefines& ShaderDefines::set(const std::string& name, int value)
+{
+    return set(name, std::to_string(value));
+}
+
+void ShaderDefines::clear()
+{
+    Values.clear();
+}
+
+bool ShaderDefines::empty() const
+{
+    return Values.empty();
+}
+
+std::string ShaderDefines::source() const
+{
+    std::string result;
+    for (const auto& kv : Values)
+        result += "#define " + kv.first + (kv.second.empty() ? "" : " " + kv.second) + "\n";
+    return result;
+}
+
+std::string ShaderDefines::key() const
+{
+    std::string result;
+    for (const auto& kv : Values) {
+        if (!result.empty())
+            result += ",";
+        result += kv.first + (kv.second.empty() ? "" : "=" + kv.second);
+    }
+    return result;
+}
+
+void ShaderSource::setIncludeDirectories(const std::vector<std::string>& directories)
+{
+    instance().IncludeDirectories = directories;
+}
+
+bool ShaderSource::load(const std::string& file, const ShaderDefines& defines,
+                        std::string& source, std::vector<std::string>& files)
+{
+    source.clear();
+    files.clear();
+    std::string lines = defines.source();
+    Expansion expansion = { instance().IncludeDirectories, files, source };
+    return expansion.expand(normalize(file), &lines);
+}
+
+ShaderSource::State& ShaderSource::instance()
+{
+    static State state;
+    return state;
+}
+
+ShaderSource::ShaderSource()
+{
+
+}
+
+ShaderSource::~ShaderSource()
+{
+
+}
+
+ShaderSource::ShaderSource(const ShaderSource& other)
+{
+
+}
+
+ShaderSource& ShaderSource::operator=(const ShaderSource& other)
+{
+    return *this;
+}
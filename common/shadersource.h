@@ -0,0 +1,82 @@
+#ifndef SHADERSOURCE_H
+#define SHADERSOURCE_H
+
+/****************************************************************
+
+    GLSL files with #include and compile time variants.
+
+    ShaderSource::load() reads a shader the way ProgramCache
+    hands it to the compiler: every line that starts with
+        #include "file"
+    is replaced by that file, looked up next to the including
+    file first and then in the include directories (Application
+    adds data/common/). A file goes in once per shader, however
+    often it is included, so shared declarations (a uniform
+    block, helper functions) don't need guards. #line directives
+    keep the compiler's line numbers right, their source string
+    numbers index the list of files load() returns; a log line
+    "2(14)" or "0:2(14)" is line 14 of the third file.
+
+    ShaderDefines are the variant: names and values that go
+    after #version as #define lines. Shaders give their defaults
+    with #ifndef, code that wants something else sets it:
+        ogle::ShaderDefines defines;
+        defines.set("WORKGROUP_SIZE", 16);
+        program = ogle::ProgramCache::build(shaders, defines, true);
+    The expanded source is what ProgramCache hashes, so each set
+    of defines is its own program in the cache and an edit to an
+    included file rebuilds every program that includes it. key()
+    names the variant in messages and benchmark parameters.
+
+****************************************************************/
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    class ShaderDefines
+    {
+    public:
+        /** an empty value is a plain #define NAME */
+        ShaderDefines& set(const std::string& name, const std::string& value = "");
+        ShaderDefines& set(const std::string& name, int value);
+        void clear();
+        bool empty() const;
+
+        /** the #define lines, sorted by name */
+        std::string source() const;
+        /** NAME=value,NAME2 sorted by name, the same for the same defines however they were set */
+        std::string key() const;
+
+    private:
+        std::map<std::string, std::string> Values;
+    };
+
+    class ShaderSource
+    {
+    public:
+        /** searched in order after the including file's directory */
+        static void setIncludeDirectories(const std::vector<std::string>& directories);
+
+        /**
+        *   file with its #includes expanded and defines after #version.
+        *   files gets every file that went in, file itself first.
+        *   false after printing when one can't be read.
+        */
+        static bool load(const std::string& file, const ShaderDefines& defines,
+                         std::string& source, std::vector<std::string>& files);
+
+    private:
+        struct State;
+        static State& instance();
+
+        ShaderSource();
+        ~ShaderSource();
+        ShaderSource(const ShaderSource& other);
+        ShaderSource& operator=(const ShaderSource& other);
+    };
+}
+
+#endif // SHADERSOURCE_H
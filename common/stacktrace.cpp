@@ -0,0 +1,100 @@
+#include "stacktrace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+using namespace ogle;
+
+namespace {
+    // StackTrace::capture itself
+    const int OwnFrames = 1;
+    const int MaxFrames = 128;
+}
+
+int StackTrace::capture(void** frames, int maxDepth, int skip)
+{
+#ifdef __linux__
+    void* buffer[MaxFrames];
+    int wanted = std::min(maxDepth + skip + OwnFrames, MaxFrames);
+    int depth = backtrace(buffer, wanted) - skip - OwnFrames;
+    if (depth <= 0)
+        return 0;
+    memcpy(frames, buffer + skip + OwnFrames, depth * sizeof(void*));
+    return depth;
+#else
+    return 0;
+#endif
+}
+
+void StackTrace::warmup()
+{
+#ifdef __linux__
+    // the first backtrace() loads libgcc_s
+    void* frames[4];
+    backtrace(frames, 4);
+#endif
+}
+
+std::string StackTrace::symbolize(void* address)
+{
+    std::ostringstream out;
+#ifdef __linux__
+    Dl_info info;
+    if (dladdr(address, &info) != 0 && info.dli_fname != nullptr) {
+        std::string result;
+        if (info.dli_sname != nullptr) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            result = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+            free(demangled);
+        }
+        else {
+            const char* module = strrchr(info.dli_fname, '/');
+            module = module != nullptr ? module + 1 : info.dli_fname;
+            out << module << "+0x" << std::hex << ((uintptr_t)address - (uintptr_t)info.dli_fbase);
+            result = out.str();
+        }
+
+        // ';' separates frames in the collapsed stack format
+        std::replace(result.begin(), result.end(), ';', ':');
+        return result;
+    }
+#endif
+
+    out << "0x" << std::hex << (uintptr_t)address;
+    return out.str();
+}
+
+void* StackTrace::callSite(void* returnAddress)
+{
+    return (void*)((uintptr_t)returnAddress - 1);
+}
+
+StackTrace::StackTrace()
+{
+
+}
+
+StackTrace::~StackTrace()
+{
+
+}
+
+StackTrace::StackTrace(const StackTrace& other)
+{
+
+}
+
+StackTrace& StackTrace::operator=(const StackTrace& other)
+{
+    return *this;
+}
@@ -0,0 +1,42 @@
+#ifndef STACKTRACE_H
+#define STACKTRACE_H
+
+/****************************************************************
+
+    Call stack capture and symbol lookup for the in process
+    profilers (SamplingProfiler, AllocTracker).
+
+    Names come from dladdr, so only functions in the dynamic
+    symbol table are found, the experiments link with -rdynamic
+    for that. Everything else is printed as module+offset.
+
+    Linux only, capture() returns 0 frames elsewhere.
+
+****************************************************************/
+
+#include <string>
+
+namespace ogle
+{
+    class StackTrace
+    {
+    public:
+        /** innermost frame first, skip leaves out the callers' own frames */
+        static int capture(void** frames, int maxDepth, int skip = 0);
+        /** loads what capture() needs up front, call it before capturing from a signal handler or allocator */
+        static void warmup();
+
+        /** demangled function name, or module+offset, never contains ';' */
+        static std::string symbolize(void* address);
+        /** frames after the innermost are return addresses, this steps back into the call instruction */
+        static void* callSite(void* returnAddress);
+
+    private:
+        StackTrace();
+        ~StackTrace();
+        StackTrace(const StackTrace& other);
+        StackTrace& operator=(const StackTrace& other);
+    };
+}
+
+#endif // STACKTRACE_H
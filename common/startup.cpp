@@ -0,0 +1,348 @@
+#include "startup.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace ogle;
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    enum kind
+    {
+        PHASE,
+        BACKGROUND,
+        LAZY
+    };
+
+    struct Entry
+    {
+        kind Kind;
+        std::string Name;
+        double Milliseconds;
+        double Waited;      // LAZY, time require() waited on the background part
+    };
+
+    // how long ago, in milliseconds, the kernel started this process
+    double processAge()
+    {
+#ifdef __linux__
+        FILE* file = fopen("/proc/self/stat", "r");
+        if (file == nullptr)
+            return 0.0;
+        char line[1024] = {0};
+        size_t len = fread(line, 1, sizeof(line) - 1, file);
+        fclose(file);
+        line[len] = 0;
+
+        // the command name may hold spaces, fields are counted from after its ')'
+        const char* field = strrchr(line, ')');
+        if (field == nullptr)
+            return 0.0;
+        unsigned long long start_ticks = 0;
+        if (sscanf(field + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+            return 0.0;
+
+        timespec boot;
+        clock_gettime(CLOCK_BOOTTIME, &boot);
+        double now_ms = boot.tv_sec * 1000.0 + boot.tv_nsec * 1e-6;
+        double start_ms = start_ticks * 1000.0 / sysconf(_SC_CLK_TCK);
+        return now_ms > start_ms ? now_ms - start_ms : 0.0;
+#else
+        return 0.0;
+#endif
+    }
+
+    double milliseconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+}
+
+struct Startup::State
+{
+    std::mutex Lock;
+    Clock::time_point ProcessStart;
+    Clock::time_point PhaseStart;
+    std::string Phase;
+    bool Started;
+    bool Finished;
+    bool Printed;
+    double FirstFrame;
+    std::vector<Entry> Entries;
+
+    State()
+        : Started(false)
+        , Finished(false)
+        , Printed(false)
+        , FirstFrame(0.0)
+    {
+        // process start is only known to the clock tick, good enough next to window and context creation
+        Clock::time_point now = Clock::now();
+        ProcessStart = now - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(processAge()));
+        PhaseStart = now;
+    }
+
+    void endPhase(Clock::time_point now)
+    {
+        if (Phase.empty())
+            return;
+        Entry entry = { PHASE, Phase, milliseconds(PhaseStart, now), 0.0 };
+        Entries.push_back(entry);
+        Phase.clear();
+    }
+};
+
+namespace {
+    // the clock starts during static initialization, not at the first phase
+    struct StartClock
+    {
+        StartClock() { Startup::elapsed(); }
+    } StartClockNow;
+
+    void printIfUnfinished()
+    {
+        Startup::printSummary();
+    }
+}
+
+Startup::State& Startup::instance()
+{
+    static State state;
+    return state;
+}
+
+void Startup::phase(const std::string& name)
+{
+    State& state = instance();
+    std::lock_guard<std::mutex> lock(state.Lock);
+    if (state.Finished)
+        return;
+
+    Clock::time_point now = Clock::now();
+    if (!state.Started) {
+        Entry entry = { PHASE, "process start", milliseconds(state.ProcessStart, now), 0.0 };
+        state.Entries.push_back(entry);
+        state.Started = true;
+        atexit(printIfUnfinished);
+    }
+    state.endPhase(now);
+    state.Phase = name;
+    state.PhaseStart = now;
+}
+
+void Startup::firstFrame()
+{
+    State& state = instance();
+    {
+        std::lock_guard<std::mutex> lock(state.Lock);
+        if (state.Finished)
+            return;
+        Clock::time_point now = Clock::now();
+        state.endPhase(now);
+        state.FirstFrame = milliseconds(state.ProcessStart, now);
+        state.Finished = true;
+    }
+    printSummary();
+}
+
+void Startup::restart(const std::string& name)
+{
+    State& state = instance();
+    std::lock_guard<std::mutex> lock(state.Lock);
+    if (!state.Started) {
+        state.Started = true;
+        atexit(printIfUnfinished);
+    }
+
+    Clock::time_point now = Clock::now();
+    state.Entries.clear();
+    state.ProcessStart = now;
+    state.PhaseStart = now;
+    state.Phase = name;
+    state.Finished = false;
+    state.Printed = false;
+    state.FirstFrame = 0.0;
+}
+
+void Startup::background(const std::string& name, double milliseconds)
+{
+    State& state = instance();
+    std::lock_guard<std::mutex> lock(state.Lock);
+    Entry entry = { BACKGROUND, name, milliseconds, 0.0 };
+    state.Entries.push_back(entry);
+}
+
+void Startup::lazy(const std::string& name, double milliseconds, double waitedMilliseconds)
+{
+    State& state = instance();
+    std::lock_guard<std::mutex> lock(state.Lock);
+    Entry entry = { LAZY, name, milliseconds, waitedMilliseconds };
+    state.Entries.push_back(entry);
+
+    // after the breakdown was printed this is a hitch in a running program, say so
+    if (state.Finished) {
+        std::cout << "[startup] " << name << " created on first use after the first frame, "
+                  << std::fixed << std::setprecision(2) << milliseconds << " ms" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+double Startup::elapsed()
+{
+    return milliseconds(instance().ProcessStart, Clock::now());
+}
+
+void Startup::printSummary()
+{
+    State& state = instance();
+    std::lock_guard<std::mutex> lock(state.Lock);
+    if (!state.Started)
+        return;
+
+    // a second call, from atexit after firstFrame() already printed
+    if (state.Printed)
+        return;
+    state.Printed = true;
+
+    double total = 0.0;
+    if (state.Finished) {
+        total = state.FirstFrame;
+        std::cout << "\nStartup, " << std::fixed << std::setprecision(2) << total << " ms to the first frame:\n";
+    }
+    else {
+        state.endPhase(Clock::now());
+        total = milliseconds(state.ProcessStart, Clock::now());
+        std::cout << "\nStartup, exited after " << std::fixed << std::setprecision(2) << total
+                  << " ms without reaching the first frame:\n";
+    }
+
+    for (const auto& entry : state.Entries) {
+        if (entry.Kind != PHASE)
+            continue;
+        std::cout << "\t" << std::left << std::setw(28) << entry.Name << std::right
+                  << std::setw(10) << entry.Milliseconds << " ms"
+                  << std::setw(8) << std::setprecision(1) << (total > 0.0 ? entry.Milliseconds / total * 100.0 : 0.0) << "%\n"
+                  << std::setprecision(2);
+    }
+
+    bool header = false;
+    for (const auto& entry : state.Entries) {
+        if (entry.Kind == PHASE)
+            continue;
+        if (!header) {
+            std::cout << "    off the startup path:\n";
+            header = true;
+        }
+        std::cout << "\t" << std::left << std::setw(28) << entry.Name << std::right
+                  << std::setw(10) << entry.Milliseconds << " ms  ";
+        if (entry.Kind == BACKGROUND)
+            std::cout << "background";
+        else if (entry.Waited > 0.0)
+            std::cout << "on first use, waited " << entry.Waited << " ms for the background part";
+        else
+            std::cout << "on first use";
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::endl;
+}
+
+Startup::Startup()
+{
+
+}
+
+Startup::~Startup()
+{
+
+}
+
+Startup::Startup(const Startup& other)
+{
+
+}
+
+Startup& Startup::operator=(const Startup& other)
+{
+    return *this;
+}
+
+LazyInit::LazyInit()
+    : Created(false)
+{
+
+}
+
+LazyInit::~LazyInit()
+{
+    shutdown();
+}
+
+void LazyInit::init(const std::string& name, const Task& create, const Task& prepare)
+{
+    shutdown();
+
+    Name = name;
+    Create = create;
+    Created = false;
+    if (prepare) {
+        std::string task_name = name;
+        Prepared = std::async(std::launch::async, [prepare, task_name]() {
+            Clock::time_point start = Clock::now();
+            prepare();
+            Startup::background(task_name, milliseconds(start, Clock::now()));
+        });
+    }
+}
+
+void LazyInit::require()
+{
+    if (Created || !Create)
+        return;
+
+    double waited = 0.0;
+    if (Prepared.valid()) {
+        Clock::time_point start = Clock::now();
+        Prepared.get();
+        waited = milliseconds(start, Clock::now());
+    }
+    Clock::time_point start = Clock::now();
+    Create();
+    Created = true;
+    Startup::lazy(Name, milliseconds(start, Clock::now()), waited);
+}
+
+bool LazyInit::created() const
+{
+    return Created;
+}
+
+void LazyInit::shutdown()
+{
+    if (Prepared.valid())
+        Prepared.wait();
+    Prepared = std::future<void>();
+    Create = Task();
+}
+
+LazyInit::LazyInit(const LazyInit& other)
+{
+
+}
+
+LazyInit& LazyInit::operator=(const LazyInit& other)
+{
+    return *this;
+}
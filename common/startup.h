@@ -0,0 +1,96 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+/****************************************************************
+
+    Where the time before the first frame goes.
+
+    Startup::phase() ends the phase that is running and starts the
+    next one, so init() reads like:
+        ogle::Startup::phase("context");
+        ogle::Context::init(config);
+        ogle::Startup::phase("shaders");
+        initShaders();
+        ...
+        ogle::Startup::phase("first frame");
+    and the render loop calls Startup::firstFrame() after its first
+    swap. That prints the breakdown, with the time from process
+    start to the first phase (loading, static init) on top. A
+    program that exits before its first frame prints it at exit.
+    ogle::Application does all of that, experiments only add
+    their own phases to init(). The suite runs several in one
+    process and calls restart() before each.
+
+    LazyInit moves work out of that path. Its create task runs on
+    the GL thread the first time require() is called, for programs
+    and lookup textures that are used late or not at all. An
+    optional prepare task starts on a worker thread right away and
+    has to be done before create runs, for the CPU side of loading
+    (reading and parsing files, building tables); it must not call
+    GL. Both show up in the breakdown, with how long require() had
+    to wait for prepare.
+
+****************************************************************/
+
+#include <functional>
+#include <future>
+#include <string>
+
+namespace ogle
+{
+    class Startup
+    {
+    public:
+        /** ends the running phase and starts timing name */
+        static void phase(const std::string& name);
+        /** ends the running phase, prints the breakdown the first time it is called */
+        static void firstFrame();
+        /** forgets everything and times the next application from now, name is its first phase */
+        static void restart(const std::string& name);
+
+        /** work done outside of the phases, thread safe */
+        static void background(const std::string& name, double milliseconds);
+        static void lazy(const std::string& name, double milliseconds, double waitedMilliseconds);
+
+        /** milliseconds since the process started */
+        static double elapsed();
+        static void printSummary();
+
+    private:
+        struct State;
+        static State& instance();
+
+        Startup();
+        ~Startup();
+        Startup(const Startup& other);
+        Startup& operator=(const Startup& other);
+    };
+
+    class LazyInit
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        LazyInit();
+        ~LazyInit();
+
+        /** prepare starts on a worker thread now, create waits for it at the first require() */
+        void init(const std::string& name, const Task& create, const Task& prepare = Task());
+        /** runs create if it didn't run yet, call it right before the resource is used */
+        void require();
+        bool created() const;
+        /** waits for a prepare that is still running, require() won't create anything afterwards */
+        void shutdown();
+
+    private:
+        std::string Name;
+        Task Create;
+        std::future<void> Prepared;
+        bool Created;
+
+        LazyInit(const LazyInit& other);
+        LazyInit& operator=(const LazyInit& other);
+    };
+}
+
+#endif // STARTUP_H
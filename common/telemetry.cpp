@@ -0,0 +1,372 @@
+#include "telemetry.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OGLE_TELEMETRY_POSIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ogle;
+
+// both sides map the same memory, the atomics must not hide a lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry needs lock free 64 bit atomics");
+static_assert(sizeof(TelemetrySlot) == 64, "a telemetry slot should fill one cache line");
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    size_t segmentBytes(size_t capacity)
+    {
+        return sizeof(TelemetryHeader) + capacity * sizeof(TelemetrySlot);
+    }
+
+    std::string segmentName(const std::string& name)
+    {
+        if (!name.empty())
+            return name;
+        const char* env = getenv("OGLE_TELEMETRY");
+        if (env != nullptr && env[0] == '/')
+            return env;
+#ifdef OGLE_TELEMETRY_POSIX
+        return Telemetry::defaultName((int64_t)getpid());
+#else
+        return Telemetry::DefaultName;
+#endif
+    }
+
+    void programName(char* out, size_t size)
+    {
+        out[0] = 0;
+#ifdef __linux__
+        FILE* file = fopen("/proc/self/comm", "r");
+        if (file == nullptr)
+            return;
+        if (fgets(out, (int)size, file) != nullptr)
+            out[strcspn(out, "\n")] = 0;
+        fclose(file);
+#endif
+    }
+}
+
+const char* const Telemetry::DefaultName = "/ogle_telemetry";
+
+struct Telemetry::State
+{
+    std::string Name;
+    TelemetryHeader* Header;
+    TelemetrySlot* Slots;
+    size_t MappedBytes;
+    uint64_t Mask;
+    uint64_t Next;
+    Clock::time_point Start;
+};
+
+Telemetry::State* Telemetry::Instance = nullptr;
+
+std::string Telemetry::defaultName(int64_t pid)
+{
+    return std::string(DefaultName) + "." + std::to_string(pid);
+}
+
+bool Telemetry::init(const std::string& name, size_t capacity)
+{
+    if (Instance)
+        return true;
+    if (name.empty() && getenv("OGLE_TELEMETRY") == nullptr)
+        return false;
+
+#ifdef OGLE_TELEMETRY_POSIX
+    // slots are picked with a mask
+    size_t slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+
+    std::string segment = segmentName(name);
+    int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        // left behind by a run that crashed, unless its writer is still going
+        TelemetryReader other;
+        if (other.open(segment) && other.writerAlive()) {
+            std::cerr << "[!] Telemetry: " << segment << " is written by pid " << other.header()->WriterPid
+                      << ", not writing telemetry." << std::endl;
+            return false;
+        }
+        other.close();
+        shm_unlink(segment.c_str());
+        fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        std::cerr << "[!] Telemetry: couldn't create the shared memory segment " << segment << "." << std::endl;
+        return false;
+    }
+    size_t bytes = segmentBytes(slots);
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        std::cerr << "[!] Telemetry: couldn't size " << segment << " to " << bytes << " bytes." << std::endl;
+        close(fd);
+        return false;
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "[!] Telemetry: couldn't map " << segment << "." << std::endl;
+        return false;
+    }
+
+    // readers wait until the magic is set
+    TelemetryHeader* header = static_cast<TelemetryHeader*>(memory);
+    header->Magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    header->Version = TelemetryHeader::CurrentVersion;
+    header->SampleSize = sizeof(TelemetrySample);
+    header->Capacity = (uint32_t)slots;
+    header->WriterPid = (int64_t)getpid();
+    programName(header->Program, sizeof(header->Program));
+    header->Head.store(0, std::memory_order_relaxed);
+
+    TelemetrySlot* ring = reinterpret_cast<TelemetrySlot*>(header + 1);
+    for (size_t i=0; i<slots; ++i)
+        ring[i].Sequence.store(0, std::memory_order_relaxed);
+    header->Magic.store(TelemetryHeader::MagicValue, std::memory_order_release);
+
+    Instance = new State;
+    Instance->Name = segment;
+    Instance->Header = header;
+    Instance->Slots = ring;
+    Instance->MappedBytes = bytes;
+    Instance->Mask = slots - 1;
+    Instance->Next = 0;
+    Instance->Start = Clock::now();
+
+    std::cout << "[telemetry] writing to " << segment << ", " << slots << " samples" << std::endl;
+    return true;
+#else
+    std::cerr << "[!] Telemetry: shared memory telemetry needs a POSIX system." << std::endl;
+    return false;
+#endif
+}
+
+bool Telemetry::running()
+{
+    return Instance != nullptr;
+}
+
+void Telemetry::write(const TelemetrySample& sample)
+{
+    if (!Instance)
+        return;
+
+    State& state = *Instance;
+    uint64_t index = state.Next++;
+    TelemetrySlot& slot = state.Slots[index & state.Mask];
+
+    // odd while the copy is going on, a reader that sees it, or sees it change, drops the slot
+    slot.Sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Sample = sample;
+    slot.Sample.Time = std::chrono::duration<double>(Clock::now() - state.Start).count();
+    slot.Sequence.store(2 * index + 2, std::memory_order_release);
+    state.Header->Head.store(index + 1, std::memory_order_release);
+}
+
+void Telemetry::shutdown()
+{
+    if (!Instance)
+        return;
+
+#ifdef OGLE_TELEMETRY_POSIX
+    // readers that still have it mapped see the writer go even though the process lives on
+    Instance->Header->Magic.store(0, std::memory_order_release);
+    munmap(Instance->Header, Instance->MappedBytes);
+    shm_unlink(Instance->Name.c_str());
+#endif
+
+    delete Instance;
+    Instance = nullptr;
+}
+
+Telemetry::Telemetry()
+{
+
+}
+
+Telemetry::~Telemetry()
+{
+
+}
+
+Telemetry::Telemetry(const Telemetry& other)
+{
+
+}
+
+Telemetry& Telemetry::operator=(const Telemetry& other)
+{
+    return *this;
+}
+
+TelemetryReader::TelemetryReader()
+    : Header(nullptr)
+    , Slots(nullptr)
+    , MappedBytes(0)
+    , Next(0)
+{
+
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+std::vector<std::string> TelemetryReader::segments()
+{
+    std::vector<std::string> names;
+#if defined(OGLE_TELEMETRY_POSIX) && defined(__linux__)
+    // where glibc keeps shm_open's segments
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr)
+        return names;
+    std::string prefix = std::string(Telemetry::DefaultName + 1) + ".";
+    while (dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0)
+            names.push_back(std::string("/") + entry->d_name);
+    }
+    closedir(dir);
+#endif
+    return names;
+}
+
+bool TelemetryReader::open(const std::string& name, bool fromOldest)
+{
+    close();
+
+#ifdef OGLE_TELEMETRY_POSIX
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    // the writer sized the segment before anything else, the header checks below say if it is done
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TelemetryHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* memory = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+
+    const TelemetryHeader* header = static_cast<const TelemetryHeader*>(memory);
+    if (header->Magic.load(std::memory_order_acquire) != TelemetryHeader::MagicValue
+        || header->Version != TelemetryHeader::CurrentVersion
+        || header->SampleSize != sizeof(TelemetrySample)
+        || segmentBytes(header->Capacity) > (size_t)info.st_size) {
+        munmap(memory, (size_t)info.st_size);
+        return false;
+    }
+
+    Header = header;
+    Slots = reinterpret_cast<const TelemetrySlot*>(header + 1);
+    MappedBytes = (size_t)info.st_size;
+
+    uint64_t head = Header->Head.load(std::memory_order_acquire);
+    Next = head;
+    if (fromOldest)
+        Next = head > Header->Capacity ? head - Header->Capacity : 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TelemetryReader::opened() const
+{
+    return Header != nullptr;
+}
+
+const TelemetryHeader* TelemetryReader::header() const
+{
+    return Header;
+}
+
+bool TelemetryReader::writerAlive() const
+{
+    if (!Header)
+        return false;
+    if (Header->Magic.load(std::memory_order_acquire) != TelemetryHeader::MagicValue)
+        return false;
+#ifdef OGLE_TELEMETRY_POSIX
+    // a new writer reset Head under our feet, or the one we know is gone
+    if (Header->Head.load(std::memory_order_acquire) < Next)
+        return false;
+    return kill((pid_t)Header->WriterPid, 0) == 0 || errno != ESRCH;
+#else
+    return false;
+#endif
+}
+
+uint64_t TelemetryReader::read(std::vector<TelemetrySample>& samples)
+{
+    if (!Header)
+        return 0;
+
+    uint64_t lost = 0;
+    uint64_t capacity = Header->Capacity;
+    uint64_t head = Header->Head.load(std::memory_order_acquire);
+    if (head < Next)
+        return 0;
+    if (head - Next > capacity) {
+        lost += head - capacity - Next;
+        Next = head - capacity;
+    }
+
+    for (; Next < head; ++Next) {
+        const TelemetrySlot& slot = Slots[Next & (capacity - 1)];
+        uint64_t expected = 2 * Next + 2;
+        if (slot.Sequence.load(std::memory_order_acquire) != expected) {
+            lost++;
+            continue;
+        }
+        TelemetrySample sample = slot.Sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.Sequence.load(std::memory_order_relaxed) != expected) {
+            lost++;
+            continue;
+        }
+        samples.push_back(sample);
+    }
+    return lost;
+}
+
+void TelemetryReader::close()
+{
+#ifdef OGLE_TELEMETRY_POSIX
+    if (Header)
+        munmap(const_cast<TelemetryHeader*>(Header), MappedBytes);
+#endif
+    Header = nullptr;
+    Slots = nullptr;
+    MappedBytes = 0;
+    Next = 0;
+}
+
+TelemetryReader::TelemetryReader(const TelemetryReader& other)
+{
+
+}
+
+TelemetryReader& TelemetryReader::operator=(const TelemetryReader& other)
+{
+    return *this;
+}
@@ -0,0 +1,139 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/****************************************************************
+
+    Per frame samples in a POSIX shared memory segment, to watch a
+    long benchmark run from another process while it is going:
+        tools/telemetry_tail [segment | pid]
+
+    The segment is a ring of fixed size records with one writer,
+    the render thread, and any number of readers that only map it
+    read only. write() copies the sample into the next slot and
+    bumps two sequence numbers, it never waits for a reader. A
+    reader that falls more than a ring behind loses the oldest
+    samples and is told how many; a slot that gets overwritten
+    while it is being copied is caught by its sequence number
+    (the slot is a seqlock) and counted as lost the same way.
+
+    Profiler::init() calls Telemetry::init() and Profiler::endFrame()
+    writes a sample with the frame's CPU time, the GPU time of the
+    last resolved frame, what GLIntercept counted as uploaded, the
+    GpuMemory and Residency totals and AllocTracker's allocations.
+    Nothing happens unless OGLE_TELEMETRY is set in the environment,
+    its value names the segment when it starts with '/', otherwise
+    it is DefaultName followed by the writer's pid, so parallel runs
+    (tools/sweep --jobs) each get their own. A segment is only ever
+    created, never shared: init() fails when another live process
+    writes to the name, one left behind by a crashed run is replaced.
+
+    Linux and other POSIX systems only, init() fails elsewhere.
+
+****************************************************************/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    struct TelemetrySample
+    {
+        uint64_t Frame;
+        double Time;                // seconds since the writer's init()
+        float CpuMilliseconds;
+        float GpuMilliseconds;      // a few frames behind, 0 without GL_ARB_timer_query
+        uint64_t UploadBytes;       // 0 unless GLIntercept is running
+        uint64_t GpuMemoryBytes;
+        uint64_t ResidentBytes;
+        uint32_t Allocations;       // 0 unless built with OGLE_ALLOC_TRACKER
+        uint32_t DrawCalls;         // 0 unless GLIntercept is running
+    };
+
+    /** the layout of the segment, shared by the writer and the readers */
+    struct TelemetryHeader
+    {
+        static const uint32_t MagicValue = 0x4f474c54; // "OGLT"
+        static const uint32_t CurrentVersion = 1;
+
+        /** set last by the writer once the rest is filled in */
+        std::atomic<uint32_t> Magic;
+        uint32_t Version;
+        uint32_t SampleSize;
+        uint32_t Capacity;          // slots, a power of two
+        int64_t WriterPid;
+        char Program[64];
+
+        /** samples written so far, the next one goes to slot Head % Capacity */
+        alignas(64) std::atomic<uint64_t> Head;
+    };
+
+    struct TelemetrySlot
+    {
+        /** 2 * index + 1 while sample index is being written, 2 * index + 2 once it is done */
+        std::atomic<uint64_t> Sequence;
+        TelemetrySample Sample;
+    };
+
+    class Telemetry
+    {
+    public:
+        /** followed by "." and the pid, see defaultName() */
+        static const char* const DefaultName;
+        static const size_t DefaultCapacity = 1 << 16;
+
+        /** the segment OGLE_TELEMETRY=1 makes the process pid write to */
+        static std::string defaultName(int64_t pid);
+
+        /** does nothing unless name is given or OGLE_TELEMETRY is in the environment */
+        static bool init(const std::string& name = "", size_t capacity = DefaultCapacity);
+        static bool running();
+        /** Time is filled in here, call it from one thread only */
+        static void write(const TelemetrySample& sample);
+        /** removes the segment, readers that have it mapped see the writer go away */
+        static void shutdown();
+
+    private:
+        struct State;
+        static State* Instance;
+
+        Telemetry();
+        ~Telemetry();
+        Telemetry(const Telemetry& other);
+        Telemetry& operator=(const Telemetry& other);
+    };
+
+    class TelemetryReader
+    {
+    public:
+        TelemetryReader();
+        ~TelemetryReader();
+
+        /** the default named segments that exist right now, for picking one without knowing the pid; Linux only */
+        static std::vector<std::string> segments();
+
+        /** false while there is no segment or its writer hasn't finished setting it up */
+        bool open(const std::string& name, bool fromOldest = false);
+        bool opened() const;
+        const TelemetryHeader* header() const;
+        /** false once the writer has exited or replaced the segment, close() and open() again */
+        bool writerAlive() const;
+
+        /** appends the samples written since the last call, returns how many were lost */
+        uint64_t read(std::vector<TelemetrySample>& samples);
+        void close();
+
+    private:
+        const TelemetryHeader* Header;
+        const TelemetrySlot* Slots;
+        size_t MappedBytes;
+        uint64_t Next;
+
+        TelemetryReader(const TelemetryReader& other);
+        TelemetryReader& operator=(const TelemetryReader& other);
+    };
+}
+
+#endif // TELEMETRY_H
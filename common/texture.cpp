@@ -1,4 +1,5 @@
 #include "texture.h"
+#include "gpumemory.h"
 #include <iostream>
 #include <string.h>
 
@@ -53,6 +54,7 @@ void Texture::create()
     if (glGetError() != GL_NONE) assert(0);
 
     glBindTexture(Target, 0);
+    OGLE_GPU_TEXTURE(Name, InternalFormat, Width, Height, "ogle::Texture");
 }
 
 void Texture::create(unsigned int width, unsigned int height)
@@ -86,6 +88,7 @@ void Texture::clear()
 
 void Texture::shutdown()
 {
+    GpuMemory::release(GpuMemory::TEXTURE, Name);
     glDeleteTextures(1, &Name);
     Name = 0;
 }
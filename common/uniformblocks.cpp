@@ -0,0 +1,309 @@
+#include "uniformblocks.h"
+#include "gpumemory.h"
+
+#include <algorithm>
+#include <iostream>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /** "Frame.LightPos[0]" is LightPos */
+    std::string memberName(const std::string& name, const std::string& block)
+    {
+        std::string result = name;
+        if (result.compare(0, block.size() + 1, block + ".") == 0)
+            result.erase(0, block.size() + 1);
+        if (result.size() > 3 && result.compare(result.size() - 3, 3, "[0]") == 0)
+            result.erase(result.size() - 3);
+        return result;
+    }
+}
+
+BlockLayout::BlockLayout()
+    : Size(0)
+    , Binding(-1)
+{
+
+}
+
+bool BlockLayout::reflect(unsigned int program, const std::string& block, bool storage)
+{
+    clear();
+    Name = block;
+
+    GLenum block_interface = storage ? GL_SHADER_STORAGE_BLOCK : GL_UNIFORM_BLOCK;
+    GLenum member_interface = storage ? GL_BUFFER_VARIABLE : GL_UNIFORM;
+
+    GLuint index = glGetProgramResourceIndex(program, block_interface, block.c_str());
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "[!] BlockLayout: program " << program << " has no active block \"" << block << "\"" << std::endl;
+        return false;
+    }
+
+    const GLenum block_props[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES };
+    GLint block_values[3] = {0};
+    glGetProgramResourceiv(program, block_interface, index, 3, block_props, 3, nullptr, block_values);
+    Binding = block_values[0];
+    Size = (size_t)block_values[1];
+
+    std::vector<GLint> variables(block_values[2]);
+    const GLenum active_variables = GL_ACTIVE_VARIABLES;
+    if (!variables.empty())
+        glGetProgramResourceiv(program, block_interface, index, 1, &active_variables, (GLsizei)variables.size(), nullptr, variables.data());
+
+    const GLenum props[] = { GL_TYPE, GL_OFFSET, GL_ARRAY_SIZE, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE, GL_NAME_LENGTH };
+    for (GLint variable : variables) {
+        GLint values[6] = {0};
+        glGetProgramResourceiv(program, member_interface, variable, 6, props, 6, nullptr, values);
+
+        std::string name(values[5], '\0');
+        glGetProgramResourceName(program, member_interface, variable, values[5], nullptr, &name[0]);
+        name.resize(values[5] > 0 ? values[5] - 1 : 0);
+
+        Member m;
+        m.Name = memberName(name, block);
+        m.Type = values[0];
+        m.Offset = values[1];
+        m.ArraySize = values[2];
+        m.ArrayStride = values[3];
+        m.MatrixStride = values[4];
+        Members.push_back(m);
+    }
+
+    std::sort(Members.begin(), Members.end(), [](const Member& a, const Member& b) {
+        return a.Offset < b.Offset;
+    });
+    return true;
+}
+
+void BlockLayout::clear()
+{
+    Name.clear();
+    Members.clear();
+    Size = 0;
+    Binding = -1;
+}
+
+bool BlockLayout::matches(std::initializer_list<Expected> members, size_t size) const
+{
+    bool matching = true;
+    for (const auto& expected : members) {
+        const Member* m = member(expected.Name);
+        if (m == nullptr) {
+            std::cerr << "[!] BlockLayout: " << Name << " has no active member " << expected.Name << std::endl;
+            matching = false;
+        }
+        else if ((size_t)m->Offset != expected.Offset) {
+            std::cerr << "[!] BlockLayout: " << Name << "." << expected.Name << " is at " << m->Offset
+                      << ", the struct has it at " << expected.Offset << std::endl;
+            matching = false;
+        }
+    }
+    if (Size != size) {
+        std::cerr << "[!] BlockLayout: " << Name << " is " << Size << " bytes, the struct " << size << std::endl;
+        matching = false;
+    }
+    if (!matching)
+        print(std::cerr);
+    return matching;
+}
+
+const BlockLayout::Member* BlockLayout::member(const std::string& name) const
+{
+    for (const auto& m : Members) {
+        if (m.Name == name)
+            return &m;
+    }
+    return nullptr;
+}
+
+const std::vector<BlockLayout::Member>& BlockLayout::members() const
+{
+    return Members;
+}
+
+size_t BlockLayout::size() const
+{
+    return Size;
+}
+
+int BlockLayout::binding() const
+{
+    return Binding;
+}
+
+void BlockLayout::print(std::ostream& out) const
+{
+    out << "block " << Name << ", " << Size << " bytes, binding " << Binding << "\n";
+    for (const auto& m : Members) {
+        out << "\t" << m.Offset << "\t" << m.Name;
+        if (m.ArrayStride > 0)
+            out << "[" << m.ArraySize << "] stride " << m.ArrayStride;
+        if (m.MatrixStride > 0)
+            out << " matrix stride " << m.MatrixStride;
+        out << "\n";
+    }
+    out.flush();
+}
+
+UniformRing::UniformRing()
+    : Buffer(0)
+    , Target(GL_UNIFORM_BUFFER)
+    , Mapped(nullptr)
+    , Persistent(false)
+    , Frames(0)
+    , Current(0)
+    , RegionBytes(0)
+    , Alignment(1)
+    , Offset(0)
+    , Waits(0)
+    , Overflowed(false)
+    , Label("UniformRing")
+{
+    for (size_t i=0; i<MaxFrames; ++i)
+        Fences[i] = nullptr;
+}
+
+UniformRing::~UniformRing()
+{
+
+}
+
+bool UniformRing::init(size_t frames, size_t frameBytes, bool storage, const char* label)
+{
+    shutdown();
+
+    Frames = std::min(std::max(frames, (size_t)1), MaxFrames);
+    Current = 0;
+    Offset = 0;
+    Waits = 0;
+    Overflowed = false;
+    Label = label;
+    Target = storage ? GL_SHADER_STORAGE_BUFFER : GL_UNIFORM_BUFFER;
+
+    GLint alignment = 0;
+    glGetIntegerv(storage ? GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT : GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    Alignment = alignment > 0 ? (size_t)alignment : 256;
+    RegionBytes = alignUp(frameBytes, Alignment);
+    size_t bytes = RegionBytes * Frames;
+
+    glGenBuffers(1, &Buffer);
+    glBindBuffer(Target, Buffer);
+    Persistent = GLEW_ARB_buffer_storage == GL_TRUE;
+    if (Persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(Target, bytes, nullptr, flags);
+        Mapped = (char*)glMapBufferRange(Target, 0, bytes, flags);
+    }
+    else {
+        glBufferData(Target, bytes, nullptr, GL_STREAM_DRAW);
+        Mapped = new char[bytes];
+    }
+    glBindBuffer(Target, 0);
+
+    if (Mapped == nullptr) {
+        std::cerr << "[!] UniformRing: " << Label << " couldn't map " << bytes << " bytes" << std::endl;
+        glDeleteBuffers(1, &Buffer);
+        Buffer = 0;
+        return false;
+    }
+    OGLE_GPU_BUFFER(Buffer, bytes, Label);
+    return true;
+}
+
+void UniformRing::beginFrame()
+{
+    Current = (Current + 1) % Frames;
+    Offset = 0;
+
+    if (Fences[Current] != nullptr) {
+        GLsync fence = (GLsync)Fences[Current];
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++Waits;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        glDeleteSync(fence);
+        Fences[Current] = nullptr;
+    }
+}
+
+void* UniformRing::allocate(size_t bytes, size_t& offset)
+{
+    size_t start = alignUp(Offset, Alignment);
+    if (start + bytes > RegionBytes) {
+        if (!Overflowed)
+            std::cerr << "[!] UniformRing: " << Label << " needs more than " << RegionBytes << " bytes in a frame" << std::endl;
+        Overflowed = true;
+        return nullptr;
+    }
+    Offset = start + bytes;
+    offset = Current * RegionBytes + start;
+    return Mapped + offset;
+}
+
+void UniformRing::bind(unsigned int index, size_t offset, size_t bytes)
+{
+    glBindBufferRange(Target, index, Buffer, offset, bytes);
+    // without a mapping the region was written on the client, the driver copies it from there
+    if (!Persistent)
+        glBufferSubData(Target, offset, bytes, Mapped + offset);
+}
+
+void UniformRing::endFrame()
+{
+    // glBufferSubData needs no fence, the driver took a copy
+    if (!Persistent)
+        return;
+
+    if (Fences[Current] != nullptr)
+        glDeleteSync((GLsync)Fences[Current]);
+    Fences[Current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t UniformRing::waits() const
+{
+    return Waits;
+}
+
+bool UniformRing::persistent() const
+{
+    return Persistent;
+}
+
+void UniformRing::shutdown()
+{
+    for (size_t i=0; i<MaxFrames; ++i) {
+        if (Fences[i] != nullptr)
+            glDeleteSync((GLsync)Fences[i]);
+        Fences[i] = nullptr;
+    }
+
+    if (Buffer != 0) {
+        // deleting the buffer unmaps it
+        if (!Persistent)
+            delete [] Mapped;
+        GpuMemory::release(GpuMemory::BUFFER, Buffer);
+        glDeleteBuffers(1, &Buffer);
+        Buffer = 0;
+    }
+    Mapped = nullptr;
+    Frames = 0;
+}
+
+UniformRing::UniformRing(const UniformRing& other)
+{
+
+}
+
+UniformRing& UniformRing::operator=(const UniformRing& other)
+{
+    return *this;
+}
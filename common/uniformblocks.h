@@ -0,0 +1,184 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+/****************************************************************
+
+    Uniform and shader storage blocks filled once per frame.
+
+    BlockLayout asks a linked program where the members of a
+    block are (offset, array and matrix stride, GL_BUFFER_DATA_SIZE)
+    through GL_ARB_program_interface_query. The C++ side of a
+    block is a plain struct laid out by hand to std140 rules and
+    pinned down with OGLE_STD140_OFFSET, so a wrong offset fails
+    to compile; matches() then compares the struct against what
+    the program reflects, which catches the GLSL side drifting
+    (a member added, a vec3 where the struct has a vec4...).
+
+    UniformRing is one buffer, persistently and coherently mapped
+    (GL_ARB_buffer_storage), split into a region per frame in
+    flight. Each frame the data is written straight into the
+    mapping and bound with glBindBufferRange at offsets aligned
+    to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (or the storage buffer
+    one). A fence marks the end of every frame and beginFrame()
+    waits on it before a region is written again, waits() counts
+    how often the CPU got there first. Without buffer storage the
+    writes go to memory on the client and bind() hands them to
+    glBufferSubData.
+
+    One block of per-frame data replaces the glUniform* calls
+    every draw used to make for the same values: written once,
+    bound to its binding point once, every program that declares
+    the block reads it.
+
+    Usage:
+        // matches layout(std140, binding=0) uniform Frame in the shaders
+        struct FrameBlock
+        {
+            glm::mat4 WorldViewProjection;
+            glm::vec4 LightPos;
+        };
+        OGLE_STD140_OFFSET(FrameBlock, LightPos, 64);
+        OGLE_STD140_SIZE(FrameBlock, 80);
+
+        // after linking
+        ogle::BlockLayout layout;
+        layout.reflect(program, "Frame");
+        layout.matches({OGLE_BLOCK_MEMBER(FrameBlock, WorldViewProjection),
+                        OGLE_BLOCK_MEMBER(FrameBlock, LightPos)}, sizeof(FrameBlock));
+        Ring.init(3, sizeof(FrameBlock));
+
+        // every frame
+        Ring.beginFrame();
+        size_t offset = 0;
+        FrameBlock* frame = Ring.allocate<FrameBlock>(offset);
+        frame->WorldViewProjection = mvp;
+        Ring.bind(0, offset, sizeof(FrameBlock));
+        ... draw ...
+        Ring.endFrame();
+
+    extensions required:
+    GL_ARB_uniform_buffer_object
+    GL_ARB_program_interface_query
+    GL_ARB_sync
+    GL_ARB_buffer_storage (optional, falls back to glBufferSubData)
+
+****************************************************************/
+
+#include <cstddef>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** std140 puts scalars on 4 bytes, vec2 on 8, vec3, vec4, matrices, arrays and structs on 16 */
+#define OGLE_STD140_OFFSET(type, member, offset) \
+    static_assert(offsetof(type, member) == (offset), #type "::" #member " is not at its std140 offset")
+/** std140 rounds a block up to 16 bytes */
+#define OGLE_STD140_SIZE(type, size) \
+    static_assert(sizeof(type) == (size) && (size) % 16 == 0, #type " is not the size of its std140 block")
+/** a member of a block struct for BlockLayout::matches(), named like its GLSL counterpart */
+#define OGLE_BLOCK_MEMBER(type, member) \
+    ogle::BlockLayout::Expected{#member, offsetof(type, member)}
+
+namespace ogle
+{
+    class BlockLayout
+    {
+    public:
+        struct Member
+        {
+            std::string Name;   // without the block name in front and [0] behind
+            unsigned int Type;  // GL_FLOAT_MAT4...
+            int Offset;
+            int ArraySize;
+            int ArrayStride;    // 0 when not an array
+            int MatrixStride;   // 0 when not a matrix
+        };
+
+        struct Expected
+        {
+            const char* Name;
+            size_t Offset;
+        };
+
+        BlockLayout();
+
+        /** false after printing when program has no active block of that name; storage for buffer blocks */
+        bool reflect(unsigned int program, const std::string& block, bool storage = false);
+        void clear();
+
+        /** false after printing every member that differs from the struct, or a size that does */
+        bool matches(std::initializer_list<Expected> members, size_t size) const;
+
+        /** nullptr when the block has no such active member */
+        const Member* member(const std::string& name) const;
+        const std::vector<Member>& members() const;
+        /** GL_BUFFER_DATA_SIZE, what has to be bound for the whole block */
+        size_t size() const;
+        /** the binding point, from layout(binding=) or glUniformBlockBinding */
+        int binding() const;
+
+        void print(std::ostream& out) const;
+
+    private:
+        std::string Name;
+        std::vector<Member> Members;
+        size_t Size;
+        int Binding;
+    };
+
+    class UniformRing
+    {
+    public:
+        static constexpr size_t MaxFrames = 4;
+
+        UniformRing();
+        ~UniformRing();
+
+        /** frames regions of frameBytes each; storage binds GL_SHADER_STORAGE_BUFFER ranges instead */
+        bool init(size_t frames, size_t frameBytes, bool storage = false, const char* label = "UniformRing");
+
+        /** moves to the next region, waiting until the GPU is done with it */
+        void beginFrame();
+
+        /** bytes in the current region at a bindable offset, nullptr after printing when the region is full */
+        void* allocate(size_t bytes, size_t& offset);
+        template <typename T>
+        T* allocate(size_t& offset)
+        {
+            return static_cast<T*>(allocate(sizeof(T), offset));
+        }
+
+        /** glBindBufferRange on index, offset as allocate() returned it */
+        void bind(unsigned int index, size_t offset, size_t bytes);
+
+        /** fences the region, after the last draw reading it */
+        void endFrame();
+
+        /** times beginFrame() had to wait on the GPU */
+        size_t waits() const;
+        bool persistent() const;
+
+        void shutdown();
+
+    private:
+        unsigned int Buffer;
+        unsigned int Target;
+        char* Mapped;                   // persistent mapping, or memory on the client
+        bool Persistent;
+        void* Fences[MaxFrames];        // GLsync
+        size_t Frames;
+        size_t Current;
+        size_t RegionBytes;
+        size_t Alignment;
+        size_t Offset;                  // into the current region
+        size_t Waits;
+        bool Overflowed;                // said so once already
+        const char* Label;
+
+        UniformRing(const UniformRing& other);
+        UniformRing& operator=(const UniformRing& other);
+    };
+}
+
+#endif // UNIFORMBLOCKS_H
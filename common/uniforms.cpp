@@ -0,0 +1,98 @@
+#include "uniforms.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+#define GLEW_NO_GLU
+#include <GL/glew.h>
+
+using namespace ogle;
+
+UniformTable::UniformTable()
+{
+    clear();
+}
+
+void UniformTable::collect(unsigned int program, const std::string& label)
+{
+    clear();
+    Label = label;
+
+    GLint active_uniforms = 0;
+    GLint max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active_uniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<std::string> names;
+    std::vector<int> locations;
+    std::vector<char> name(std::max(max_length, 1));
+    for (GLint i=0; i<active_uniforms; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, GLuint(i), (GLsizei)name.size(), &length, &size, &type, name.data());
+        // block members have no location, they are set through their buffer
+        GLint location = glGetUniformLocation(program, name.data());
+        if (location < 0)
+            continue;
+
+        // arrays are reported as "name[0]", resolve() takes "name"
+        std::string uniform(name.data(), length);
+        if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+            uniform.resize(uniform.size() - 3);
+        names.push_back(uniform);
+        locations.push_back(location);
+    }
+
+    std::vector<size_t> order(names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<uint32_t> hashes(names.size());
+    for (size_t i=0; i<names.size(); ++i)
+        hashes[i] = uniformHash(names[i].c_str());
+    std::sort(order.begin(), order.end(),
+        [&hashes](size_t a, size_t b) {
+            return hashes[a] < hashes[b];
+        });
+
+    for (size_t i : order) {
+        Hashes.push_back(hashes[i]);
+        Names.push_back(names[i]);
+        Locations.push_back(locations[i]);
+    }
+}
+
+void UniformTable::clear()
+{
+    Hashes.assign(1, 0);
+    Names.assign(1, std::string());
+    Locations.assign(1, -1);
+    Label.clear();
+}
+
+UniformHandle UniformTable::resolve(const UniformName& name) const
+{
+    UniformHandle handle = find(name);
+    if (handle == NoUniform) {
+        std::cerr << "[!] UniformTable: " << (Label.empty() ? "the program" : Label)
+                  << " has no active uniform \"" << name.Name << "\"" << std::endl;
+    }
+    return handle;
+}
+
+UniformHandle UniformTable::find(const UniformName& name) const
+{
+    auto first = std::lower_bound(Hashes.begin() + 1, Hashes.end(), name.Hash);
+    for (auto it = first; it != Hashes.end() && *it == name.Hash; ++it) {
+        size_t index = it - Hashes.begin();
+        if (strcmp(Names[index].c_str(), name.Name) == 0)
+            return (UniformHandle)index;
+    }
+    return NoUniform;
+}
+
+size_t UniformTable::size() const
+{
+    return Locations.size() - 1;
+}
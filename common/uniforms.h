@@ -0,0 +1,96 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+/****************************************************************
+
+    Uniform locations looked up once instead of on every call.
+
+    A UniformTable holds the active uniforms of a linked program
+    in a flat array. resolve() turns a name into a handle, an
+    index into that array, and complains about names the program
+    doesn't have (a typo, or a uniform the compiler optimized
+    away) right there instead of quietly setting location -1.
+    After that a location is one array read. Names are hashed
+    with FNV-1a; declared constexpr the hash is computed by the
+    compiler, resolve() only compares strings when two hashes
+    collide.
+
+    Usage:
+        constexpr ogle::UniformName WorldView("WorldView");
+
+        // once, after linking
+        Uniforms.collect(program, "mesh");
+        WorldViewHandle = Uniforms.resolve(WorldView);
+
+        // every frame
+        glUniformMatrix4fv(Uniforms[WorldViewHandle], 1, false, mv);
+
+    NoUniform maps to location -1, which glUniform* ignores, so
+    a handle that didn't resolve is safe to use.
+
+****************************************************************/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ogle
+{
+    /** FNV-1a, constexpr so that names known at compile time are hashed there */
+    constexpr uint32_t uniformHash(const char* name)
+    {
+        uint32_t hash = 2166136261u;
+        for (; *name; ++name) {
+            hash ^= (uint8_t)*name;
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    struct UniformName
+    {
+        const char* Name;
+        uint32_t Hash;
+
+        constexpr UniformName(const char* name)
+            : Name(name)
+            , Hash(uniformHash(name))
+        {
+
+        }
+    };
+
+    /** index into a UniformTable */
+    typedef unsigned int UniformHandle;
+    const UniformHandle NoUniform = 0;
+
+    class UniformTable
+    {
+    public:
+        UniformTable();
+
+        /** every active uniform of program, label names it in the complaints */
+        void collect(unsigned int program, const std::string& label);
+        void clear();
+
+        /** NoUniform after printing that the program has no such active uniform */
+        UniformHandle resolve(const UniformName& name) const;
+        /** like resolve() but quiet, for uniforms that only some variants have */
+        UniformHandle find(const UniformName& name) const;
+
+        int operator[](UniformHandle handle) const
+        {
+            return Locations[handle];
+        }
+        size_t size() const;
+
+    private:
+        // sorted by hash, entry 0 is NoUniform
+        std::vector<uint32_t> Hashes;
+        std::vector<std::string> Names;
+        std::vector<int> Locations;
+        std::string Label;
+    };
+}
+
+#endif // UNIFORMS_H
@@ -0,0 +1,5 @@
+// one work group covers WORKGROUP_SIZE x WORKGROUP_SIZE texels, ogl_compute --workgroup picks it
+#ifndef WORKGROUP_SIZE
+#define WORKGROUP_SIZE 32
+#endif
+layout(local_size_x=WORKGROUP_SIZE, local_size_y=WORKGROUP_SIZE) in;
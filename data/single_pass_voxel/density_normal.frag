@@ -10,7 +10,7 @@ layout(binding=1) uniform usampler2D Density1;
 layout(binding=2) uniform usampler2D BitMask;
 layout(binding=3) uniform usampler2D ColumnBitMask;
 
-layout(location=3) uniform vec2 DepthExtents = vec2(.1,100.);
+#include "depth_slab.glsl"
 
 layout(location=0) out vec4 Frag;
 
@@ -32,16 +32,7 @@ void main() {
     uvec4 negy1 = texture(Density1, density_coord + vec2( 0,-1)*its);
 
     // figure out which, or both, density to sample from
-    float range = DepthExtents.y - DepthExtents.x;
-    float half_range = range * .5;
-    float depth = (1./gl_FragCoord.w) - DepthExtents.x;
-
-    vec2 coord;
-    if (depth < half_range){
-        coord = vec2(depth / half_range);
-    }else{
-        coord = vec2((depth-half_range) / half_range);
-    }
+    vec2 coord = vec2(slabCoord());
 
     // grab the info to make our normal
 
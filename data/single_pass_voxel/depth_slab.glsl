@@ -0,0 +1,15 @@
+#include "frame.glsl"
+
+// the depth range is cut into VOXEL_SLABS slabs, the BitMask texture spans one of them
+#ifndef VOXEL_SLABS
+#define VOXEL_SLABS 2
+#endif
+
+/** where the fragment is in its slab, 0 at the near side to 1 at the far side */
+float slabCoord()
+{
+    float slab_range = (DepthExtents.y - DepthExtents.x) / float(VOXEL_SLABS);
+    float depth = (1./gl_FragCoord.w) - DepthExtents.x;
+    float slab = clamp(floor(depth / slab_range), 0., float(VOXEL_SLABS - 1));
+    return depth / slab_range - slab;
+}
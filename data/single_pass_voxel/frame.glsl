@@ -0,0 +1,8 @@
+// written once per frame, see FrameBlock in single_pass_voxel.cpp
+layout(std140, binding=0) uniform Frame
+{
+    mat4 WorldViewProjection;
+    mat4 WorldView;
+    vec4 LightPos;
+    vec2 DepthExtents;
+};
@@ -2,7 +2,7 @@
 
 layout(location=0) in vec4 Position;
 
-layout(location=0) uniform mat4 WorldViewProjection;
+#include "frame.glsl"
 
 void main() {
     gl_Position = WorldViewProjection * Position;
@@ -23,7 +23,6 @@
 ****************************************************/
 
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <algorithm>
 #include <vector>
@@ -34,18 +33,19 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include <gputimer.h>
+#include "application.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 /** throw things into the unnamed namespace */
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
 
     const int QuadVerts = 6;
-    const int VertexCount = QuadVerts * 1;
-    GLuint VBOCount = 10000;
+    GLsizei VertexCount = QuadVerts * 1; // --quads N makes it QuadVerts * N
+    GLuint VBOCount = 10000; // --size WxH makes it W*H
     GLuint BoundVao;
     vector<GLuint> VBO_Bound(VBOCount);
     GLuint Bound_Program = 0;
@@ -66,7 +66,7 @@ namespace {
     map<int, string> OGLDebugSeverity;
     map<int, string> OGLDebugIDs;
 
-    vec3 DataInit[VertexCount];
+    vector<vec3> DataInit(VertexCount);
 
     void debugOutput(
         unsigned int source,
@@ -121,17 +121,6 @@ namespace {
     }
 }
 
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
 /** makes sure that we can use all the extensions we need for this app */
 void checkExtensions()
 {
@@ -153,7 +142,7 @@ void checkExtensions()
         ,"GL_ARB_debug_output"                  // http://www.opengl.org/registry/specs/ARB/debug_output.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required and not supported on this machine." << endl;
     }
 }
@@ -167,54 +156,6 @@ void initGLSettings()
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 }
 
-/** creates our Window */
-void initGLFW()
-{
-    int width, height;
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    // glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( 400, 400, "Bindless NV Example", NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 0 ); // Turn off vsync for benchmarking.
-    cout << "[!] Warning, be sure that vsync is disabled in NVidia controller panel." << endl;
-
-    glfwGetFramebufferSize(glfwWindow, &width, &height);
-    glViewport( 0, 0, (GLsizei)width, (GLsizei)height );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-    glfwSetErrorCallback(errorCallback);
-}
-
-/** inits glew for us */
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError();
-}
-
 /** init some plain jane VBO's */
 void initOldVBOs()
 {
@@ -223,7 +164,7 @@ void initOldVBOs()
     vec3 br( 1.0f, -1.0f, 0.0f);
     vec3 tr( 1.0f,  1.0f, 0.0f);
     vec3 tl(-1.0f,  1.0f, 0.0f);
-    for (int i=0; i<VertexCount; i+=QuadVerts){
+    for (GLsizei i=0; i<VertexCount; i+=QuadVerts){
         DataInit[i+0] = bl;
         DataInit[i+1] = br;
         DataInit[i+2] = tr;
@@ -240,75 +181,19 @@ void initOldVBOs()
     glGenBuffers(VBOCount, VBO_Bound.data());
     for (GLuint i=0; i<VBOCount; ++i){
         glBindBuffer(GL_ARRAY_BUFFER, VBO_Bound[i]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(DataInit), (const GLvoid*)&DataInit[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, DataInit.size() * sizeof(vec3), (const GLvoid*)DataInit.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0); // just position data
     }
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
-{
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
-}
-
 /** shaders that use old vbo's */
 void initShadersOldVBOs()
 {
 
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "bound.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "bound.frag");
-
-    Bound_Program = glCreateProgram();
-    glAttachShader(Bound_Program, vert);
-    glDeleteShader(vert);
-    glAttachShader(Bound_Program, frag);
-    glDeleteShader(frag);
-    glLinkProgram(Bound_Program);
-
-    int status;
-    glGetProgramiv(Bound_Program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(Bound_Program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "bound.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "bound.frag";
+    Bound_Program = ogle::ProgramCache::build(shaders);
 
     glUseProgram(Bound_Program);
 }
@@ -326,7 +211,7 @@ void initBindlessVBOs() {
     glGenBuffers(VBOCount, VBO_Bindless.data());
     for (GLuint i=0; i<VBOCount; ++i){
         glBindBuffer(GL_ARRAY_BUFFER, VBO_Bindless[i]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(DataInit), (const GLvoid*)&DataInit[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, DataInit.size() * sizeof(vec3), (const GLvoid*)DataInit.data(), GL_STATIC_DRAW);
 
         // get the buffer addr and then make it resident
         glGetBufferParameterui64vNV(GL_ARRAY_BUFFER, GL_BUFFER_GPU_ADDRESS_NV, &VBO_Addrs[i]);
@@ -337,70 +222,14 @@ void initBindlessVBOs() {
 /** init shaders that use bindless VBOs */
 void initShadersBindless()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "bindless.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "bindless.frag");
-
-    Bindless_Program = glCreateProgram();
-    glAttachShader(Bindless_Program, vert);
-    glDeleteShader(vert);
-    glAttachShader(Bindless_Program, frag);
-    glDeleteShader(frag);
-    glLinkProgram(Bindless_Program);
-
-    int status;
-    glGetProgramiv(Bindless_Program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(Bindless_Program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "bindless.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "bindless.frag";
+    Bindless_Program = ogle::ProgramCache::build(shaders);
 
     glUseProgram(Bindless_Program);
 }
 
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
-/** calls other init functions and may do some other init'ing as well */
-void init( int argc, char *argv[] )
-{
-    setDataDir(argc, argv);
-
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-
-    ::initDebug();
-
-    initGLSettings();
-
-    // now get to the real inits.
-    // init some VBO's the normal way
-    initOldVBOs();
-
-    // normal shaders
-    initShadersOldVBOs();
-
-    // bindless vbos
-    initBindlessVBOs();
-
-    // shaders that use bindless vbo's
-    initShadersBindless();
-}
-
 void runInitBound()
 {
     glBindVertexArray(BoundVao);
@@ -427,80 +256,122 @@ void runInitBindless()
 
 void runCycleBindless()
 {
-    static GLsizeiptr vertex_bytes = sizeof(DataInit);
+    static GLsizeiptr vertex_bytes = DataInit.size() * sizeof(vec3);
     for (GLuint i=0; i<VBOCount; ++i){
         glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 0, VBO_Addrs[i], vertex_bytes);
         glDrawArrays(GL_POINTS, 0, VertexCount);
     }
 }
 
-void shutdown()
+class BindlessNV : public ogle::Application
 {
-    glDeleteProgram(Bindless_Program);
-    glDeleteBuffers(VBOCount, VBO_Bindless.data());
-    glDeleteVertexArrays(1, &BindlessVao);
+public:
+    BindlessNV()
+        : ogle::Application("bindless_nv")
+    {
+        Config.Width = 400;
+        Config.Height = 400;
+        Config.Name = "Bindless NV Example";
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.Debug = false;
+
+        // there is nothing to look at, it always runs as a benchmark
+        BenchmarkByDefault = true;
+        JsonFile = "bindless_nv.bench.json";
+        Methods = { "bound", "bindless" };
+        Benchmark.WarmupIterations = 20;
+        Benchmark.TimeBudget = 1.0;
+        // the params are built before the run, nothing in the measured loop may allocate
+        Benchmark.AssertNoAllocations = true;
+        Options.addOption("quads", "quads in each VBO, the vertices of one draw");
+    }
 
-    glDeleteProgram(Bound_Program);
-    glDeleteBuffers(VBOCount, VBO_Bound.data());
-    glDeleteVertexArrays(1, &BoundVao);
-}
+protected:
+    /** sizes the VBO count, the window stays as it is */
+    void setSize(int width, int height) override
+    {
+        VBOCount = width * height;
+        VBO_Bound.resize(VBOCount);
+        VBO_Bindless.resize(VBOCount);
+        VBO_Addrs.resize(VBOCount);
+    }
 
-typedef void (APIENTRY *run_inits)();
-typedef void (APIENTRY *run_cycles)();
-void runTest( const string& test_name, run_inits init_callback, run_cycles render_callback )
-{
-    int loop_counter = 0;
+    bool load() override
+    {
+        unsigned int quads = 1;
+        if (!commandLine().unsignedValue("quads", quads))
+            return false;
+        if (quads == 0) {
+            cerr << "[!] bindless_nv: --quads needs at least 1" << endl;
+            return false;
+        }
+        VertexCount = QuadVerts * quads;
+        DataInit.resize(VertexCount);
+        return true;
+    }
 
-    init_callback();
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
+        cout << "[!] Warning, be sure that vsync is disabled in NVidia controller panel." << endl;
+        Benchmark.Params["VBOCount"] = to_string(VBOCount);
+        Benchmark.Params["VertexCount"] = to_string(VertexCount);
 
-    glfwSetTime(0);
-    double start = glfwGetTime();
-    double gpu_total_time = 0.0f;
+        ogle::Startup::phase("extensions");
+        checkExtensions();
 
-    ogle::gpuTimer gpuTimer;
-    gpuTimer.init();
+        ogle::Startup::phase("debug output");
+        ::initDebug();
 
-    cout << "Starting " << test_name << " iterations" << endl;
+        ogle::Startup::phase("gl settings");
+        initGLSettings();
 
-    /* Main loop, see how many draw calls we can make within 1 second */
-    while ( (glfwGetTime() - start) < 1.0 )
-    {
-        gpuTimer.start();
-        render_callback();
-        gpuTimer.end();
-        gpu_total_time += gpuTimer.elaspedTime();
+        // now get to the real inits.
+        // init some VBO's the normal way
+        ogle::Startup::phase("vbos");
+        initOldVBOs();
 
-        /* Swap buffers */
-        glfwSwapBuffers(glfwWindow);
-        glfwPollEvents();
+        // normal shaders
+        ogle::Startup::phase("shaders");
+        initShadersOldVBOs();
 
-        // cout << ".";
-        // cout.flush();
+        // bindless vbos
+        ogle::Startup::phase("bindless vbos");
+        initBindlessVBOs();
 
-        loop_counter++;
+        // shaders that use bindless vbo's
+        ogle::Startup::phase("bindless shaders");
+        initShadersBindless();
+        return true;
     }
-    cout << "Finished " << test_name << " iterations\n"
-         << "\ttime to complete " << glfwGetTime() - start << "\n"
-         << "\tgpu time " << gpu_total_time * 1e-3f << "\n"
-         << "\tloop counter " << loop_counter << endl;
-
-    cout << "Clearing out gpu queries..." << endl;
-    double additional_time = 0.0;
-    while (gpuTimer.activeQueries() > 0){
-        additional_time += gpuTimer.elaspedTime();
+
+    void setMethod(size_t method) override
+    {
+        if (method == 0)
+            runInitBound();
+        else
+            runInitBindless();
     }
-    cout << "Additional Time: " << additional_time * 1e-3f << "\n" << endl;
-}
 
-int main( int argc, char *argv[])
-{
-    init(argc, argv);
+    void frame() override
+    {
+        if (method() == 0)
+            runCycleBound();
+        else
+            runCycleBindless();
+    }
 
-    runTest("Bound VBO's", (run_inits)runInitBound, (run_cycles)runCycleBound);
-    runTest("Bindless VBO's", (run_inits)runInitBindless, (run_cycles)runCycleBindless);
+    void shutdown() override
+    {
+        glDeleteProgram(Bindless_Program);
+        glDeleteBuffers(VBOCount, VBO_Bindless.data());
+        glDeleteVertexArrays(1, &BindlessVao);
 
-    shutdown();
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwTerminate();
-    exit( EXIT_SUCCESS );
-}
+        glDeleteProgram(Bound_Program);
+        glDeleteBuffers(VBOCount, VBO_Bound.data());
+        glDeleteVertexArrays(1, &BoundVao);
+    }
+};
+
+OGLE_APPLICATION(BindlessNV)
\ No newline at end of file
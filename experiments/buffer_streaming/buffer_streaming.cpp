@@ -7,8 +7,8 @@
 #include <functional>
 #include <memory>
 
+#include "application.h"
 #include "common.h"
-#include "debug.h"
 
 #include "drawablebufferdata.h"
 #include "bufferdata_pre_orphan.h"
@@ -19,13 +19,14 @@
 #include "map_persistent.h"
 #include "meshdata.h"
 #include "programobject.h"
+#include "latencytracker.h"
+#include "profiler.h"
+#include "startup.h"
 
 namespace {
     int WindowWidth = 640;
     int WindowHeight = 480;
-    std::string WindowName = "";
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
 
     enum buffer_update_method
     {
@@ -49,8 +50,10 @@ namespace {
     // ParticleCount creates # of bytes:
     // Verts( 6 * ParticleCount * (3*sizeof(float)))
     // Verts( ParticleCount * 72 )
-    unsigned int Count = 400;
-    unsigned int ParticleCount = Count*Count;    // bytes: 11520000, ~11 MB
+    // --size sets Columns x Rows
+    unsigned int Columns = 400;
+    unsigned int Rows = 400;
+    unsigned int ParticleCount = Columns*Rows;    // bytes: 11520000, ~11 MB
     MeshData Particles;
     ogle::ProgramObject ParticleShader;
 
@@ -59,11 +62,6 @@ namespace {
 }
 
 
-void errorCallback(int error, const char* description)
-{
-    std::cerr << description << std::endl;
-}
-
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
@@ -72,12 +70,12 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     if (action == GLFW_RELEASE){
         switch(key){
             case GLFW_KEY_UP:
-                MethodSelection = (MethodSelection+1) % buffer_update_method::MAX;
+                MethodSelection = (MethodSelection+1) % (int)BufferMethod.size();
                 std::cout << "New selection: " << MethodSelection << std::endl;
             break;
             case GLFW_KEY_DOWN:
             {
-                MethodSelection = (MethodSelection - 1 + buffer_update_method::MAX) % buffer_update_method::MAX;
+                MethodSelection = (MethodSelection - 1 + (int)BufferMethod.size()) % (int)BufferMethod.size();
                 std::cout << "New selection: " << MethodSelection << std::endl;
                 break;
             }
@@ -110,7 +108,7 @@ bool checkExtensions()
 
     bool found_lacking = false;
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE){
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE){
             std::cerr << extension << " - is required and not supported on this machine." << std::endl;
             found_lacking = true;
         }
@@ -125,60 +123,18 @@ void initGLSettings()
     glEnable(GL_CULL_FACE);
 }
 
-/** creates our Window */
-void initGLFW()
-{
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, WindowName.c_str(), NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 0 ); // Turn off vsync for benchmarking.
-    std::cout << "[!] Warning, be sure that vsync is disabled in NVidia controller panel." << std::endl;
-    std::cout << "[!] Having vsync disabled allows for a little faster frame rate, but allows for screen tearing and possibly disables triple buffering of the driver." << std::endl;
-
-    int width, height;
-    glfwGetFramebufferSize(glfwWindow, &width, &height);
-    glViewport( 0, 0, (GLsizei)width, (GLsizei)height );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-    glfwSetErrorCallback(errorCallback);
-}
-
-void setDataDir(int argc, char *argv[]){
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-    WindowName = exe_name;
-}
-
 void fillParticleMeshData(){
+    OGLE_PROFILE_ZONE("fill particle mesh");
 
     const int points_per_quad = 6;
     // Particles.VertData.resize(ParticleCount * points_per_quad);
     Particles.VertByteCount = ParticleCount * points_per_quad * sizeof(glm::vec3);
     Particles.VertData = new char[Particles.VertByteCount];
     memset((void*)Particles.VertData, 0, Particles.VertByteCount);
+    ogle::Profiler::zoneBytes(Particles.VertByteCount);
     
-    int rows = Count;
-    int colums = Count;
+    int rows = Rows;
+    int colums = Columns;
 
     float width = 1 / (float)colums;
     float height = 1 / (float)rows;
@@ -232,26 +188,6 @@ void createBufferObject(){
     }
 }
 
-bool init(int argc, char *argv[]){
-
-    setDataDir(argc, argv);
-    initGLFW();
-    ogle::initGLEW();
-    bool found_extensions = checkExtensions();
-    if (!found_extensions)
-        return false;
-    
-    ogle::Debug::init();
-
-    initGLSettings();
-
-    createParticles();
-
-    createBufferObject();
-
-    return true;
-}
-
 void update(){
     BufferMethod[MethodSelection]->update(Particles);
 }
@@ -265,67 +201,106 @@ void render(){
     ParticleShader.unbind();
 }
 
-void runloop(){
+class BufferStreaming : public ogle::Application
+{
+public:
+    BufferStreaming()
+        : ogle::Application("buffer_streaming")
+        , FrameCounter(0)
+        , PreviousTime(0)
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        TraceFile = "buffer_streaming.trace.json";
+        // in the order createBufferObject() makes them
+        Methods = {
+            "map_persistent",
+            "buffer_data",
+            "buffer_data_pre_orphan",
+            "buffer_sub_data_no_orphan",
+            "buffer_sub_data_pre_orphan",
+            "buffer_sub_data_post_orphan"
+        };
+    }
 
-    static uint32_t frame_counter = 0;
-    static double curr_time = 0;
-    static double prev_time = 0;
+protected:
+    /** sizes the particle grid, the window stays as it is */
+    void setSize(int width, int height) override {
+        Columns = width;
+        Rows = height;
+        ParticleCount = Columns*Rows;
+    }
 
-    bool close = glfwWindowShouldClose(glfwWindow);
-    double start, end;
-    while (!close){
-        // std::cout << "-------------------------------------------------------" << std::endl;
-        glfwPollEvents();
+    bool init() override {
+        DataDirectory = dataDirectory();
+        ogle::Context::setKeyCallback(keyCallback);
+        std::cout << "[!] Warning, be sure that vsync is disabled in NVidia controller panel." << std::endl;
+        std::cout << "[!] Having vsync disabled allows for a little faster frame rate, but allows for screen tearing and possibly disables triple buffering of the driver." << std::endl;
 
-        // start = glfwGetTime();
-        update();
-        // end = glfwGetTime();
-        // std::cout << std::setprecision(9) << std::fixed << "Update: " << (end - start) << std::endl;
+        ogle::Startup::phase("extensions");
+        if (!checkExtensions())
+            return false;
+        ogle::LatencyTracker::init();
 
-        render();
+        ogle::Startup::phase("gl settings");
+        initGLSettings();
 
-        // start = glfwGetTime();
-        glfwSwapBuffers(glfwWindow);
-        // end = glfwGetTime();
-        // std::cout << std::setprecision(9) << std::fixed << "SwapBuffers: " << (end - start) << std::endl;
+        ogle::Startup::phase("particles");
+        createParticles();
+        Benchmark.Params["particles"] = std::to_string(ParticleCount);
 
-        close = glfwWindowShouldClose(glfwWindow);
-        
-        curr_time = glfwGetTime();
-        if ( (curr_time-prev_time) > 1.0){
-            std::cout << "FPS: " << frame_counter << std::endl;
-            frame_counter = 0;
-            prev_time = curr_time;
+        ogle::Startup::phase("buffer objects");
+        createBufferObject();
+        return true;
+    }
+
+    void setMethod(size_t method) override {
+        MethodSelection = (int)method;
+    }
+
+    void frame() override {
+        ogle::LatencyTracker::beginFrame();
+
+        {
+            OGLE_PROFILE_ZONE("update");
+            update();
+        }
+
+        {
+            OGLE_PROFILE_ZONE("render");
+            render();
         }
-        frame_counter++;
     }
-}
 
-void shutdown(){
-    for (auto& buff : BufferMethod){
-        buff->shutdown();
+    void endFrame() override {
+        ogle::LatencyTracker::endFrame();
+        if (benchmarking())
+            return;
+
+        double curr_time = ogle::Context::time();
+        if ( (curr_time-PreviousTime) > 1.0){
+            std::cout << "FPS: " << FrameCounter << std::endl;
+            FrameCounter = 0;
+            PreviousTime = curr_time;
+        }
+        FrameCounter++;
     }
-       
-    ParticleShader.shutdown();
-    delete [] Particles.VertData;
 
-    ogle::Debug::shutdown();
-    
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
+    void shutdown() override {
+        for (auto& buff : BufferMethod){
+            buff->shutdown();
+        }
 
-int main(int argc, char *argv[]){
+        ParticleShader.shutdown();
+        delete [] Particles.VertData;
 
-    if (!init(argc, argv)) {
-        std::cerr << "Error occured!" << std::endl;
-        shutdown();
-        exit( EXIT_FAILURE );
+        ogle::LatencyTracker::printSummary();
+        ogle::LatencyTracker::shutdown();
     }
 
-    runloop();
+private:
+    uint32_t FrameCounter;
+    double PreviousTime;
+};
 
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
\ No newline at end of file
+OGLE_APPLICATION(BufferStreaming)
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "drawablebufferdata.h"
+#include "gpumemory.h"
 
 
 void DrawableBufferData::init(const MeshData& mesh)
@@ -23,6 +24,8 @@ void DrawableBufferData::init(const MeshData& mesh)
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, bytes_per_particle, nullptr, Usage);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    OGLE_GPU_BUFFER(VBO, bytes_per_particle, "DrawableBufferData vbo");
+    OGLE_GPU_BUFFER(IBO, 0, "DrawableBufferData ibo");
 }
 
 void DrawableBufferData::render(const MeshData& mesh)
@@ -48,6 +51,8 @@ void DrawableBufferData::update(const MeshData& mesh)
 void DrawableBufferData::shutdown()
 {
     unsigned int buffs[2] = { VBO, IBO };
+    ogle::GpuMemory::release(ogle::GpuMemory::BUFFER, VBO);
+    ogle::GpuMemory::release(ogle::GpuMemory::BUFFER, IBO);
     glDeleteBuffers(2, buffs);
     glDeleteVertexArrays(1, &VAO);
 }
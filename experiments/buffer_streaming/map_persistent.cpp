@@ -1,6 +1,8 @@
 #include <iostream>
 
 #include "map_persistent.h"
+#include "gpumemory.h"
+#include "profiler.h"
 
 
 void MapPersistent::init(const MeshData& mesh)
@@ -20,6 +22,7 @@ void MapPersistent::init(const MeshData& mesh)
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glBufferStorage(GL_ARRAY_BUFFER, Bytes, nullptr, flags /*| GL_CLIENT_STORAGE_BIT*/);
+    OGLE_GPU_BUFFER(VBO, Bytes, "MapPersistent");
     MappedVertPointer = glMapBufferRange(GL_ARRAY_BUFFER, 0, Bytes, flags);
 
     for (int i=0;i<BufferCount; ++i){
@@ -41,6 +44,9 @@ void MapPersistent::render(const MeshData& mesh)
     const size_t bytes_per_quad = sizeof(glm::vec3) * points_per_quad;
     const size_t particle_count = mesh.VertByteCount / bytes_per_quad;
 
+    // copies and draws are interleaved per particle, the zone covers both
+    OGLE_PROFILE_ZONE("map persistent copy + draw");
+    ogle::Profiler::zoneBytes(particle_count * bytes_per_quad);
     for (size_t p=0; p<particle_count; ++p){
 
         // update the buffer
@@ -75,6 +81,7 @@ void MapPersistent::shutdown()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     
+    ogle::GpuMemory::release(ogle::GpuMemory::BUFFER, VBO);
     glDeleteBuffers(1, &VBO);
     glDeleteVertexArrays(1, &VAO);
 }
@@ -1,5 +1,5 @@
 #include <algorithm>
-#include <fstream>
+#include <map>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -13,14 +13,15 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "debug.h"
+#include "application.h"
 #include "objloader.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 800;
     int WindowHeight = 640;
     string WindowName = "ShowDerivates";
@@ -72,144 +73,18 @@ namespace {
     BoundingBox SceneBoundingBox;
 }
 
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, WindowName.c_str(), NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-}
-
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
-}
-
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
 void initGLObjects()
 {
     glGenVertexArrays(::vao::MAX, VAO);
     glGenBuffers(::buffer::MAX, Buffer);
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
-{
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
-}
-
-void checkShaderLinkage( const GLuint& program)
-{
-    int status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-}
-
 void initShader(int program, const std::string& shader)
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + shader + ".vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + shader + ".frag");
-
-    Program[program] = glCreateProgram();
-    glAttachShader(Program[program], vert);
-    glAttachShader(Program[program], frag);
-    glLinkProgram(Program[program]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + shader + ".vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + shader + ".frag";
+    Program[program] = ogle::ProgramCache::build(shaders);
 }
 
 glm::mat4 center_scene(const BoundingBox& scene, float view_angle_degree)
@@ -235,7 +110,7 @@ void render()
     glm::vec4 lookat = glm::vec4(SceneBoundingBox.Center, 1);
     glm::vec4 dir = lookat - eye_pos;
 
-    float scalar = sin( (float)glfwGetTime() ) * 0.3 + 1.6f;
+    float scalar = sin( (float)ogle::Context::time() ) * 0.3 + 1.6f;
     eye_pos = dir * scalar;
     View = glm::lookAt(glm::vec3(-eye_pos), SceneBoundingBox.Center, {0,1,0});
 
@@ -257,30 +132,6 @@ void render()
     glDrawRangeElements(GL_TRIANGLES, 0, VertCount, IndexCount, GL_UNSIGNED_INT, 0);
 }
 
-void runloop()
-{
-    while (!glfwWindowShouldClose(glfwWindow)){
-        render();
-        glfwSwapBuffers(glfwWindow);
-        glfwPollEvents();
-    }
-}
-
-void shutdown()
-{
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
-
-    for (size_t i=0; i<program::MAX; ++i){
-        glDeleteProgram(Program[i]);
-    }
-
-    ogle::Debug::shutdown();
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
-
 void initDerivativeShader()
 {
     initShader(program::DERIVATIVES, "derivatives");
@@ -334,22 +185,56 @@ void initMesh()
     glFinish();
 }
 
-void init(int argc, char* argv[])
+class GlslDerivative : public ogle::Application
 {
-    setDataDir(argc, argv);
-    initGLFW();
-    initGLEW();
-    ogle::Debug::init();
-    initGLObjects();
-
-    initDerivativeShader();
-    initMesh();
-}
+public:
+    GlslDerivative()
+        : ogle::Application("glsl_derivative")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = WindowName;
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.SwapInterval = 1;
+    }
 
-int main(int argc, char* argv[])
-{
-    init(argc, argv);
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
\ No newline at end of file
+protected:
+    void setSize(int width, int height) override
+    {
+        ogle::Application::setSize(width, height);
+        WindowWidth = width;
+        WindowHeight = height;
+    }
+
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
+
+        ogle::Startup::phase("gl objects");
+        initGLObjects();
+
+        ogle::Startup::phase("shaders");
+        initDerivativeShader();
+        ogle::Startup::phase("mesh");
+        initMesh();
+        return true;
+    }
+
+    void frame() override
+    {
+        render();
+    }
+
+    void shutdown() override
+    {
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
+
+        for (size_t i=0; i<program::MAX; ++i){
+            glDeleteProgram(Program[i]);
+        }
+    }
+};
+
+OGLE_APPLICATION(GlslDerivative)
\ No newline at end of file
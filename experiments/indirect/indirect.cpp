@@ -15,7 +15,7 @@
     that holds the command arguments that controls how many instances of the cube to draw.
 */
 #include <iostream>
-#include <fstream>
+#include <map>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -35,13 +35,17 @@
 #include <GLFW/glfw3.h>
 
 #include "cubegenerator.h"
-#include "debug.h"
+#include "application.h"
+#include "framearena.h"
+#include "gpumemory.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 800;
     int WindowHeight = 640;
 
@@ -154,60 +158,9 @@ namespace {
     GLsizei CubeIndiceCount = 0;
     GLuint  CubeTransformBlockIdx = 0;
     double  DeltaTime = 0;
-}
-
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    // glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, "Indirect Demo", NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-}
 
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
+    // transient per frame data (the cube MVPs), reset at the start of every frame
+    ogle::FrameArena FrameMemory;
 }
 
 /** makes sure that we can use all the extensions we need for this app */
@@ -235,7 +188,7 @@ void checkExtensions()
         ,"GL_ARB_clear_buffer_object"           // http://www.opengl.org/registry/specs/ARB/clear_buffer_object.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required but not supported on this machine." << endl;
     }
 }
@@ -262,6 +215,7 @@ void initTexture()
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
     glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, ::ic::TextureSize, ::ic::TextureSize, 0, GL_RGBA, GL_UNSIGNED_INT, data);
+    OGLE_GPU_TEXTURE(::ic::TextureID, GL_RGBA, ::ic::TextureSize, ::ic::TextureSize, "indirect command counts");
 
     if (glGetError() != GL_NONE) assert(0);
 
@@ -328,12 +282,13 @@ void checkFBO()
 void initFramebuffer()
 {
     glGenFramebuffers(1, &::ic::FramebufferID);
+    OGLE_GPU_FRAMEBUFFER(::ic::FramebufferID, "indirect command counts");
     glBindFramebuffer(GL_FRAMEBUFFER, ::ic::FramebufferID);
     glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ::ic::TextureID, 0);
 
     // check for completeness
     checkFBO();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ogle::Context::defaultFramebuffer());
 }
 
 void bindFBO()
@@ -353,74 +308,12 @@ void createGLObjects()
     glGenProgramPipelines(::pipeline::MAX, Pipeline);
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
-{
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
-}
-
-void checkShaderLinkage( const GLuint& program)
-{
-    int status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-}
-
 void initQuadShader()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "quad.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "quad.frag");
-
-    Program[program::QUAD] = glCreateProgram();
-    glProgramParameteri(Program[program::QUAD], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::QUAD], vert);
-    glAttachShader(Program[program::QUAD], frag);
-    glLinkProgram(Program[program::QUAD]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::QUAD]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "../common/quad.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "quad.frag";
+    Program[program::QUAD] = ogle::ProgramCache::build(shaders, {}, true);
     glUseProgramStages(Pipeline[pipeline::QUAD], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::QUAD]);
 }
 
@@ -457,18 +350,10 @@ void initFullScreenQuad()
 
 void initCubeShader()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "cube.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "cube.frag");
-
-    Program[program::CUBE] = glCreateProgram();
-    glProgramParameteri(Program[program::CUBE], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::CUBE], vert);
-    glAttachShader(Program[program::CUBE], frag);
-    glLinkProgram(Program[program::CUBE]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::CUBE]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "cube.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "cube.frag";
+    Program[program::CUBE] = ogle::ProgramCache::build(shaders, {}, true);
     glUseProgramStages(Pipeline[pipeline::CUBE], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::CUBE]);
 }
 
@@ -551,17 +436,6 @@ void initCube()
     initCubeIndirectCommand();
 }
 
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
 void setGLSettings()
 {
     // glCullFace(GL_BACK);
@@ -586,27 +460,6 @@ void oglGets()
          << endl;
 }
 
-void init( int argc, char *argv[] )
-{
-    setDataDir(argc, argv);
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-    ogle::Debug::init();
-
-    oglGets();
-
-    initTexture();
-    initFramebuffer();
-
-    createGLObjects();
-
-    initFullScreenQuad();
-    initCube();
-
-    setGLSettings();
-}
-
 void renderquad()
 {
     glDisable(GL_DEPTH_TEST);
@@ -637,7 +490,7 @@ void renderquad()
 
     glBindVertexArray(0);
     glBindProgramPipeline(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ogle::Context::defaultFramebuffer());
     glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
     glEnable(GL_DEPTH_TEST);
 
@@ -679,7 +532,9 @@ void rendercube()
         // the center of each cube will be at 0,0,0
         glm::vec3 push_vec(0);
         const GLsizei limit = ic::TextureSize*ic::TextureSize;
-        vector<glm::mat4> MVP(limit);
+        ogle::FrameVector<glm::mat4> CubeMVP(limit, ogle::ArenaAllocator<glm::mat4>(FrameMemory));
+        OGLE_PROFILE_ZONE("mvp");
+        ogle::Profiler::zoneBytes(sizeof(glm::mat4) * limit);
         for (GLsizei i=0; i<limit; ++i){
             glm::mat4 Model = glm::mat4(1.0f);
             if (i % 3 == 0)
@@ -690,12 +545,12 @@ void rendercube()
                 Model = glm::rotate(Model, (float)y, glm::vec3(0.f, 0.f, 1.f));
             Model[3] = glm::vec4(push_vec, 1);
 
-            MVP[i] = Projection * View * Model;
+            CubeMVP[i] = Projection * View * Model;
             push_vec = glm::vec3(4,0,0);
             push_vec = glm::rotateZ(push_vec, (i/float(limit-1)) * pi2 );
         }
 
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4) * limit, (const GLvoid*)MVP.data());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4) * limit, (const GLvoid*)CubeMVP.data());
     }
 
 
@@ -726,47 +581,82 @@ void rendercube()
     glBindProgramPipeline(0);
 }
 
-void runloop()
+class Indirect : public ogle::Application
 {
-    glfwSetTime(0);
-    while (!glfwWindowShouldClose(glfwWindow)){
-        DeltaTime = glfwGetTime();
-        renderquad();
-        rendercube();
-        glfwSetTime(0);
-
-        // test if buffer was written to
-        // IndirectCommand *counter;
-        // glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, Buffer[buffer::INDIRECT]);
-        // counter = (IndirectCommand*)glMapBufferRange(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(IndirectCommand), GL_MAP_READ_BIT);
-        // cout << "Counter : " << counter->PrimCount << endl;
-        // glUnmapBuffer(GL_ATOMIC_COUNTER_BUFFER);
+public:
+    Indirect()
+        : ogle::Application("indirect")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = "Indirect Demo";
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.Debug = false;
+        Config.SwapInterval = 1;
+        TraceFile = "indirect.trace.json";
+    }
 
-        glfwSwapBuffers(glfwWindow);
-        glfwPollEvents();
+protected:
+    void setSize(int width, int height) override
+    {
+        ogle::Application::setSize(width, height);
+        WindowWidth = width;
+        WindowHeight = height;
     }
-}
 
-void shutdown()
-{
-    glDeleteFramebuffers(1, &::ic::FramebufferID);
-    glDeleteTextures(1, &::ic::TextureID);
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
 
-    glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
+        ogle::Startup::phase("extensions");
+        checkExtensions();
 
-    ogle::Debug::shutdown();
+        ogle::Startup::phase("gl limits");
+        oglGets();
+        // oglGets picks TextureSize, one MVP per cube
+        FrameMemory.init(sizeof(glm::mat4) * ic::TextureSize * ic::TextureSize);
+        Benchmark.Params["TextureSize"] = to_string(ic::TextureSize);
 
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
+        ogle::Startup::phase("framebuffer");
+        initTexture();
+        initFramebuffer();
 
-int main( int argc, char *argv[])
-{
-    init(argc, argv);
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
+        ogle::Startup::phase("gl objects");
+        createGLObjects();
+
+        ogle::Startup::phase("quad");
+        initFullScreenQuad();
+        ogle::Startup::phase("cube");
+        initCube();
+
+        ogle::Startup::phase("gl settings");
+        setGLSettings();
+        ogle::Context::setTime(0);
+        return true;
+    }
+
+    void frame() override
+    {
+        DeltaTime = ogle::Context::time();
+        ogle::Context::setTime(0);
+        FrameMemory.reset();
+        renderquad();
+        rendercube();
+    }
+
+    void shutdown() override
+    {
+        ogle::GpuMemory::release(ogle::GpuMemory::FRAMEBUFFER, ::ic::FramebufferID);
+        ogle::GpuMemory::release(ogle::GpuMemory::TEXTURE, ::ic::TextureID);
+        glDeleteFramebuffers(1, &::ic::FramebufferID);
+        glDeleteTextures(1, &::ic::TextureID);
+
+        glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
+        FrameMemory.shutdown();
+    }
+};
+
+OGLE_APPLICATION(Indirect)
\ No newline at end of file
@@ -2,7 +2,7 @@
     Calulating navier stokes non-compressable fluids using openGL compute shaders.
 */
 #include <iostream>
-#include <fstream>
+#include <map>
 #include <vector>
 #include <algorithm>
 
@@ -17,15 +17,19 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "debug.h"
+#include "application.h"
+#include "pipelinestatistics.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 512;
     int WindowHeight = 512;
+    unsigned int WorkGroupSize = 32; // --workgroup, compiled into the compute shaders (workgroup.glsl)
 
     namespace vao
     {
@@ -107,6 +111,9 @@ namespace {
     GLuint Pipeline[pipeline::MAX] = {0};
     GLuint Texture[texture::MAX] = {0};
 
+    ogle::PipelineStatistics AdvectVelocityStats;
+    ogle::PipelineStatistics AdvectInkStats;
+
     const GLsizei QuadVertCount = 4;
     const GLsizei QuadSize = QuadVertCount * sizeof(glm::vec2);
     const glm::vec2 QuadVerts[QuadVertCount] = {
@@ -128,24 +135,19 @@ namespace {
     bool CaptureMouse = false;
 }
 
-void errorCallback(int error, const char* description)
+/** the cursor in fluid texels, --size sets the fluid apart from the window */
+glm::ivec2 cursorTexel()
 {
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
+    double x,y;
+    ogle::Context::cursorPos(x, y);
+    return glm::ivec2(int(x * textureObject::Width / WindowWidth), int((WindowHeight - y) * textureObject::Height / WindowHeight));
 }
 
 void mouseCallback(GLFWwindow* window, int btn, int action, int mods)
 {
     if (btn == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS) {
         CaptureMouse = true;
-        double x,y;
-        glfwGetCursorPos(glfwWindow, &x, &y);
-        MousePresses[0] = glm::ivec2((int)x,WindowHeight-(int)y);
+        MousePresses[0] = cursorTexel();
         MousePresses[1] = MousePresses[0];
     }
     if (btn == GLFW_MOUSE_BUTTON_1 && action == GLFW_RELEASE) {
@@ -155,50 +157,6 @@ void mouseCallback(GLFWwindow* window, int btn, int action, int mods)
     }
 }
 
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, "OpenGL Compute, Fluids", NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-    glfwSetMouseButtonCallback(glfwWindow, mouseCallback);
-}
-
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
-}
-
 /** makes sure that we can use all the extensions we need for this app */
 void checkExtensions()
 {
@@ -220,7 +178,7 @@ void checkExtensions()
         ,"GL_ARB_shader_image_load_store"       // https://www.opengl.org/registry/specs/ARB/shader_image_load_store.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required but not supported on this machine." << endl;
     }
 }
@@ -271,61 +229,6 @@ void createGLObjects()
     glGenProgramPipelines(::pipeline::MAX, Pipeline);
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
-{
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader <" << fileName
-                    << "> Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
-}
-
-void checkShaderLinkage( const GLuint& program)
-{
-    int status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-}
-
 void computeShaderStats()
 {
     cout << "[!] Compute Shader stats" << endl;
@@ -360,35 +263,30 @@ void computeShaderStats()
     // ATOMIC_COUNTER_BUFFER_REFERENCED_BY_COMPUTE_SHADER;
 }
 
-void initComputeShader(string&& name, int program_id, int pipeline_id)
+/** only submitted, initPipelines() uses it once every program is linked */
+void initComputeShader(string&& name, int program_id)
 {
-    GLuint compute = createShader(GL_COMPUTE_SHADER, DataDirectory + name + ".compute");
-
-    Program[program_id] = glCreateProgram();
-    glProgramParameteri(Program[program_id], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program_id], compute);
-    glLinkProgram(Program[program_id]);
-    glDeleteShader(compute);
-
-    checkShaderLinkage(Program[program_id]);
-    glUseProgramStages(Pipeline[pipeline_id], GL_COMPUTE_SHADER_BIT, Program[program_id]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_COMPUTE_SHADER] = DataDirectory + name + ".compute";
+    ogle::ShaderDefines defines;
+    defines.set("WORKGROUP_SIZE", (int)WorkGroupSize);
+    Program[program_id] = ogle::ProgramCache::submit(shaders, defines, true);
 }
 
 void initQuadShader()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "quad.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "result.frag");
-
-    Program[program::QUAD] = glCreateProgram();
-    glProgramParameteri(Program[program::QUAD], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::QUAD], vert);
-    glAttachShader(Program[program::QUAD], frag);
-    glLinkProgram(Program[program::QUAD]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::QUAD]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "../common/quad.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "result.frag";
+    Program[program::QUAD] = ogle::ProgramCache::submit(shaders, {}, true);
+}
+
+void initPipelines()
+{
     glUseProgramStages(Pipeline[pipeline::QUAD], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::QUAD]);
+    glUseProgramStages(Pipeline[pipeline::SplatInk], GL_COMPUTE_SHADER_BIT, Program[program::SplatInk]);
+    glUseProgramStages(Pipeline[pipeline::Advect], GL_COMPUTE_SHADER_BIT, Program[program::Advect]);
+    glUseProgramStages(Pipeline[pipeline::Impulse], GL_COMPUTE_SHADER_BIT, Program[program::Impulse]);
 }
 
 void initQuadGeometry()
@@ -413,43 +311,6 @@ void initFullScreenQuad()
     initQuadGeometry();
 }
 
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
-void init( int argc, char *argv[])
-{
-    setDataDir(argc, argv);
-
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-    ogle::Debug::init();
-
-    initTexture();
-
-    createGLObjects();
-
-    initFullScreenQuad();
-
-    initComputeShader("ink", program::SplatInk, pipeline::SplatInk);
-    initComputeShader("advect", program::Advect, pipeline::Advect);
-    initComputeShader("impulse", program::Impulse, pipeline::Impulse);
-    computeShaderStats();
-
-    MouseShaderLoc = glGetUniformLocation(Program[program::SplatInk], "InkSpot");
-    DeltaTimeLoc = glGetUniformLocation(Program[program::Advect], "DeltaTime");
-    ImpulsePositionLoc = glGetUniformLocation(Program[program::Impulse], "ImpulsePosition");
-    ForceLoc = glGetUniformLocation(Program[program::Impulse], "Force");
-}
-
 void dispatchSplatInk()
 {
     glBindProgramPipeline(Pipeline[pipeline::SplatInk]);
@@ -537,59 +398,138 @@ void renderquad(int tex)
     glBindProgramPipeline(0);
 }
 
-void runloop()
+class OglCompute : public ogle::Application
 {
-    while (!glfwWindowShouldClose(glfwWindow)){
-        glfwSetTime(0);
-        glfwPollEvents();
+public:
+    OglCompute()
+        : ogle::Application("ogl_compute")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = "OpenGL Compute, Fluids";
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.SwapInterval = 1;
+        TraceFile = "ogl_compute.trace.json";
+        Options.addOption("workgroup", "width and height of the compute shaders' work groups, 32 by default");
+    }
 
+protected:
+    /** sizes the fluid, the window stays as it is */
+    void setSize(int width, int height) override
+    {
+        textureObject::Width = width;
+        textureObject::Height = height;
+    }
+
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
+        if (!commandLine().unsignedValue("workgroup", WorkGroupSize) || WorkGroupSize == 0)
+            return false;
+        Benchmark.Params["workgroup"] = std::to_string(WorkGroupSize);
+        ogle::Context::setMouseButtonCallback(mouseCallback);
+
+        ogle::Startup::phase("extensions");
+        checkExtensions();
+        AdvectVelocityStats.init("advect velocity");
+        AdvectInkStats.init("advect ink");
+
+        ogle::Startup::phase("textures");
+        initTexture();
+
+        ogle::Startup::phase("gl objects");
+        createGLObjects();
+
+        ogle::Startup::phase("quad");
+        initFullScreenQuad();
+
+        ogle::Startup::phase("compute shaders");
+        initComputeShader("ink", program::SplatInk);
+        initComputeShader("advect", program::Advect);
+        initComputeShader("impulse", program::Impulse);
+        // the quad's and the compute programs compile side by side
+        if (!ogle::ProgramCache::finishAll())
+            return false;
+        initPipelines();
+        computeShaderStats();
+        if (textureObject::Width % LocalWorkGroupSize.x != 0 || textureObject::Height % LocalWorkGroupSize.y != 0)
+            cerr << "[!] the fluid size isn't a multiple of the work group size, the edges are left out" << endl;
+
+        MouseShaderLoc = glGetUniformLocation(Program[program::SplatInk], "InkSpot");
+        DeltaTimeLoc = glGetUniformLocation(Program[program::Advect], "DeltaTime");
+        ImpulsePositionLoc = glGetUniformLocation(Program[program::Impulse], "ImpulsePosition");
+        ForceLoc = glGetUniformLocation(Program[program::Impulse], "Force");
+        return true;
+    }
+
+    void frame() override
+    {
         if (CaptureMouse)
         {
-            double x,y;
-            glfwGetCursorPos(glfwWindow, &x, &y);
             MousePresses[1] = MousePresses[0];
-            MousePresses[0] = glm::ivec2((int)x,WindowHeight-(int)y);
+            MousePresses[0] = cursorTexel();
         }
 
         float dt = .1f;
         static int t0 = texture::Velocity0;
         static int t1 = texture::Velocity0;
-        dispatchAdvect(t0, t1, dt);
-        std::swap(t0, t1);
+        {
+            OGLE_PROFILE_ZONE("dispatch");
+            {
+                OGLE_PROFILE_ZONE("advect velocity");
+                AdvectVelocityStats.begin();
+                dispatchAdvect(t0, t1, dt);
+                AdvectVelocityStats.end();
+            }
+            std::swap(t0, t1);
+
+            {
+                OGLE_PROFILE_ZONE("splat ink");
+                dispatchSplatInk();
+            }
+            {
+                OGLE_PROFILE_ZONE("advect ink");
+                AdvectInkStats.begin();
+                dispatchAdvect(texture::SplatInk, t1, dt);
+                AdvectInkStats.end();
+            }
+            {
+                OGLE_PROFILE_ZONE("impulse");
+                dispatchImpulse(t1);
+            }
+            dispatchProject(t1, -1, 4);
+        }
 
-        dispatchSplatInk();
-        dispatchAdvect(texture::SplatInk, t1, dt);
-        dispatchImpulse(t1);
-        dispatchProject(t1, -1, 4);
-        renderquad(t1);
+        {
+            OGLE_PROFILE_ZONE("render");
+            renderquad(t1);
+        }
+    }
 
-        glfwSwapBuffers(glfwWindow);
+    void endFrame() override
+    {
+        AdvectVelocityStats.poll();
+        AdvectInkStats.poll();
     }
-}
 
-void shutdown()
-{
-    glDeleteTextures(::texture::MAX, Texture);
+    void shutdown() override
+    {
+        glDeleteTextures(::texture::MAX, Texture);
 
-    glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
-    
-    for (int i=0; i<::program::MAX; ++i)
-        glDeleteProgram(Program[i]);
+        glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
 
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
+        for (int i=0; i<::program::MAX; ++i)
+            glDeleteProgram(Program[i]);
 
-    ogle::Debug::shutdown();
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
 
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
+        AdvectVelocityStats.print();
+        AdvectVelocityStats.shutdown();
+        AdvectInkStats.print();
+        AdvectInkStats.shutdown();
+    }
+};
 
-int main( int argc, char *argv[])
-{
-    init(argc, argv);
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
\ No newline at end of file
+OGLE_APPLICATION(OglCompute)
\ No newline at end of file
@@ -4,7 +4,7 @@
     http://renderingpipeline.com/2012/03/gpu-rasterizer-pattern/
 */
 #include <iostream>
-#include <fstream>
+#include <map>
 #include <vector>
 #include <algorithm>
 
@@ -19,13 +19,14 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "debug.h"
+#include "application.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 800;
     int WindowHeight = 640;
 
@@ -115,60 +116,6 @@ namespace {
     };
 }
 
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, "Round Trip Demo", NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-}
-
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
-}
-
 /** makes sure that we can use all the extensions we need for this app */
 void checkExtensions()
 {
@@ -184,7 +131,7 @@ void checkExtensions()
         ,"GL_ARB_debug_output"                  // http://www.opengl.org/registry/specs/ARB/debug_output.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required but not supported on this machine." << endl;
     }
 }
@@ -196,91 +143,25 @@ void createGLObjects()
     glGenProgramPipelines(::pipeline::MAX, Pipeline);
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
+void initQuadShader()
 {
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "../common/quad.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "quad.frag";
+    Program[program::QUAD] = ogle::ProgramCache::submit(shaders, {}, true);
 }
 
-void checkShaderLinkage( const GLuint& program)
+void initQuadShaderAtomic()
 {
-    int status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "../common/quad.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "atomic_inc.frag";
+    Program[program::INC_ATOMIC] = ogle::ProgramCache::submit(shaders, {}, true);
 }
 
-void initQuadShader()
+void initPipelines()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "quad.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "quad.frag");
-
-    Program[program::QUAD] = glCreateProgram();
-    glProgramParameteri(Program[program::QUAD], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::QUAD], vert);
-    glAttachShader(Program[program::QUAD], frag);
-    glLinkProgram(Program[program::QUAD]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::QUAD]);
     glUseProgramStages(Pipeline[pipeline::QUAD], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::QUAD]);
-}
-
-void initQuadShaderAtomic()
-{
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "quad.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "atomic_inc.frag");
-
-    Program[program::INC_ATOMIC] = glCreateProgram();
-    glProgramParameteri(Program[program::INC_ATOMIC], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::INC_ATOMIC], vert);
-    glAttachShader(Program[program::INC_ATOMIC], frag);
-    glLinkProgram(Program[program::INC_ATOMIC]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::INC_ATOMIC]);
     glUseProgramStages(Pipeline[pipeline::INC_ATOMIC], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::INC_ATOMIC]);
 }
 
@@ -335,38 +216,16 @@ void initAtomicUniform()
 
 void initFullScreenQuad()
 {
+    // the programs compile while the buffers are set up
     initQuadShader();
     initQuadShaderAtomic();
     initQuadGeometry();
     initAtomicBuffers();
+    ogle::ProgramCache::finishAll();
+    initPipelines();
     initAtomicUniform();
 }
 
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
-void init( int argc, char *argv[])
-{
-    setDataDir(argc, argv);
-
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-    ogle::Debug::init();
-
-    createGLObjects();
-
-    initFullScreenQuad();
-}
-
 void increment_counter()
 {
     // Clear out the atmoic counter
@@ -419,36 +278,60 @@ void renderquad()
     glBindProgramPipeline(0);
 }
 
-void runloop()
+class RasterPattern : public ogle::Application
 {
-    while (!glfwWindowShouldClose(glfwWindow)){
-        increment_counter();
-        renderquad();
-        glfwSwapBuffers(glfwWindow);
-        glfwPollEvents();
+public:
+    RasterPattern()
+        : ogle::Application("raster_pattern")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = "Round Trip Demo";
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.SwapInterval = 1;
     }
-}
 
-void shutdown()
-{
-    glDeleteFramebuffers(1, &framebuffer::FramebufferName);
-    glDeleteTextures(1, &framebuffer::TextureName);
+protected:
+    void setSize(int width, int height) override
+    {
+        ogle::Application::setSize(width, height);
+        WindowWidth = width;
+        WindowHeight = height;
+        framebuffer::Width = width;
+        framebuffer::Height = height;
+    }
 
-    glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
 
-    ogle::Debug::shutdown();
+        ogle::Startup::phase("extensions");
+        checkExtensions();
 
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
+        ogle::Startup::phase("gl objects");
+        createGLObjects();
 
-int main( int argc, char *argv[])
-{
-    init(argc, argv);
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
\ No newline at end of file
+        ogle::Startup::phase("quad");
+        initFullScreenQuad();
+        return true;
+    }
+
+    void frame() override
+    {
+        increment_counter();
+        renderquad();
+    }
+
+    void shutdown() override
+    {
+        glDeleteFramebuffers(1, &framebuffer::FramebufferName);
+        glDeleteTextures(1, &framebuffer::TextureName);
+
+        glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
+    }
+};
+
+OGLE_APPLICATION(RasterPattern)
\ No newline at end of file
@@ -2,7 +2,7 @@
     Quick little experiment to see how long it takes to render to a texture and read it back.
 */
 #include <iostream>
-#include <fstream>
+#include <map>
 #include <vector>
 #include <algorithm>
 
@@ -17,13 +17,16 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "debug.h"
+#include "application.h"
+#include "gpumemory.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "startup.h"
 
 using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 800;
     int WindowHeight = 640;
 
@@ -82,6 +85,9 @@ namespace {
         GLint  InternalFormat = GL_RED;
         GLint  Format = GL_RED;
         GLint  Type = GL_UNSIGNED_INT;
+
+        // read back into the same memory every frame instead of new[]/delete[]
+        std::vector<unsigned int> Readback;
     }
 
     GLuint VAO[vao::MAX] = {0};
@@ -100,60 +106,6 @@ namespace {
     };
 }
 
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, "Round Trip Demo", NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-}
-
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
-}
-
 /** makes sure that we can use all the extensions we need for this app */
 void checkExtensions()
 {
@@ -169,7 +121,7 @@ void checkExtensions()
         ,"GL_ARB_debug_output"                  // http://www.opengl.org/registry/specs/ARB/debug_output.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required but not supported on this machine." << endl;
     }
 }
@@ -187,6 +139,7 @@ void initTexture()
     unsigned int *data = new unsigned int[size];
     for (int i=0; i<size; i+=4)
         data[i] = 0;
+    framebuffer::Readback.resize(size);
 
     // Nvidia has a bug that if these were intergal textures
     // GL_LINEAR cannot be used and must be GL_NEAREST
@@ -204,6 +157,7 @@ void initTexture()
         framebuffer::Type,
         data
     );
+    OGLE_GPU_TEXTURE(framebuffer::TextureName, framebuffer::InternalFormat, framebuffer::Width, framebuffer::Height, "round trip target");
 
     if (glGetError() != GL_NONE) assert(0);
 
@@ -270,12 +224,13 @@ void checkFBO()
 void initFramebuffer()
 {
     glGenFramebuffers(1, &framebuffer::FramebufferName);
+    OGLE_GPU_FRAMEBUFFER(framebuffer::FramebufferName, "round trip");
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer::FramebufferName);
     glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebuffer::TextureName, 0);
 
     // check for completeness
     checkFBO();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ogle::Context::defaultFramebuffer());
 }
 
 void bindFBO()
@@ -295,74 +250,12 @@ void createGLObjects()
     glGenProgramPipelines(::pipeline::MAX, Pipeline);
 }
 
-GLuint createShader(GLuint type, const std::string &fileName)
-{
-    GLuint shader = glCreateShader(type);
-
-    // load up the file
-    std::ifstream inf(fileName);
-    if (!inf.is_open()) {
-        cerr << "Failed to open " << fileName << endl;
-        assert(0);
-    }
-
-    std::string source;
-    inf.seekg(0, std::ios::end);
-    source.resize(inf.tellg());
-    inf.seekg(0, std::ios::beg);
-    inf.read(&source[0], source.size());
-    inf.close();
-
-    const char *c_str = source.c_str();
-    glShaderSource(shader, 1, &c_str, NULL);
-    glCompileShader(shader);
-
-    int status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetShaderInfoLog(shader, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Compile with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-
-    return shader;
-}
-
-void checkShaderLinkage( const GLuint& program)
-{
-    int status;
-    glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        const int maxLen = 1000;
-        int len;
-        char errorBuffer[maxLen]{0};
-        glGetProgramInfoLog(program, maxLen, &len, errorBuffer);
-        std::cerr   << "Shader Linked with erros:\n"
-                    << errorBuffer << std::endl;
-        assert(0);
-    }
-}
-
 void initQuadShader()
 {
-    GLuint vert = createShader(GL_VERTEX_SHADER, DataDirectory + "quad.vert");
-    GLuint frag = createShader(GL_FRAGMENT_SHADER, DataDirectory + "quad.frag");
-
-    Program[program::QUAD] = glCreateProgram();
-    glProgramParameteri(Program[program::QUAD], GL_PROGRAM_SEPARABLE, GL_TRUE);
-    glAttachShader(Program[program::QUAD], vert);
-    glAttachShader(Program[program::QUAD], frag);
-    glLinkProgram(Program[program::QUAD]);
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-
-    checkShaderLinkage(Program[program::QUAD]);
+    std::map<GLuint, std::string> shaders;
+    shaders[GL_VERTEX_SHADER] = DataDirectory + "../common/quad.vert";
+    shaders[GL_FRAGMENT_SHADER] = DataDirectory + "quad.frag";
+    Program[program::QUAD] = ogle::ProgramCache::build(shaders, {}, true);
     glUseProgramStages(Pipeline[pipeline::QUAD], GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, Program[program::QUAD]);
 }
 
@@ -388,34 +281,6 @@ void initFullScreenQuad()
     initQuadGeometry();
 }
 
-void setDataDir(int argc, char *argv[])
-{
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
-}
-
-void init( int argc, char *argv[])
-{
-    setDataDir(argc, argv);
-
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-    ogle::Debug::init();
-
-    initTexture();
-    initFramebuffer();
-
-    createGLObjects();
-
-    initFullScreenQuad();
-}
-
 void renderquad()
 {
     // the main goal of this render pass is to write to the atomic counter, turn off what we are not going to use.
@@ -437,49 +302,78 @@ void renderquad()
 
     glBindVertexArray(0);
     glBindProgramPipeline(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ogle::Context::defaultFramebuffer());
 }
 
-void runloop()
+class RoundTrip : public ogle::Application
 {
-    while (!glfwWindowShouldClose(glfwWindow)){
-        glfwSetTime(0);
-        renderquad();
-
-        unsigned int size = framebuffer::Width * framebuffer::Height * framebuffer::ComponentCount;
-        unsigned int *data = new unsigned int[size];
-        glBindTexture(GL_TEXTURE_2D, framebuffer::TextureName);
-        glGetTexImage(GL_TEXTURE_2D, 0, framebuffer::Format, framebuffer::Type, (GLvoid*)data);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        double time = glfwGetTime();
-        cout << "Round trip time: " << time*1000.0 << " milliseconds" << endl;
-        delete [] data;
+public:
+    RoundTrip()
+        : ogle::Application("round_trip")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = "Round Trip Demo";
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.SwapInterval = 1;
+        TraceFile = "round_trip.trace.json";
+    }
 
-        glfwSwapBuffers(glfwWindow);
-        glfwPollEvents();
+protected:
+    void setSize(int width, int height) override
+    {
+        ogle::Application::setSize(width, height);
+        WindowWidth = width;
+        WindowHeight = height;
+        framebuffer::Width = width;
+        framebuffer::Height = height;
     }
-}
 
-void shutdown()
-{
-    glDeleteFramebuffers(1, &framebuffer::FramebufferName);
-    glDeleteTextures(1, &framebuffer::TextureName);
+    bool init() override
+    {
+        DataDirectory = dataDirectory();
 
-    glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
+        ogle::Startup::phase("extensions");
+        checkExtensions();
 
-    ogle::Debug::shutdown();
+        ogle::Startup::phase("framebuffer");
+        initTexture();
+        initFramebuffer();
 
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
-}
+        ogle::Startup::phase("gl objects");
+        createGLObjects();
 
-int main( int argc, char *argv[])
-{
-    init(argc, argv);
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
\ No newline at end of file
+        ogle::Startup::phase("quad");
+        initFullScreenQuad();
+        return true;
+    }
+
+    void frame() override
+    {
+        OGLE_PROFILE_ZONE("round trip");
+        {
+            OGLE_PROFILE_ZONE("render");
+            renderquad();
+        }
+
+        OGLE_PROFILE_ZONE("readback");
+        glBindTexture(GL_TEXTURE_2D, framebuffer::TextureName);
+        glGetTexImage(GL_TEXTURE_2D, 0, framebuffer::Format, framebuffer::Type, (GLvoid*)framebuffer::Readback.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void shutdown() override
+    {
+        ogle::GpuMemory::release(ogle::GpuMemory::FRAMEBUFFER, framebuffer::FramebufferName);
+        ogle::GpuMemory::release(ogle::GpuMemory::TEXTURE, framebuffer::TextureName);
+        glDeleteFramebuffers(1, &framebuffer::FramebufferName);
+        glDeleteTextures(1, &framebuffer::TextureName);
+
+        glDeleteProgramPipelines(::pipeline::MAX, Pipeline);
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
+    }
+};
+
+OGLE_APPLICATION(RoundTrip)
\ No newline at end of file
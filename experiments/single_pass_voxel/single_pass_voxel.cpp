@@ -24,7 +24,11 @@
 #include <bitset>
 
 #include "common.h"
-#include "debug.h"
+#include "application.h"
+#include "pipelinestatistics.h"
+#include "profiler.h"
+#include "residency.h"
+#include "startup.h"
 #include "test_xor.h"
 #include "test_integer_texture.h"
 #include "objloader.h"
@@ -33,10 +37,10 @@ using namespace std;
 
 namespace {
     std::string DataDirectory; // ends with a forward slash
-    GLFWwindow *glfwWindow;
     int WindowWidth = 512;
     int WindowHeight = 512;
     std::string WindowTitle = "SinglePass Voxelization";
+    std::string MeshFile = "bunny.obj"; // --mesh, in data/geometry
 
     namespace vao
     {
@@ -58,6 +62,20 @@ namespace {
         };
     }
 
+    // what render_to_screen() shows, one method each
+    namespace show
+    {
+        enum type
+        {
+            DENSITY,
+            VOXEL,
+            MESH,
+            DENSITY_NORMALS,
+            MAX
+        };
+    }
+    show::type Show = show::DENSITY;
+
     namespace program
     {
         enum type
@@ -106,12 +124,57 @@ namespace {
     ogle::Framebuffer VoxelData;
     ogle::ShaderProgram VoxelShader;
 
+    // the Frame block in frame.glsl, std140
+    struct FrameBlock
+    {
+        glm::mat4 WorldViewProjection;
+        glm::mat4 WorldView;
+        glm::vec4 LightPos;
+        glm::vec2 DepthExtents;
+        glm::vec2 Padding;
+    };
+    OGLE_STD140_OFFSET(FrameBlock, WorldView, 64);
+    OGLE_STD140_OFFSET(FrameBlock, LightPos, 128);
+    OGLE_STD140_OFFSET(FrameBlock, DepthExtents, 144);
+    OGLE_STD140_SIZE(FrameBlock, 160);
+
+    // written once in frame() and bound for every pass, instead of glUniform* before each draw
+    const GLuint FrameBinding = 0;
+    ogle::UniformRing FrameUniforms;
+
+    // slabs the depth range is cut into, compiled into the voxel and density normal shaders (depth_slab.glsl)
+    const int VoxelSlabs = 2;
+
     ogle::Framebuffer DensityData;
 
+    ogle::PipelineStatistics XorPassStats;
+
     GLuint BitMask;
     GLuint DensityBitMask;
     GLuint DensityColumnBitMask;
 
+    // Residency handles, use()d before a pass binds them; a pass the view doesn't need
+    // leaves its resources to be evicted when another view runs under --vram-budget
+    std::vector<int> MeshResidency;
+    std::vector<int> BitMaskResidency;
+    std::vector<int> DensityBitMaskResidency;
+    std::vector<int> VoxelResidency;
+    std::vector<int> DensityResidency;
+
+    // created the first time a render pass needs them, only the density normals view needs all of them
+    ogle::LazyInit BlitVoxelProgram;
+    ogle::LazyInit BlitDensityProgram;
+    ogle::LazyInit MeshProgram;
+    ogle::LazyInit VoxelProgram;
+    ogle::LazyInit DensityProgram;
+    ogle::LazyInit DensityNormalProgram;
+    ogle::LazyInit BitMaskTexture;
+    ogle::LazyInit DensityBitMaskTextures;
+
+    // read and parsed on a worker thread while the window and shaders are set up
+    ogle::ObjLoader MeshLoader;
+    ogle::LazyInit MeshGeometry;
+
     /*
     struct Renderable
     {
@@ -143,60 +206,6 @@ namespace {
     */
 }
 
-void errorCallback(int error, const char* description)
-{
-    cerr << description << endl;
-}
-
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
-
-void initGLFW()
-{
-    glfwSetErrorCallback(errorCallback);
-
-    /* Init GLFW */
-    if( !glfwInit() )
-        exit( EXIT_FAILURE );
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-
-    glfwWindow = glfwCreateWindow( WindowWidth, WindowHeight, WindowTitle.c_str(), NULL, NULL );
-    if (!glfwWindow)
-    {
-        glfwTerminate();
-        exit( EXIT_FAILURE );
-    }
-
-    glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval( 1 );
-
-    glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
-
-    glfwSetTime( 0.0 );
-    glfwSetKeyCallback(glfwWindow, keyCallback);
-}
-
-void initGLEW()
-{
-    glewExperimental=GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        /// if it fails here, its becuase there is no current opengl version,
-        /// don't call glewInit() until after a context has been made current.
-        fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
-        exit( EXIT_FAILURE );
-    }
-    glGetError(); // GLEW has problems, clear that one that it creates.
-}
-
 /** makes sure that we can use all the extensions we need for this app */
 void checkExtensions()
 {
@@ -210,9 +219,11 @@ void checkExtensions()
                                                 // for RGBA32UI_EXT
         // default binding values in shaders for textures
         ,"GL_ARB_shading_language_420pack"      // http://www.opengl.org/registry/specs/ARB/shading_language_420pack.txt
+        // the per frame uniforms
+        ,"GL_ARB_uniform_buffer_object"         // http://www.opengl.org/registry/specs/ARB/uniform_buffer_object.txt
     };
     for (auto extension : extensions) {
-        if (glfwExtensionSupported(extension.c_str()) == GL_FALSE)
+        if (ogle::Context::extensionSupported(extension.c_str()) == GL_FALSE)
             cerr << extension << " - is required but not supported on this machine." << endl;
     }
 }
@@ -223,28 +234,49 @@ void createGLObjects()
     glGenBuffers(::buffer::MAX, Buffer);
 }
 
-void initFullScreenQuad()
+void addResidentTexture(std::vector<int>& handles, GLuint texture, GLint internalFormat, GLsizei width, GLsizei height,
+                        GLenum format, GLenum type, const char* label)
+{
+    int handle = ogle::Residency::addTexture(texture, internalFormat, width, height, format, type, label);
+    if (handle != ogle::Residency::InvalidHandle)
+        handles.push_back(handle);
+}
+
+void addResidentFramebuffer(std::vector<int>& handles, const ogle::Framebuffer& framebuffer, const char* label)
+{
+    for (auto texture : framebuffer.TextureNames)
+        addResidentTexture(handles, texture, framebuffer.InternalFormat, framebuffer.Width, framebuffer.Height,
+                           framebuffer.Format, framebuffer.Type, label);
+}
+
+/** brings back what was evicted before the pass binds it */
+void useResident(const std::vector<int>& handles)
+{
+    for (int handle : handles)
+        ogle::Residency::use(handle);
+}
+
+void initBlitVoxelShader()
 {
-    Quad.init();
     std::map<GLuint, std::string> shaders;
     shaders[GL_VERTEX_SHADER] = DataDirectory + "quad.vert";
     shaders[GL_FRAGMENT_SHADER] = DataDirectory + "quad.frag";
     FS_Shader.init(shaders);
+}
 
+void initBlitDensityShader()
+{
+    std::map<GLuint, std::string> shaders;
     shaders[GL_VERTEX_SHADER] = DataDirectory + "quad.vert";
     shaders[GL_FRAGMENT_SHADER] = DataDirectory + "blit_density.frag";
     Density_FS_Shader.init(shaders);
 }
 
-void setDataDir(int argc, char *argv[])
+void initFullScreenQuad()
 {
-    // get base directory for reading in files
-    std::string path = argv[0];
-    std::replace(path.begin(), path.end(), '\\', '/');
-    size_t dir_idx = path.rfind("/")+1;
-    std::string exe_dir = path.substr(0, dir_idx);
-    std::string exe_name = path.substr(dir_idx);
-    DataDirectory = exe_dir + "../data/" + exe_name + "/";
+    Quad.init();
+    BlitVoxelProgram.init("blit voxel program", initBlitVoxelShader);
+    BlitDensityProgram.init("blit density program", initBlitDensityShader);
 }
 
 BoundingBox get_bounding_box(const std::vector<glm::vec3>& positions)
@@ -262,22 +294,35 @@ BoundingBox get_bounding_box(const std::vector<glm::vec3>& positions)
     return box;
 }
 
+/** make sure frame.glsl still agrees with FrameBlock */
+void checkFrameBlock(ogle::ShaderProgram& shader)
+{
+    ogle::BlockLayout layout;
+    if (!shader.block("Frame", layout))
+        return;
+    layout.matches({
+        OGLE_BLOCK_MEMBER(FrameBlock, WorldViewProjection),
+        OGLE_BLOCK_MEMBER(FrameBlock, WorldView),
+        OGLE_BLOCK_MEMBER(FrameBlock, LightPos),
+        OGLE_BLOCK_MEMBER(FrameBlock, DepthExtents)
+    }, sizeof(FrameBlock));
+}
+
 void initMeshShaders()
 {
     std::map<GLuint, std::string> shaders;
     shaders[GL_VERTEX_SHADER] = DataDirectory + "mesh.vert";
     shaders[GL_FRAGMENT_SHADER] = DataDirectory + "mesh.frag";
     MeshShader.init(shaders);
+    checkFrameBlock(MeshShader);
 }
 
-void initMesh()
+/** runs on a worker thread, no GL in here */
+void loadMesh()
 {
-    // load up mesh
-    ogle::ObjLoader loader;
-    loader.load(DataDirectory + "../geometry/bunny.obj");
+    ogle::ObjLoader& loader = MeshLoader;
+    loader.load(DataDirectory + "../geometry/" + MeshFile);
     VertCount = (GLuint)loader.getVertCount();
-    size_t position_attribute_size = loader.getPositionAttributeSize();
-    size_t position_bytes = VertCount * position_attribute_size;
 
     Positions.resize(VertCount);
     const float* positions = loader.getPositions();
@@ -285,8 +330,6 @@ void initMesh()
         Positions[i] = glm::vec3(positions[i*3+0], positions[i*3+1], positions[i*3+2]);
     }
 
-    size_t normal_attribute_size = loader.getNormalAttributeSize();
-    size_t normal_bytes = VertCount * normal_attribute_size;
     Normals.resize(VertCount);
     const float* normals = loader.getNormals();
     for (size_t i=0; i<VertCount; ++i){
@@ -294,10 +337,14 @@ void initMesh()
     }
 
     IndexCount = (GLuint)loader.getIndexCount();
-    size_t index_attribute_size = loader.getIndexAttributeSize();
-    size_t index_bytes = IndexCount * index_attribute_size;
-
     SceneBoundingBox = get_bounding_box(Positions);
+}
+
+void uploadMesh()
+{
+    ogle::ObjLoader& loader = MeshLoader;
+    size_t position_bytes = VertCount * loader.getPositionAttributeSize();
+    size_t index_bytes = IndexCount * loader.getIndexAttributeSize();
 
     // get mesh info into the gpu
     glBindVertexArray(VAO[vao::MESH]);
@@ -316,7 +363,23 @@ void initMesh()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Buffer[buffer::MESH0_INDICES]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, (const GLvoid*)elements, GL_STATIC_DRAW);
     glFinish();
-    initMeshShaders();
+
+    const struct { GLuint Name; size_t Bytes; const char* Label; } buffers[] = {
+        { Buffer[buffer::MESH0_POSITIONS], position_bytes, "mesh positions" },
+        { Buffer[buffer::MESH0_NORMALS], position_bytes, "mesh normals" },
+        { Buffer[buffer::MESH0_INDICES], index_bytes, "mesh indices" },
+    };
+    for (const auto& b : buffers) {
+        int handle = ogle::Residency::addBuffer(b.Name, b.Bytes, b.Label);
+        if (handle != ogle::Residency::InvalidHandle)
+            MeshResidency.push_back(handle);
+    }
+}
+
+void initMesh()
+{
+    MeshGeometry.init("bunny mesh", uploadMesh, loadMesh);
+    MeshProgram.init("mesh program", initMeshShaders);
 }
 
 void initVoxelShader()
@@ -324,7 +387,8 @@ void initVoxelShader()
     std::map<GLuint, std::string> shaders;
     shaders[GL_VERTEX_SHADER] = DataDirectory + "voxel.vert";
     shaders[GL_FRAGMENT_SHADER] = DataDirectory + "voxel.frag";
-    VoxelShader.init(shaders);
+    VoxelShader.init(shaders, ogle::ShaderDefines().set("VOXEL_SLABS", VoxelSlabs));
+    checkFrameBlock(VoxelShader);
 }
 
 void initBitMaskTexture()
@@ -392,6 +456,8 @@ void initBitMaskTexture()
     glFinish();
     delete [] data;
     if (glGetError() != GL_NONE) assert(0);
+
+    addResidentTexture(BitMaskResidency, BitMask, GL_RGBA32UI, width, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, "bitmask");
 }
 
 void initDensityShader()
@@ -407,7 +473,8 @@ void initDensityNormalShader()
     std::map<GLuint, std::string> shaders;
     shaders[GL_VERTEX_SHADER] = DataDirectory + "mesh.vert";
     shaders[GL_FRAGMENT_SHADER] = DataDirectory + "density_normal.frag";
-    DensityNormalShader.init(shaders);
+    DensityNormalShader.init(shaders, ogle::ShaderDefines().set("VOXEL_SLABS", VoxelSlabs));
+    checkFrameBlock(DensityNormalShader);
 }
 
 void initDensityBitMaskTexture()
@@ -477,6 +544,8 @@ void initDensityBitMaskTexture()
     glFinish();
     delete [] data;
     if (glGetError() != GL_NONE) assert(0);
+
+    addResidentTexture(DensityBitMaskResidency, DensityBitMask, GL_RGBA32UI, width, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, "density bitmask");
 }
 
 void initDensityColBitMaskTexture()
@@ -578,6 +647,8 @@ void initDensityColBitMaskTexture()
     glFinish();
     delete [] data;
     if (glGetError() != GL_NONE) assert(0);
+
+    addResidentTexture(DensityBitMaskResidency, DensityColumnBitMask, GL_RGBA32UI, width, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, "density column bitmask");
 }
 
 void initVoxel()
@@ -602,30 +673,17 @@ void initVoxel()
     DensityData.TextureNames.resize(VoxelData.TextureNames.size() * 2);
     ogle::initFramebuffer(DensityData);
 
-    initVoxelShader();
-    initDensityShader();
-    initDensityNormalShader();
-    initBitMaskTexture();
-    initDensityBitMaskTexture();
-    initDensityColBitMaskTexture();
-}
-
-void init( int argc, char *argv[])
-{
-    setDataDir(argc, argv);
-
-    initGLFW();
-    initGLEW();
-    checkExtensions();
-    ogle::Debug::init();
-
-    createGLObjects();
-
-    initFullScreenQuad();
-    initMesh();
-    initVoxel();
-    SceneTransform = glm::mat4(1.0f);
-    ProjectionData.Fov = 1.0f;
+    addResidentFramebuffer(VoxelResidency, VoxelData, "voxels");
+    addResidentFramebuffer(DensityResidency, DensityData, "density");
+
+    VoxelProgram.init("voxel program", initVoxelShader);
+    DensityProgram.init("density program", initDensityShader);
+    DensityNormalProgram.init("density normal program", initDensityNormalShader);
+    BitMaskTexture.init("bitmask texture", initBitMaskTexture);
+    DensityBitMaskTextures.init("density bitmask textures", []() {
+        initDensityBitMaskTexture();
+        initDensityColBitMaskTexture();
+    });
 }
 
 glm::mat4 center_scene_in_camera()
@@ -647,15 +705,10 @@ void render_mesh_to_screen()
         glEnable(GL_CULL_FACE);
     }
 
+    MeshProgram.require();
+    MeshGeometry.require();
+    useResident(MeshResidency);
     MeshShader.bind();
-    glUniformMatrix4fv(MeshShader.Uniforms["WorldViewProjection"], 1, false, glm::value_ptr(MVP));
-    glUniformMatrix4fv(MeshShader.Uniforms["WorldView"], 1, false, glm::value_ptr(MV));
-
-    // add a light to the scene
-    {
-        glm::vec3 light_position = SceneBoundingBox.Extents;
-        glUniform3fv(MeshShader.Uniforms["LightPos"], 1, glm::value_ptr(light_position));
-    }
 
     glBindVertexArray(VAO[vao::MESH]);
     glDrawRangeElements(GL_TRIANGLES, 0, VertCount, IndexCount, GL_UNSIGNED_INT, 0);
@@ -665,6 +718,8 @@ void render_fs_voxel()
 {
     glEnable(GL_BLEND);
 
+    BlitVoxelProgram.require();
+    useResident(VoxelResidency);
     FS_Shader.bind();
 
     glActiveTexture(GL_TEXTURE0);
@@ -679,6 +734,8 @@ void render_fs_density()
 {
     glEnable(GL_BLEND);
 
+    BlitDensityProgram.require();
+    useResident(DensityResidency);
     Density_FS_Shader.bind();
 
     glActiveTexture(GL_TEXTURE0);
@@ -696,6 +753,12 @@ void render_mesh_normals_from_density()
         glEnable(GL_CULL_FACE);
     }
 
+    DensityNormalProgram.require();
+    DensityBitMaskTextures.require();
+    MeshGeometry.require();
+    useResident(DensityResidency);
+    useResident(DensityBitMaskResidency);
+    useResident(MeshResidency);
     DensityNormalShader.bind();
 
     glActiveTexture(GL_TEXTURE0);
@@ -707,16 +770,6 @@ void render_mesh_normals_from_density()
     glActiveTexture(GL_TEXTURE3);
     glBindTexture(GL_TEXTURE_2D, DensityColumnBitMask);
 
-    glUniformMatrix4fv(DensityNormalShader.Uniforms["WorldViewProjection"], 1, false, glm::value_ptr(MVP));
-    glUniformMatrix4fv(DensityNormalShader.Uniforms["WorldView"], 1, false, glm::value_ptr(MV));
-    glUniform2f(DensityNormalShader.Uniforms["DepthExtents"], ProjectionData.Near, ProjectionData.Far);
-
-    // add a light to the scene
-    {
-        glm::vec3 light_position = SceneBoundingBox.Extents;
-        glUniform3fv(DensityNormalShader.Uniforms["LightPos"], 1, glm::value_ptr(light_position));
-    }
-
     glBindVertexArray(VAO[vao::MESH]);
     glDrawRangeElements(GL_TRIANGLES, 0, VertCount, IndexCount, GL_UNSIGNED_INT, 0);
 
@@ -728,22 +781,35 @@ void render_mesh_normals_from_density()
 
 void render_to_screen()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, ogle::Context::defaultFramebuffer());
     glViewport( 0, 0, (GLsizei)WindowWidth, (GLsizei)WindowHeight );
     glClearColor( 0.1f,0.1f,0.2f,0 );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    // render_mesh_to_screen();
-    // render_fs_voxel();
-     render_fs_density();
-//    render_mesh_normals_from_density();
+    switch (Show) {
+        case show::VOXEL:
+            render_fs_voxel();
+            break;
+        case show::MESH:
+            render_mesh_to_screen();
+            break;
+        case show::DENSITY_NORMALS:
+            render_mesh_normals_from_density();
+            break;
+        default:
+            render_fs_density();
+            break;
+    }
 }
 
 void render_mesh_to_voxel()
 {
+    VoxelProgram.require();
+    BitMaskTexture.require();
+    MeshGeometry.require();
+    useResident(BitMaskResidency);
+    useResident(MeshResidency);
     VoxelShader.bind();
-    glUniformMatrix4fv(VoxelShader.Uniforms["WorldViewProjection"], 1, false, glm::value_ptr(MVP));
-    glUniform2f(VoxelShader.Uniforms["DepthExtents"], ProjectionData.Near, ProjectionData.Far);
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, BitMask);
@@ -754,6 +820,7 @@ void render_mesh_to_voxel()
 
 void render_to_voxel()
 {
+    useResident(VoxelResidency);
     glBindFramebuffer(GL_FRAMEBUFFER, VoxelData.FramebufferName);
     glViewport( 0, 0, VoxelData.Width, VoxelData.Height );
 
@@ -771,7 +838,9 @@ void render_to_voxel()
         glLogicOp(GL_XOR);
     }
 
+    XorPassStats.begin();
     render_mesh_to_voxel();
+    XorPassStats.end();
 
     // disable render state
     {
@@ -783,6 +852,8 @@ void render_to_voxel()
 
 void render_to_density()
 {
+    useResident(DensityResidency);
+    useResident(VoxelResidency);
     glBindFramebuffer(GL_FRAMEBUFFER, DensityData.FramebufferName);
     glViewport( 0, 0, DensityData.Width, DensityData.Height );
 
@@ -791,6 +862,7 @@ void render_to_density()
     for (size_t i=0; i<buffer_count; ++i)
         glClearBufferuiv(GL_COLOR, i, color);
 
+    DensityProgram.require();
     DensityShader.bind();
     for (size_t i=0; i<VoxelData.TextureNames.size(); ++i){
         glActiveTexture(GL_TEXTURE0+i);
@@ -839,18 +911,23 @@ void render_to_density()
 
 void render()
 {
-    // double before = glfwGetTime();
-    // double after = glfwGetTime();
+    // double before = ogle::Context::time();
+    // double after = ogle::Context::time();
     // double diff = after - before;
     // cout << "CPU Voxelization time: " << diff*1000.0 << " ms" << endl;
 
-    render_to_voxel();
-    render_to_density();
+    // the mesh view needs neither pass, the voxel view only the first
+    if (Show != show::MESH)
+        render_to_voxel();
+    if (Show == show::DENSITY || Show == show::DENSITY_NORMALS)
+        render_to_density();
     render_to_screen();
 }
 
 void update(double time_passed)
 {
+    // the camera is fit around the mesh
+    MeshGeometry.require();
     glm::mat4 y_rot = glm::rotate(SceneTransform, /*0.0f*/float(time_passed), glm::vec3(0,1,0));
     View = center_scene_in_camera();
 
@@ -867,42 +944,20 @@ void update(double time_passed)
     MVP =  Projection * MV;
 }
 
-void runloop()
+/** the one upload of the frame, every pass after it reads the same Frame block */
+void upload_frame_uniforms()
 {
-    while (!glfwWindowShouldClose(glfwWindow)){
-        update(glfwGetTime());
-        render();
-        glfwPollEvents();
-        glfwSwapBuffers(glfwWindow);
-    }
-}
-
-void shutdown()
-{
-    for (const auto& p : Program)
-        glDeleteProgram(p);
-
-    Quad.shutdown();
-    FS_Shader.shutdown();
-    Density_FS_Shader.shutdown();
-    MeshShader.shutdown();
-    VoxelShader.shutdown();
-    DensityShader.shutdown();
-    DensityNormalShader.shutdown();
-
-
-    VoxelData.shutdown();
-    DensityData.shutdown();
-    glDeleteTextures(1, &BitMask);
-
-    glDeleteBuffers(::buffer::MAX, Buffer);
-    glDeleteVertexArrays(::vao::MAX, VAO);
-
-    ogle::Debug::shutdown();
-
-    glfwSetWindowShouldClose(glfwWindow, 1);
-    glfwDestroyWindow(glfwWindow);
-    glfwTerminate();
+    FrameUniforms.beginFrame();
+    size_t offset = 0;
+    FrameBlock* frame = FrameUniforms.allocate<FrameBlock>(offset);
+    if (frame == nullptr)
+        return;
+
+    frame->WorldViewProjection = MVP;
+    frame->WorldView = MV;
+    frame->LightPos = glm::vec4(SceneBoundingBox.Extents, 1.0f);   // the light is at a corner of the scene
+    frame->DepthExtents = glm::vec2(ProjectionData.Near, ProjectionData.Far);
+    FrameUniforms.bind(FrameBinding, offset, sizeof(FrameBlock));
 }
 
 void run_tests()
@@ -920,11 +975,104 @@ void run_tests()
     Test_XOR_Ops.shutdown();
 }
 
-int main( int argc, char *argv[])
+class SinglePassVoxel : public ogle::Application
 {
-    init(argc, argv);
-    // run_tests();
-    runloop();
-    shutdown();
-    exit( EXIT_SUCCESS );
-}
+public:
+    SinglePassVoxel()
+        : ogle::Application("single_pass_voxel")
+    {
+        Config.Width = WindowWidth;
+        Config.Height = WindowHeight;
+        Config.Name = WindowTitle;
+        Config.MinorVersion = 3;
+        Config.ForwardCompatible = true;
+        Config.SwapInterval = 1;
+        Options.addOption("mesh", "obj file in data/geometry to voxelize, bunny.obj by default");
+        Methods = { "density", "voxel", "mesh", "density_normals" };
+    }
+
+protected:
+    void setMethod(size_t method) override
+    {
+        Show = (show::type)method;
+    }
+
+    void setSize(int width, int height) override
+    {
+        ogle::Application::setSize(width, height);
+        WindowWidth = width;
+        WindowHeight = height;
+    }
+
+    bool load() override
+    {
+        DataDirectory = dataDirectory();
+        MeshFile = commandLine().value("mesh", MeshFile);
+        Benchmark.Params["mesh"] = MeshFile;
+        // only needs DataDirectory, gets the file parsing going before anything else
+        initMesh();
+        return true;
+    }
+
+    bool init() override
+    {
+        ogle::Startup::phase("extensions");
+        checkExtensions();
+        XorPassStats.init("render_to_voxel xor pass");
+
+        ogle::Startup::phase("gl objects");
+        createGLObjects();
+        if (!FrameUniforms.init(3, sizeof(FrameBlock), false, "frame uniforms"))
+            return false;
+
+        ogle::Startup::phase("quad");
+        initFullScreenQuad();
+        ogle::Startup::phase("voxel framebuffers");
+        initVoxel();
+        SceneTransform = glm::mat4(1.0f);
+        ProjectionData.Fov = 1.0f;
+        // run_tests();
+        return true;
+    }
+
+    void frame() override
+    {
+        update(ogle::Context::time());
+        upload_frame_uniforms();
+        render();
+    }
+
+    void endFrame() override
+    {
+        FrameUniforms.endFrame();
+        XorPassStats.poll();
+    }
+
+    void shutdown() override
+    {
+        MeshGeometry.shutdown();
+        for (const auto& p : Program)
+            glDeleteProgram(p);
+
+        Quad.shutdown();
+        FS_Shader.shutdown();
+        Density_FS_Shader.shutdown();
+        MeshShader.shutdown();
+        VoxelShader.shutdown();
+        DensityShader.shutdown();
+        DensityNormalShader.shutdown();
+
+        VoxelData.shutdown();
+        DensityData.shutdown();
+        glDeleteTextures(1, &BitMask);
+
+        glDeleteBuffers(::buffer::MAX, Buffer);
+        glDeleteVertexArrays(::vao::MAX, VAO);
+        FrameUniforms.shutdown();
+
+        XorPassStats.print();
+        XorPassStats.shutdown();
+    }
+};
+
+OGLE_APPLICATION(SinglePassVoxel)
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "test_integer_texture.h"
+#include "context.h"
 
 #include <iostream>
 
@@ -127,7 +128,7 @@ void Test_Integer_Texture::write_read_to_fbo()
 
     // read data back from it
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
         glBindTexture(TextureInfo.target, FBO.TextureNames[0]);
         unsigned int size = FBO.Width * FBO.Height * FBO.ComponentCount;
         unsigned int *data = new unsigned int[size];
@@ -1,4 +1,5 @@
 #include "test_xor.h"
+#include "context.h"
 
 #include <iostream>
 #include <map>
@@ -117,7 +118,7 @@ void TestXOR::run()
 
         glDisable(GL_COLOR_LOGIC_OP);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, Context::defaultFramebuffer());
     }
 
     // read back the values
@@ -0,0 +1,259 @@
+/**
+    Runs the experiments one after the other in one process and one GL context.
+
+    Every experiment that calls createSuiteModule() in its CMakeLists.txt is
+    also built as bin/<name>_module.so (configure with -DOGLE_SUITE=ON). The
+    suite loads each with dlopen, creates its ogle::Application through the
+    entry point OGLE_APPLICATION() defines, runs it with the suite's command
+    line and unloads it. The experiments define the same global functions
+    (checkExtensions, createShader...), RTLD_LOCAL keeps each module's to
+    itself; common, GLEW and GLFW are the suite's, exported to the modules.
+
+    The context is created once: context creation, GLEW, the driver's
+    shader cache and whatever else it keeps stay warm between experiments.
+    Before each one Context::reset() sizes it for the experiment, turns vsync
+    and the headless frame limit back to what the experiment asks for, drops
+    the input callbacks and puts the GL state back to its defaults.
+    --fresh-context lets every experiment create and destroy its own instead.
+
+    usage:
+        suite [--list] [--only a,b] [--skip a,b] [--fresh-context] [--modules dir] [experiment options]
+
+    Everything else is passed to every experiment, --frames 200 --json out.json
+    benchmarks all of them and writes one file with every result. An experiment
+    that doesn't know an option fails, the others still run. The exit code is 1
+    when one of them failed.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+
+#include "application.h"
+#include "benchmark.h"
+#include "context.h"
+#include "debug.h"
+#include "startup.h"
+
+using namespace std;
+
+namespace {
+    typedef ogle::Application* (*CreateApplication)();
+
+    const string ModuleSuffix = "_module.so";
+
+    struct Outcome
+    {
+        string Name;
+        int Status;
+        double Seconds;
+        string Error;
+    };
+
+    vector<string> split(const string& list)
+    {
+        vector<string> result;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t comma = list.find(',', start);
+            if (comma == string::npos)
+                comma = list.size();
+            if (comma > start)
+                result.push_back(list.substr(start, comma - start));
+            start = comma + 1;
+        }
+        return result;
+    }
+
+    bool contains(const vector<string>& list, const string& name)
+    {
+        return find(list.begin(), list.end(), name) != list.end();
+    }
+
+    /** experiment names of the modules in dir, sorted */
+    vector<string> findModules(const string& dir)
+    {
+        vector<string> names;
+        DIR* handle = opendir(dir.c_str());
+        if (!handle)
+            return names;
+        while (dirent* entry = readdir(handle)) {
+            string file = entry->d_name;
+            if (file.size() > ModuleSuffix.size() && file.compare(file.size() - ModuleSuffix.size(), ModuleSuffix.size(), ModuleSuffix) == 0)
+                names.push_back(file.substr(0, file.size() - ModuleSuffix.size()));
+        }
+        closedir(handle);
+        sort(names.begin(), names.end());
+        return names;
+    }
+
+    /** argv[0] is where the experiment's executable would be, it finds its data relative to that */
+    int runModule(const string& dir, const string& name, const vector<string>& options, ogle::BenchmarkRunner* results, string& error)
+    {
+        string path = dir + name + ModuleSuffix;
+        void* module = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!module) {
+            error = dlerror();
+            return EXIT_FAILURE;
+        }
+
+        CreateApplication create = (CreateApplication)dlsym(module, "ogleCreateApplication");
+        if (!create) {
+            error = "no OGLE_APPLICATION() in " + path;
+            dlclose(module);
+            return EXIT_FAILURE;
+        }
+
+        int status = EXIT_FAILURE;
+        {
+            vector<string> args;
+            args.push_back(dir + name);
+            args.insert(args.end(), options.begin(), options.end());
+            vector<char*> argv;
+            for (auto& arg : args)
+                argv.push_back(&arg[0]);
+            argv.push_back(nullptr);
+
+            unique_ptr<ogle::Application> app(create());
+            app->collectResults(results);
+            status = app->run((int)args.size(), argv.data());
+        }
+
+        // its globals are destroyed here, while the context they were made in is still current
+        dlclose(module);
+        return status;
+    }
+
+    void usage()
+    {
+        cerr << "usage: suite [--list] [--only a,b] [--skip a,b] [--fresh-context] [--modules dir] [experiment options]" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool list = false;
+    bool fresh_context = false;
+    vector<string> only;
+    vector<string> skip;
+    string dir;
+    string json_file;
+    vector<string> options;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        }
+        else if (strcmp(argv[i], "--fresh-context") == 0) {
+            fresh_context = true;
+        }
+        else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = split(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+            skip = split(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--modules") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--help") == 0) {
+            usage();
+            exit( EXIT_SUCCESS );
+        }
+        else {
+            // the experiments see it, the suite writes the one file
+            if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+                json_file = argv[i + 1];
+            else if (strncmp(argv[i], "--json=", 7) == 0)
+                json_file = argv[i] + 7;
+            options.push_back(argv[i]);
+        }
+    }
+
+    // the modules are built next to the suite
+    if (dir.empty()) {
+        string path = argv[0];
+        size_t slash = path.rfind('/');
+        dir = slash == string::npos ? "." : path.substr(0, slash);
+    }
+    if (dir.back() != '/')
+        dir += "/";
+
+    vector<string> names;
+    for (const auto& name : findModules(dir)) {
+        if ((only.empty() || contains(only, name)) && !contains(skip, name))
+            names.push_back(name);
+    }
+    for (const auto& name : only) {
+        if (!contains(names, name))
+            cerr << "[!] suite: there is no " << dir << name << ModuleSuffix << endl;
+    }
+
+    if (list) {
+        for (const auto& name : names)
+            cout << name << endl;
+        exit( EXIT_SUCCESS );
+    }
+    if (names.empty()) {
+        cerr << "[!] suite: no experiment modules in " << dir << ", configure with -DOGLE_SUITE=ON" << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    // the experiments only reset it, created like they create their own so the numbers compare
+    // with standalone runs, the ones that differ in the debug flag record it in their params
+    if (!fresh_context) {
+        ogle::ContextConfig config;
+        config.Name = "suite";
+        config.MinorVersion = 3;
+        config.ForwardCompatible = true;
+        if (!ogle::Context::init(config))
+            exit( EXIT_FAILURE );
+        ogle::Debug::init();
+    }
+
+    ogle::BenchmarkRunner results;
+    vector<Outcome> outcomes;
+    for (const auto& name : names) {
+        cout << "\n[suite] " << name << endl;
+        ogle::Startup::restart("load module");
+
+        Outcome outcome;
+        outcome.Name = name;
+        auto start = chrono::steady_clock::now();
+        outcome.Status = runModule(dir, name, options, json_file.empty() ? nullptr : &results, outcome.Error);
+        outcome.Seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (!outcome.Error.empty())
+            cerr << "[!] suite: " << name << ": " << outcome.Error << endl;
+        outcomes.push_back(outcome);
+    }
+
+    if (!fresh_context) {
+        ogle::Debug::shutdown();
+        ogle::Context::shutdown();
+    }
+
+    size_t failed = 0;
+    cout << "\nSuite:\n";
+    for (const auto& outcome : outcomes) {
+        cout << "\t" << left << setw(24) << outcome.Name << right
+             << setw(10) << fixed << setprecision(2) << outcome.Seconds << " s  "
+             << (outcome.Status == EXIT_SUCCESS ? "ok" : "failed") << "\n";
+        if (outcome.Status != EXIT_SUCCESS)
+            ++failed;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << outcomes.size() - failed << " of " << outcomes.size() << " experiments succeeded"
+         << (fresh_context ? ", each in its own context" : " in one context") << endl;
+
+    if (!json_file.empty() && !results.results().empty())
+        results.writeJson(json_file);
+
+    exit( failed ? EXIT_FAILURE : EXIT_SUCCESS );
+}
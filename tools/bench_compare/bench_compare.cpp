@@ -0,0 +1,288 @@
+/**
+    Compares two benchmark result files written by ogle::BenchmarkRunner::writeJson.
+
+    Benchmarks are matched by name and parameters, then every matched pair
+    runs a Mann-Whitney U test on the per-iteration samples. Results that
+    are both statistically significant and bigger than --min-change are
+    listed as speedups or regressions.
+
+    usage:
+        bench_compare [--alpha 0.01] [--min-change 0.02] [--metric cpu|gpu|both] baseline.json candidate.json
+
+    The exit code is 1 when a significant regression was found, so it can gate CI runs.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "json.h"
+
+using namespace std;
+
+namespace {
+    double Alpha = 0.01;
+    double MinChange = 0.02;
+    bool CompareCpu = true;
+    bool CompareGpu = true;
+
+    struct Comparison
+    {
+        string Benchmark;
+        string Metric;
+        double BaselineMedian;
+        double CandidateMedian;
+        double Change;      // relative change of the median, negative is faster
+        double PValue;
+        bool Significant;
+    };
+
+    /** name plus sorted parameters, what two results are matched on */
+    string benchmarkKey(const ogle::JsonValue& benchmark)
+    {
+        string key = benchmark["name"].asString();
+        for (const auto& kv : benchmark["params"].members())
+            key += " " + kv.first + "=" + kv.second.asString();
+        return key;
+    }
+
+    vector<double> samples(const ogle::JsonValue& stats)
+    {
+        vector<double> result;
+        const ogle::JsonValue& values = stats["samples"];
+        for (size_t i=0; i<values.size(); ++i)
+            result.push_back(values[i].asNumber());
+        return result;
+    }
+
+    double median(vector<double> values)
+    {
+        if (values.empty())
+            return 0.0;
+        sort(values.begin(), values.end());
+        size_t mid = values.size() / 2;
+        if (values.size() % 2 == 0)
+            return (values[mid - 1] + values[mid]) * 0.5;
+        return values[mid];
+    }
+
+    /**
+        two sided Mann-Whitney U test using the normal approximation with tie correction,
+        good enough for the sample counts benchmarks produce (> 20 per side).
+    */
+    double mannWhitneyU(const vector<double>& a, const vector<double>& b)
+    {
+        const double n1 = (double)a.size();
+        const double n2 = (double)b.size();
+        if (n1 < 2 || n2 < 2)
+            return 1.0;
+
+        vector<pair<double, int>> all;
+        all.reserve(a.size() + b.size());
+        for (double v : a) all.push_back(make_pair(v, 0));
+        for (double v : b) all.push_back(make_pair(v, 1));
+        sort(all.begin(), all.end());
+
+        // average ranks over ties
+        double rank_sum_a = 0.0;
+        double tie_term = 0.0;
+        size_t i = 0;
+        while (i < all.size()) {
+            size_t j = i;
+            while (j + 1 < all.size() && all[j + 1].first == all[i].first)
+                ++j;
+            double rank = (i + j) * 0.5 + 1.0;
+            double ties = (double)(j - i + 1);
+            tie_term += ties * ties * ties - ties;
+            for (size_t k=i; k<=j; ++k) {
+                if (all[k].second == 0)
+                    rank_sum_a += rank;
+            }
+            i = j + 1;
+        }
+
+        const double n = n1 + n2;
+        double u = rank_sum_a - n1 * (n1 + 1.0) * 0.5;
+        double mean = n1 * n2 * 0.5;
+        double variance = n1 * n2 / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+        if (variance <= 0.0)
+            return 1.0;
+
+        double diff = fabs(u - mean) - 0.5; // continuity correction
+        double z = max(diff, 0.0) / sqrt(variance);
+        return erfc(z / sqrt(2.0));
+    }
+
+    void printMachineDifferences(const ogle::JsonValue& baseline, const ogle::JsonValue& candidate)
+    {
+        const ogle::JsonValue& lhs = baseline["machine"];
+        const ogle::JsonValue& rhs = candidate["machine"];
+        cout << "baseline:  " << lhs["gl_renderer"].asString("?") << " | " << lhs["cpu_model"].asString("?")
+             << " | " << lhs["cpu_cores"].asString("?") << " cores\n";
+        cout << "candidate: " << rhs["gl_renderer"].asString("?") << " | " << rhs["cpu_model"].asString("?")
+             << " | " << rhs["cpu_cores"].asString("?") << " cores\n";
+
+        map<string, bool> keys;
+        for (const auto& kv : lhs.members()) keys[kv.first] = true;
+        for (const auto& kv : rhs.members()) keys[kv.first] = true;
+        for (const auto& kv : keys) {
+            if (kv.first == "hostname")
+                continue;
+            string before = lhs[kv.first].asString("<missing>");
+            string after = rhs[kv.first].asString("<missing>");
+            if (before != after)
+                cout << "[!] " << kv.first << " differs: \"" << before << "\" vs \"" << after << "\"\n";
+        }
+        cout << endl;
+    }
+
+    void compareMetric(const string& key, const string& metric, const ogle::JsonValue& base, const ogle::JsonValue& cand, vector<Comparison>& comparisons)
+    {
+        vector<double> base_samples = samples(base[metric + "_ms"]);
+        vector<double> cand_samples = samples(cand[metric + "_ms"]);
+        if (base_samples.empty() || cand_samples.empty())
+            return;
+
+        Comparison c;
+        c.Benchmark = key;
+        c.Metric = metric;
+        c.BaselineMedian = median(base_samples);
+        c.CandidateMedian = median(cand_samples);
+        c.Change = c.BaselineMedian > 0.0 ? (c.CandidateMedian - c.BaselineMedian) / c.BaselineMedian : 0.0;
+        c.PValue = mannWhitneyU(base_samples, cand_samples);
+        c.Significant = c.PValue < Alpha && fabs(c.Change) >= MinChange;
+        comparisons.push_back(c);
+    }
+
+    void printTable(const string& title, const vector<Comparison>& rows)
+    {
+        if (rows.empty())
+            return;
+
+        cout << title << ":\n";
+        cout << left << setw(6) << "metric"
+             << right << setw(10) << "change"
+             << setw(12) << "p-value"
+             << setw(14) << "baseline ms"
+             << setw(14) << "candidate ms"
+             << "  benchmark\n";
+        for (const auto& row : rows) {
+            cout << left << setw(6) << row.Metric
+                 << right << setw(9) << fixed << setprecision(2) << row.Change * 100.0 << "%"
+                 << setw(12) << scientific << setprecision(2) << row.PValue
+                 << setw(14) << fixed << setprecision(4) << row.BaselineMedian
+                 << setw(14) << row.CandidateMedian
+                 << "  " << row.Benchmark << "\n";
+        }
+        cout << endl;
+    }
+
+    void usage()
+    {
+        cerr << "usage: bench_compare [--alpha 0.01] [--min-change 0.02] [--metric cpu|gpu|both] baseline.json candidate.json" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    vector<string> files;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+            Alpha = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--min-change") == 0 && i + 1 < argc) {
+            MinChange = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--metric") == 0 && i + 1 < argc) {
+            // a typo must not turn both off, a CI gate would pass without comparing anything
+            string metric = argv[++i];
+            if (metric != "cpu" && metric != "gpu" && metric != "both") {
+                cerr << "unknown metric " << metric << endl;
+                usage();
+                exit( EXIT_FAILURE );
+            }
+            CompareCpu = metric == "cpu" || metric == "both";
+            CompareGpu = metric == "gpu" || metric == "both";
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.size() != 2) {
+        usage();
+        exit( EXIT_FAILURE );
+    }
+
+    ogle::JsonValue baseline;
+    ogle::JsonValue candidate;
+    string error;
+    if (!ogle::JsonValue::load(files[0], baseline, error) || !ogle::JsonValue::load(files[1], candidate, error)) {
+        cerr << error << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    printMachineDifferences(baseline, candidate);
+
+    map<string, const ogle::JsonValue*> baseline_benchmarks;
+    const ogle::JsonValue& base_list = baseline["benchmarks"];
+    for (size_t i=0; i<base_list.size(); ++i)
+        baseline_benchmarks[benchmarkKey(base_list[i])] = &base_list[i];
+
+    vector<Comparison> comparisons;
+    vector<string> unmatched;
+    const ogle::JsonValue& cand_list = candidate["benchmarks"];
+    for (size_t i=0; i<cand_list.size(); ++i) {
+        string key = benchmarkKey(cand_list[i]);
+        auto iter = baseline_benchmarks.find(key);
+        if (iter == baseline_benchmarks.end()) {
+            unmatched.push_back("only in candidate: " + key);
+            continue;
+        }
+
+        if (!iter->second->operator[]("stable").asBool(true) || !cand_list[i]["stable"].asBool(true))
+            cout << "[!] " << key << " was flagged as unstable, take its numbers with a grain of salt\n";
+
+        if (CompareCpu)
+            compareMetric(key, "cpu", *iter->second, cand_list[i], comparisons);
+        if (CompareGpu)
+            compareMetric(key, "gpu", *iter->second, cand_list[i], comparisons);
+        baseline_benchmarks.erase(iter);
+    }
+    for (const auto& kv : baseline_benchmarks)
+        unmatched.push_back("only in baseline: " + kv.first);
+
+    // rank by size of the change, biggest wins and biggest losses first
+    vector<Comparison> speedups;
+    vector<Comparison> regressions;
+    vector<Comparison> unchanged;
+    for (const auto& c : comparisons) {
+        if (!c.Significant)
+            unchanged.push_back(c);
+        else if (c.Change < 0.0)
+            speedups.push_back(c);
+        else
+            regressions.push_back(c);
+    }
+    sort(speedups.begin(), speedups.end(), [](const Comparison& l, const Comparison& r) { return l.Change < r.Change; });
+    sort(regressions.begin(), regressions.end(), [](const Comparison& l, const Comparison& r) { return l.Change > r.Change; });
+    sort(unchanged.begin(), unchanged.end(), [](const Comparison& l, const Comparison& r) { return fabs(l.Change) > fabs(r.Change); });
+
+    cout << endl;
+    printTable("Significant speedups", speedups);
+    printTable("Significant regressions", regressions);
+    printTable("No significant change", unchanged);
+
+    for (const auto& msg : unmatched)
+        cout << "[!] " << msg << "\n";
+
+    cout << speedups.size() << " faster, " << regressions.size() << " slower, "
+         << unchanged.size() << " unchanged (alpha " << Alpha << ", min change " << MinChange * 100.0 << "%)" << endl;
+
+    exit( regressions.empty() ? EXIT_SUCCESS : EXIT_FAILURE );
+}
@@ -0,0 +1,735 @@
+/**
+    Runs experiments over the cartesian product of their parameters and gathers
+    every result into one table.
+
+    A sweep file names an experiment and the values of each option:
+        {
+            "experiment": "buffer_streaming",
+            "frames": 300,
+            "warmup": 50,
+            "cooldown": 2.0,
+            "params": {
+                "size": ["64", "128", "256"],
+                "method": ["map_persistent", "buffer_data", "buffer_sub_data_pre_orphan"]
+            }
+        }
+    runs buffer_streaming 9 times with --size and --method set, --frames 300 and
+    --warmup 50. Every param becomes --name value, true makes it a bare flag and
+    false leaves it out, a single value doesn't need an array. "args" are passed
+    as they are, "env" is added to the environment, "repeat" runs every
+    configuration that many times, "timeout" kills a run after that many seconds.
+    A file can hold several sweeps in "sweeps": [...], what is set next to
+    "sweeps" is the default for each of them, params and env are merged.
+
+    Every run is a fresh process started from bin/ (or --bin), in its own
+    directory under --out (default sweep_results/<n>/) so the trace, log and
+    result files of parallel runs stay apart. It is pinned to --cpus-per-run
+    cores, gets LP_NUM_THREADS for that many (llvmpipe would otherwise start a
+    thread per core of the machine), and a slot waits "cooldown" seconds before
+    its next run. --jobs N runs N configurations at once on disjoint cores,
+    meant for software rendering; a GPU should be measured with one job.
+
+    usage:
+        sweep [--jobs 1] [--cpus-per-run N] [--bin dir] [--out dir] [--csv file] [--json file] [--dry-run] sweep.json
+
+    --json writes every benchmark into one file bench_compare reads, with the
+    sweep params added to the benchmarks' own. The exit code is 1 when a run failed.
+    Linux only.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "csv.h"
+#include "json.h"
+
+using namespace std;
+
+namespace {
+    typedef chrono::steady_clock Clock;
+
+    size_t Jobs = 1;
+    size_t CpusPerRun = 0; // 0 splits the cores evenly between the jobs
+    string BinDir;
+    string OutDir = "sweep_results";
+    string CsvFile;
+    string JsonFile;
+    bool DryRun = false;
+
+    /** one process to start, a configuration of a sweep */
+    struct Run
+    {
+        Run()
+            : Cooldown(0.0)
+            , Timeout(0.0)
+            , Repeat(0)
+            , Status(-1)
+            , Seconds(0.0)
+        {
+
+        }
+
+        string Experiment;  // absolute path of the executable
+        vector<pair<string, string>> Params; // what the sweep varies, for the table
+        vector<string> Args;
+        map<string, string> Env;
+        double Cooldown;
+        double Timeout;
+        unsigned int Repeat;
+
+        string Directory;
+        int Status;         // exit code, -1 when it didn't exit normally
+        double Seconds;
+    };
+
+    /** one value of a param, a bool is a flag that is passed or not */
+    struct ParamValue
+    {
+        string Text;
+        bool IsFlag;
+        bool FlagSet;
+    };
+
+    /** a running child and the cores it owns */
+    struct Slot
+    {
+        Slot()
+            : Pid(0)
+            , Current(nullptr)
+            , ReadyAt(Clock::now())
+        {
+
+        }
+
+        vector<int> Cpus;
+        pid_t Pid;
+        Run* Current;
+        Clock::time_point Started;
+        Clock::time_point ReadyAt;
+    };
+
+    string directoryOf(const string& path)
+    {
+        size_t slash = path.rfind('/');
+        return slash == string::npos ? "." : path.substr(0, slash);
+    }
+
+    string absolutePath(const string& path)
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(path.c_str(), resolved))
+            return path;
+        return resolved;
+    }
+
+    bool makeDirectory(const string& path)
+    {
+        if (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST)
+            return true;
+        cerr << "[!] sweep: can't create " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    bool removeFile(const string& path)
+    {
+        if (unlink(path.c_str()) == 0 || errno == ENOENT)
+            return true;
+        cerr << "[!] sweep: can't remove " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    vector<int> allowedCpus()
+    {
+        vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int i=0; i<CPU_SETSIZE; ++i)
+                if (CPU_ISSET(i, &set))
+                    cpus.push_back(i);
+        }
+        if (cpus.empty())
+            cpus.push_back(0);
+        return cpus;
+    }
+
+    /** the sweep's own value, or the one next to "sweeps" */
+    const ogle::JsonValue& setting(const ogle::JsonValue& sweep, const ogle::JsonValue& defaults, const string& key)
+    {
+        return sweep.has(key) ? sweep[key] : defaults[key];
+    }
+
+    bool paramValues(const string& name, const ogle::JsonValue& param, vector<ParamValue>& values, string& error)
+    {
+        vector<const ogle::JsonValue*> list;
+        if (param.isArray()) {
+            for (size_t i=0; i<param.size(); ++i)
+                list.push_back(&param[i]);
+        }
+        else {
+            list.push_back(&param);
+        }
+
+        for (const ogle::JsonValue* value : list) {
+            ogle::JsonValue::type type = value->getType();
+            if (type != ogle::JsonValue::BOOLEAN && type != ogle::JsonValue::STRING && type != ogle::JsonValue::NUMBER) {
+                error = "param \"" + name + "\" has to be a string, number, bool or an array of those";
+                return false;
+            }
+            ParamValue v;
+            v.Text = value->asString();
+            v.IsFlag = type == ogle::JsonValue::BOOLEAN;
+            v.FlagSet = value->asBool();
+            values.push_back(v);
+        }
+        if (values.empty()) {
+            error = "param \"" + name + "\" has no values";
+            return false;
+        }
+        return true;
+    }
+
+    /** appends a run for every combination of the sweep's params */
+    bool expand(const ogle::JsonValue& sweep, const ogle::JsonValue& defaults, vector<Run>& runs, string& error)
+    {
+        string experiment = setting(sweep, defaults, "experiment").asString();
+        if (experiment.empty()) {
+            error = "a sweep without \"experiment\"";
+            return false;
+        }
+        string path = experiment.find('/') == string::npos ? BinDir + "/" + experiment : absolutePath(experiment);
+        if (!DryRun && access(path.c_str(), X_OK) != 0) {
+            error = path + " is not an executable, build it or point --bin at it";
+            return false;
+        }
+
+        Run base;
+        base.Experiment = path;
+        base.Cooldown = setting(sweep, defaults, "cooldown").asNumber(0.0);
+        base.Timeout = setting(sweep, defaults, "timeout").asNumber(0.0);
+        for (const char* option : { "frames", "warmup" }) {
+            const ogle::JsonValue& value = setting(sweep, defaults, option);
+            if (!value.isNull()) {
+                base.Args.push_back(string("--") + option);
+                base.Args.push_back(value.asString());
+            }
+        }
+        const ogle::JsonValue& args = setting(sweep, defaults, "args");
+        for (size_t i=0; i<args.size(); ++i)
+            base.Args.push_back(args[i].asString());
+        for (const auto& kv : defaults["env"].members())
+            base.Env[kv.first] = kv.second.asString();
+        for (const auto& kv : sweep["env"].members())
+            base.Env[kv.first] = kv.second.asString();
+
+        map<string, const ogle::JsonValue*> params;
+        for (const auto& kv : defaults["params"].members())
+            params[kv.first] = &kv.second;
+        for (const auto& kv : sweep["params"].members())
+            params[kv.first] = &kv.second;
+
+        vector<string> names;
+        vector<vector<ParamValue>> values;
+        for (const auto& kv : params) {
+            names.push_back(kv.first);
+            values.push_back(vector<ParamValue>());
+            if (!paramValues(kv.first, *kv.second, values.back(), error))
+                return false;
+        }
+
+        unsigned int repeat = (unsigned int)max(1.0, setting(sweep, defaults, "repeat").asNumber(1.0));
+
+        // counts through the combinations, the last param changes fastest
+        vector<size_t> index(names.size(), 0);
+        while (true) {
+            for (unsigned int r=0; r<repeat; ++r) {
+                Run run = base;
+                run.Repeat = repeat > 1 ? r + 1 : 0;
+                for (size_t p=0; p<names.size(); ++p) {
+                    const ParamValue& value = values[p][index[p]];
+                    run.Params.push_back(make_pair(names[p], value.Text));
+                    if (value.IsFlag && !value.FlagSet)
+                        continue;
+                    run.Args.push_back("--" + names[p]);
+                    if (!value.IsFlag)
+                        run.Args.push_back(value.Text);
+                }
+                runs.push_back(run);
+            }
+
+            size_t p = names.size();
+            while (p > 0 && ++index[p - 1] == values[p - 1].size()) {
+                index[p - 1] = 0;
+                --p;
+            }
+            if (p == 0)
+                break;
+        }
+        return true;
+    }
+
+    string commandLine(const Run& run)
+    {
+        string line = run.Experiment;
+        for (const auto& arg : run.Args)
+            line += " " + arg;
+        return line;
+    }
+
+    /** fork, pin, redirect output into the run's directory, exec */
+    pid_t launch(Run& run, const vector<int>& cpus)
+    {
+        vector<string> args;
+        args.push_back(run.Experiment);
+        args.insert(args.end(), run.Args.begin(), run.Args.end());
+        args.push_back("--json");
+        args.push_back("result.json");
+
+        pid_t pid = fork();
+        if (pid != 0)
+            return pid;
+
+        // child, only async signal safe calls from here on would be proper,
+        // the parent is single threaded so the rest is fine in practice
+        if (chdir(run.Directory.c_str()) != 0)
+            _exit(127);
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+            CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+
+        if (!getenv("LP_NUM_THREADS") && run.Env.find("LP_NUM_THREADS") == run.Env.end())
+            setenv("LP_NUM_THREADS", to_string(cpus.size()).c_str(), 1);
+        for (const auto& kv : run.Env)
+            setenv(kv.first.c_str(), kv.second.c_str(), 1);
+
+        int log = open("log.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+
+        vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+
+        cerr << "[!] sweep: can't run " << argv[0] << ": " << strerror(errno) << endl;
+        _exit(127);
+    }
+
+    string describe(const Run& run)
+    {
+        string text;
+        for (const auto& kv : run.Params)
+            text += (text.empty() ? "" : " ") + kv.first + "=" + kv.second;
+        if (run.Repeat)
+            text += " #" + to_string(run.Repeat);
+        return text;
+    }
+
+    /** runs everything, Jobs at a time, returns how many failed */
+    size_t runAll(vector<Run>& runs)
+    {
+        vector<int> cpus = allowedCpus();
+        size_t per_run = CpusPerRun ? CpusPerRun : max<size_t>(1, cpus.size() / Jobs);
+        if (per_run * Jobs > cpus.size()) {
+            size_t jobs = max<size_t>(1, cpus.size() / per_run);
+            cerr << "[!] sweep: " << cpus.size() << " cores can't give " << Jobs << " jobs "
+                 << per_run << " each, running " << jobs << " at a time" << endl;
+            Jobs = jobs;
+            per_run = min(per_run, cpus.size());
+        }
+
+        vector<Slot> slots(Jobs);
+        for (size_t s=0; s<slots.size(); ++s)
+            slots[s].Cpus.assign(cpus.begin() + s * per_run, cpus.begin() + (s + 1) * per_run);
+
+        size_t next = 0;
+        size_t done = 0;
+        size_t failed = 0;
+        while (done < runs.size()) {
+            Clock::time_point now = Clock::now();
+            for (auto& slot : slots) {
+                if (slot.Current || next >= runs.size() || now < slot.ReadyAt)
+                    continue;
+
+                Run& run = runs[next];
+                run.Directory = OutDir + "/" + to_string(next);
+                ++next;
+                // the directory may be left from an earlier sweep, its results mustn't pass for this run's
+                if (!makeDirectory(run.Directory) || !removeFile(run.Directory + "/result.json")) {
+                    ++done;
+                    ++failed;
+                    continue;
+                }
+                slot.Pid = launch(run, slot.Cpus);
+                if (slot.Pid < 0) {
+                    cerr << "[!] sweep: fork failed: " << strerror(errno) << endl;
+                    ++done;
+                    ++failed;
+                    continue;
+                }
+                slot.Current = &run;
+                slot.Started = now;
+                cout << "[" << next << "/" << runs.size() << "] cpus " << slot.Cpus.front();
+                if (slot.Cpus.size() > 1)
+                    cout << "-" << slot.Cpus.back();
+                cout << "  " << describe(run) << endl;
+            }
+
+            this_thread::sleep_for(chrono::milliseconds(20));
+
+            now = Clock::now();
+            for (auto& slot : slots) {
+                if (!slot.Current)
+                    continue;
+
+                Run& run = *slot.Current;
+                double seconds = chrono::duration<double>(now - slot.Started).count();
+                int status = 0;
+                pid_t result = waitpid(slot.Pid, &status, WNOHANG);
+                if (result == 0) {
+                    if (run.Timeout > 0.0 && seconds > run.Timeout) {
+                        cerr << "[!] sweep: " << describe(run) << " took longer than " << run.Timeout << "s, killed" << endl;
+                        kill(slot.Pid, SIGKILL);
+                    }
+                    continue;
+                }
+
+                run.Seconds = seconds;
+                run.Status = (result > 0 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+                if (run.Status != 0) {
+                    ++failed;
+                    cerr << "[!] sweep: " << describe(run) << " failed (" << (run.Status < 0 ? "killed" : "exit " + to_string(run.Status))
+                         << "), see " << run.Directory << "/log.txt" << endl;
+                }
+                ++done;
+                slot.Current = nullptr;
+                slot.ReadyAt = now + chrono::duration_cast<Clock::duration>(chrono::duration<double>(run.Cooldown));
+            }
+        }
+        return failed;
+    }
+
+    string formatMs(const ogle::JsonValue& stats, const string& name)
+    {
+        if (!stats.has(name) || stats["count"].asNumber() == 0.0)
+            return "-";
+        ostringstream out;
+        out << fixed << setprecision(4) << stats[name].asNumber();
+        return out.str();
+    }
+
+    void writeValue(ostream& out, const ogle::JsonValue& value);
+
+    void writeString(ostream& out, const string& text)
+    {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (c == '\n')
+                out << "\\n";
+            else if ((unsigned char)c < 0x20)
+                out << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec << setfill(' ');
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    void writeValue(ostream& out, const ogle::JsonValue& value)
+    {
+        switch (value.getType()) {
+            case ogle::JsonValue::NUL:
+                out << "null";
+                break;
+            case ogle::JsonValue::BOOLEAN:
+                out << (value.asBool() ? "true" : "false");
+                break;
+            case ogle::JsonValue::NUMBER:
+                out << value.asNumber();
+                break;
+            case ogle::JsonValue::STRING:
+                writeString(out, value.asString());
+                break;
+            case ogle::JsonValue::ARRAY:
+                out << "[";
+                for (size_t i=0; i<value.size(); ++i) {
+                    out << (i > 0 ? "," : "");
+                    writeValue(out, value[i]);
+                }
+                out << "]";
+                break;
+            case ogle::JsonValue::OBJECT: {
+                out << "{";
+                bool first = true;
+                for (const auto& kv : value.members()) {
+                    out << (first ? "" : ",");
+                    writeString(out, kv.first);
+                    out << ":";
+                    writeValue(out, kv.second);
+                    first = false;
+                }
+                out << "}";
+                break;
+            }
+        }
+    }
+
+    /** the benchmark with the sweep params it doesn't record itself added to its params */
+    void writeBenchmark(ostream& out, const ogle::JsonValue& benchmark, const Run& run)
+    {
+        map<string, string> params;
+        for (const auto& kv : run.Params)
+            params[kv.first] = kv.second;
+        if (run.Repeat)
+            params["repeat"] = to_string(run.Repeat);
+        for (const auto& kv : benchmark["params"].members())
+            params[kv.first] = kv.second.asString();
+
+        out << "{";
+        bool first = true;
+        for (const auto& kv : benchmark.members()) {
+            out << (first ? "" : ",");
+            writeString(out, kv.first);
+            out << ":";
+            if (kv.first == "params") {
+                out << "{";
+                bool first_param = true;
+                for (const auto& param : params) {
+                    out << (first_param ? "" : ",");
+                    writeString(out, param.first);
+                    out << ":";
+                    writeString(out, param.second);
+                    first_param = false;
+                }
+                out << "}";
+            }
+            else {
+                writeValue(out, kv.second);
+            }
+            first = false;
+        }
+        out << "}";
+    }
+
+    void usage()
+    {
+        cerr << "usage: sweep [--jobs 1] [--cpus-per-run N] [--bin dir] [--out dir] [--csv file] [--json file] [--dry-run] sweep.json" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    vector<string> files;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            Jobs = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--cpus-per-run") == 0 && i + 1 < argc) {
+            CpusPerRun = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--bin") == 0 && i + 1 < argc) {
+            BinDir = absolutePath(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            OutDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            CsvFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            JsonFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--dry-run") == 0) {
+            DryRun = true;
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.size() != 1) {
+        usage();
+        exit( EXIT_FAILURE );
+    }
+
+    // the experiments are built next to this tool
+    if (BinDir.empty())
+        BinDir = directoryOf(absolutePath(argv[0]));
+
+    ogle::JsonValue root;
+    string error;
+    if (!ogle::JsonValue::load(files[0], root, error)) {
+        cerr << error << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    vector<Run> runs;
+    const ogle::JsonValue& sweeps = root["sweeps"];
+    bool expanded = true;
+    if (sweeps.isArray()) {
+        for (size_t i=0; i<sweeps.size() && expanded; ++i)
+            expanded = expand(sweeps[i], root, runs, error);
+    }
+    else {
+        expanded = expand(root, ogle::JsonValue(), runs, error);
+    }
+    if (!expanded) {
+        cerr << "[!] sweep: " << files[0] << ": " << error << endl;
+        exit( EXIT_FAILURE );
+    }
+
+    if (DryRun) {
+        for (const auto& run : runs)
+            cout << commandLine(run) << " --json result.json" << endl;
+        exit( EXIT_SUCCESS );
+    }
+
+    // the output directory is relative to where the sweep was started, the runs are not
+    if (!makeDirectory(OutDir))
+        exit( EXIT_FAILURE );
+    OutDir = absolutePath(OutDir);
+
+    cout << runs.size() << " runs, " << Jobs << " at a time, results in " << OutDir << endl;
+    size_t failed = runAll(runs);
+
+    // one row per benchmark, the sweep's params first
+    vector<string> param_names;
+    for (const auto& run : runs)
+        for (const auto& kv : run.Params)
+            if (find(param_names.begin(), param_names.end(), kv.first) == param_names.end())
+                param_names.push_back(kv.first);
+
+    vector<string> header { "run" };
+    header.insert(header.end(), param_names.begin(), param_names.end());
+    for (const char* column : { "benchmark", "cpu median", "cpu p95", "gpu median", "gpu p95", "stable", "seconds" })
+        header.push_back(column);
+
+    vector<vector<string>> rows;
+    vector<ogle::JsonValue> results(runs.size());
+    ogle::JsonValue machine;
+    for (size_t r=0; r<runs.size(); ++r) {
+        const Run& run = runs[r];
+        vector<string> prefix { to_string(r) };
+        for (const auto& name : param_names) {
+            string value = "-";
+            for (const auto& kv : run.Params)
+                if (kv.first == name)
+                    value = kv.second;
+            prefix.push_back(value);
+        }
+
+        ostringstream seconds;
+        seconds << fixed << setprecision(1) << run.Seconds;
+
+        string load_error;
+        // a failed or killed run may have written half a file, it has no results
+        if (run.Directory.empty() || run.Status != 0 || !ogle::JsonValue::load(run.Directory + "/result.json", results[r], load_error)) {
+            vector<string> row = prefix;
+            row.push_back(run.Status == 0 ? "(no results)" : "(failed)");
+            row.insert(row.end(), 5, "-");
+            row.push_back(seconds.str());
+            rows.push_back(row);
+            continue;
+        }
+        if (machine.isNull())
+            machine = results[r]["machine"];
+
+        const ogle::JsonValue& benchmarks = results[r]["benchmarks"];
+        for (size_t b=0; b<benchmarks.size(); ++b) {
+            const ogle::JsonValue& benchmark = benchmarks[b];
+            vector<string> row = prefix;
+            row.push_back(benchmark["name"].asString());
+            row.push_back(formatMs(benchmark["cpu_ms"], "median"));
+            row.push_back(formatMs(benchmark["cpu_ms"], "p95"));
+            row.push_back(formatMs(benchmark["gpu_ms"], "median"));
+            row.push_back(formatMs(benchmark["gpu_ms"], "p95"));
+            row.push_back(benchmark["failed"].asBool() ? "failed" : benchmark["stable"].asBool(true) ? "yes" : "no");
+            row.push_back(seconds.str());
+            rows.push_back(row);
+        }
+    }
+
+    vector<size_t> widths;
+    for (const auto& column : header)
+        widths.push_back(column.size());
+    for (const auto& row : rows)
+        for (size_t c=0; c<row.size(); ++c)
+            widths[c] = max(widths[c], row[c].size());
+
+    cout << endl;
+    for (size_t c=0; c<header.size(); ++c)
+        cout << left << setw((int)widths[c] + 2) << header[c];
+    cout << "\n";
+    for (const auto& row : rows) {
+        for (size_t c=0; c<row.size(); ++c)
+            cout << left << setw((int)widths[c] + 2) << row[c];
+        cout << "\n";
+    }
+    cout << right << endl;
+
+    if (!CsvFile.empty()) {
+        ofstream csv(CsvFile);
+        if (csv.is_open()) {
+            ogle::Csv::writeRow(csv, header);
+            for (const auto& row : rows)
+                ogle::Csv::writeRow(csv, row);
+            cout << "Wrote the table to " << CsvFile << endl;
+        }
+        else {
+            cerr << "Failed to open " << CsvFile << endl;
+        }
+    }
+
+    if (!JsonFile.empty()) {
+        ofstream json(JsonFile);
+        if (json.is_open()) {
+            json << setprecision(9) << "{\n\"machine\":";
+            writeValue(json, machine);
+            json << ",\n\"benchmarks\":[";
+            bool first = true;
+            for (size_t r=0; r<runs.size(); ++r) {
+                const ogle::JsonValue& benchmarks = results[r]["benchmarks"];
+                for (size_t b=0; b<benchmarks.size(); ++b) {
+                    json << (first ? "\n" : ",\n");
+                    writeBenchmark(json, benchmarks[b], runs[r]);
+                    first = false;
+                }
+            }
+            json << "\n]\n}\n";
+            cout << "Wrote benchmark results to " << JsonFile << endl;
+        }
+        else {
+            cerr << "Failed to open " << JsonFile << endl;
+        }
+    }
+
+    if (failed)
+        cout << failed << " of " << runs.size() << " runs failed" << endl;
+    exit( failed ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,288 @@
+/**
+    Follows the shared memory telemetry ring of a running experiment, see common/telemetry.h.
+
+    Every interval one line sums up the frames written since the last one:
+    frame rate, CPU and GPU frame times (average, 99th percentile, worst),
+    upload rate, GPU memory, resident memory, allocations and draw calls
+    per frame, and samples lost because the reader fell more than a ring
+    behind. Ctrl-C prints the same for the whole run.
+
+    usage:
+        telemetry_tail [--interval 1.0] [--all] [--raw] [segment | pid]
+
+    --all starts with what is still in the ring instead of the next frame,
+    --raw prints every sample instead of the summaries. A pid reads the
+    segment OGLE_TELEMETRY=1 makes that process write, /ogle_telemetry.<pid>.
+    Without either the tool follows the one process writing telemetry, and
+    lists them when there are several. When the writer exits the tool waits
+    for the next one.
+*/
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdrhistogram.h"
+#include "telemetry.h"
+
+using namespace std;
+
+namespace {
+    double Interval = 1.0;
+    bool FromOldest = false;
+    bool Raw = false;
+    // empty follows whichever process writes to a default named segment
+    string Segment;
+
+    volatile sig_atomic_t Stop = 0;
+
+    const double MB = 1024.0 * 1024.0;
+
+    // microseconds, the same range FrameTimes uses
+    const int64_t HighestFrameTime = 60ll * 60 * 1000 * 1000;
+
+    /** what is printed about a span of samples, the same size however long the span is */
+    struct Aggregate
+    {
+        Aggregate()
+            : Cpu(HighestFrameTime, 3)
+            , Gpu(HighestFrameTime, 3)
+        {
+            clear();
+        }
+
+        ogle::HdrHistogram Cpu;
+        ogle::HdrHistogram Gpu;
+        uint64_t Count;
+        uint64_t Lost;
+        double Upload;
+        double Allocations;
+        double Draws;
+        double FirstTime;
+        ogle::TelemetrySample Last;
+
+        void clear()
+        {
+            Cpu.reset();
+            Gpu.reset();
+            Count = 0;
+            Lost = 0;
+            Upload = 0.0;
+            Allocations = 0.0;
+            Draws = 0.0;
+            FirstTime = 0.0;
+            Last = ogle::TelemetrySample();
+        }
+
+        void add(const ogle::TelemetrySample& sample)
+        {
+            if (Count == 0)
+                FirstTime = sample.Time;
+            Cpu.record((int64_t)(sample.CpuMilliseconds * 1000.0 + 0.5));
+            Gpu.record((int64_t)(sample.GpuMilliseconds * 1000.0 + 0.5));
+            Upload += (double)sample.UploadBytes;
+            Allocations += sample.Allocations;
+            Draws += sample.DrawCalls;
+            Last = sample;
+            Count++;
+        }
+    };
+
+    struct TimeStats
+    {
+        double Average;
+        double P99;
+        double Max;
+    };
+
+    /** milliseconds from a histogram of microseconds */
+    TimeStats timeStats(const ogle::HdrHistogram& histogram)
+    {
+        TimeStats stats = { 0.0, 0.0, 0.0 };
+        if (histogram.count() == 0)
+            return stats;
+        stats.Average = histogram.mean() * 0.001;
+        stats.P99 = histogram.valueAtPercentile(99.0) * 0.001;
+        stats.Max = histogram.max() * 0.001;
+        return stats;
+    }
+
+    void printHeader()
+    {
+        cout << setw(10) << "frame" << setw(9) << "fps"
+             << setw(22) << "cpu ms avg/p99/max" << setw(22) << "gpu ms avg/p99/max"
+             << setw(13) << "upload MB/s" << setw(9) << "gpu MB" << setw(10) << "resid MB"
+             << setw(9) << "allocs" << setw(8) << "draws" << setw(7) << "lost" << endl;
+    }
+
+    void printAggregate(const Aggregate& aggregate)
+    {
+        if (aggregate.Count == 0) {
+            if (aggregate.Lost > 0)
+                cout << "lost " << aggregate.Lost << " samples" << endl;
+            return;
+        }
+
+        TimeStats cpu_stats = timeStats(aggregate.Cpu);
+        TimeStats gpu_stats = timeStats(aggregate.Gpu);
+
+        // the first sample's frame started before the span covered by the time stamps
+        const ogle::TelemetrySample& last = aggregate.Last;
+        double seconds = last.Time - aggregate.FirstTime;
+        double fps = seconds > 0.0 ? (aggregate.Count - 1) / seconds : 0.0;
+
+        cout << fixed << setprecision(2)
+             << setw(10) << last.Frame << setw(9) << setprecision(1) << fps << setprecision(2)
+             << setw(8) << cpu_stats.Average << setw(7) << cpu_stats.P99 << setw(7) << cpu_stats.Max
+             << setw(8) << gpu_stats.Average << setw(7) << gpu_stats.P99 << setw(7) << gpu_stats.Max
+             << setw(13) << (seconds > 0.0 ? aggregate.Upload / MB / seconds : 0.0)
+             << setw(9) << last.GpuMemoryBytes / MB << setw(10) << last.ResidentBytes / MB
+             << setw(9) << setprecision(1) << aggregate.Allocations / aggregate.Count
+             << setw(8) << aggregate.Draws / aggregate.Count << setw(7) << aggregate.Lost << endl;
+        cout.unsetf(ios::floatfield);
+    }
+
+    void printSample(const ogle::TelemetrySample& sample)
+    {
+        cout << fixed << setprecision(3)
+             << setw(10) << sample.Frame << setw(12) << sample.Time
+             << setw(9) << sample.CpuMilliseconds << setw(9) << sample.GpuMilliseconds
+             << setw(12) << sample.UploadBytes << setw(12) << sample.GpuMemoryBytes
+             << setw(12) << sample.ResidentBytes << setw(8) << sample.Allocations
+             << setw(8) << sample.DrawCalls << endl;
+        cout.unsetf(ios::floatfield);
+    }
+
+    /** the default named segment of the one live writer, empty while there is none */
+    string findWriter()
+    {
+        vector<string> live;
+        for (const auto& name : ogle::TelemetryReader::segments()) {
+            ogle::TelemetryReader reader;
+            if (reader.open(name) && reader.writerAlive())
+                live.push_back(name);
+        }
+        if (live.size() > 1) {
+            cerr << "several processes write telemetry, pass one of them:" << endl;
+            for (const auto& name : live)
+                cerr << "\t" << name << endl;
+            exit( EXIT_FAILURE );
+        }
+        return live.empty() ? string() : live.front();
+    }
+
+    void stop(int)
+    {
+        Stop = 1;
+    }
+
+    void usage()
+    {
+        cerr << "usage: telemetry_tail [--interval 1.0] [--all] [--raw] [segment | pid]" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            Interval = max(0.01, atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--all") == 0) {
+            FromOldest = true;
+        }
+        else if (strcmp(argv[i], "--raw") == 0) {
+            Raw = true;
+        }
+        else if (argv[i][0] == '/') {
+            Segment = argv[i];
+        }
+        else if (strspn(argv[i], "0123456789") == strlen(argv[i])) {
+            Segment = ogle::Telemetry::defaultName(atoll(argv[i]));
+        }
+        else {
+            usage();
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    ogle::TelemetryReader reader;
+    // only the samples read since the last poll are kept, the aggregates don't grow
+    vector<ogle::TelemetrySample> samples;
+    Aggregate interval;
+    Aggregate run;
+    bool waiting = false;
+
+    // polls the ring, the writer never waits on this side so sleeping is all there is to do
+    const chrono::milliseconds poll(10);
+    chrono::steady_clock::time_point next_print = chrono::steady_clock::now();
+    while (!Stop) {
+        if (!reader.opened()) {
+            string segment = Segment.empty() ? findWriter() : Segment;
+            if (segment.empty() || !reader.open(segment, FromOldest)) {
+                if (!waiting)
+                    cout << "waiting for a writer on " << (Segment.empty() ? string(ogle::Telemetry::DefaultName) + ".<pid>" : Segment) << endl;
+                waiting = true;
+                this_thread::sleep_for(chrono::milliseconds(200));
+                continue;
+            }
+            waiting = false;
+            cout << "reading " << reader.header()->Program << " (pid " << reader.header()->WriterPid << "), "
+                 << reader.header()->Capacity << " samples in the ring" << endl;
+            if (Raw)
+                cout << setw(10) << "frame" << setw(12) << "time s" << setw(9) << "cpu ms" << setw(9) << "gpu ms"
+                     << setw(12) << "upload B" << setw(12) << "gpu B" << setw(12) << "resident B"
+                     << setw(8) << "allocs" << setw(8) << "draws" << endl;
+            else
+                printHeader();
+            next_print = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(Interval));
+        }
+
+        samples.clear();
+        uint64_t lost = reader.read(samples);
+        interval.Lost += lost;
+        run.Lost += lost;
+        for (const auto& sample : samples) {
+            if (Raw)
+                printSample(sample);
+            interval.add(sample);
+            run.add(sample);
+        }
+
+        bool alive = reader.writerAlive();
+        if (!alive || chrono::steady_clock::now() >= next_print) {
+            if (!Raw)
+                printAggregate(interval);
+            interval.clear();
+            next_print += chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(Interval));
+        }
+
+        if (!alive) {
+            cout << "writer went away" << endl;
+            reader.close();
+            FromOldest = true;
+            continue;
+        }
+        this_thread::sleep_for(poll);
+    }
+
+    samples.clear();
+    run.Lost += reader.read(samples);
+    for (const auto& sample : samples)
+        run.add(sample);
+    if (run.Count > 0) {
+        cout << "\nwhole run, " << run.Count << " samples:" << endl;
+        printHeader();
+        printAggregate(run);
+    }
+    return 0;
+}